@@ -0,0 +1,92 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ili9488_dma.h"
+#include "pixel_utils.h"
+
+namespace ili9488 {
+
+class ILI9488Transport;
+
+struct BandPipelineStats {
+    uint64_t frames = 0;
+    uint64_t bands = 0;
+    // Last frame: present() entry until the first band is handed to the bus,
+    // and until the last band has been sent.
+    uint64_t first_band_ns = 0;
+    uint64_t frame_ns = 0;
+    // Time the converting thread spent waiting for a free band buffer, i.e.
+    // how far conversion ran ahead of the wire.
+    uint64_t producer_wait_ns = 0;
+};
+
+// Converts and rotates an RGB888/RGBA8888 frame one band of output rows at a
+// time into a pair of small buffers. While one band is being converted the
+// other is on the bus, so the first pixels leave after one band instead of a
+// full convert + rotate pass, and the working set stays at a few band sizes.
+class BandPipeline {
+public:
+    static constexpr uint32_t kDefaultBandRows = 32;
+
+    explicit BandPipeline(ILI9488Transport& transport, uint32_t band_rows = kDefaultBandRows,
+                          pixel::DitherMode dither = pixel::DitherMode::None);
+    ~BandPipeline();
+
+    // src is width x height in source orientation; rotated by rotation_degrees
+    // it must cover the transport window. stride 0 means tightly packed.
+    bool present(const uint8_t* src, InputFormat format, size_t src_stride, int rotation_degrees);
+
+    uint32_t bandRows() const { return band_rows_; }
+    // The dither pattern is anchored to source frame coordinates.
+    void setDitherMode(pixel::DitherMode mode) { dither_ = mode; }
+    pixel::DitherMode ditherMode() const { return dither_; }
+    size_t workingSetBytes() const;
+    BandPipelineStats stats() const;
+    void resetStats();
+
+private:
+    struct Band {
+        size_t slot;
+        size_t bytes;
+    };
+
+    void fillBand(uint8_t* out, uint32_t y0, uint32_t rows);
+    void senderLoop();
+
+    ILI9488Transport& transport_;
+    uint32_t band_rows_;
+    pixel::DitherMode dither_;
+
+    const uint8_t* src_;
+    InputFormat format_;
+    size_t src_stride_;
+    size_t src_bpp_;
+    uint32_t src_width_;
+    uint32_t src_height_;
+    uint32_t out_width_;
+    int rotation_;
+
+    std::vector<uint8_t> buffers_[2];
+    std::vector<uint8_t> scratch_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable band_ready_;
+    std::condition_variable band_done_;
+    std::deque<Band> pending_;
+    bool busy_[2];
+    bool sending_;
+    bool failed_;
+    bool running_;
+    bool first_band_pending_;
+    uint64_t frame_start_ns_;
+    BandPipelineStats stats_;
+    std::thread sender_;
+};
+
+}
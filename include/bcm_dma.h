@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ili9488 {
+
+struct DmaControlBlock {
+    uint32_t transfer_info;
+    uint32_t source_addr;
+    uint32_t dest_addr;
+    uint32_t transfer_length;
+    uint32_t stride;
+    uint32_t next_cb;
+    uint32_t reserved[2];
+};
+
+namespace dma {
+
+constexpr uint32_t kBusAddressMask = 0x3FFFFFFF;
+
+constexpr uint32_t kTiInterruptEnable = 1 << 0;
+constexpr uint32_t kTiTdMode = 1 << 1;
+constexpr uint32_t kTiWaitResp = 1 << 3;
+constexpr uint32_t kTiDestInc = 1 << 4;
+constexpr uint32_t kTiDestDreq = 1 << 6;
+constexpr uint32_t kTiSrcInc = 1 << 8;
+constexpr uint32_t kTiSrcDreq = 1 << 10;
+constexpr uint32_t kTiPermapShift = 16;
+constexpr uint32_t kTiNoWideBursts = 1 << 26;
+
+constexpr uint32_t kMaxXLength = 0xFFFF;
+constexpr uint32_t kMaxYLength = 0x3FFF;
+
+inline uint32_t TransferLength2d(uint32_t xlength, uint32_t ylength) {
+    return ((ylength - 1) << 16) | (xlength & 0xFFFF);
+}
+
+inline uint32_t Stride2d(int32_t src_stride, int32_t dst_stride) {
+    return (static_cast<uint32_t>(static_cast<uint16_t>(dst_stride)) << 16) |
+           static_cast<uint32_t>(static_cast<uint16_t>(src_stride));
+}
+
+inline bool StrideFits(int64_t stride) {
+    return stride >= -32768 && stride <= 32767;
+}
+
+class MemoryModel {
+public:
+    void map(uint32_t bus_addr, void* cpu_addr, size_t size);
+    void clear();
+    uint8_t* translate(uint32_t bus_addr, size_t length) const;
+
+private:
+    struct Region {
+        uint32_t bus_addr;
+        uint8_t* cpu_addr;
+        size_t size;
+    };
+    std::vector<Region> regions_;
+};
+
+struct RunStats {
+    size_t control_blocks = 0;
+    size_t bytes_transferred = 0;
+};
+
+bool RunControlBlockChain(const MemoryModel& memory, uint32_t first_cb_bus_addr,
+                          RunStats* stats = nullptr);
+
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ili9488 {
+
+constexpr uint32_t kBufferExportVersion = 1;
+constexpr uint32_t kBufferExportCount = 3;
+constexpr uint32_t kBufferExportDmaBuf = 1U << 0;
+constexpr const char* kDefaultExportSocket = "/run/ili9488-daemon.sock";
+
+// Sent once per connection; the buffer fds travel as SCM_RIGHTS ancillary
+// data in the same message, in slot order.
+struct BufferExportInfo {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_pixel;
+    uint32_t stride;
+    uint32_t buffer_size;
+    uint32_t buffer_count;
+    uint32_t flags;
+    uint32_t bus_addr[kBufferExportCount];
+};
+
+bool SendExportedBuffers(int socket_fd, const BufferExportInfo& info, const int* fds);
+bool ReceiveExportedBuffers(int socket_fd, BufferExportInfo* info, int* fds);
+int ConnectBufferExport(const std::string& path);
+
+bool DmaBufBeginCpuAccess(int dmabuf_fd, bool write);
+bool DmaBufEndCpuAccess(int dmabuf_fd, bool write);
+
+class BufferExportServer {
+public:
+    BufferExportServer();
+    ~BufferExportServer();
+
+    bool start(const std::string& path, const BufferExportInfo& info, const int* fds);
+    void stop();
+    void poll();
+    bool clientConnected() const { return client_fd_ >= 0; }
+    int listenFd() const { return listen_fd_; }
+
+private:
+    void dropClient();
+
+    std::string path_;
+    int listen_fd_;
+    int client_fd_;
+    BufferExportInfo info_;
+    int fds_[kBufferExportCount];
+};
+
+}
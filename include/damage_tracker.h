@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "spi_dma_linux.h"
+
+namespace ili9488 {
+
+class WorkerPool;
+
+struct DamageStats {
+    uint64_t frames = 0;
+    uint64_t tiles_scanned = 0;
+    uint64_t tiles_dirty = 0;
+    uint64_t bytes_total = 0;
+    uint64_t bytes_dirty = 0;
+
+    uint64_t bytesSaved() const {
+        return bytes_total > bytes_dirty ? bytes_total - bytes_dirty : 0;
+    }
+};
+
+Rect RotateRect(const Rect& rect, uint32_t src_width, uint32_t src_height, int rotation_degrees);
+
+class DamageTracker {
+public:
+    static constexpr uint32_t kDefaultTileSize = 32;
+
+    DamageTracker();
+    void configure(uint32_t width, uint32_t height, size_t bytes_per_pixel,
+                   uint32_t tile_size = kDefaultTileSize);
+    void invalidate();
+    size_t detect(const uint8_t* frame, size_t stride, std::vector<Rect>& out_rects);
+    // detect() in steps, for callers that already walk the frame in bands:
+    // hashRows() for every band (y0 a multiple of tileSize(); distinct bands
+    // may be hashed concurrently), then markDirty() for areas that change
+    // without showing up in the hashed frame, then finish().
+    void hashRows(const uint8_t* frame, size_t stride, uint32_t y0, uint32_t y1);
+    void markDirty(const Rect& rect);
+    size_t finish(std::vector<Rect>& out_rects);
+    const DamageStats& stats() const { return stats_; }
+    void resetStats() { stats_ = DamageStats{}; }
+    uint32_t tileSize() const { return tile_size_; }
+    // Rows of tiles are hashed in parallel on the pool; nullptr hashes on the
+    // caller.
+    void setWorkerPool(WorkerPool* pool) { pool_ = pool; }
+
+private:
+    uint64_t hashTile(const uint8_t* tile, size_t stride, uint32_t tile_w, uint32_t tile_h) const;
+    void hashTileRows(const uint8_t* frame, size_t stride, uint32_t ty_begin, uint32_t ty_end);
+    void collectRects(std::vector<Rect>& out_rects) const;
+
+    uint32_t width_;
+    uint32_t height_;
+    size_t bytes_per_pixel_;
+    uint32_t tile_size_;
+    uint32_t tiles_x_;
+    uint32_t tiles_y_;
+    bool valid_;
+    std::vector<uint64_t> tile_hashes_;
+    std::vector<uint8_t> tile_dirty_;
+    DamageStats stats_;
+    WorkerPool* pool_;
+};
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spi_dma_linux.h"
+
+namespace ili9488 {
+
+constexpr uint32_t kRecordingMagic = 0x31434552;  // "REC1"
+constexpr uint32_t kRecordingVersion = 1;
+// Granularity of the delta against the previous frame.
+constexpr size_t kRecordingBlockBytes = 32;
+// Frames copied by append() and not yet written before further frames are
+// dropped.
+constexpr size_t kRecordingQueueFrames = 4;
+
+// File layout, all fields little-endian:
+//   RecordingHeader
+//   per frame: RecordedFrame, rect_count Rects, then span_count spans of
+//   { uint32_t offset; uint32_t length; uint8_t bytes[length] } that replace
+//   the same bytes of the previous frame (the first frame is one full span).
+// frame_count is patched in when the recorder closes; readers scan the frames
+// and ignore a truncated tail, so a recording from a killed daemon still plays.
+struct RecordingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_pixel;
+    uint32_t frame_count;
+};
+
+struct RecordedFrame {
+    uint64_t timestamp_ns;  // since the first frame
+    uint32_t sequence;      // client publish sequence or frame_counter
+    uint32_t rect_count;    // damage rectangles, 0 when unknown
+    uint32_t span_count;
+    uint32_t payload_bytes; // spans including their headers
+};
+
+// Appends packed frames to a recording. append() only copies the frame into
+// one of kRecordingQueueFrames slots; a writer thread computes the delta and
+// does the write(2) calls, so a slow disk never stalls the caller. When every
+// slot is taken the frame is dropped and counted, and the next recorded frame
+// is still a valid delta against the last one written.
+class FrameRecorder {
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    bool open(const std::string& path, uint32_t width, uint32_t height, size_t bytes_per_pixel);
+    bool append(const uint8_t* frame, uint64_t timestamp_ns, uint32_t sequence, const Rect* rects,
+                size_t rect_count);
+    // Writes out queued frames, patches the header and closes the file.
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+    uint32_t frameCount() const { return frame_count_.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return bytes_written_.load(std::memory_order_relaxed); }
+    uint64_t droppedFrames() const { return dropped_frames_.load(std::memory_order_relaxed); }
+
+private:
+    struct PendingFrame {
+        std::vector<uint8_t> pixels;
+        std::vector<Rect> rects;
+        uint64_t timestamp_ns = 0;
+        uint32_t sequence = 0;
+    };
+
+    void writerLoop();
+    bool writeFrame(const PendingFrame& frame);
+
+    int fd_;
+    RecordingHeader header_;
+    size_t frame_bytes_;
+    uint64_t first_timestamp_ns_;
+    std::atomic<uint32_t> frame_count_;
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> dropped_frames_;
+    std::vector<uint8_t> previous_;
+    std::vector<uint8_t> record_;
+
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::deque<PendingFrame> queue_;
+    std::vector<PendingFrame> free_;
+    size_t slots_in_use_;
+    bool stopping_;
+    bool failed_;
+    std::thread writer_;
+};
+
+struct PlaybackFrame {
+    const uint8_t* pixels;  // packed, valid until the next call to next()
+    uint64_t timestamp_ns;
+    uint32_t sequence;
+    const Rect* rects;
+    size_t rect_count;
+};
+
+// Plays a recording from a read-only mapping, applying each frame's spans to
+// a working frame.
+class FramePlayer {
+public:
+    FramePlayer();
+    ~FramePlayer();
+
+    bool open(const std::string& path);
+    void close();
+    bool next(PlaybackFrame* frame);
+    void rewind();
+
+    uint32_t width() const { return header_.width; }
+    uint32_t height() const { return header_.height; }
+    size_t bytesPerPixel() const { return header_.bytes_per_pixel; }
+    size_t frameCount() const { return frame_offsets_.size(); }
+
+private:
+    const uint8_t* map_;
+    size_t map_size_;
+    RecordingHeader header_;
+    std::vector<size_t> frame_offsets_;
+    size_t next_frame_;
+    std::vector<uint8_t> frame_;
+    std::vector<Rect> rects_;
+};
+
+}
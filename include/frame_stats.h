@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace ili9488 {
+
+constexpr const char* kDefaultStatsSocket = "/run/ili9488-stats.sock";
+constexpr const char* kDefaultStatsFile = "/tmp/ili9488_stats.txt";
+constexpr uint32_t kDefaultStatsIntervalMs = 1000;
+
+// CLOCK_MONOTONIC in nanoseconds, the clock clients stamp publish_ns with.
+uint64_t MonotonicNs();
+
+// Log-linear histogram of nanosecond values: exact below 32 ns, then 16
+// buckets per power of two (at most 6.25% relative error) up to ~18 minutes.
+// record() is a handful of relaxed atomic adds and safe from any thread.
+class LatencyHistogram {
+public:
+    static constexpr uint32_t kSubBucketBits = 4;
+    static constexpr uint32_t kSubBuckets = 1U << kSubBucketBits;
+    static constexpr uint32_t kMaxBits = 40;
+    static constexpr size_t kBucketCount = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t p50_ns = 0;
+        uint64_t p99_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t mean_ns = 0;
+    };
+
+    void record(uint64_t ns);
+    // Percentiles report the upper edge of the bucket they fall in. Readers
+    // race with writers, so a summary may miss samples recorded meanwhile.
+    Summary summarize() const;
+
+    static size_t BucketIndex(uint64_t ns);
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> buckets_[kBucketCount] {};
+    std::atomic<uint64_t> count_ {0};
+    std::atomic<uint64_t> sum_ {0};
+    std::atomic<uint64_t> max_ {0};
+};
+
+enum class FrameStage {
+    PostToAcquire,  // client publish_ns -> frame taken (protocol v2 only)
+    Acquire,        // frame slot / pending semaphore taken
+    Ingest,         // copy or convert into the DMA buffer
+    Overlay,        // FPS overlay drawn
+    Damage,         // damage detection outside the ingest pass
+    RotateCpu,
+    RotateDma,
+    FenceWait,      // waiting for the previous transmit before queueing
+    TransmitQueue,  // queued -> transmit thread picks it up
+    Transmit,       // SPI transmit start -> end
+    Frame,          // frame taken -> transmit end
+    PostToScanout,  // client publish_ns -> transmit end (protocol v2 only)
+    PaceLate,       // max_fps deadline -> loop woken by the pacing timer
+    Count
+};
+
+const char* FrameStageName(FrameStage stage);
+
+enum class FrameCounter {
+    Frames,
+    Dropped,
+    TransmitFailures,
+    TilesScanned,
+    TilesDirty,
+    BytesSaved,
+    Count
+};
+
+const char* FrameCounterName(FrameCounter counter);
+
+class FrameStats {
+public:
+    static constexpr size_t kStageCount = static_cast<size_t>(FrameStage::Count);
+    static constexpr size_t kCounterCount = static_cast<size_t>(FrameCounter::Count);
+
+    void record(FrameStage stage, uint64_t ns) { stages_[static_cast<size_t>(stage)].record(ns); }
+    void recordSince(FrameStage stage, uint64_t start_ns) {
+        const uint64_t now = MonotonicNs();
+        record(stage, now > start_ns ? now - start_ns : 0);
+    }
+    void add(FrameCounter counter, uint64_t n = 1) {
+        counters_[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+    void set(FrameCounter counter, uint64_t value) {
+        counters_[static_cast<size_t>(counter)].store(value, std::memory_order_relaxed);
+    }
+    // Counts the frames a client published but the daemon never took, from
+    // gaps in its publish sequence (protocol v2) or frame_counter (v1).
+    // Called from the ingest thread only.
+    void observeSequence(uint32_t sequence);
+
+    const LatencyHistogram& stage(FrameStage stage) const { return stages_[static_cast<size_t>(stage)]; }
+    uint64_t counter(FrameCounter counter) const {
+        return counters_[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    // Plain-text snapshot: counters as "name value" lines, then one
+    // "stage count p50_us p99_us max_us mean_us" line per stage with samples.
+    std::string format(double fps) const;
+
+private:
+    LatencyHistogram stages_[kStageCount];
+    std::atomic<uint64_t> counters_[kCounterCount] {};
+    uint32_t last_sequence_ = 0;
+    bool have_sequence_ = false;
+};
+
+// Publishes snapshots off the hot path: a thread answers each connection to
+// the Unix socket with the current snapshot and rewrites the text file every
+// interval (through a temporary file and rename, so readers never see half a
+// snapshot). Either path may be empty.
+class StatsReporter {
+public:
+    explicit StatsReporter(const FrameStats& stats);
+    ~StatsReporter();
+
+    bool start(const std::string& socket_path, const std::string& file_path, uint32_t interval_ms);
+    void stop();
+
+private:
+    void run();
+    void writeFile(const std::string& text) const;
+
+    const FrameStats& stats_;
+    std::string socket_path_;
+    std::string file_path_;
+    uint32_t interval_ms_;
+    int listen_fd_;
+    int wake_fd_;
+    std::thread thread_;
+};
+
+}
@@ -1,9 +1,13 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "pixel_utils.h"
+
 namespace ili9488 {
 
 enum class Rotation {
@@ -23,6 +27,11 @@ enum class OutputFormat {
     Rgb565
 };
 
+enum class BusBackend {
+    Spidev,
+    Simulator
+};
+
 struct DisplayConfig {
     uint32_t width;
     uint32_t height;
@@ -33,14 +42,28 @@ struct DisplayConfig {
     std::string spi_device = "/dev/spidev0.0";
     int dc_gpio = 24;
     int reset_gpio = 25;
+    BusBackend bus_backend = BusBackend::Spidev;
+    bool simulator_realtime = true;
     Rotation rotation;
+    bool panel_rotation = false;
     OutputFormat output_format = OutputFormat::Rgb666;
+    // Applied when presentFrame() truncates RGB888/RGBA8888 input.
+    pixel::DitherMode dither = pixel::DitherMode::None;
     bool use_double_buffer = true;
     bool use_gpu_mailbox = true;
+    bool use_direct_spi_dma = false;
 };
 
 class ILI9488Transport;
 class ILI9488Framebuffer;
+struct DmaBuffer;
+struct Rect;
+struct PresentQueue;
+class SimulatorBus;
+class BandPipeline;
+class FrameStats;
+
+using PresentCallback = std::function<void(uint64_t fence, uint32_t tag, bool ok)>;
 namespace gpu {
 class ILI9488Rotate;
 }
@@ -58,18 +81,50 @@ public:
     void swapBuffers();
     bool isUsingGpuMailbox() const;
     bool rotateFrameGpu(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height, int rotation_degrees);
+
+    uint64_t presentAsync(const uint8_t* buffer, uint32_t tag = 0);
+    // Sends only the given rects; count == 0 sends nothing, but the fence
+    // and callback still complete in order.
+    uint64_t presentRegionsAsync(const uint8_t* buffer, size_t stride, const Rect* rects, size_t count,
+                                 uint32_t tag = 0);
+    // Converts an RGB888/RGBA8888 frame band by band while earlier bands are
+    // on the bus. Waits for queued presents first; returns once sent.
+    bool presentFrame(const uint8_t* pixels, InputFormat format, int rotation_degrees = 0,
+                      size_t stride = 0);
+    bool waitFence(uint64_t fence, uint32_t timeout_ms = 0);
+    bool fenceSignaled(uint64_t fence) const;
+    uint64_t lastPresentedFence() const;
+    void setPresentCallback(PresentCallback callback);
+    void mirrorFences(volatile uint32_t* submitted, volatile uint32_t* completed);
+    // Records the transmit_queue and transmit stages of every present;
+    // nullptr (the default) disables it.
+    void setFrameStats(FrameStats* stats);
+    // SCHED_FIFO priority (0 keeps CFS) and CPU set for the transmit thread.
+    bool setTransmitThreadPolicy(int rt_priority, const std::vector<int>& cpus);
     ILI9488Framebuffer* getFramebuffer() { return gpu_.get(); }
     ILI9488Transport* getTransport() { return spi_.get(); }
     gpu::ILI9488Rotate* getRotator() { return gpu_rotate_.get(); }
+    SimulatorBus* getSimulator() { return simulator_; }
 
 private:
     size_t bytesPerPixel() const;
     void writeFrameDma(const uint8_t* buf);
     void writeFrameDmaFromBusAddr(uint32_t bus_addr, size_t size);
+    bool transmitFullFrame(const uint8_t* buffer);
+    uint64_t queuePresent(const uint8_t* buffer, size_t stride, const Rect* rects, size_t count, bool full_frame,
+                          uint32_t tag);
+    void startTransmitThread();
+    void stopTransmitThread();
+    void transmitLoop();
     DisplayConfig config_;
     std::unique_ptr<ILI9488Transport> spi_;
     std::unique_ptr<ILI9488Framebuffer> gpu_;
     std::unique_ptr<gpu::ILI9488Rotate> gpu_rotate_;
+    std::unique_ptr<DmaBuffer> rotate_cb_buffer_;
+    std::unique_ptr<DmaBuffer> spi_cb_buffer_;
+    std::unique_ptr<PresentQueue> present_queue_;
+    std::unique_ptr<BandPipeline> band_pipeline_;
+    SimulatorBus* simulator_;
     std::vector<uint8_t> backBuffer_;
     std::vector<uint8_t> frontBuffer_;
     bool zero_copy_mode_;
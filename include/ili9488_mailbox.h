@@ -1,6 +1,7 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <semaphore.h>
@@ -31,14 +32,23 @@ struct TripleBufferShmHeader {
     volatile uint32_t daemon_ready;
     volatile uint32_t app_connected;
 
-    uint8_t padding[64];
+    uint32_t control_offset;
+    volatile uint32_t client_version;
+    uint32_t features;
+    volatile uint32_t present_fence;
+    volatile uint32_t complete_fence;
+    volatile uint32_t scanout_sequence;
+    uint8_t padding[40];
 };
 
+struct TripleBufferControlV2;
+
 struct DmaBuffer {
     void* user_ptr = nullptr;
     uint32_t bus_addr = 0;
     uint32_t handle = 0;
     size_t size = 0;
+    int dmabuf_fd = -1;
 };
 
 class ILI9488Framebuffer {
@@ -46,13 +56,14 @@ public:
     ILI9488Framebuffer();
     ~ILI9488Framebuffer();
 
-    bool initialize(uint32_t width, uint32_t height, bool enable_mailbox);
+    bool initialize(uint32_t width, uint32_t height, bool enable_mailbox, size_t bytes_per_pixel = 3);
     uint8_t* backBuffer();
     uint8_t* frontBuffer();
     uint8_t* pendingBuffer();
     void swapBuffers();
     void rotateBuffers();
     size_t bufferSize() const;
+    size_t bytesPerPixel() const;
     bool usingMailbox() const;
 
     bool createTripleBufferSharedMemory(
@@ -69,11 +80,23 @@ public:
     void swapBackAndFront();
 
     uint8_t* getShmPendingBuffer();
+    uint8_t* getShmBuffer(uint32_t slot);
+    TripleBufferControlV2* getSharedControl();
+
+    uint8_t* getBuffer(uint32_t index);
+    int exportBufferFd(uint32_t index) const;
+    bool buffersAreDmaBufs() const;
     void cleanupSharedMemory();
 
     uint32_t backBufferBusAddr() const;
     uint32_t frontBufferBusAddr() const;
     uint32_t pendingBufferBusAddr() const;
+    // Bus address of a pointer into one of the three frame buffers, or 0.
+    uint32_t busAddressOf(const uint8_t* ptr) const;
+    uint32_t bufferBusAddr(uint32_t index) const;
+    // Called before the frame buffers are unmapped, so cached views of them
+    // can be dropped.
+    void setReleaseListener(std::function<void()> listener);
 
     bool allocateDmaBuffer(size_t size, DmaBuffer& out_buffer);
     void freeDmaBuffer(DmaBuffer& buffer);
@@ -85,6 +108,8 @@ private:
     bool allocateMailboxBuffers();
     bool allocateCmaBuffers();
     bool allocateCpuBuffers();
+    void releaseCpuBuffers();
+    bool allocateCmaDmaBuffer(size_t size, DmaBuffer& out_buffer);
     void releaseMailboxBuffers();
     void releaseCmaBuffers();
     bool openMailboxDevice();
@@ -95,9 +120,11 @@ private:
     bool mailboxUnlock(uint32_t handle);
     bool mailboxRelease(uint32_t handle);
     void* mapBusAddress(uint32_t bus_addr, size_t size);
+    void notifyRelease();
 
     uint32_t width_;
     uint32_t height_;
+    size_t bytes_per_pixel_;
     size_t buffer_size_;
     bool use_mailbox_;
 
@@ -115,7 +142,8 @@ private:
     int vcsm_fd_;
     uint32_t vcsm_handle_[3];
 
-    std::vector<uint8_t> cpu_buffers_[3];
+    int memfd_[3];
+    void* cpu_map_[3];
     int front_index_;
     int back_index_;
     int pending_index_;
@@ -123,8 +151,10 @@ private:
     TripleBufferShmHeader* triple_buffer_header_;
     int triple_buffer_shm_fd_;
     uint8_t* triple_buffer_base_;
+    TripleBufferControlV2* triple_buffer_control_;
     size_t triple_buffer_total_size_;
     std::string shm_name_;
+    std::function<void()> release_listener_;
 };
 
 }
@@ -2,13 +2,31 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "bcm_dma.h"
+
 namespace ili9488::gpu {
 
+size_t RotationControlBlockCount(uint32_t height, int rotation_degrees);
+
+size_t BuildRotationControlBlocks(
+    DmaControlBlock* cbs, size_t max_cbs, uint32_t cb_bus_addr,
+    uint32_t src_bus_addr, uint32_t dst_bus_addr,
+    uint32_t width, uint32_t height, size_t bytes_per_pixel,
+    int rotation_degrees);
+
+bool SimulateDmaRotation(
+    const uint8_t* src, uint8_t* dst,
+    uint32_t width, uint32_t height, size_t bytes_per_pixel,
+    int rotation_degrees);
+
 class ILI9488Rotate {
 public:
     ILI9488Rotate();
     ~ILI9488Rotate();
     bool initialize(bool enable_dma = true);
+    void setControlBlockMemory(void* cpu_addr, uint32_t bus_addr, size_t size);
+    // Pixel size moved by each control block; 2 for RGB565 frames.
+    void setBytesPerPixel(size_t bytes_per_pixel);
     bool rotateRgb666DmaMode(
         const uint8_t* src, uint32_t src_bus_addr,
         uint8_t* dst, uint32_t dst_bus_addr,
@@ -32,6 +50,16 @@ private:
     int dma_channel_;
     void* dma_regs_map_;
     volatile uint32_t* dma_regs_;
+    DmaControlBlock* cb_mem_;
+    uint32_t cb_bus_addr_;
+    size_t cb_capacity_;
+    size_t cb_count_;
+    uint32_t chain_src_bus_addr_;
+    uint32_t chain_dst_bus_addr_;
+    uint32_t chain_width_;
+    uint32_t chain_height_;
+    int chain_rotation_;
+    size_t bytes_per_pixel_;
 };
 
 }
@@ -0,0 +1,127 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "spi_bus.h"
+
+namespace ili9488 {
+
+constexpr uint32_t kPanelNativeWidth = 320;
+constexpr uint32_t kPanelNativeHeight = 480;
+
+struct PanelStats {
+    uint64_t commands = 0;
+    uint64_t parameter_bytes = 0;
+    uint64_t memory_writes = 0;
+    uint64_t pixels_written = 0;
+    uint64_t clipped_pixels = 0;
+    uint64_t stray_bytes = 0;
+    uint64_t hardware_resets = 0;
+};
+
+// Software model of the ILI9488 controller as seen over 4-wire SPI. Decodes
+// the command stream, keeps a 320x480 GRAM and applies MADCTL addressing and
+// the COLMOD pixel format to memory writes.
+//
+// GRAM is stored in controller order. pixel() and writePpm() render it as
+// seen on the common 3.5" modules, whose source driver is wired mirrored and
+// whose filter is BGR, so the driver's MADCTL values (0x48 upright) produce an
+// upright image.
+class PanelSimulator {
+public:
+    PanelSimulator();
+
+    // Hardware reset: registers return to their power-on values, GRAM keeps
+    // its contents.
+    void reset();
+    void command(uint8_t command);
+    void data(const uint8_t* data, size_t length);
+
+    uint8_t madctl() const { return madctl_; }
+    uint8_t pixelFormat() const { return colmod_; }
+    bool sleeping() const { return sleeping_; }
+    bool displayOn() const { return display_on_; }
+    bool inverted() const { return inverted_; }
+    bool idle() const { return idle_; }
+    const std::vector<uint8_t>& registerValue(uint8_t command) const { return registers_[command]; }
+    const PanelStats& stats() const { return stats_; }
+
+    // Visible pixel at (x, y) in native portrait coordinates as 0xRRGGBB.
+    uint32_t pixel(uint32_t x, uint32_t y) const;
+    bool writePpm(const std::string& path) const;
+
+private:
+    void resetRegisters();
+    void beginMemoryWrite(bool restart);
+    void parameter(uint8_t value);
+    void writePixel(const uint8_t* bytes);
+    size_t bytesPerPixel() const;
+
+    std::vector<uint8_t> gram_;
+    std::array<std::vector<uint8_t>, 256> registers_;
+    PanelStats stats_;
+    uint8_t command_;
+    size_t parameter_index_;
+    bool writing_;
+    uint8_t madctl_;
+    uint8_t colmod_;
+    bool sleeping_;
+    bool display_on_;
+    bool inverted_;
+    bool idle_;
+    uint16_t column_start_;
+    uint16_t column_end_;
+    uint16_t page_start_;
+    uint16_t page_end_;
+    uint16_t column_;
+    uint16_t page_;
+    uint8_t pending_[3];
+    size_t pending_length_;
+};
+
+struct SimulatorConfig {
+    size_t bufsiz = 65536;
+    // SPI0 derives SCLK from the core clock with an even divider. When set,
+    // requested speeds are rounded down the same way; 0 clocks at the
+    // requested speed exactly.
+    uint32_t core_clock_hz = 0;
+    uint64_t message_overhead_ns = 0;
+    // Block in message() until the modeled transfer would have finished, so
+    // the daemon paces like real hardware.
+    bool realtime = false;
+};
+
+// SpiBus backend that feeds a PanelSimulator instead of spidev and keeps a
+// wire-time clock. Safe to inspect from another thread while a transmit
+// thread drives it.
+class SimulatorBus : public SpiBus {
+public:
+    explicit SimulatorBus(const SimulatorConfig& config = SimulatorConfig{});
+
+    bool message(const SpiSegment* segments, size_t count, uint32_t speed_hz) override;
+    bool setDataCommand(bool data) override;
+    bool setReset(bool high) override;
+    size_t maxMessageBytes() const override { return config_.bufsiz; }
+    size_t maxMessageSegments() const override { return kMaxSpiTransfersPerMessage; }
+
+    uint32_t effectiveSpeedHz(uint32_t speed_hz) const;
+    uint64_t wireTimeNs() const;
+    PanelSimulator snapshot() const;
+    bool writePpm(const std::string& path) const;
+
+private:
+    SimulatorConfig config_;
+    mutable std::mutex mutex_;
+    PanelSimulator panel_;
+    bool data_mode_;
+    bool reset_low_;
+    uint64_t wire_time_ns_;
+    std::chrono::steady_clock::time_point busy_until_;
+};
+
+}
@@ -1,17 +1,163 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+
+namespace ili9488 {
+class WorkerPool;
+}
 
 namespace ili9488::pixel {
 
+enum class SimdLevel {
+    Scalar,
+    Neon,
+    Ssse3,
+    Avx2
+};
+
+enum class DitherMode {
+    None,
+    Bayer4,
+    Bayer8,
+    BlueNoise
+};
+
+SimdLevel DetectSimdLevel();
+SimdLevel ActiveSimdLevel();
+bool SelectSimdLevel(SimdLevel level);
+const char* SimdLevelName(SimdLevel level);
+const char* DitherModeName(DitherMode mode);
+// Conversions and rotations of at least kParallelMinPixels are split into
+// bands across the pool. nullptr (the default) keeps them on the caller.
+constexpr size_t kParallelMinPixels = 32768;
+void SetWorkerPool(WorkerPool* pool);
+bool ParseDitherMode(const char* name, DitherMode* mode);
+
 void ConvertRgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count);
 void ConvertRgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count);
 void ConvertRgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count);
 void ConvertRgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+
+// Ordered dithering before truncation. The pixels are a run of one row that
+// starts at frame position (x, y); the pattern is anchored to frame
+// coordinates, so partial updates line up with full frames.
+void ConvertRgb888ToRgb666Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                   uint32_t x, uint32_t y, DitherMode mode);
+void ConvertRgba8888ToRgb666Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                     uint32_t x, uint32_t y, DitherMode mode);
+void ConvertRgb888ToRgb565Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                   uint32_t x, uint32_t y, DitherMode mode);
+void ConvertRgba8888ToRgb565Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                     uint32_t x, uint32_t y, DitherMode mode);
 void RotateRgb666(const uint8_t* src,
                   uint8_t* dst,
                   uint32_t width,
                   uint32_t height,
                   int rotation_degrees);
+// RGB565 pixels are two bytes, high byte first, as sent to the panel.
+void RotateRgb565(const uint8_t* src,
+                  uint8_t* dst,
+                  uint32_t width,
+                  uint32_t height,
+                  int rotation_degrees);
+// True when the active kernels include a 90/270 rotation built for exactly
+// this source frame size (320x480 and 480x320, the panel in either
+// orientation). RotateFrame and ComposeFrame pick it up automatically; other
+// sizes take the generic path.
+bool HasFixedRotation(uint32_t width, uint32_t height, size_t bytes_per_pixel, int rotation_degrees);
+// Dispatches to RotateRgb565 for 2 bytes per pixel, RotateRgb666 otherwise.
+void RotateFrame(const uint8_t* src,
+                 uint8_t* dst,
+                 uint32_t width,
+                 uint32_t height,
+                 size_t bytes_per_pixel,
+                 int rotation_degrees);
+
+// Source layout for ComposeFrame: already in the output format, or 8-bit
+// RGB/RGBA converted on the way.
+enum class SourceFormat {
+    Output,
+    Rgb888,
+    Rgba8888
+};
+
+// An opaque rectangle in source coordinates that replaces the frame pixels
+// under it. pixels is width x height in the output format, tightly packed.
+struct Overlay {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    const uint8_t* pixels;
+};
+
+// Called with each band of source rows [y0, y1) just before it is composed,
+// so another reader of the source (damage hashing) finds it in cache. With a
+// worker pool, different bands reach the hook from several threads at once.
+using BandHook = std::function<void(uint32_t y0, uint32_t y1)>;
+
+// Copy/convert, overlay and rotate in one pass: src (width x height, 0 stride
+// = packed) is read once and dst (packed, rotated) written once, band_rows
+// source rows at a time.
+bool ComposeFrame(const uint8_t* src, SourceFormat format, size_t src_stride, uint8_t* dst,
+                  uint32_t width, uint32_t height, size_t bytes_per_pixel, int rotation_degrees,
+                  const Overlay* overlay, uint32_t band_rows = 32, const BandHook& hook = BandHook());
+
+// RGB666 is three bytes with the colour in the top six bits of each, so it
+// can be read wherever RGB888 is accepted.
+enum class PixelFormat {
+    Rgb666,
+    Rgb565,
+    Rgb888,
+    Rgba8888
+};
+
+size_t BytesPerPixel(PixelFormat format);
+
+// width x height pixels whose rows start stride bytes apart. The rows may be
+// padded (stride > width * bpp) or be a window into a larger buffer.
+struct ImageView {
+    uint8_t* data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;
+    PixelFormat format = PixelFormat::Rgb666;
+};
+
+struct ConstImageView {
+    const uint8_t* data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;
+    PixelFormat format = PixelFormat::Rgb666;
+
+    ConstImageView() = default;
+    ConstImageView(const uint8_t* data, uint32_t width, uint32_t height, size_t stride, PixelFormat format)
+        : data(data), width(width), height(height), stride(stride), format(format) {}
+    ConstImageView(const ImageView& view)
+        : data(view.data), width(view.width), height(view.height), stride(view.stride), format(view.format) {}
+};
+
+// stride 0 means tightly packed rows.
+ImageView MakeView(uint8_t* data, uint32_t width, uint32_t height, PixelFormat format, size_t stride = 0);
+ConstImageView MakeView(const uint8_t* data, uint32_t width, uint32_t height, PixelFormat format,
+                        size_t stride = 0);
+// The part of view inside (x, y, width, height); empty when they do not meet.
+ImageView SubView(const ImageView& view, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+ConstImageView SubView(const ConstImageView& view, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+// Copies src into dst of the same size, converting RGB888/RGB666/RGBA8888 to
+// RGB666 or RGB565 on the way. (dither_x, dither_y) is the frame position of
+// the views' top-left pixel, which anchors the dither pattern.
+bool ConvertView(const ConstImageView& src, const ImageView& dst, DitherMode mode = DitherMode::None,
+                 uint32_t dither_x = 0, uint32_t dither_y = 0);
+// src and dst share a 2 or 3 byte format; dst is src's size with the axes
+// swapped for 90/270. The views must not overlap.
+bool RotateView(const ConstImageView& src, const ImageView& dst, int rotation_degrees);
+// Fills dst with an 8-bit RGB colour, truncated to dst's format.
+bool FillView(const ImageView& dst, uint8_t r, uint8_t g, uint8_t b);
+// ConvertView of src placed at (x, y) in dst, clipped to dst.
+bool BlitView(const ConstImageView& src, const ImageView& dst, int32_t x, int32_t y);
 
 }
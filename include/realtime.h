@@ -0,0 +1,31 @@
+#pragma once
+#include <pthread.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ili9488 {
+
+// SCHED_FIFO at priority 1-99. Needs CAP_SYS_NICE or an RLIMIT_RTPRIO of at
+// least priority (LimitRTPRIO= in the systemd unit).
+bool SetThreadRealtime(pthread_t thread, int priority);
+// Restricts the thread to cpus; an empty list leaves it alone.
+bool SetThreadAffinity(pthread_t thread, const std::vector<int>& cpus);
+
+// mlockall(MCL_CURRENT | MCL_FUTURE). Needs CAP_IPC_LOCK or a large enough
+// RLIMIT_MEMLOCK (LimitMEMLOCK=).
+bool LockAllMemory();
+// Locked memory of this process (VmLck) in kB, 0 when unknown.
+size_t LockedMemoryKb();
+
+// Faults in every page of [data, data + size) now instead of on first use in
+// the frame loop. write also breaks copy-on-write and zero-page mappings, for
+// buffers the caller will write. Returns the number of pages touched.
+size_t PrefaultPages(void* data, size_t size, bool write);
+// Touches bytes of stack below the caller's frame.
+void PrefaultStack(size_t bytes);
+
+std::string FormatCpuList(const std::vector<int>& cpus);
+
+}
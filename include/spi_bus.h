@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ili9488 {
+
+// spidev rejects SPI_IOC_MESSAGE(n) for n above this.
+constexpr size_t kMaxSpiTransfersPerMessage = 256;
+
+struct SpiSegment {
+    const uint8_t* data;
+    size_t length;
+};
+
+struct BusStats {
+    uint64_t spi_messages = 0;
+    uint64_t spi_transfers = 0;
+    uint64_t gpio_writes = 0;
+    uint64_t bytes = 0;
+    uint64_t ioctl_ns = 0;
+    uint64_t max_ioctl_ns = 0;
+
+    uint64_t syscalls() const { return spi_messages + gpio_writes; }
+};
+
+class SpiBus {
+public:
+    virtual ~SpiBus() = default;
+
+    // One SPI message: all segments are clocked out back to back with CS held.
+    virtual bool message(const SpiSegment* segments, size_t count, uint32_t speed_hz) = 0;
+    virtual bool setDataCommand(bool data) = 0;
+    virtual bool setReset(bool high) = 0;
+    virtual size_t maxMessageBytes() const = 0;
+    virtual size_t maxMessageSegments() const = 0;
+
+    BusStats stats() const;
+    void resetStats();
+
+protected:
+    void recordMessage(size_t segments, size_t bytes, uint64_t elapsed_ns);
+    void recordGpioWrite(uint64_t elapsed_ns);
+
+private:
+    void recordIoctl(uint64_t elapsed_ns);
+
+    std::atomic<uint64_t> spi_messages_{0};
+    std::atomic<uint64_t> spi_transfers_{0};
+    std::atomic<uint64_t> gpio_writes_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> ioctl_ns_{0};
+    std::atomic<uint64_t> max_ioctl_ns_{0};
+};
+
+struct SpidevConfig {
+    std::string device;
+    uint8_t mode;
+    uint8_t bits_per_word;
+    uint32_t speed_hz;
+    int dc_gpio;
+    int reset_gpio;
+};
+
+class SpidevBus : public SpiBus {
+public:
+    SpidevBus();
+    ~SpidevBus() override;
+
+    bool open(const SpidevConfig& config);
+    bool message(const SpiSegment* segments, size_t count, uint32_t speed_hz) override;
+    bool setDataCommand(bool data) override;
+    bool setReset(bool high) override;
+    size_t maxMessageBytes() const override { return bufsiz_; }
+    size_t maxMessageSegments() const override;
+
+    static size_t ReadSpidevBufsiz();
+
+private:
+    int configureGpioOutput(int gpio, bool value);
+    bool setLine(int line_fd, bool value);
+
+    int spi_fd_;
+    int gpio_chip_fd_;
+    int dc_line_fd_;
+    int reset_line_fd_;
+    uint8_t bits_per_word_;
+    size_t bufsiz_;
+    std::vector<uint8_t> transfers_;
+};
+
+// Accepts every message without touching hardware and charges a fixed cost
+// per ioctl, so transfer strategies can be compared off-target.
+class MockSpiBus : public SpiBus {
+public:
+    explicit MockSpiBus(size_t bufsiz = 4096, uint64_t ioctl_cost_ns = 0);
+
+    bool message(const SpiSegment* segments, size_t count, uint32_t speed_hz) override;
+    bool setDataCommand(bool data) override;
+    bool setReset(bool high) override;
+    size_t maxMessageBytes() const override { return bufsiz_; }
+    size_t maxMessageSegments() const override;
+
+    uint64_t wireTimeNs() const { return wire_time_ns_; }
+
+private:
+    size_t bufsiz_;
+    uint64_t ioctl_cost_ns_;
+    uint64_t wire_time_ns_;
+};
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "bcm_dma.h"
+
+namespace ili9488::spidma {
+
+constexpr uint32_t kPeripheralBusBase = 0x7E000000;
+constexpr uint32_t kDmaBusBase = kPeripheralBusBase + 0x7000;
+constexpr uint32_t kSpi0BusBase = kPeripheralBusBase + 0x204000;
+constexpr uint32_t kDmaChannelStride = 0x100;
+constexpr uint32_t kDmaChannelCount = 15;
+
+constexpr uint32_t kSpiCs = 0x00;
+constexpr uint32_t kSpiFifo = 0x04;
+
+constexpr uint32_t kSpiCsModeMask = 0x4F;
+constexpr uint32_t kSpiCsClearTx = 1 << 4;
+constexpr uint32_t kSpiCsClearRx = 1 << 5;
+constexpr uint32_t kSpiCsTa = 1 << 7;
+constexpr uint32_t kSpiCsDmaen = 1 << 8;
+constexpr uint32_t kSpiCsAdcs = 1 << 11;
+
+constexpr uint32_t kDmaCs = 0x00;
+constexpr uint32_t kDmaConblkAd = 0x04;
+constexpr uint32_t kDmaCsActive = 1 << 0;
+constexpr uint32_t kDmaCsEnd = 1 << 1;
+constexpr uint32_t kDmaCsError = 1 << 8;
+constexpr uint32_t kDmaCsWaitWriteResp = 1 << 28;
+constexpr uint32_t kDmaCsReset = 1U << 31;
+
+constexpr uint32_t kDreqSpiTx = 6;
+constexpr uint32_t kDreqSpiRx = 7;
+
+// DLEN is 16 bits wide. Segments stay word aligned so every FIFO write by
+// the TX channel is a full 32-bit word.
+constexpr size_t kMaxSegmentBytes = 65532;
+
+struct ChainConfig {
+    uint32_t tx_channel;
+    uint32_t rx_channel;
+    // SPI CS bits 0-7 (chip select, CPHA, CPOL, CSPOL) for every segment.
+    uint32_t spi_mode_bits;
+};
+
+// A frame is split into DLEN-sized segments. The TX channel writes one
+// segment (header word + data) into the SPI FIFO and stops. The RX channel
+// drains the bytes clocked back in, and once a segment has fully left the
+// shifter it re-arms the TX channel with the next segment. After the last
+// segment the RX channel copies the sequence word into the completion word,
+// so the CPU only polls memory.
+struct Chain {
+    uint32_t tx_cb_bus_addr = 0;
+    uint32_t rx_cb_bus_addr = 0;
+    size_t sequence_offset = 0;
+    size_t completion_offset = 0;
+    size_t segments = 0;
+    size_t control_blocks = 0;
+};
+
+size_t SegmentCount(size_t length);
+size_t ChainBytes(size_t length);
+
+bool BuildChain(void* cb_mem, uint32_t cb_bus_addr, size_t cb_mem_size,
+                uint32_t src_bus_addr, size_t length,
+                const ChainConfig& config, Chain* out);
+
+struct ModelStats {
+    size_t control_blocks = 0;
+    size_t segments = 0;
+    size_t register_writes = 0;
+};
+
+// Register-level model of SPI0 in DMA mode plus the DMA channels driving it.
+// Control blocks are read through a MemoryModel; writes to the SPI and DMA
+// register windows take effect as they would on the SoC.
+class SpiDmaModel {
+public:
+    explicit SpiDmaModel(const dma::MemoryModel& memory);
+
+    void writeSpiCs(uint32_t value);
+    void startChannel(uint32_t channel, uint32_t cb_bus_addr);
+    bool run();
+
+    const std::vector<uint8_t>& wire() const { return wire_; }
+    const ModelStats& stats() const { return stats_; }
+    uint32_t spiCs() const { return spi_cs_; }
+    const std::string& error() const { return error_; }
+
+private:
+    struct Channel {
+        uint32_t number = 0;
+        bool active = false;
+        bool loaded = false;
+        uint32_t cb_addr = 0;
+        uint32_t current_cb = 0;
+        DmaControlBlock cb {};
+        uint32_t src = 0;
+        uint32_t dst = 0;
+        uint32_t remaining = 0;
+    };
+
+    bool stepChannel(Channel& channel);
+    bool stepSpi();
+    bool writeRegister(uint32_t bus_addr, uint32_t value);
+    Channel* channelAt(uint32_t bus_addr, uint32_t* offset);
+    bool fail(const std::string& message);
+
+    const dma::MemoryModel& memory_;
+    std::array<Channel, kDmaChannelCount> channels_;
+    std::deque<uint8_t> tx_fifo_;
+    std::deque<uint8_t> rx_fifo_;
+    uint32_t spi_cs_;
+    uint32_t dlen_;
+    std::vector<uint8_t> wire_;
+    ModelStats stats_;
+    std::string error_;
+};
+
+bool SimulateTransfer(const uint8_t* src, size_t length, std::vector<uint8_t>* wire,
+                      ModelStats* stats = nullptr);
+
+}
@@ -1,9 +1,15 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "bcm_dma.h"
+#include "spi_bus.h"
+#include "spi_dma_chain.h"
+
 namespace ili9488 {
 
 struct SpiConfig {
@@ -17,31 +23,82 @@ struct SpiConfig {
     uint32_t height;
     size_t transfer_chunk_bytes;
     int rotation_degrees;
+    bool panel_rotation;
+    bool batch_transfers;
     int dc_gpio;
     int reset_gpio;
 };
 
+struct Rect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct BusMappingStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+};
+
+constexpr size_t kRegionOverheadBytes = 1024;
+
+void CoalesceRects(std::vector<Rect>& rects, size_t overhead_pixels);
+
 class ILI9488Transport {
 public:
     ILI9488Transport();
     ~ILI9488Transport();
     bool initialize(const SpiConfig& config);
+    bool initialize(const SpiConfig& config, std::unique_ptr<SpiBus> bus);
     bool transferDma(const uint8_t* buf, size_t length);
+    bool transferRegion(const uint8_t* buf, size_t stride,
+                        uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+    bool transferRegions(const uint8_t* buf, size_t stride, const Rect* rects, size_t count);
+    // Opens a memory write into the window; writePixels() then streams the
+    // window contents in row-major order across as many calls as needed.
+    bool beginWrite(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+    bool writePixels(const uint8_t* data, size_t length);
     bool transferDmaFromBusAddr(uint32_t bus_addr, size_t length);
     bool supportsBusAddrTransfer() const;
+    // Drives SPI0 straight from a DMA control block chain for bus-address
+    // transfers. cb_cpu/cb_bus_addr must be uncached, DMA-visible memory.
+    bool enableDirectDma(void* cb_cpu, uint32_t cb_bus_addr, size_t cb_size);
+    // Bus-address transfers that cannot use direct DMA read the source through
+    // a CPU mapping. Registered mappings (the frame buffers) are used as-is;
+    // other addresses are mapped from /dev/mem once and kept until evicted.
+    void registerBusMapping(uint32_t bus_addr, const uint8_t* cpu_addr, size_t length);
+    void invalidateBusMappings();
+    BusMappingStats busMappingStats() const;
+    bool panelRotationActive() const;
+    uint32_t windowWidth() const;
+    uint32_t windowHeight() const;
+    size_t bytesPerPixel() const;
+    BusStats busStats() const;
+    void resetBusStats();
+    static uint8_t MadctlForRotation(int rotation_degrees);
 private:
-    bool setGpioValue(int line_fd, bool value);
-    int configureGpioOutput(int gpio, bool value);
+    bool setDataCommand(bool data);
     bool sendCommand(uint8_t command);
     bool sendData(const uint8_t* data, size_t length);
+    bool sendRows(const uint8_t* origin, size_t stride, size_t row_bytes, uint32_t rows);
+    bool flushSegments();
     bool sendDataFromBusAddr(uint32_t bus_addr, size_t length);
+    bool runDirectDma(uint32_t bus_addr, size_t length);
+    const uint8_t* lookupBusMapping(uint32_t bus_addr, size_t length);
+    void releaseBusMapping(size_t index);
+    bool setAddressWindow(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
     bool initializePanel();
     bool setupDirectDma();
     void cleanupDirectDma();
-    int spi_fd_;
-    int gpio_chip_fd_;
-    int dc_line_fd_;
-    int reset_line_fd_;
+    std::unique_ptr<SpiBus> bus_;
+    int dc_state_;
+    bool window_valid_;
+    uint32_t window_[4];
+    std::vector<SpiSegment> segments_;
+    size_t segment_bytes_;
     uint32_t current_speed_hz_;
     SpiConfig config_;
     bool direct_dma_available_;
@@ -51,18 +108,28 @@ private:
     volatile uint32_t* dma_regs_;
     volatile uint32_t* spi_regs_;
     uint32_t dma_channel_;
+    uint32_t dma_rx_channel_;
     void* dma_cb_mem_;
     uint32_t dma_cb_bus_addr_;
-};
-
-struct DmaControlBlock {
-    uint32_t transfer_info;
-    uint32_t source_addr;
-    uint32_t dest_addr;
-    uint32_t transfer_length;
-    uint32_t stride;
-    uint32_t next_cb;
-    uint32_t reserved[2];
+    size_t dma_cb_size_;
+    spidma::Chain dma_chain_;
+    uint32_t dma_chain_src_;
+    size_t dma_chain_length_;
+    uint32_t dma_sequence_;
+    struct BusMapping {
+        uint32_t bus_addr;
+        size_t length;
+        const uint8_t* data;
+        void* map_base;
+        size_t map_size;
+        uint64_t last_use;
+    };
+    mutable std::mutex bus_mapping_mutex_;
+    std::vector<BusMapping> bus_mappings_;
+    BusMappingStats bus_mapping_stats_;
+    uint64_t bus_mapping_clock_;
+    std::vector<uint8_t> region_staging_;
+    std::vector<Rect> region_scratch_;
 };
 
 }
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "ili9488_mailbox.h"
+
+namespace ili9488 {
+
+constexpr uint32_t kShmMagic = 0x49494C39;
+constexpr uint32_t kShmProtocolV1 = 1;
+constexpr uint32_t kShmProtocolV2 = 2;
+constexpr size_t kCacheLineSize = 64;
+constexpr uint32_t kShmFeatureBufferExport = 1U << 0;
+
+// Ownership of the three slots is split between the producer (the slot it is
+// drawing into), the consumer (the slot being displayed) and the shared state
+// word, which holds the most recently published slot:
+//   bits 0-1  slot index
+//   bit  2    dirty (published but not yet taken by the consumer)
+//   bits 3-31 publish sequence
+struct TripleBufferControlV2 {
+    alignas(kCacheLineSize) uint32_t state;
+
+    alignas(kCacheLineSize) uint32_t producer_slot;
+    uint32_t frame_futex;
+    uint64_t frames_published;
+    uint64_t frames_dropped;
+    // CLOCK_MONOTONIC ns of the latest publish, 0 if the client does not stamp it.
+    uint64_t publish_ns;
+
+    alignas(kCacheLineSize) uint32_t consumer_slot;
+    uint32_t consumer_waiting;
+    uint64_t frames_consumed;
+};
+
+namespace shm {
+
+constexpr uint32_t kStateSlotMask = 0x3;
+constexpr uint32_t kStateDirty = 1U << 2;
+constexpr uint32_t kStateSeqShift = 3;
+
+inline uint32_t StateSlot(uint32_t state) { return state & kStateSlotMask; }
+inline bool StateDirty(uint32_t state) { return (state & kStateDirty) != 0; }
+inline uint32_t StateSequence(uint32_t state) { return state >> kStateSeqShift; }
+inline uint32_t MakeState(uint32_t slot, bool dirty, uint32_t sequence) {
+    return (sequence << kStateSeqShift) | (dirty ? kStateDirty : 0U) | (slot & kStateSlotMask);
+}
+
+size_t ControlOffset(size_t buffer_size);
+void InitializeControl(TripleBufferControlV2* control);
+
+// Producer: hands the current producer slot to the consumer and returns the
+// slot to draw the next frame into. Wakes the consumer if it is sleeping.
+// Stamps publish_ns so the daemon can measure post-to-scanout latency.
+uint32_t PublishFrame(TripleBufferControlV2* control);
+
+// Consumer: takes the newest published slot if one is pending. The previous
+// consumer slot is returned to the shared state.
+bool AcquireFrame(TripleBufferControlV2* control, uint32_t* out_slot, uint32_t* out_sequence = nullptr);
+
+// Consumer: sleeps on the frame futex until a frame is published or the
+// timeout expires. Returns true when a frame is pending.
+bool WaitForFrame(TripleBufferControlV2* control, uint32_t timeout_us);
+void WakeConsumer(TripleBufferControlV2* control);
+
+// Consumer: turns publishes into eventfd readiness so the consumer can wait
+// for frames in epoll next to its other fds. A helper thread sleeps on
+// frame_futex and bumps the eventfd once per wake; fd() stays readable until
+// drain().
+class FrameNotifier {
+public:
+    FrameNotifier();
+    ~FrameNotifier();
+
+    bool start(TripleBufferControlV2* control);
+    void stop();
+    int fd() const { return event_fd_; }
+    void drain();
+
+private:
+    void run();
+    void signal();
+
+    TripleBufferControlV2* control_;
+    int event_fd_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+}
+
+}
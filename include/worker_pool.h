@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ili9488 {
+
+// Persistent helper threads for splitting one pixel job into horizontal
+// bands. The threads are created once; the calling thread works on the first
+// band, so a pool of size N starts N-1 helpers.
+class WorkerPool {
+public:
+    using BandFn = std::function<void(size_t begin, size_t end)>;
+
+    // cpus, when not empty, pins helper i to cpus[(i + 1) % cpus.size()];
+    // cpus[0] is left for the caller to use.
+    explicit WorkerPool(size_t threads, const std::vector<int>& cpus = {});
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return helpers_.size() + 1; }
+    size_t pinnedHelpers() const { return pinned_; }
+    // SCHED_FIFO for the helpers. A real-time caller needs it: it spins
+    // while waiting for the helpers, which would starve CFS helpers sharing
+    // its CPU.
+    bool setRealtimePriority(int priority);
+
+    // Splits [0, count) into one band per thread. Every band except the last
+    // starts and ends on a multiple of align. Returns when all bands are done.
+    // A nested or concurrent call runs on the caller alone.
+    void parallelFor(size_t count, size_t align, const BandFn& fn);
+
+private:
+    void helperLoop(size_t index);
+
+    std::vector<std::thread> helpers_;
+    size_t pinned_;
+
+    std::mutex dispatch_mutex_;
+    std::condition_variable dispatch_;
+    uint64_t generation_;
+    bool running_;
+
+    std::atomic<bool> busy_;
+    const BandFn* job_;
+    size_t job_count_;
+    size_t job_band_;
+    size_t job_bands_;
+    std::atomic<size_t> remaining_;
+};
+
+}
@@ -63,9 +63,9 @@ sudo pkill -9 ili9488-daemon 2>/dev/null || true
 sudo pkill -9 frame_generator 2>/dev/null || true
 sleep 2
 
-# Clean up shared memory and benchmark log (use sudo for log file created by root)
+# Clean up shared memory and stats files (use sudo for files created by root)
 sudo rm -f /dev/shm/ili9488_rgb666 2>/dev/null || true
-sudo rm -f /tmp/ili9488_benchmark.log 2>/dev/null || true
+sudo rm -f /tmp/ili9488_stats.txt /tmp/ili9488_fps.log 2>/dev/null || true
 sudo rm -f /tmp/daemon_output.log 2>/dev/null || true
 
 # Start daemon directly with parameters and FPS overlay
@@ -79,6 +79,8 @@ sudo /usr/bin/ili9488-daemon \
     --rotation \${ROTATION_DEGREES} \
     --max-fps 15 \
     --fps-overlay 1 \
+    --stats-file /tmp/ili9488_stats.txt \
+    --stats-interval 1000 \
     > /tmp/daemon_output.log 2>&1 &
 
 DAEMON_PID=\$!
@@ -133,6 +135,9 @@ for sec in \$(seq 0 \$((BENCH_DUR-1))); do
         fi
     fi
 
+    # The daemon rewrites its stats snapshot every second
+    awk '\$1 == "fps" && \$2 > 0 {print \$2}' /tmp/ili9488_stats.txt >> /tmp/ili9488_fps.log 2>/dev/null || true
+
     sleep 1
 done
 
@@ -146,13 +151,14 @@ sudo pkill -9 frame_generator 2>/dev/null || true
 sudo pkill -9 ili9488-daemon 2>/dev/null || true
 wait \${DAEMON_PID} 2>/dev/null || true
 
-# Save FPS log before cleanup
+# Save FPS samples and the last latency snapshot before cleanup
 mkdir -p /tmp/benchmark_data
-cp /tmp/ili9488_benchmark.log /tmp/benchmark_data/fps_${rotation}.txt 2>/dev/null || echo "no fps data" > /tmp/benchmark_data/fps_${rotation}.txt
+cp /tmp/ili9488_fps.log /tmp/benchmark_data/fps_${rotation}.txt 2>/dev/null || echo "no fps data" > /tmp/benchmark_data/fps_${rotation}.txt
+cp /tmp/ili9488_stats.txt /tmp/benchmark_data/latency_${rotation}.txt 2>/dev/null || true
 
-# Clean up shared memory and log files
+# Clean up shared memory and stats files
 sudo rm -f /dev/shm/ili9488_rgb666 2>/dev/null || true
-sudo rm -f /tmp/ili9488_benchmark.log 2>/dev/null || true
+sudo rm -f /tmp/ili9488_stats.txt /tmp/ili9488_fps.log 2>/dev/null || true
 sleep 2
 
 # Calculate CPU stats (min/avg/max)
@@ -186,6 +192,7 @@ BENCH_SCRIPT
 
     scp "${REMOTE_PI}:/tmp/benchmark_data/fps_${rotation}.txt" "/tmp/benchmark_data/fps_${rotation}.txt" 2>/dev/null || true
     scp "${REMOTE_PI}:/tmp/benchmark_data/metrics_${rotation}.txt" "/tmp/benchmark_data/metrics_${rotation}.txt" 2>/dev/null || true
+    scp "${REMOTE_PI}:/tmp/benchmark_data/latency_${rotation}.txt" "/tmp/benchmark_data/latency_${rotation}.txt" 2>/dev/null || true
 
     # Parse metrics
     if [ -f "/tmp/benchmark_data/metrics_${rotation}.txt" ]; then
@@ -231,7 +238,7 @@ done
 # Re-enable systemd service
 echo ""
 echo "Re-enabling ili9488-daemon service..."
-ssh "${REMOTE_PI}" "sudo pkill -9 frame_generator 2>/dev/null || true; sudo pkill -9 ili9488-daemon 2>/dev/null || true; sudo rm -f /dev/shm/ili9488_rgb666 /tmp/ili9488_benchmark.log /tmp/daemon_output.log 2>/dev/null || true; sleep 2; sudo systemctl start ili9488-daemon.service"
+ssh "${REMOTE_PI}" "sudo pkill -9 frame_generator 2>/dev/null || true; sudo pkill -9 ili9488-daemon 2>/dev/null || true; sudo rm -f /dev/shm/ili9488_rgb666 /tmp/ili9488_stats.txt /tmp/ili9488_fps.log /tmp/daemon_output.log 2>/dev/null || true; sleep 2; sudo systemctl start ili9488-daemon.service"
 sleep 3
 
 # Add footer with notes
@@ -1,5 +1,8 @@
 /* Simple frame generator for benchmarking ili9488-daemon.
-   Continuously writes frames to shared memory to simulate app input. */
+   Continuously writes frames to shared memory to simulate app input.
+   Usage: frame_generator [seconds] [export-socket]
+   With an export socket the frames are rendered straight into the
+   daemon's DMA buffers (zero-copy). */
 
 #include <fcntl.h>
 #include <math.h>
@@ -8,8 +11,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <linux/dma-buf.h>
+#include <linux/futex.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -31,9 +40,133 @@ struct TripleBufferShmHeader {
     volatile uint32_t rotation_degrees;
     volatile uint32_t daemon_ready;
     volatile uint32_t app_connected;
-    uint8_t padding[64];
+    uint32_t control_offset;
+    volatile uint32_t client_version;
+    uint32_t features;
+    volatile uint32_t present_fence;
+    volatile uint32_t complete_fence;
+    volatile uint32_t scanout_sequence;
+    uint8_t padding[40];
 };
 
+// Zero-copy handshake message, must match buffer_export.h
+struct BufferExportInfo {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_pixel;
+    uint32_t stride;
+    uint32_t buffer_size;
+    uint32_t buffer_count;
+    uint32_t flags;
+    uint32_t bus_addr[3];
+};
+
+#define BUFFER_EXPORT_DMABUF 1u
+
+// Protocol v2 control block, must match triple_buffer_protocol.h
+struct TripleBufferControlV2 {
+    _Alignas(64) uint32_t state;
+    _Alignas(64) uint32_t producer_slot;
+    uint32_t frame_futex;
+    uint64_t frames_published;
+    uint64_t frames_dropped;
+    uint64_t publish_ns;
+    _Alignas(64) uint32_t consumer_slot;
+    uint32_t consumer_waiting;
+    uint64_t frames_consumed;
+};
+
+#define STATE_SLOT_MASK 0x3u
+#define STATE_DIRTY (1u << 2)
+#define STATE_SEQ_SHIFT 3
+
+static uint32_t publish_frame(struct TripleBufferControlV2 *control) {
+    uint32_t slot = __atomic_load_n(&control->producer_slot, __ATOMIC_RELAXED);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    __atomic_store_n(&control->publish_ns, (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec,
+                     __ATOMIC_RELAXED);
+    uint32_t previous = __atomic_load_n(&control->state, __ATOMIC_RELAXED);
+    uint32_t desired;
+    do {
+        desired = (((previous >> STATE_SEQ_SHIFT) + 1) << STATE_SEQ_SHIFT) | STATE_DIRTY | slot;
+    } while (!__atomic_compare_exchange_n(&control->state, &previous, desired, 1,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    uint32_t next_slot = previous & STATE_SLOT_MASK;
+    __atomic_store_n(&control->producer_slot, next_slot, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&control->frames_published, 1, __ATOMIC_RELAXED);
+    if (previous & STATE_DIRTY) {
+        __atomic_add_fetch(&control->frames_dropped, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&control->frame_futex, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&control->consumer_waiting, __ATOMIC_SEQ_CST)) {
+        syscall(SYS_futex, &control->frame_futex, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+    return next_slot;
+}
+
+static void render_frame(uint8_t *pending_buf, uint32_t width, uint32_t height, uint32_t bytes_per_pixel,
+                         unsigned int frame_num);
+
+static int attach_exported_buffers(const char *path, struct BufferExportInfo *info, uint8_t *maps[3], int fds[3]) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect export socket");
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+
+    char control[CMSG_SPACE(sizeof(int) * 3)];
+    struct iovec iov = {info, sizeof(*info)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != (ssize_t)sizeof(*info)) {
+        perror("recvmsg");
+        close(sock);
+        return -1;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3)) {
+        fprintf(stderr, "Export socket sent no buffers\n");
+        close(sock);
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * 3);
+
+    for (int i = 0; i < 3; i++) {
+        void *map = mmap(NULL, info->buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[i], 0);
+        if (map == MAP_FAILED) {
+            perror("mmap exported buffer");
+            close(sock);
+            return -1;
+        }
+        maps[i] = (uint8_t *)map;
+    }
+
+    // Keep the socket open: the daemon treats a hang-up as detach
+    return sock;
+}
+
+static void dmabuf_sync(int fd, uint64_t flags) {
+    struct dma_buf_sync sync = {flags};
+    ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
 int main(int argc, char *argv[]) {
     int duration = 15;
     if (argc > 1) {
@@ -68,53 +201,56 @@ int main(int argc, char *argv[]) {
     }
 
     uint32_t buffer_size = header->width * header->height * header->bytes_per_pixel;
+    uint8_t *buffers = (uint8_t *)map + sizeof(struct TripleBufferShmHeader);
     time_t start = time(NULL);
 
+    struct TripleBufferControlV2 *control = NULL;
+    if (header->version >= 2 && header->control_offset != 0 &&
+        header->control_offset + sizeof(struct TripleBufferControlV2) <= (size_t)sb.st_size) {
+        control = (struct TripleBufferControlV2 *)((uint8_t *)map + header->control_offset);
+    }
+
+    // Zero-copy: render into the exported DMA buffers instead of the SHM slots
+    struct BufferExportInfo export_info;
+    uint8_t *export_maps[3] = {NULL, NULL, NULL};
+    int export_fds[3] = {-1, -1, -1};
+    int export_sock = -1;
+    if (argc > 2 && control != NULL && (header->features & 1u)) {
+        export_sock = attach_exported_buffers(argv[2], &export_info, export_maps, export_fds);
+        if (export_sock < 0) {
+            fprintf(stderr, "Zero-copy attach failed, using shared memory buffers\n");
+        }
+    }
+    const int use_dmabuf_sync = export_sock >= 0 && (export_info.flags & BUFFER_EXPORT_DMABUF);
+
+    if (control != NULL) {
+        __atomic_store_n(&header->client_version, 2, __ATOMIC_RELEASE);
+    }
+
     // Generate frames continuously with animated colors
     unsigned int frame_num = 0;
     while (time(NULL) - start < duration) {
-        // Try to acquire semaphore (non-blocking)
-        if (sem_trywait(&header->pending_sem) == 0) {
-            // Write animated color pattern to pending buffer
-            uint8_t *pending_buf =
-                (uint8_t *)map + sizeof(struct TripleBufferShmHeader) +
-                header->pending_index * buffer_size;
-
-            // Generate rainbow gradient animation
-            for (uint32_t y = 0; y < header->height; y++) {
-                for (uint32_t x = 0; x < header->width; x++) {
-                    uint32_t pixel_idx = (y * header->width + x) * 3;
-
-                    // Create moving rainbow effect
-                    // HSV to RGB conversion for smooth color transitions
-                    float hue = ((float)((x + y + frame_num * 2) % 360)) / 360.0f;
-                    float s = 1.0f;
-                    float v = 1.0f;
-
-                    float c = v * s;
-                    float x_val = c * (1.0f - fabsf(fmodf(hue * 6.0f, 2.0f) - 1.0f));
-                    float m = v - c;
-
-                    float r, g, b;
-                    if (hue < 1.0f/6.0f) {
-                        r = c; g = x_val; b = 0;
-                    } else if (hue < 2.0f/6.0f) {
-                        r = x_val; g = c; b = 0;
-                    } else if (hue < 3.0f/6.0f) {
-                        r = 0; g = c; b = x_val;
-                    } else if (hue < 4.0f/6.0f) {
-                        r = 0; g = x_val; b = c;
-                    } else if (hue < 5.0f/6.0f) {
-                        r = x_val; g = 0; b = c;
-                    } else {
-                        r = c; g = 0; b = x_val;
-                    }
-
-                    pending_buf[pixel_idx] = (uint8_t)((r + m) * 252.0f);     // R (max 0xFC)
-                    pending_buf[pixel_idx + 1] = (uint8_t)((g + m) * 252.0f); // G
-                    pending_buf[pixel_idx + 2] = (uint8_t)((b + m) * 252.0f); // B
+        if (control != NULL) {
+            // Protocol v2: draw into the producer slot, then publish it
+            uint32_t slot = __atomic_load_n(&control->producer_slot, __ATOMIC_RELAXED);
+            if (export_sock >= 0) {
+                if (use_dmabuf_sync) {
+                    dmabuf_sync(export_fds[slot], DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+                }
+                render_frame(export_maps[slot], header->width, header->height, header->bytes_per_pixel, frame_num);
+                if (use_dmabuf_sync) {
+                    dmabuf_sync(export_fds[slot], DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
                 }
+            } else {
+                render_frame(buffers + slot * buffer_size, header->width, header->height, header->bytes_per_pixel,
+                             frame_num);
             }
+            publish_frame(control);
+            frame_num++;
+        } else if (sem_trywait(&header->pending_sem) == 0) {
+            // Protocol v1: write to pending buffer under the semaphore
+            render_frame(buffers + header->pending_index * buffer_size,
+                         header->width, header->height, header->bytes_per_pixel, frame_num);
 
             header->frame_counter++;
             frame_num++;
@@ -127,7 +263,62 @@ int main(int argc, char *argv[]) {
         usleep(10000);  // 10ms = ~100 FPS max
     }
 
+    if (export_sock >= 0) {
+        for (int i = 0; i < 3; i++) {
+            munmap(export_maps[i], export_info.buffer_size);
+            close(export_fds[i]);
+        }
+        close(export_sock);
+    }
     munmap(map, sb.st_size);
     close(shm_fd);
     return 0;
 }
+
+static void render_frame(uint8_t *pending_buf, uint32_t width, uint32_t height, uint32_t bytes_per_pixel,
+                         unsigned int frame_num) {
+    // Generate rainbow gradient animation
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t pixel_idx = (y * width + x) * bytes_per_pixel;
+
+            // Create moving rainbow effect
+            // HSV to RGB conversion for smooth color transitions
+            float hue = ((float)((x + y + frame_num * 2) % 360)) / 360.0f;
+            float s = 1.0f;
+            float v = 1.0f;
+
+            float c = v * s;
+            float x_val = c * (1.0f - fabsf(fmodf(hue * 6.0f, 2.0f) - 1.0f));
+            float m = v - c;
+
+            float r, g, b;
+            if (hue < 1.0f/6.0f) {
+                r = c; g = x_val; b = 0;
+            } else if (hue < 2.0f/6.0f) {
+                r = x_val; g = c; b = 0;
+            } else if (hue < 3.0f/6.0f) {
+                r = 0; g = c; b = x_val;
+            } else if (hue < 4.0f/6.0f) {
+                r = 0; g = x_val; b = c;
+            } else if (hue < 5.0f/6.0f) {
+                r = x_val; g = 0; b = c;
+            } else {
+                r = c; g = 0; b = x_val;
+            }
+
+            if (bytes_per_pixel == 2) {
+                // RGB565, high byte first
+                uint16_t value = (uint16_t)(((uint16_t)((r + m) * 31.0f) << 11) |
+                                            ((uint16_t)((g + m) * 63.0f) << 5) |
+                                            (uint16_t)((b + m) * 31.0f));
+                pending_buf[pixel_idx] = (uint8_t)(value >> 8);
+                pending_buf[pixel_idx + 1] = (uint8_t)(value & 0xFF);
+                continue;
+            }
+            pending_buf[pixel_idx] = (uint8_t)((r + m) * 252.0f);     // R (max 0xFC)
+            pending_buf[pixel_idx + 1] = (uint8_t)((g + m) * 252.0f); // G
+            pending_buf[pixel_idx + 2] = (uint8_t)((b + m) * 252.0f); // B
+        }
+    }
+}
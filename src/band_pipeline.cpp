@@ -0,0 +1,207 @@
+#include "band_pipeline.h"
+
+#include "pixel_utils.h"
+#include "spi_dma_linux.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace ili9488 {
+
+namespace {
+uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+}
+
+BandPipeline::BandPipeline(ILI9488Transport& transport, uint32_t band_rows, pixel::DitherMode dither)
+    : transport_(transport),
+      band_rows_(band_rows > 0 ? band_rows : kDefaultBandRows),
+      dither_(dither),
+      src_(nullptr),
+      format_(InputFormat::Rgb888),
+      src_stride_(0),
+      src_bpp_(3),
+      src_width_(0),
+      src_height_(0),
+      out_width_(0),
+      rotation_(0),
+      busy_{false, false},
+      sending_(false),
+      failed_(false),
+      running_(true),
+      first_band_pending_(false),
+      frame_start_ns_(0) {
+    sender_ = std::thread(&BandPipeline::senderLoop, this);
+}
+
+BandPipeline::~BandPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    band_ready_.notify_all();
+    if (sender_.joinable()) {
+        sender_.join();
+    }
+}
+
+size_t BandPipeline::workingSetBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buffers_[0].size() + buffers_[1].size() + scratch_.size();
+}
+
+BandPipelineStats BandPipeline::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void BandPipeline::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = BandPipelineStats{};
+}
+
+bool BandPipeline::present(const uint8_t* src, InputFormat format, size_t src_stride, int rotation_degrees) {
+    if (src == nullptr) {
+        return false;
+    }
+    if (rotation_degrees != 0 && rotation_degrees != 90 && rotation_degrees != 180 && rotation_degrees != 270) {
+        return false;
+    }
+    const size_t out_bpp = transport_.bytesPerPixel();
+    const uint32_t out_width = transport_.windowWidth();
+    const uint32_t out_height = transport_.windowHeight();
+    const bool swap_axes = rotation_degrees == 90 || rotation_degrees == 270;
+
+    src_ = src;
+    format_ = format;
+    src_bpp_ = format == InputFormat::Rgba8888 ? 4U : 3U;
+    src_width_ = swap_axes ? out_height : out_width;
+    src_height_ = swap_axes ? out_width : out_height;
+    src_stride_ = src_stride > 0 ? src_stride : static_cast<size_t>(src_width_) * src_bpp_;
+    out_width_ = out_width;
+    rotation_ = rotation_degrees;
+
+    const size_t band_bytes = static_cast<size_t>(out_width) * band_rows_ * out_bpp;
+    const size_t scratch_bytes = rotation_degrees == 0
+                                     ? 0
+                                     : static_cast<size_t>(swap_axes ? src_height_ : src_width_) *
+                                           band_rows_ * out_bpp;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& buffer : buffers_) {
+            if (buffer.size() < band_bytes) {
+                buffer.resize(band_bytes);
+            }
+        }
+        if (scratch_.size() < scratch_bytes) {
+            scratch_.resize(scratch_bytes);
+        }
+        failed_ = false;
+        first_band_pending_ = true;
+        frame_start_ns_ = NowNs();
+    }
+
+    if (!transport_.beginWrite(0, 0, out_width, out_height)) {
+        return false;
+    }
+
+    uint64_t wait_ns = 0;
+    size_t bands = 0;
+    for (uint32_t y0 = 0; y0 < out_height; y0 += band_rows_) {
+        const uint32_t rows = std::min(band_rows_, out_height - y0);
+        const size_t slot = bands & 1U;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (busy_[slot] && !failed_) {
+                const uint64_t wait_start = NowNs();
+                band_done_.wait(lock, [this, slot] { return !busy_[slot] || failed_; });
+                wait_ns += NowNs() - wait_start;
+            }
+            if (failed_) {
+                break;
+            }
+        }
+        fillBand(buffers_[slot].data(), y0, rows);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_[slot] = true;
+            pending_.push_back(Band{slot, static_cast<size_t>(out_width) * rows * out_bpp});
+        }
+        band_ready_.notify_one();
+        ++bands;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    band_done_.wait(lock, [this] { return pending_.empty() && !sending_; });
+    stats_.bands += bands;
+    stats_.producer_wait_ns += wait_ns;
+    if (failed_) {
+        return false;
+    }
+    ++stats_.frames;
+    stats_.frame_ns = NowNs() - frame_start_ns_;
+    return true;
+}
+
+void BandPipeline::fillBand(uint8_t* out, uint32_t y0, uint32_t rows) {
+    const pixel::PixelFormat out_format =
+        transport_.bytesPerPixel() == 2 ? pixel::PixelFormat::Rgb565 : pixel::PixelFormat::Rgb666;
+    const pixel::ConstImageView src = pixel::MakeView(
+        src_, src_width_, src_height_,
+        format_ == InputFormat::Rgba8888 ? pixel::PixelFormat::Rgba8888 : pixel::PixelFormat::Rgb888, src_stride_);
+    const pixel::ImageView band = pixel::MakeView(out, out_width_, rows, out_format);
+    if (rotation_ == 0) {
+        pixel::ConvertView(pixel::SubView(src, 0, y0, src_width_, rows), band, dither_, 0, y0);
+        return;
+    }
+
+    if (rotation_ == 180) {
+        // Output rows [y0, y0 + rows) are source rows [H - y0 - rows, H - y0)
+        // turned upside down.
+        const uint32_t src_y0 = src_height_ - y0 - rows;
+        const pixel::ImageView staged = pixel::MakeView(scratch_.data(), src_width_, rows, out_format);
+        pixel::ConvertView(pixel::SubView(src, 0, src_y0, src_width_, rows), staged, dither_, 0, src_y0);
+        pixel::RotateView(staged, band, 180);
+        return;
+    }
+
+    // For 90/270 an output band is a strip of source columns: [y0, y0 + rows)
+    // for 90, mirrored from the right edge for 270.
+    const uint32_t src_x0 = rotation_ == 90 ? y0 : src_width_ - y0 - rows;
+    const pixel::ImageView strip = pixel::MakeView(scratch_.data(), rows, src_height_, out_format);
+    pixel::ConvertView(pixel::SubView(src, src_x0, 0, rows, src_height_), strip, dither_, src_x0, 0);
+    pixel::RotateView(strip, band, rotation_);
+}
+
+void BandPipeline::senderLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        band_ready_.wait(lock, [this] { return !running_ || !pending_.empty(); });
+        if (pending_.empty()) {
+            break;
+        }
+        const Band band = pending_.front();
+        pending_.pop_front();
+        const bool skip = failed_;
+        if (!skip && first_band_pending_) {
+            stats_.first_band_ns = NowNs() - frame_start_ns_;
+            first_band_pending_ = false;
+        }
+        sending_ = true;
+        lock.unlock();
+
+        const bool ok = skip || transport_.writePixels(buffers_[band.slot].data(), band.bytes);
+
+        lock.lock();
+        sending_ = false;
+        busy_[band.slot] = false;
+        if (!ok) {
+            failed_ = true;
+        }
+        band_done_.notify_all();
+    }
+}
+
+}
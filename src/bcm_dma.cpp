@@ -0,0 +1,89 @@
+#include "bcm_dma.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace ili9488::dma {
+
+namespace {
+constexpr size_t kMaxChainLength = 1U << 20;
+}
+
+void MemoryModel::map(uint32_t bus_addr, void* cpu_addr, size_t size) {
+    regions_.push_back(Region{bus_addr & kBusAddressMask, static_cast<uint8_t*>(cpu_addr), size});
+}
+
+void MemoryModel::clear() {
+    regions_.clear();
+}
+
+uint8_t* MemoryModel::translate(uint32_t bus_addr, size_t length) const {
+    const uint32_t masked = bus_addr & kBusAddressMask;
+    for (const auto& region : regions_) {
+        if (masked >= region.bus_addr && masked - region.bus_addr + length <= region.size) {
+            return region.cpu_addr + (masked - region.bus_addr);
+        }
+    }
+    return nullptr;
+}
+
+bool RunControlBlockChain(const MemoryModel& memory, uint32_t first_cb_bus_addr, RunStats* stats) {
+    uint32_t cb_addr = first_cb_bus_addr;
+    size_t executed = 0;
+    size_t bytes = 0;
+
+    while (cb_addr != 0) {
+        if (executed++ >= kMaxChainLength) {
+            std::fprintf(stderr, "DMA model: control block chain does not terminate\n");
+            return false;
+        }
+
+        const uint8_t* cb_ptr = memory.translate(cb_addr, sizeof(DmaControlBlock));
+        if (cb_ptr == nullptr) {
+            std::fprintf(stderr, "DMA model: control block 0x%08x is not mapped\n", cb_addr);
+            return false;
+        }
+        DmaControlBlock cb;
+        std::memcpy(&cb, cb_ptr, sizeof(cb));
+
+        const bool two_d = (cb.transfer_info & kTiTdMode) != 0;
+        const uint32_t xlength = two_d ? (cb.transfer_length & 0xFFFF) : cb.transfer_length;
+        const uint32_t ylength = two_d ? ((cb.transfer_length >> 16) & kMaxYLength) + 1 : 1;
+        const int32_t src_stride = two_d ? static_cast<int16_t>(cb.stride & 0xFFFF) : 0;
+        const int32_t dst_stride = two_d ? static_cast<int16_t>(cb.stride >> 16) : 0;
+        const bool src_inc = (cb.transfer_info & kTiSrcInc) != 0;
+        const bool dst_inc = (cb.transfer_info & kTiDestInc) != 0;
+
+        int64_t src = cb.source_addr & kBusAddressMask;
+        int64_t dst = cb.dest_addr & kBusAddressMask;
+        for (uint32_t row = 0; row < ylength; ++row) {
+            const uint8_t* s = memory.translate(static_cast<uint32_t>(src), src_inc ? xlength : 1);
+            uint8_t* d = memory.translate(static_cast<uint32_t>(dst), dst_inc ? xlength : 1);
+            if (s == nullptr || d == nullptr) {
+                std::fprintf(stderr, "DMA model: CB 0x%08x accesses unmapped memory (src=0x%08x dst=0x%08x)\n",
+                             cb_addr, static_cast<uint32_t>(src), static_cast<uint32_t>(dst));
+                return false;
+            }
+            if (src_inc && dst_inc) {
+                std::memmove(d, s, xlength);
+            } else {
+                for (uint32_t i = 0; i < xlength; ++i) {
+                    d[dst_inc ? i : 0] = s[src_inc ? i : 0];
+                }
+            }
+            src += (src_inc ? xlength : 0) + src_stride;
+            dst += (dst_inc ? xlength : 0) + dst_stride;
+            bytes += xlength;
+        }
+
+        cb_addr = cb.next_cb;
+    }
+
+    if (stats != nullptr) {
+        stats->control_blocks = executed;
+        stats->bytes_transferred = bytes;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,217 @@
+#include "buffer_export.h"
+
+#include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace ili9488 {
+
+namespace {
+
+bool FillSocketAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        std::fprintf(stderr, "Buffer export: invalid socket path '%s'\n", path.c_str());
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+bool DmaBufSync(int dmabuf_fd, uint64_t flags) {
+    dma_buf_sync sync {};
+    sync.flags = flags;
+    while (ioctl(dmabuf_fd, DMA_BUF_IOCTL_SYNC, &sync) < 0) {
+        if (errno != EINTR && errno != EAGAIN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+bool SendExportedBuffers(int socket_fd, const BufferExportInfo& info, const int* fds) {
+    char control[CMSG_SPACE(sizeof(int) * kBufferExportCount)];
+    std::memset(control, 0, sizeof(control));
+
+    iovec iov {};
+    iov.iov_base = const_cast<BufferExportInfo*>(&info);
+    iov.iov_len = sizeof(info);
+
+    msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * kBufferExportCount);
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * kBufferExportCount);
+
+    if (sendmsg(socket_fd, &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(info))) {
+        std::perror("Buffer export: sendmsg");
+        return false;
+    }
+    return true;
+}
+
+bool ReceiveExportedBuffers(int socket_fd, BufferExportInfo* info, int* fds) {
+    char control[CMSG_SPACE(sizeof(int) * kBufferExportCount)];
+    std::memset(control, 0, sizeof(control));
+
+    iovec iov {};
+    iov.iov_base = info;
+    iov.iov_len = sizeof(*info);
+
+    msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(*info))) {
+        std::perror("Buffer export: recvmsg");
+        return false;
+    }
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int) * kBufferExportCount)) {
+        std::fprintf(stderr, "Buffer export: message carries no buffer fds\n");
+        return false;
+    }
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * kBufferExportCount);
+    return info->version == kBufferExportVersion && info->buffer_count == kBufferExportCount;
+}
+
+int ConnectBufferExport(const std::string& path) {
+    sockaddr_un addr;
+    if (!FillSocketAddress(path, addr)) {
+        return -1;
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool DmaBufBeginCpuAccess(int dmabuf_fd, bool write) {
+    return DmaBufSync(dmabuf_fd, DMA_BUF_SYNC_START | (write ? DMA_BUF_SYNC_RW : DMA_BUF_SYNC_READ));
+}
+
+bool DmaBufEndCpuAccess(int dmabuf_fd, bool write) {
+    return DmaBufSync(dmabuf_fd, DMA_BUF_SYNC_END | (write ? DMA_BUF_SYNC_RW : DMA_BUF_SYNC_READ));
+}
+
+BufferExportServer::BufferExportServer()
+    : listen_fd_(-1),
+      client_fd_(-1),
+      info_{},
+      fds_{-1, -1, -1} {}
+
+BufferExportServer::~BufferExportServer() {
+    stop();
+}
+
+bool BufferExportServer::start(const std::string& path, const BufferExportInfo& info, const int* fds) {
+    stop();
+
+    sockaddr_un addr;
+    if (!FillSocketAddress(path, addr)) {
+        return false;
+    }
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        std::perror("Buffer export: socket");
+        return false;
+    }
+
+    unlink(path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd_, 1) < 0) {
+        std::perror("Buffer export: bind/listen");
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    chmod(path.c_str(), 0666);
+
+    path_ = path;
+    info_ = info;
+    for (uint32_t i = 0; i < kBufferExportCount; ++i) {
+        fds_[i] = fds[i];
+    }
+    return true;
+}
+
+void BufferExportServer::stop() {
+    dropClient();
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(path_.c_str());
+    }
+    path_.clear();
+}
+
+void BufferExportServer::poll() {
+    if (listen_fd_ < 0) {
+        return;
+    }
+
+    if (client_fd_ >= 0) {
+        pollfd pfd {client_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 0) > 0) {
+            char byte;
+            if ((pfd.revents & (POLLHUP | POLLERR)) != 0 ||
+                recv(client_fd_, &byte, sizeof(byte), MSG_DONTWAIT) == 0) {
+                dropClient();
+            }
+        }
+    }
+
+    const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    if (client_fd_ >= 0) {
+        std::fprintf(stderr, "Buffer export: rejecting second client\n");
+        close(fd);
+        return;
+    }
+    if (!SendExportedBuffers(fd, info_, fds_)) {
+        close(fd);
+        return;
+    }
+    client_fd_ = fd;
+    std::fprintf(stderr, "Buffer export: zero-copy client attached\n");
+}
+
+void BufferExportServer::dropClient() {
+    if (client_fd_ >= 0) {
+        close(client_fd_);
+        client_fd_ = -1;
+        std::fprintf(stderr, "Buffer export: zero-copy client detached\n");
+    }
+}
+
+}
@@ -0,0 +1,221 @@
+#include "damage_tracker.h"
+
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ili9488 {
+
+namespace {
+constexpr size_t kHashLanes = 8;
+constexpr uint32_t kLanePrime = 0x9E3779B1U;
+constexpr uint32_t kLaneSeed = 0x85EBCA77U;
+constexpr uint64_t kCombinePrime = 0x9E3779B97F4A7C15ULL;
+
+inline uint32_t MixLane(uint32_t acc, uint32_t value) {
+    const uint32_t x = (acc ^ value) * kLanePrime;
+    return (x << 13) | (x >> 19);
+}
+
+inline uint64_t Finalize64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+}
+
+Rect RotateRect(const Rect& rect, uint32_t src_width, uint32_t src_height, int rotation_degrees) {
+    switch (rotation_degrees) {
+        case 90:
+            return Rect{src_height - (rect.y + rect.height), rect.x, rect.height, rect.width};
+        case 180:
+            return Rect{src_width - (rect.x + rect.width), src_height - (rect.y + rect.height),
+                        rect.width, rect.height};
+        case 270:
+            return Rect{rect.y, src_width - (rect.x + rect.width), rect.height, rect.width};
+        default:
+            return rect;
+    }
+}
+
+DamageTracker::DamageTracker()
+    : width_(0),
+      height_(0),
+      bytes_per_pixel_(3),
+      tile_size_(kDefaultTileSize),
+      tiles_x_(0),
+      tiles_y_(0),
+      valid_(false),
+      pool_(nullptr) {}
+
+void DamageTracker::configure(uint32_t width, uint32_t height, size_t bytes_per_pixel, uint32_t tile_size) {
+    width_ = width;
+    height_ = height;
+    bytes_per_pixel_ = bytes_per_pixel;
+    tile_size_ = tile_size > 0 ? tile_size : kDefaultTileSize;
+    tiles_x_ = (width_ + tile_size_ - 1) / tile_size_;
+    tiles_y_ = (height_ + tile_size_ - 1) / tile_size_;
+    tile_hashes_.assign(static_cast<size_t>(tiles_x_) * tiles_y_, 0);
+    tile_dirty_.assign(tile_hashes_.size(), 0);
+    valid_ = false;
+}
+
+void DamageTracker::invalidate() {
+    valid_ = false;
+}
+
+uint64_t DamageTracker::hashTile(const uint8_t* tile, size_t stride, uint32_t tile_w, uint32_t tile_h) const {
+    uint32_t acc[kHashLanes];
+    for (size_t lane = 0; lane < kHashLanes; ++lane) {
+        acc[lane] = kLaneSeed + static_cast<uint32_t>(lane) * kLanePrime;
+    }
+
+    const size_t row_bytes = static_cast<size_t>(tile_w) * bytes_per_pixel_;
+    const size_t row_words = row_bytes / 4;
+    for (uint32_t row = 0; row < tile_h; ++row) {
+        const uint8_t* p = tile + static_cast<size_t>(row) * stride;
+        size_t word = 0;
+        for (; word + kHashLanes <= row_words; word += kHashLanes) {
+            uint32_t values[kHashLanes];
+            std::memcpy(values, p + word * 4, sizeof(values));
+            for (size_t lane = 0; lane < kHashLanes; ++lane) {
+                acc[lane] = MixLane(acc[lane], values[lane]);
+            }
+        }
+        for (size_t lane = 0; word < row_words; ++word, ++lane) {
+            uint32_t value;
+            std::memcpy(&value, p + word * 4, sizeof(value));
+            acc[lane] = MixLane(acc[lane], value);
+        }
+        uint32_t tail = 0;
+        std::memcpy(&tail, p + row_words * 4, row_bytes - row_words * 4);
+        acc[kHashLanes - 1] = MixLane(acc[kHashLanes - 1], tail ^ row);
+    }
+
+    uint64_t h = 0;
+    for (size_t lane = 0; lane < kHashLanes; ++lane) {
+        h = (h ^ acc[lane]) * kCombinePrime;
+    }
+    return Finalize64(h);
+}
+
+size_t DamageTracker::detect(const uint8_t* frame, size_t stride, std::vector<Rect>& out_rects) {
+    out_rects.clear();
+    if (frame == nullptr || tile_hashes_.empty()) {
+        return 0;
+    }
+
+    if (pool_ != nullptr && pool_->size() > 1 && tiles_y_ > 1) {
+        pool_->parallelFor(tiles_y_, 1, [&](size_t begin, size_t end) {
+            hashTileRows(frame, stride, static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+    } else {
+        hashTileRows(frame, stride, 0, tiles_y_);
+    }
+    return finish(out_rects);
+}
+
+void DamageTracker::hashRows(const uint8_t* frame, size_t stride, uint32_t y0, uint32_t y1) {
+    if (frame == nullptr || tile_hashes_.empty() || y0 >= y1) {
+        return;
+    }
+    const uint32_t ty_end = std::min(tiles_y_, (y1 + tile_size_ - 1) / tile_size_);
+    hashTileRows(frame, stride, y0 / tile_size_, ty_end);
+}
+
+void DamageTracker::markDirty(const Rect& rect) {
+    if (tile_hashes_.empty() || rect.width == 0 || rect.height == 0 || rect.x >= width_ || rect.y >= height_) {
+        return;
+    }
+    const uint32_t tx_end = std::min(tiles_x_, (rect.x + rect.width + tile_size_ - 1) / tile_size_);
+    const uint32_t ty_end = std::min(tiles_y_, (rect.y + rect.height + tile_size_ - 1) / tile_size_);
+    for (uint32_t ty = rect.y / tile_size_; ty < ty_end; ++ty) {
+        for (uint32_t tx = rect.x / tile_size_; tx < tx_end; ++tx) {
+            tile_dirty_[static_cast<size_t>(ty) * tiles_x_ + tx] = 1;
+        }
+    }
+}
+
+size_t DamageTracker::finish(std::vector<Rect>& out_rects) {
+    out_rects.clear();
+    if (tile_hashes_.empty()) {
+        return 0;
+    }
+    size_t dirty_tiles = 0;
+    for (uint8_t dirty : tile_dirty_) {
+        dirty_tiles += dirty;
+    }
+    valid_ = true;
+
+    if (dirty_tiles > 0) {
+        collectRects(out_rects);
+        CoalesceRects(out_rects, kRegionOverheadBytes / bytes_per_pixel_);
+    }
+
+    uint64_t dirty_pixels = 0;
+    for (const Rect& rect : out_rects) {
+        dirty_pixels += static_cast<uint64_t>(rect.width) * rect.height;
+    }
+
+    ++stats_.frames;
+    stats_.tiles_scanned += tile_hashes_.size();
+    stats_.tiles_dirty += dirty_tiles;
+    stats_.bytes_total += static_cast<uint64_t>(width_) * height_ * bytes_per_pixel_;
+    stats_.bytes_dirty += dirty_pixels * bytes_per_pixel_;
+    return dirty_tiles;
+}
+
+void DamageTracker::hashTileRows(const uint8_t* frame, size_t stride, uint32_t ty_begin, uint32_t ty_end) {
+    for (uint32_t ty = ty_begin; ty < ty_end; ++ty) {
+        const uint32_t y = ty * tile_size_;
+        const uint32_t tile_h = std::min(tile_size_, height_ - y);
+        for (uint32_t tx = 0; tx < tiles_x_; ++tx) {
+            const uint32_t x = tx * tile_size_;
+            const uint32_t tile_w = std::min(tile_size_, width_ - x);
+            const uint8_t* tile = frame + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * bytes_per_pixel_;
+            const size_t index = static_cast<size_t>(ty) * tiles_x_ + tx;
+            const uint64_t hash = hashTile(tile, stride, tile_w, tile_h);
+            tile_dirty_[index] = (!valid_ || hash != tile_hashes_[index]) ? 1 : 0;
+            tile_hashes_[index] = hash;
+        }
+    }
+}
+
+void DamageTracker::collectRects(std::vector<Rect>& out_rects) const {
+    for (uint32_t ty = 0; ty < tiles_y_; ++ty) {
+        const uint32_t y = ty * tile_size_;
+        const uint32_t tile_h = std::min(tile_size_, height_ - y);
+
+        uint32_t tx = 0;
+        while (tx < tiles_x_) {
+            if (tile_dirty_[static_cast<size_t>(ty) * tiles_x_ + tx] == 0) {
+                ++tx;
+                continue;
+            }
+            const uint32_t run_begin = tx;
+            while (tx < tiles_x_ && tile_dirty_[static_cast<size_t>(ty) * tiles_x_ + tx] != 0) {
+                ++tx;
+            }
+            const uint32_t x = run_begin * tile_size_;
+            const uint32_t w = std::min(tx * tile_size_, width_) - x;
+
+            bool extended = false;
+            for (Rect& above : out_rects) {
+                if (above.x == x && above.width == w && above.y + above.height == y) {
+                    above.height += tile_h;
+                    extended = true;
+                    break;
+                }
+            }
+            if (!extended) {
+                out_rects.push_back(Rect{x, y, w, tile_h});
+            }
+        }
+    }
+}
+
+}
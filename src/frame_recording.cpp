@@ -0,0 +1,348 @@
+#include "frame_recording.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace ili9488 {
+
+namespace {
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void AppendBytes(std::vector<uint8_t>& out, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+void AppendSpan(std::vector<uint8_t>& out, const uint8_t* frame, size_t offset, size_t length) {
+    const uint32_t span[2] = {static_cast<uint32_t>(offset), static_cast<uint32_t>(length)};
+    AppendBytes(out, span, sizeof(span));
+    AppendBytes(out, frame + offset, length);
+}
+
+}
+
+FrameRecorder::FrameRecorder()
+    : fd_(-1),
+      header_{},
+      frame_bytes_(0),
+      first_timestamp_ns_(0),
+      frame_count_(0),
+      bytes_written_(0),
+      dropped_frames_(0),
+      slots_in_use_(0),
+      stopping_(false),
+      failed_(false) {}
+
+FrameRecorder::~FrameRecorder() {
+    close();
+}
+
+bool FrameRecorder::open(const std::string& path, uint32_t width, uint32_t height, size_t bytes_per_pixel) {
+    close();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::fprintf(stderr, "Frame recorder: cannot open %s (%s)\n", path.c_str(), std::strerror(errno));
+        return false;
+    }
+    header_ = RecordingHeader {kRecordingMagic, kRecordingVersion, width, height,
+                               static_cast<uint32_t>(bytes_per_pixel), 0};
+    if (!WriteAll(fd_, reinterpret_cast<const uint8_t*>(&header_), sizeof(header_))) {
+        std::perror("Frame recorder: write");
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    frame_bytes_ = static_cast<size_t>(width) * height * bytes_per_pixel;
+    previous_.assign(frame_bytes_, 0);
+    frame_count_ = 0;
+    bytes_written_ = sizeof(header_);
+    dropped_frames_ = 0;
+    queue_.clear();
+    free_.clear();
+    slots_in_use_ = 0;
+    stopping_ = false;
+    failed_ = false;
+    writer_ = std::thread(&FrameRecorder::writerLoop, this);
+    return true;
+}
+
+bool FrameRecorder::append(const uint8_t* frame, uint64_t timestamp_ns, uint32_t sequence, const Rect* rects,
+                           size_t rect_count) {
+    if (fd_ < 0) {
+        return false;
+    }
+    PendingFrame slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failed_) {
+            return false;
+        }
+        if (slots_in_use_ >= kRecordingQueueFrames) {
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        ++slots_in_use_;
+        if (!free_.empty()) {
+            slot = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+
+    // The copy is the only per-frame cost left on the caller's thread.
+    slot.pixels.assign(frame, frame + frame_bytes_);
+    slot.rects.assign(rects, rects != nullptr ? rects + rect_count : rects);
+    slot.timestamp_ns = timestamp_ns;
+    slot.sequence = sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(slot));
+    }
+    queued_.notify_one();
+    return true;
+}
+
+void FrameRecorder::writerLoop() {
+    for (;;) {
+        PendingFrame slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            slot = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        const bool ok = writeFrame(slot);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ok) {
+            failed_ = true;
+        }
+        free_.push_back(std::move(slot));
+        --slots_in_use_;
+    }
+}
+
+bool FrameRecorder::writeFrame(const PendingFrame& frame) {
+    if (failed_) {
+        return false;
+    }
+    const uint8_t* pixels = frame.pixels.data();
+    if (frame_count_ == 0) {
+        first_timestamp_ns_ = frame.timestamp_ns;
+    }
+
+    RecordedFrame record {};
+    record.timestamp_ns = frame.timestamp_ns >= first_timestamp_ns_ ? frame.timestamp_ns - first_timestamp_ns_ : 0;
+    record.sequence = frame.sequence;
+    record.rect_count = static_cast<uint32_t>(frame.rects.size());
+
+    record_.clear();
+    AppendBytes(record_, &record, sizeof(record));
+    if (record.rect_count > 0) {
+        AppendBytes(record_, frame.rects.data(), frame.rects.size() * sizeof(Rect));
+    }
+    const size_t payload_start = record_.size();
+
+    // Runs of changed blocks become spans; unchanged blocks cost nothing.
+    if (frame_count_ == 0) {
+        AppendSpan(record_, pixels, 0, frame_bytes_);
+        record.span_count = 1;
+    } else {
+        size_t span_start = frame_bytes_;
+        for (size_t offset = 0; offset < frame_bytes_; offset += kRecordingBlockBytes) {
+            const size_t length = std::min(kRecordingBlockBytes, frame_bytes_ - offset);
+            const bool changed = std::memcmp(pixels + offset, previous_.data() + offset, length) != 0;
+            if (changed && span_start == frame_bytes_) {
+                span_start = offset;
+            } else if (!changed && span_start != frame_bytes_) {
+                AppendSpan(record_, pixels, span_start, offset - span_start);
+                ++record.span_count;
+                span_start = frame_bytes_;
+            }
+        }
+        if (span_start != frame_bytes_) {
+            AppendSpan(record_, pixels, span_start, frame_bytes_ - span_start);
+            ++record.span_count;
+        }
+    }
+    record.payload_bytes = static_cast<uint32_t>(record_.size() - payload_start);
+    std::memcpy(record_.data(), &record, sizeof(record));
+
+    if (!WriteAll(fd_, record_.data(), record_.size())) {
+        std::perror("Frame recorder: write");
+        return false;
+    }
+    std::memcpy(previous_.data(), pixels, frame_bytes_);
+    bytes_written_ += record_.size();
+    ++frame_count_;
+    return true;
+}
+
+void FrameRecorder::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    header_.frame_count = frame_count_;
+    if (pwrite(fd_, &header_, sizeof(header_), 0) != static_cast<ssize_t>(sizeof(header_))) {
+        std::perror("Frame recorder: header");
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+FramePlayer::FramePlayer() : map_(nullptr), map_size_(0), header_{}, next_frame_(0) {}
+
+FramePlayer::~FramePlayer() {
+    close();
+}
+
+bool FramePlayer::open(const std::string& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::fprintf(stderr, "Frame player: cannot open %s (%s)\n", path.c_str(), std::strerror(errno));
+        return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(RecordingHeader)) {
+        std::fprintf(stderr, "Frame player: %s is not a recording\n", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    map_size_ = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::perror("Frame player: mmap");
+        map_size_ = 0;
+        return false;
+    }
+    map_ = static_cast<const uint8_t*>(map);
+    madvise(map, map_size_, MADV_SEQUENTIAL);
+
+    std::memcpy(&header_, map_, sizeof(header_));
+    const size_t frame_bytes = static_cast<size_t>(header_.width) * header_.height * header_.bytes_per_pixel;
+    if (header_.magic != kRecordingMagic || header_.version != kRecordingVersion || frame_bytes == 0) {
+        std::fprintf(stderr, "Frame player: %s is not a version %u recording\n", path.c_str(), kRecordingVersion);
+        close();
+        return false;
+    }
+
+    // Index and validate every frame once, so next() can trust the spans.
+    size_t offset = sizeof(header_);
+    while (offset + sizeof(RecordedFrame) <= map_size_) {
+        RecordedFrame record;
+        std::memcpy(&record, map_ + offset, sizeof(record));
+        // Bound the count by what is left of the mapping before multiplying,
+        // so a corrupt count cannot wrap size_t on 32-bit targets.
+        const size_t remaining = map_size_ - offset - sizeof(record);
+        if (record.rect_count > remaining / sizeof(Rect)) {
+            break;
+        }
+        const size_t payload = offset + sizeof(record) + record.rect_count * sizeof(Rect);
+        if (record.payload_bytes > map_size_ - payload) {
+            break;
+        }
+        size_t span = payload;
+        bool valid = true;
+        for (uint32_t i = 0; i < record.span_count && valid; ++i) {
+            uint32_t fields[2];
+            valid = span + sizeof(fields) <= payload + record.payload_bytes;
+            if (valid) {
+                std::memcpy(fields, map_ + span, sizeof(fields));
+                span += sizeof(fields);
+                valid = fields[0] <= frame_bytes && fields[1] <= frame_bytes - fields[0] &&
+                        fields[1] <= payload + record.payload_bytes - span;
+                span += fields[1];
+            }
+        }
+        if (!valid || span != payload + record.payload_bytes) {
+            break;
+        }
+        frame_offsets_.push_back(offset);
+        offset = span;
+    }
+    if (frame_offsets_.size() != header_.frame_count) {
+        std::fprintf(stderr, "Frame player: %s has %zu complete frames (header says %u)\n", path.c_str(),
+                     frame_offsets_.size(), header_.frame_count);
+    }
+    frame_.assign(frame_bytes, 0);
+    next_frame_ = 0;
+    return !frame_offsets_.empty();
+}
+
+void FramePlayer::close() {
+    if (map_ != nullptr) {
+        munmap(const_cast<uint8_t*>(map_), map_size_);
+    }
+    map_ = nullptr;
+    map_size_ = 0;
+    frame_offsets_.clear();
+    next_frame_ = 0;
+}
+
+bool FramePlayer::next(PlaybackFrame* frame) {
+    if (next_frame_ >= frame_offsets_.size()) {
+        return false;
+    }
+    const uint8_t* cursor = map_ + frame_offsets_[next_frame_++];
+    RecordedFrame record;
+    std::memcpy(&record, cursor, sizeof(record));
+    cursor += sizeof(record);
+    rects_.resize(record.rect_count);
+    if (record.rect_count > 0) {
+        std::memcpy(rects_.data(), cursor, record.rect_count * sizeof(Rect));
+        cursor += record.rect_count * sizeof(Rect);
+    }
+    for (uint32_t i = 0; i < record.span_count; ++i) {
+        uint32_t fields[2];
+        std::memcpy(fields, cursor, sizeof(fields));
+        cursor += sizeof(fields);
+        std::memcpy(frame_.data() + fields[0], cursor, fields[1]);
+        cursor += fields[1];
+    }
+
+    frame->pixels = frame_.data();
+    frame->timestamp_ns = record.timestamp_ns;
+    frame->sequence = record.sequence;
+    frame->rects = rects_.data();
+    frame->rect_count = rects_.size();
+    return true;
+}
+
+void FramePlayer::rewind() {
+    next_frame_ = 0;
+    std::fill(frame_.begin(), frame_.end(), 0);
+}
+
+}
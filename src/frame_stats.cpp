@@ -0,0 +1,334 @@
+#include "frame_stats.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+
+namespace ili9488 {
+
+namespace {
+
+constexpr const char* kStageNames[] = {
+    "post_to_acquire",
+    "acquire",
+    "ingest",
+    "overlay",
+    "damage",
+    "rotate_cpu",
+    "rotate_dma",
+    "fence_wait",
+    "transmit_queue",
+    "transmit",
+    "frame",
+    "post_to_scanout",
+    "pace_late",
+};
+static_assert(std::size(kStageNames) == FrameStats::kStageCount, "stage names out of date");
+
+constexpr const char* kCounterNames[] = {
+    "frames",
+    "dropped",
+    "transmit_failures",
+    "tiles_scanned",
+    "tiles_dirty",
+    "bytes_saved",
+};
+static_assert(std::size(kCounterNames) == FrameStats::kCounterCount, "counter names out of date");
+
+// Sequence jumps beyond this are a client restart or wraparound, not drops.
+constexpr uint32_t kMaxSequenceGap = 1U << 20;
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void AppendLine(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void AppendLine(std::string& out, const char* format, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(line, std::min(static_cast<size_t>(length), sizeof(line) - 1));
+    }
+}
+
+double Us(uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+}
+
+uint64_t MonotonicNs() {
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t ns) {
+    if (ns < 2 * kSubBuckets) {
+        return static_cast<size_t>(ns);
+    }
+    const uint32_t msb = 63U - static_cast<uint32_t>(__builtin_clzll(ns));
+    if (msb >= kMaxBits) {
+        return kBucketCount - 1;
+    }
+    const uint32_t shift = msb - kSubBucketBits;
+    return static_cast<size_t>(shift) * kSubBuckets + static_cast<size_t>(ns >> shift);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+    if (index < 2 * kSubBuckets) {
+        return index;
+    }
+    const uint32_t shift = static_cast<uint32_t>(index / kSubBuckets) - 1;
+    const uint64_t sub = index % kSubBuckets + kSubBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets_[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize() const {
+    Summary summary;
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return summary;
+    }
+    summary.count = total;
+    summary.max_ns = max_.load(std::memory_order_relaxed);
+    const uint64_t recorded = count_.load(std::memory_order_relaxed);
+    summary.mean_ns = recorded > 0 ? sum_.load(std::memory_order_relaxed) / recorded : 0;
+
+    const uint64_t p50_rank = (total + 1) / 2;
+    const uint64_t p99_rank = total - total / 100;
+    uint64_t seen = 0;
+    bool have_p50 = false;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts[i];
+        if (!have_p50 && seen >= p50_rank) {
+            summary.p50_ns = std::min(BucketUpperBound(i), summary.max_ns);
+            have_p50 = true;
+        }
+        if (seen >= p99_rank) {
+            summary.p99_ns = std::min(BucketUpperBound(i), summary.max_ns);
+            break;
+        }
+    }
+    return summary;
+}
+
+const char* FrameStageName(FrameStage stage) {
+    const size_t index = static_cast<size_t>(stage);
+    return index < FrameStats::kStageCount ? kStageNames[index] : "unknown";
+}
+
+const char* FrameCounterName(FrameCounter counter) {
+    const size_t index = static_cast<size_t>(counter);
+    return index < FrameStats::kCounterCount ? kCounterNames[index] : "unknown";
+}
+
+void FrameStats::observeSequence(uint32_t sequence) {
+    if (have_sequence_) {
+        const uint32_t gap = sequence - last_sequence_;
+        if (gap > 1 && gap < kMaxSequenceGap) {
+            add(FrameCounter::Dropped, gap - 1);
+        }
+    }
+    last_sequence_ = sequence;
+    have_sequence_ = true;
+}
+
+std::string FrameStats::format(double fps) const {
+    std::string out;
+    out.reserve(1024);
+    AppendLine(out, "fps %.1f\n", fps);
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        AppendLine(out, "%s %llu\n", kCounterNames[i],
+                   static_cast<unsigned long long>(counters_[i].load(std::memory_order_relaxed)));
+    }
+    AppendLine(out, "%-16s %10s %10s %10s %10s %10s\n", "stage", "count", "p50_us", "p99_us", "max_us", "mean_us");
+    for (size_t i = 0; i < kStageCount; ++i) {
+        const LatencyHistogram::Summary summary = stages_[i].summarize();
+        if (summary.count == 0) {
+            continue;
+        }
+        AppendLine(out, "%-16s %10llu %10.1f %10.1f %10.1f %10.1f\n", kStageNames[i],
+                   static_cast<unsigned long long>(summary.count), Us(summary.p50_ns), Us(summary.p99_ns),
+                   Us(summary.max_ns), Us(summary.mean_ns));
+    }
+    return out;
+}
+
+StatsReporter::StatsReporter(const FrameStats& stats)
+    : stats_(stats), interval_ms_(kDefaultStatsIntervalMs), listen_fd_(-1), wake_fd_(-1) {}
+
+StatsReporter::~StatsReporter() {
+    stop();
+}
+
+bool StatsReporter::start(const std::string& socket_path, const std::string& file_path, uint32_t interval_ms) {
+    stop();
+    if (socket_path.empty() && file_path.empty()) {
+        return false;
+    }
+
+    if (!socket_path.empty()) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(addr.sun_path)) {
+            std::fprintf(stderr, "Frame stats: invalid socket path '%s'\n", socket_path.c_str());
+            return false;
+        }
+        std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size());
+
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            std::perror("Frame stats: socket");
+            return false;
+        }
+        unlink(socket_path.c_str());
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listen_fd_, 4) < 0) {
+            std::perror("Frame stats: bind/listen");
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        chmod(socket_path.c_str(), 0666);
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        std::perror("Frame stats: eventfd");
+        if (listen_fd_ >= 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+            unlink(socket_path.c_str());
+        }
+        return false;
+    }
+
+    socket_path_ = socket_path;
+    file_path_ = file_path;
+    interval_ms_ = interval_ms > 0 ? interval_ms : kDefaultStatsIntervalMs;
+    thread_ = std::thread(&StatsReporter::run, this);
+    pthread_setname_np(thread_.native_handle(), "ili9488-stats");
+    return true;
+}
+
+void StatsReporter::stop() {
+    if (thread_.joinable()) {
+        const uint64_t one = 1;
+        WriteAll(wake_fd_, reinterpret_cast<const char*>(&one), sizeof(one));
+        thread_.join();
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(socket_path_.c_str());
+    }
+    socket_path_.clear();
+    file_path_.clear();
+}
+
+void StatsReporter::run() {
+    using Clock = std::chrono::steady_clock;
+    const auto interval = std::chrono::milliseconds(interval_ms_);
+    auto last_tick = Clock::now();
+    uint64_t last_frames = stats_.counter(FrameCounter::Frames);
+    double fps = 0.0;
+
+    while (true) {
+        const auto now = Clock::now();
+        if (now - last_tick >= interval) {
+            const uint64_t frames = stats_.counter(FrameCounter::Frames);
+            const double seconds = std::chrono::duration<double>(now - last_tick).count();
+            fps = static_cast<double>(frames - last_frames) / seconds;
+            last_frames = frames;
+            last_tick = now;
+            if (!file_path_.empty()) {
+                writeFile(stats_.format(fps));
+            }
+        }
+
+        pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {listen_fd_, POLLIN, 0}};
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(last_tick + interval - Clock::now());
+        const int ready = ::poll(fds, listen_fd_ >= 0 ? 2 : 1, static_cast<int>(std::max<int64_t>(wait.count(), 0)));
+        if (ready < 0 && errno != EINTR) {
+            std::perror("Frame stats: poll");
+            return;
+        }
+        if (fds[0].revents != 0) {
+            return;
+        }
+        if (listen_fd_ >= 0 && (fds[1].revents & POLLIN) != 0) {
+            int client;
+            while ((client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+                // The snapshot is smaller than the socket buffer, so a client
+                // that never reads cannot stall this thread.
+                const std::string text = stats_.format(fps);
+                send(client, text.data(), text.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+                close(client);
+            }
+        }
+    }
+}
+
+void StatsReporter::writeFile(const std::string& text) const {
+    const std::string tmp_path = file_path_ + ".tmp";
+    const int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    const bool written = WriteAll(fd, text.data(), text.size());
+    close(fd);
+    if (!written || rename(tmp_path.c_str(), file_path_.c_str()) < 0) {
+        unlink(tmp_path.c_str());
+    }
+}
+
+}
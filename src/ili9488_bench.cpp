@@ -0,0 +1,510 @@
+#include "damage_tracker.h"
+#include "pixel_utils.h"
+#include "worker_pool.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+#ifdef __OPTIMIZE__
+constexpr bool kOptimizedBuild = true;
+#else
+constexpr bool kOptimizedBuild = false;
+#endif
+
+struct Size {
+    uint32_t width;
+    uint32_t height;
+};
+
+struct BenchOptions {
+    uint32_t width = 320;
+    uint32_t height = 480;
+    uint32_t iterations = 200;
+    uint32_t max_threads = 4;
+    bool pin = true;
+    std::string suite = "all";
+    std::vector<Size> sizes = {{320, 480}, {480, 320}, {800, 480}, {1280, 720}, {1920, 1080}};
+    std::string simd = "all";
+    std::string json_path;
+    uint32_t cpu_mhz = 0;
+};
+
+uint32_t ParseUint(const char* value) {
+    return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+}
+
+// "320x480,1920x1080"; malformed entries are skipped.
+std::vector<Size> ParseSizes(const std::string& value) {
+    std::vector<Size> sizes;
+    size_t pos = 0;
+    while (pos < value.size()) {
+        const size_t comma = value.find(',', pos);
+        const std::string item = value.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        unsigned width = 0;
+        unsigned height = 0;
+        if (std::sscanf(item.c_str(), "%ux%u", &width, &height) == 2 && width > 0 && height > 0) {
+            sizes.push_back({width, height});
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+    return sizes;
+}
+
+BenchOptions ParseOptions(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        if (arg == "--width") {
+            options.width = ParseUint(argv[i + 1]);
+        } else if (arg == "--height") {
+            options.height = ParseUint(argv[i + 1]);
+        } else if (arg == "--iterations") {
+            options.iterations = ParseUint(argv[i + 1]);
+        } else if (arg == "--max-threads") {
+            options.max_threads = ParseUint(argv[i + 1]);
+        } else if (arg == "--pin") {
+            options.pin = ParseUint(argv[i + 1]) != 0;
+        } else if (arg == "--suite") {
+            options.suite = argv[i + 1];
+        } else if (arg == "--sizes") {
+            options.sizes = ParseSizes(argv[i + 1]);
+        } else if (arg == "--simd") {
+            options.simd = argv[i + 1];
+        } else if (arg == "--json") {
+            options.json_path = argv[i + 1];
+        } else if (arg == "--cpu-mhz") {
+            options.cpu_mhz = ParseUint(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+        }
+    }
+    return options;
+}
+
+struct Workload {
+    const char* name;
+    std::function<void()> run;
+};
+
+double TimeUs(const Workload& workload, uint32_t iterations) {
+    workload.run();
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        workload.run();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+// User-space cycles, cache references and cache misses of the calling thread.
+// Unavailable in most containers and with kernel.perf_event_paranoid > 2.
+class PerfCounters {
+public:
+    PerfCounters() {
+        const uint64_t configs[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_REFERENCES,
+                                    PERF_COUNT_HW_CACHE_MISSES};
+        for (size_t i = 0; i < kEvents; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fds_[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds_[0], 0));
+            if (fds_[i] < 0) {
+                close();
+                return;
+            }
+        }
+    }
+    ~PerfCounters() { close(); }
+
+    bool available() const { return fds_[0] >= 0; }
+
+    void start() {
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    // cycles, references, misses since start().
+    bool stop(uint64_t values[3]) {
+        ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t group[1 + kEvents];
+        if (::read(fds_[0], group, sizeof(group)) != static_cast<ssize_t>(sizeof(group)) || group[0] != kEvents) {
+            return false;
+        }
+        std::copy(group + 1, group + 1 + kEvents, values);
+        return true;
+    }
+
+private:
+    static constexpr size_t kEvents = 3;
+
+    void close() {
+        for (int& fd : fds_) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            fd = -1;
+        }
+    }
+
+    int fds_[kEvents] = {-1, -1, -1};
+};
+
+struct KernelResult {
+    std::string kernel;
+    const char* simd;
+    Size size;
+    uint32_t iterations;
+    double us;
+    double mb_per_s;
+    double ns_per_pixel;
+    double cycles_per_pixel;      // < 0 when unknown
+    double cache_miss_rate;       // < 0 when unknown
+    double cache_misses_per_kb;   // < 0 when unknown
+};
+
+struct ScalingResult {
+    const char* workload;
+    std::vector<double> us;
+};
+
+// A kernel with the bytes it reads and writes per call.
+struct Kernel {
+    std::string name;
+    size_t bytes;
+    std::function<void()> run;
+};
+
+std::vector<Kernel> MakeKernels(Size size, const std::vector<uint8_t>& src, std::vector<uint8_t>& dst,
+                                ili9488::DamageTracker& damage, std::vector<ili9488::Rect>& rects) {
+    using namespace ili9488::pixel;
+    const uint32_t w = size.width;
+    const uint32_t h = size.height;
+    const size_t pixels = static_cast<size_t>(w) * h;
+    const uint8_t* in = src.data();
+    uint8_t* out = dst.data();
+    std::vector<Kernel> kernels;
+
+    kernels.push_back({"convert rgb888->rgb666", pixels * 6, [=] { ConvertRgb888ToRgb666(in, out, pixels); }});
+    kernels.push_back({"convert rgba8888->rgb666", pixels * 7, [=] { ConvertRgba8888ToRgb666(in, out, pixels); }});
+    kernels.push_back({"convert rgb888->rgb565", pixels * 5, [=] { ConvertRgb888ToRgb565(in, out, pixels); }});
+    kernels.push_back({"convert rgba8888->rgb565", pixels * 6, [=] { ConvertRgba8888ToRgb565(in, out, pixels); }});
+    for (DitherMode mode : {DitherMode::Bayer4, DitherMode::Bayer8, DitherMode::BlueNoise}) {
+        for (PixelFormat format : {PixelFormat::Rgb666, PixelFormat::Rgb565}) {
+            const size_t out_bpp = BytesPerPixel(format);
+            kernels.push_back({std::string("dither ") + DitherModeName(mode) + " rgb888->" +
+                                   (format == PixelFormat::Rgb565 ? "rgb565" : "rgb666"),
+                               pixels * (3 + out_bpp), [=] {
+                                   ConvertView(MakeView(in, w, h, PixelFormat::Rgb888),
+                                               MakeView(out, w, h, format), mode);
+                               }});
+        }
+    }
+    for (size_t bpp : {3U, 2U}) {
+        for (int rotation : {90, 180, 270}) {
+            std::string name = std::string("rotate ") + (bpp == 3 ? "rgb666 " : "rgb565 ") + std::to_string(rotation);
+            if (HasFixedRotation(w, h, bpp, rotation)) {
+                name += " (fixed)";
+            }
+            kernels.push_back({name, pixels * bpp * 2, [=] { RotateFrame(in, out, w, h, bpp, rotation); }});
+        }
+    }
+    kernels.push_back({"compose rgb888->rgb666 90", pixels * 6, [=] {
+                           ComposeFrame(in, SourceFormat::Rgb888, 0, out, w, h, 3, 90, nullptr);
+                       }});
+    kernels.push_back({"compose rgb666 90", pixels * 6, [=] {
+                           ComposeFrame(in, SourceFormat::Output, 0, out, w, h, 3, 90, nullptr);
+                       }});
+    kernels.push_back({"damage hash", pixels * 3, [&damage, &rects, in, w] {
+                           damage.detect(in, static_cast<size_t>(w) * 3, rects);
+                       }});
+    return kernels;
+}
+
+std::vector<KernelResult> RunKernelSuite(const BenchOptions& options) {
+    using namespace ili9488::pixel;
+    const SimdLevel detected = ActiveSimdLevel();
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Ssse3, SimdLevel::Avx2, SimdLevel::Neon}) {
+        const bool wanted = options.simd == "all" ? SelectSimdLevel(level)
+                            : options.simd == "active" ? level == detected
+                                                        : options.simd == SimdLevelName(level) && SelectSimdLevel(level);
+        if (wanted) {
+            levels.push_back(level);
+        }
+    }
+    SelectSimdLevel(detected);
+    if (levels.empty()) {
+        std::fprintf(stderr, "Kernel suite: SIMD level '%s' is not supported here\n", options.simd.c_str());
+        return {};
+    }
+
+    PerfCounters perf;
+    std::printf("Kernel suite: single thread, %s", perf.available() ? "perf counters" : "no perf counters");
+    if (!perf.available() && options.cpu_mhz > 0) {
+        std::printf(", cycles estimated at %u MHz", options.cpu_mhz);
+    }
+    std::printf("\n\n");
+    std::printf("%-34s %-7s %10s %10s %10s %8s %8s %10s\n", "kernel", "simd", "size", "us/call", "MB/s", "ns/px",
+                "cyc/px", "miss/KB");
+
+    // Every call touches the same amount of memory whatever the size, so
+    // large frames do not take minutes.
+    const size_t base_pixels = static_cast<size_t>(options.width) * options.height;
+    std::vector<KernelResult> results;
+    for (const Size size : options.sizes) {
+        const size_t pixels = static_cast<size_t>(size.width) * size.height;
+        std::vector<uint8_t> src(pixels * 4);
+        std::vector<uint8_t> dst(pixels * 4);
+        for (size_t i = 0; i < src.size(); ++i) {
+            src[i] = static_cast<uint8_t>(i * 31U + (i >> 11));
+        }
+        ili9488::DamageTracker damage;
+        damage.configure(size.width, size.height, 3);
+        std::vector<ili9488::Rect> rects;
+        const std::vector<Kernel> kernels = MakeKernels(size, src, dst, damage, rects);
+        const uint32_t iterations = static_cast<uint32_t>(
+            std::max<size_t>(5, static_cast<size_t>(options.iterations) * base_pixels / pixels));
+        const std::string size_name = std::to_string(size.width) + "x" + std::to_string(size.height);
+
+        for (SimdLevel level : levels) {
+            SelectSimdLevel(level);
+            for (const Kernel& kernel : kernels) {
+                kernel.run();
+                uint64_t counts[3] = {};
+                bool counted = false;
+                if (perf.available()) {
+                    perf.start();
+                }
+                const double us = TimeUs({kernel.name.c_str(), kernel.run}, iterations);
+                if (perf.available()) {
+                    counted = perf.stop(counts);
+                }
+
+                KernelResult result;
+                result.kernel = kernel.name;
+                result.simd = SimdLevelName(level);
+                result.size = size;
+                result.iterations = iterations;
+                result.us = us;
+                result.mb_per_s = static_cast<double>(kernel.bytes) / us;
+                result.ns_per_pixel = us * 1000.0 / static_cast<double>(pixels);
+                result.cycles_per_pixel = -1.0;
+                result.cache_miss_rate = -1.0;
+                result.cache_misses_per_kb = -1.0;
+                // The counters also saw the warm-up call inside TimeUs.
+                const double calls = static_cast<double>(iterations) + 1.0;
+                if (counted) {
+                    result.cycles_per_pixel = static_cast<double>(counts[0]) / calls / static_cast<double>(pixels);
+                    if (counts[1] > 0) {
+                        result.cache_miss_rate = static_cast<double>(counts[2]) / static_cast<double>(counts[1]);
+                    }
+                    result.cache_misses_per_kb =
+                        static_cast<double>(counts[2]) / calls / (static_cast<double>(kernel.bytes) / 1024.0);
+                } else if (options.cpu_mhz > 0) {
+                    result.cycles_per_pixel = result.ns_per_pixel * options.cpu_mhz / 1000.0;
+                }
+
+                char cycles[16] = "-";
+                char misses[16] = "-";
+                if (result.cycles_per_pixel >= 0.0) {
+                    std::snprintf(cycles, sizeof(cycles), "%.2f", result.cycles_per_pixel);
+                }
+                if (result.cache_misses_per_kb >= 0.0) {
+                    std::snprintf(misses, sizeof(misses), "%.2f", result.cache_misses_per_kb);
+                }
+                std::printf("%-34s %-7s %10s %10.1f %10.0f %8.3f %8s %10s\n", result.kernel.c_str(), result.simd,
+                            size_name.c_str(), result.us, result.mb_per_s, result.ns_per_pixel, cycles, misses);
+                results.push_back(result);
+            }
+        }
+        SelectSimdLevel(detected);
+    }
+    std::printf("\nMB/s counts bytes read plus bytes written per call.\n\n");
+    return results;
+}
+
+std::vector<ScalingResult> RunThreadScaling(const BenchOptions& options) {
+    const uint32_t w = options.width;
+    const uint32_t h = options.height;
+    const size_t pixels = static_cast<size_t>(w) * h;
+    std::vector<uint8_t> rgb888(pixels * 3);
+    std::vector<uint8_t> rgb666(pixels * 3);
+    std::vector<uint8_t> rgb565(pixels * 2);
+    std::vector<uint8_t> rotated(pixels * 3);
+    for (size_t i = 0; i < rgb888.size(); ++i) {
+        rgb888[i] = static_cast<uint8_t>(i * 31U);
+    }
+    ili9488::pixel::ConvertRgb888ToRgb666(rgb888.data(), rgb666.data(), pixels);
+    ili9488::pixel::ConvertRgb888ToRgb565(rgb888.data(), rgb565.data(), pixels);
+
+    ili9488::DamageTracker damage;
+    damage.configure(w, h, 3);
+    std::vector<ili9488::Rect> rects;
+
+    using namespace ili9488::pixel;
+    const Workload workloads[] = {
+        {"convert rgb888->rgb666", [&] { ConvertRgb888ToRgb666(rgb888.data(), rgb666.data(), pixels); }},
+        {"convert rgb888->rgb565", [&] { ConvertRgb888ToRgb565(rgb888.data(), rgb565.data(), pixels); }},
+        {"rotate rgb666 90", [&] { RotateRgb666(rgb666.data(), rotated.data(), w, h, 90); }},
+        {"rotate rgb666 180", [&] { RotateRgb666(rgb666.data(), rotated.data(), w, h, 180); }},
+        {"rotate rgb666 270", [&] { RotateRgb666(rgb666.data(), rotated.data(), w, h, 270); }},
+        {"rotate rgb565 90", [&] { RotateRgb565(rgb565.data(), rotated.data(), w, h, 90); }},
+        {"damage hash", [&] { damage.detect(rgb666.data(), static_cast<size_t>(w) * 3, rects); }},
+    };
+
+    const unsigned cpus = std::max(1U, std::thread::hardware_concurrency());
+    std::printf("Thread scaling: %ux%u, %u iterations\n\n", w, h, options.iterations);
+    std::printf("%-24s", "workload");
+    for (uint32_t threads = 1; threads <= options.max_threads; ++threads) {
+        std::printf(" %9u thr", threads);
+    }
+    std::printf("\n");
+
+    std::vector<ScalingResult> results;
+    for (const Workload& workload : workloads) {
+        results.push_back({workload.name, {}});
+    }
+    for (uint32_t threads = 1; threads <= options.max_threads; ++threads) {
+        std::vector<int> pin_cpus;
+        if (options.pin) {
+            for (uint32_t i = 0; i < threads; ++i) {
+                pin_cpus.push_back(static_cast<int>(i % cpus));
+            }
+        }
+        ili9488::WorkerPool pool(threads, pin_cpus);
+        SetWorkerPool(&pool);
+        damage.setWorkerPool(&pool);
+        for (size_t i = 0; i < std::size(workloads); ++i) {
+            results[i].us.push_back(TimeUs(workloads[i], options.iterations));
+        }
+        SetWorkerPool(nullptr);
+        damage.setWorkerPool(nullptr);
+    }
+
+    for (const ScalingResult& result : results) {
+        std::printf("%-24s", result.workload);
+        for (double us : result.us) {
+            std::printf(" %8.1f us", us);
+        }
+        std::printf("   x%.2f\n", result.us.front() / result.us.back());
+    }
+    std::printf("\nPer-call averages. The last column is the speedup of %u threads over 1.\n",
+                options.max_threads);
+    return results;
+}
+
+void WriteJsonNumber(FILE* out, const char* key, double value, const char* separator) {
+    if (value < 0.0) {
+        std::fprintf(out, "\"%s\": null%s", key, separator);
+    } else {
+        std::fprintf(out, "\"%s\": %.4f%s", key, value, separator);
+    }
+}
+
+void WriteJson(FILE* out, const BenchOptions& options, bool perf_counters, const std::vector<KernelResult>& kernels,
+               const std::vector<ScalingResult>& scaling) {
+    using namespace ili9488::pixel;
+    std::fprintf(out, "{\n  \"optimized_build\": %s,\n  \"simd_detected\": \"%s\",\n  \"cpus\": %u,\n  \"perf_counters\": %s,\n",
+                 kOptimizedBuild ? "true" : "false", SimdLevelName(DetectSimdLevel()), std::max(1U, std::thread::hardware_concurrency()),
+                 perf_counters ? "true" : "false");
+    std::fprintf(out, "  \"iterations\": %u,\n  \"cpu_mhz\": %u,\n  \"kernels\": [", options.iterations,
+                 options.cpu_mhz);
+    for (size_t i = 0; i < kernels.size(); ++i) {
+        const KernelResult& r = kernels[i];
+        std::fprintf(out, "%s\n    {\"kernel\": \"%s\", \"simd\": \"%s\", \"width\": %u, \"height\": %u, "
+                          "\"iterations\": %u, ",
+                     i == 0 ? "" : ",", r.kernel.c_str(), r.simd, r.size.width, r.size.height, r.iterations);
+        WriteJsonNumber(out, "us_per_call", r.us, ", ");
+        WriteJsonNumber(out, "mb_per_s", r.mb_per_s, ", ");
+        WriteJsonNumber(out, "ns_per_pixel", r.ns_per_pixel, ", ");
+        WriteJsonNumber(out, "cycles_per_pixel", r.cycles_per_pixel, ", ");
+        WriteJsonNumber(out, "cache_miss_rate", r.cache_miss_rate, ", ");
+        WriteJsonNumber(out, "cache_misses_per_kb", r.cache_misses_per_kb, "}");
+    }
+    std::fprintf(out, "%s],\n  \"thread_scaling\": {\"width\": %u, \"height\": %u, \"workloads\": [",
+                 kernels.empty() ? "" : "\n  ", options.width, options.height);
+    for (size_t i = 0; i < scaling.size(); ++i) {
+        std::fprintf(out, "%s\n    {\"workload\": \"%s\", \"us_per_call\": [", i == 0 ? "" : ",",
+                     scaling[i].workload);
+        for (size_t t = 0; t < scaling[i].us.size(); ++t) {
+            std::fprintf(out, "%s%.4f", t == 0 ? "" : ", ", scaling[i].us[t]);
+        }
+        std::fprintf(out, "]}");
+    }
+    std::fprintf(out, "%s]}\n}\n", scaling.empty() ? "" : "\n  ");
+}
+
+}
+
+int main(int argc, char** argv) {
+    const BenchOptions options = ParseOptions(argc, argv);
+    const bool run_kernels = options.suite == "all" || options.suite == "kernels";
+    const bool run_threads = options.suite == "all" || options.suite == "threads";
+    if (options.width == 0 || options.height == 0 || options.iterations == 0 || options.max_threads == 0 ||
+        (!run_kernels && !run_threads) || (run_kernels && options.sizes.empty())) {
+        std::fprintf(stderr, "Usage: %s [--suite all|kernels|threads] [--width px] [--height px]"
+                             " [--iterations n] [--max-threads n] [--pin 0|1] [--sizes WxH,...]"
+                             " [--simd all|active|scalar|ssse3|avx2|neon] [--cpu-mhz n] [--json file|-]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    // With --json - the JSON keeps stdout and the tables go to stderr.
+    FILE* json = nullptr;
+    if (options.json_path == "-") {
+        json = fdopen(dup(STDOUT_FILENO), "w");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    } else if (!options.json_path.empty()) {
+        json = std::fopen(options.json_path.c_str(), "w");
+    }
+    if (!options.json_path.empty() && json == nullptr) {
+        std::perror("ili9488-bench: json");
+        return 1;
+    }
+
+    const unsigned cpus = std::max(1U, std::thread::hardware_concurrency());
+    std::printf("%s kernels detected, %u CPUs online\n\n",
+                ili9488::pixel::SimdLevelName(ili9488::pixel::ActiveSimdLevel()), cpus);
+    if (!kOptimizedBuild) {
+        // Intrinsics are not inlined at -O0, which makes SIMD slower than scalar.
+        std::printf("WARNING: unoptimized build, configure with -DCMAKE_BUILD_TYPE=Release\n\n");
+    }
+    std::vector<KernelResult> kernels;
+    std::vector<ScalingResult> scaling;
+    if (run_kernels) {
+        kernels = RunKernelSuite(options);
+    }
+    if (run_threads) {
+        scaling = RunThreadScaling(options);
+    }
+    if (json != nullptr) {
+        const PerfCounters perf;
+        WriteJson(json, options, perf.available(), kernels, scaling);
+        std::fclose(json);
+    }
+    return 0;
+}
@@ -3,29 +3,35 @@
 #include "ili9488_rotate.h"
 #include "spi_dma_linux.h"
 #include "pixel_utils.h"
+#include "damage_tracker.h"
+#include "triple_buffer_protocol.h"
+#include "buffer_export.h"
+#include "frame_stats.h"
+#include "panel_simulator.h"
+#include "worker_pool.h"
+#include "realtime.h"
+#include "frame_recording.h"
+#include <sys/epoll.h>
 #include <sys/mman.h>
+#include <sys/signalfd.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
+#include <atomic>
 #include <cerrno>
 #include <chrono>
-#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
-#include <thread>
 #include <vector>
 #include <semaphore.h>
 
 namespace {
-volatile std::sig_atomic_t g_running = 1;
-
-void HandleSignal(int) {
-    g_running = 0;
-}
-
 struct Options {
     std::string shm_name;
     uint32_t width = 0;
@@ -33,8 +39,31 @@ struct Options {
     int rotation_degrees = 0;
     bool overlay_fps = true;
     uint32_t max_fps = 20;
+    bool panel_rotation = true;
+    bool damage_tracking = true;
+    uint32_t damage_tile = ili9488::DamageTracker::kDefaultTileSize;
+    std::string export_socket = ili9488::kDefaultExportSocket;
+    bool direct_dma = false;
+    std::string bus = "spidev";
+    std::string sim_dump;
+    std::string pixel_format = "rgb666";
+    uint32_t worker_threads = 1;
+    std::vector<int> worker_cpus;
+    std::string stats_socket = ili9488::kDefaultStatsSocket;
+    std::string stats_file = ili9488::kDefaultStatsFile;
+    uint32_t stats_interval_ms = ili9488::kDefaultStatsIntervalMs;
+    uint32_t rt_priority = 0;
+    std::vector<int> ingest_cpus;
+    std::vector<int> transmit_cpus;
+    bool mlock = false;
+    bool prefault = true;
+    std::string record_path;
+    std::string replay_path;
 };
 
+// Stack the frame loop may use, faulted in at startup.
+constexpr size_t kPrefaultStackBytes = 256 * 1024;
+
 uint32_t ParseUintEnv(const char* value) {
     if (!value) {
         return 0;
@@ -44,6 +73,25 @@ uint32_t ParseUintEnv(const char* value) {
     return (end && *end == '\0') ? static_cast<uint32_t>(parsed) : 0U;
 }
 
+std::vector<int> ParseCpuList(const std::string& value) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < value.size()) {
+        const size_t comma = value.find(',', pos);
+        const std::string item = value.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        char* end = nullptr;
+        const long cpu = std::strtol(item.c_str(), &end, 10);
+        if (!item.empty() && end != nullptr && *end == '\0' && cpu >= 0) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+    return cpus;
+}
+
 Options ParseOptions(int argc, char** argv) {
     Options options;
     if (const char* env_name = std::getenv("ILI9488_SHM_NAME")) {
@@ -57,6 +105,67 @@ Options ParseOptions(int argc, char** argv) {
     if (env_max_fps > 0) {
         options.max_fps = env_max_fps;
     }
+    if (const char* env_panel_rotation = std::getenv("ILI9488_PANEL_ROTATION")) {
+        options.panel_rotation = ParseUintEnv(env_panel_rotation) != 0U;
+    }
+    if (const char* env_damage = std::getenv("ILI9488_DAMAGE_TRACKING")) {
+        options.damage_tracking = ParseUintEnv(env_damage) != 0U;
+    }
+    const uint32_t env_damage_tile = ParseUintEnv(std::getenv("ILI9488_DAMAGE_TILE"));
+    if (env_damage_tile > 0) {
+        options.damage_tile = env_damage_tile;
+    }
+    if (const char* env_export = std::getenv("ILI9488_EXPORT_SOCKET")) {
+        options.export_socket = env_export;
+    }
+    if (const char* env_direct_dma = std::getenv("ILI9488_DIRECT_DMA")) {
+        options.direct_dma = ParseUintEnv(env_direct_dma) != 0U;
+    }
+    if (const char* env_bus = std::getenv("ILI9488_BUS")) {
+        options.bus = env_bus;
+    }
+    if (const char* env_sim_dump = std::getenv("ILI9488_SIM_DUMP")) {
+        options.sim_dump = env_sim_dump;
+    }
+    if (const char* env_pixel_format = std::getenv("ILI9488_PIXEL_FORMAT")) {
+        options.pixel_format = env_pixel_format;
+    }
+    const uint32_t env_worker_threads = ParseUintEnv(std::getenv("ILI9488_WORKER_THREADS"));
+    if (env_worker_threads > 0) {
+        options.worker_threads = env_worker_threads;
+    }
+    if (const char* env_worker_cpus = std::getenv("ILI9488_WORKER_CPUS")) {
+        options.worker_cpus = ParseCpuList(env_worker_cpus);
+    }
+    if (const char* env_stats_socket = std::getenv("ILI9488_STATS_SOCKET")) {
+        options.stats_socket = env_stats_socket;
+    }
+    if (const char* env_stats_file = std::getenv("ILI9488_STATS_FILE")) {
+        options.stats_file = env_stats_file;
+    }
+    const uint32_t env_stats_interval = ParseUintEnv(std::getenv("ILI9488_STATS_INTERVAL_MS"));
+    if (env_stats_interval > 0) {
+        options.stats_interval_ms = env_stats_interval;
+    }
+    options.rt_priority = ParseUintEnv(std::getenv("ILI9488_RT_PRIORITY"));
+    if (const char* env_ingest_cpus = std::getenv("ILI9488_INGEST_CPUS")) {
+        options.ingest_cpus = ParseCpuList(env_ingest_cpus);
+    }
+    if (const char* env_transmit_cpus = std::getenv("ILI9488_TRANSMIT_CPUS")) {
+        options.transmit_cpus = ParseCpuList(env_transmit_cpus);
+    }
+    if (const char* env_mlock = std::getenv("ILI9488_MLOCK")) {
+        options.mlock = ParseUintEnv(env_mlock) != 0U;
+    }
+    if (const char* env_prefault = std::getenv("ILI9488_PREFAULT")) {
+        options.prefault = ParseUintEnv(env_prefault) != 0U;
+    }
+    if (const char* env_record = std::getenv("ILI9488_RECORD")) {
+        options.record_path = env_record;
+    }
+    if (const char* env_replay = std::getenv("ILI9488_REPLAY")) {
+        options.replay_path = env_replay;
+    }
     for (int i = 1; i < argc; ++i) {
         const std::string arg = argv[i];
         constexpr const char* kShmPrefix = "--shm=";
@@ -65,6 +174,26 @@ Options ParseOptions(int argc, char** argv) {
         constexpr const char* kRotationPrefix = "--rotation=";
         constexpr const char* kOverlayFpsPrefix = "--fps-overlay=";
         constexpr const char* kMaxFpsPrefix = "--max-fps=";
+        constexpr const char* kPanelRotationPrefix = "--panel-rotation=";
+        constexpr const char* kDamagePrefix = "--damage-tracking=";
+        constexpr const char* kDamageTilePrefix = "--damage-tile=";
+        constexpr const char* kExportSocketPrefix = "--export-socket=";
+        constexpr const char* kDirectDmaPrefix = "--direct-dma=";
+        constexpr const char* kBusPrefix = "--bus=";
+        constexpr const char* kSimDumpPrefix = "--sim-dump=";
+        constexpr const char* kPixelFormatPrefix = "--pixel-format=";
+        constexpr const char* kWorkerThreadsPrefix = "--worker-threads=";
+        constexpr const char* kWorkerCpusPrefix = "--worker-cpus=";
+        constexpr const char* kStatsSocketPrefix = "--stats-socket=";
+        constexpr const char* kStatsFilePrefix = "--stats-file=";
+        constexpr const char* kStatsIntervalPrefix = "--stats-interval=";
+        constexpr const char* kRtPriorityPrefix = "--rt-priority=";
+        constexpr const char* kIngestCpusPrefix = "--ingest-cpus=";
+        constexpr const char* kTransmitCpusPrefix = "--transmit-cpus=";
+        constexpr const char* kMlockPrefix = "--mlock=";
+        constexpr const char* kPrefaultPrefix = "--prefault=";
+        constexpr const char* kRecordPrefix = "--record=";
+        constexpr const char* kReplayPrefix = "--replay=";
         if (arg.rfind(kShmPrefix, 0) == 0) {
             options.shm_name = arg.substr(std::strlen(kShmPrefix));
         } else if (arg == "--shm" && i + 1 < argc) {
@@ -89,13 +218,237 @@ Options ParseOptions(int argc, char** argv) {
             options.max_fps = ParseUintEnv(arg.c_str() + std::strlen(kMaxFpsPrefix));
         } else if (arg == "--max-fps" && i + 1 < argc) {
             options.max_fps = ParseUintEnv(argv[++i]);
+        } else if (arg.rfind(kPanelRotationPrefix, 0) == 0) {
+            options.panel_rotation = ParseUintEnv(arg.c_str() + std::strlen(kPanelRotationPrefix)) != 0U;
+        } else if (arg == "--panel-rotation" && i + 1 < argc) {
+            options.panel_rotation = ParseUintEnv(argv[++i]) != 0U;
+        } else if (arg.rfind(kDamagePrefix, 0) == 0) {
+            options.damage_tracking = ParseUintEnv(arg.c_str() + std::strlen(kDamagePrefix)) != 0U;
+        } else if (arg == "--damage-tracking" && i + 1 < argc) {
+            options.damage_tracking = ParseUintEnv(argv[++i]) != 0U;
+        } else if (arg.rfind(kDamageTilePrefix, 0) == 0) {
+            options.damage_tile = ParseUintEnv(arg.c_str() + std::strlen(kDamageTilePrefix));
+        } else if (arg == "--damage-tile" && i + 1 < argc) {
+            options.damage_tile = ParseUintEnv(argv[++i]);
+        } else if (arg.rfind(kExportSocketPrefix, 0) == 0) {
+            options.export_socket = arg.substr(std::strlen(kExportSocketPrefix));
+        } else if (arg == "--export-socket" && i + 1 < argc) {
+            options.export_socket = argv[++i];
+        } else if (arg.rfind(kDirectDmaPrefix, 0) == 0) {
+            options.direct_dma = ParseUintEnv(arg.c_str() + std::strlen(kDirectDmaPrefix)) != 0U;
+        } else if (arg == "--direct-dma" && i + 1 < argc) {
+            options.direct_dma = ParseUintEnv(argv[++i]) != 0U;
+        } else if (arg.rfind(kBusPrefix, 0) == 0) {
+            options.bus = arg.substr(std::strlen(kBusPrefix));
+        } else if (arg == "--bus" && i + 1 < argc) {
+            options.bus = argv[++i];
+        } else if (arg.rfind(kSimDumpPrefix, 0) == 0) {
+            options.sim_dump = arg.substr(std::strlen(kSimDumpPrefix));
+        } else if (arg == "--sim-dump" && i + 1 < argc) {
+            options.sim_dump = argv[++i];
+        } else if (arg.rfind(kPixelFormatPrefix, 0) == 0) {
+            options.pixel_format = arg.substr(std::strlen(kPixelFormatPrefix));
+        } else if (arg == "--pixel-format" && i + 1 < argc) {
+            options.pixel_format = argv[++i];
+        } else if (arg.rfind(kWorkerThreadsPrefix, 0) == 0) {
+            options.worker_threads = ParseUintEnv(arg.c_str() + std::strlen(kWorkerThreadsPrefix));
+        } else if (arg == "--worker-threads" && i + 1 < argc) {
+            options.worker_threads = ParseUintEnv(argv[++i]);
+        } else if (arg.rfind(kWorkerCpusPrefix, 0) == 0) {
+            options.worker_cpus = ParseCpuList(arg.substr(std::strlen(kWorkerCpusPrefix)));
+        } else if (arg == "--worker-cpus" && i + 1 < argc) {
+            options.worker_cpus = ParseCpuList(argv[++i]);
+        } else if (arg.rfind(kStatsSocketPrefix, 0) == 0) {
+            options.stats_socket = arg.substr(std::strlen(kStatsSocketPrefix));
+        } else if (arg == "--stats-socket" && i + 1 < argc) {
+            options.stats_socket = argv[++i];
+        } else if (arg.rfind(kStatsFilePrefix, 0) == 0) {
+            options.stats_file = arg.substr(std::strlen(kStatsFilePrefix));
+        } else if (arg == "--stats-file" && i + 1 < argc) {
+            options.stats_file = argv[++i];
+        } else if (arg.rfind(kStatsIntervalPrefix, 0) == 0) {
+            options.stats_interval_ms = ParseUintEnv(arg.c_str() + std::strlen(kStatsIntervalPrefix));
+        } else if (arg == "--stats-interval" && i + 1 < argc) {
+            options.stats_interval_ms = ParseUintEnv(argv[++i]);
+        } else if (arg.rfind(kRtPriorityPrefix, 0) == 0) {
+            options.rt_priority = ParseUintEnv(arg.c_str() + std::strlen(kRtPriorityPrefix));
+        } else if (arg == "--rt-priority" && i + 1 < argc) {
+            options.rt_priority = ParseUintEnv(argv[++i]);
+        } else if (arg.rfind(kIngestCpusPrefix, 0) == 0) {
+            options.ingest_cpus = ParseCpuList(arg.substr(std::strlen(kIngestCpusPrefix)));
+        } else if (arg == "--ingest-cpus" && i + 1 < argc) {
+            options.ingest_cpus = ParseCpuList(argv[++i]);
+        } else if (arg.rfind(kTransmitCpusPrefix, 0) == 0) {
+            options.transmit_cpus = ParseCpuList(arg.substr(std::strlen(kTransmitCpusPrefix)));
+        } else if (arg == "--transmit-cpus" && i + 1 < argc) {
+            options.transmit_cpus = ParseCpuList(argv[++i]);
+        } else if (arg.rfind(kMlockPrefix, 0) == 0) {
+            options.mlock = ParseUintEnv(arg.c_str() + std::strlen(kMlockPrefix)) != 0U;
+        } else if (arg == "--mlock" && i + 1 < argc) {
+            options.mlock = ParseUintEnv(argv[++i]) != 0U;
+        } else if (arg.rfind(kPrefaultPrefix, 0) == 0) {
+            options.prefault = ParseUintEnv(arg.c_str() + std::strlen(kPrefaultPrefix)) != 0U;
+        } else if (arg == "--prefault" && i + 1 < argc) {
+            options.prefault = ParseUintEnv(argv[++i]) != 0U;
+        } else if (arg.rfind(kRecordPrefix, 0) == 0) {
+            options.record_path = arg.substr(std::strlen(kRecordPrefix));
+        } else if (arg == "--record" && i + 1 < argc) {
+            options.record_path = argv[++i];
+        } else if (arg.rfind(kReplayPrefix, 0) == 0) {
+            options.replay_path = arg.substr(std::strlen(kReplayPrefix));
+        } else if (arg == "--replay" && i + 1 < argc) {
+            options.replay_path = argv[++i];
         }
     }
     return options;
 }
 
+ili9488::Rotation RotationFromDegrees(int degrees) {
+    switch (degrees) {
+        case 90:
+            return ili9488::Rotation::Deg90;
+        case 180:
+            return ili9488::Rotation::Deg180;
+        case 270:
+            return ili9488::Rotation::Deg270;
+        default:
+            return ili9488::Rotation::Deg0;
+    }
+}
+
+void PrintDamageStats(const ili9488::DamageStats& stats) {
+    const double dirty_pct = stats.tiles_scanned > 0
+                                 ? (100.0 * static_cast<double>(stats.tiles_dirty)) / static_cast<double>(stats.tiles_scanned)
+                                 : 0.0;
+    std::fprintf(stderr,
+                 "Damage tracking: frames=%llu tiles_scanned=%llu tiles_dirty=%llu (%.1f%%) bytes_saved=%llu\n",
+                 static_cast<unsigned long long>(stats.frames),
+                 static_cast<unsigned long long>(stats.tiles_scanned),
+                 static_cast<unsigned long long>(stats.tiles_dirty),
+                 dirty_pct,
+                 static_cast<unsigned long long>(stats.bytesSaved()));
+}
+
+void PrintBusStats(const ili9488::BusStats& stats) {
+    const double avg_us = stats.syscalls() > 0
+                              ? static_cast<double>(stats.ioctl_ns) / static_cast<double>(stats.syscalls()) / 1000.0
+                              : 0.0;
+    std::fprintf(stderr,
+                 "SPI bus: messages=%llu transfers=%llu gpio_writes=%llu bytes=%llu avg_ioctl=%.1fus max_ioctl=%.1fus\n",
+                 static_cast<unsigned long long>(stats.spi_messages),
+                 static_cast<unsigned long long>(stats.spi_transfers),
+                 static_cast<unsigned long long>(stats.gpio_writes),
+                 static_cast<unsigned long long>(stats.bytes),
+                 avg_us,
+                 static_cast<double>(stats.max_ioctl_ns) / 1000.0);
+}
+
+void PrintBusMappingStats(const ili9488::BusMappingStats& stats) {
+    if (stats.hits == 0 && stats.misses == 0) {
+        return;
+    }
+    std::fprintf(stderr, "Bus mappings: entries=%zu hits=%llu misses=%llu evictions=%llu\n",
+                 stats.entries,
+                 static_cast<unsigned long long>(stats.hits),
+                 static_cast<unsigned long long>(stats.misses),
+                 static_cast<unsigned long long>(stats.evictions));
+}
+
+void DumpSimulator(ili9488::ILI9488Driver& driver, const std::string& path) {
+    ili9488::SimulatorBus* simulator = driver.getSimulator();
+    if (simulator == nullptr) {
+        return;
+    }
+    const double wire_ms = static_cast<double>(simulator->wireTimeNs()) / 1e6;
+    if (path.empty()) {
+        std::fprintf(stderr, "Panel simulator: wire time %.1f ms\n", wire_ms);
+    } else if (simulator->writePpm(path)) {
+        std::fprintf(stderr, "Panel simulator: wire time %.1f ms, GRAM written to %s\n", wire_ms, path.c_str());
+    }
+}
+
 constexpr uint8_t kFontHeight = 8;
 constexpr uint8_t kFontWidth = 8;
+// v1 clients do not wake the daemon, so frame_counter is polled every
+// millisecond until a v2 client attaches. After that it is checked once a
+// second, in case a v1 client takes over.
+constexpr int kLegacyPollMs = 1;
+constexpr int kLegacyCheckMs = 1000;
+
+enum EventSource : uint32_t {
+    kEventSignal,
+    kEventTimer,
+    kEventFrame,
+    kEventExport
+};
+
+// The main loop sleeps in epoll on signals (signalfd), the max_fps pacing
+// timer (timerfd, absolute CLOCK_MONOTONIC deadlines), frame wakeups and the
+// export socket.
+class EventLoop {
+public:
+    ~EventLoop() {
+        for (int fd : {timer_fd_, signal_fd_, epoll_fd_}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    bool open(const sigset_t& signals) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        signal_fd_ = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (epoll_fd_ < 0 || signal_fd_ < 0 || timer_fd_ < 0) {
+            std::perror("Event loop");
+            return false;
+        }
+        return watch(signal_fd_, kEventSignal) && watch(timer_fd_, kEventTimer);
+    }
+
+    bool watch(int fd, EventSource source) {
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.u32 = source;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            std::perror("Event loop: epoll_ctl");
+            return false;
+        }
+        return true;
+    }
+
+    bool armTimer(uint64_t deadline_ns) {
+        itimerspec spec {};
+        spec.it_value.tv_sec = static_cast<time_t>(deadline_ns / 1000000000ULL);
+        spec.it_value.tv_nsec = static_cast<long>(deadline_ns % 1000000000ULL);
+        return timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) == 0;
+    }
+
+    void readTimer() {
+        uint64_t expirations = 0;
+        while (read(timer_fd_, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {
+        }
+    }
+
+    bool readSignal(int* signo) {
+        signalfd_siginfo info {};
+        if (read(signal_fd_, &info, sizeof(info)) != static_cast<ssize_t>(sizeof(info))) {
+            return false;
+        }
+        *signo = static_cast<int>(info.ssi_signo);
+        return true;
+    }
+
+    int wait(epoll_event* events, int max_events, int timeout_ms) {
+        const int count = epoll_wait(epoll_fd_, events, max_events, timeout_ms);
+        return count < 0 ? 0 : count;
+    }
+
+private:
+    int epoll_fd_ = -1;
+    int signal_fd_ = -1;
+    int timer_fd_ = -1;
+};
 
 struct Glyph {
     char ch;
@@ -130,8 +483,8 @@ const Glyph* FindGlyph(char ch) {
     return &kFont[0];
 }
 
-void DrawChar(uint8_t* buffer, uint32_t width, uint32_t height, size_t stride_bytes,
-              uint32_t x, uint32_t y, char ch, uint8_t r, uint8_t g, uint8_t b) {
+void DrawChar(uint8_t* buffer, uint32_t width, uint32_t height, size_t stride_bytes, size_t bytes_per_pixel,
+              uint32_t x, uint32_t y, char ch, const uint8_t* color) {
     const Glyph* glyph = FindGlyph(ch);
     for (uint32_t row = 0; row < kFontHeight; ++row) {
         if (y + row >= height) {
@@ -144,21 +497,17 @@ void DrawChar(uint8_t* buffer, uint32_t width, uint32_t height, size_t stride_by
                 continue;
             }
             if (bits & (0x80 >> col)) {
-                size_t pixel_offset = static_cast<size_t>(x + col) * 3U;
-                dst[pixel_offset + 0] = r;
-                dst[pixel_offset + 1] = g;
-                dst[pixel_offset + 2] = b;
+                std::memcpy(dst + static_cast<size_t>(x + col) * bytes_per_pixel, color, bytes_per_pixel);
             }
         }
     }
 }
 
-void DrawText(uint8_t* buffer, uint32_t width, uint32_t height, size_t stride_bytes,
-              uint32_t x, uint32_t y, const std::string& text,
-              uint8_t r, uint8_t g, uint8_t b) {
+void DrawText(uint8_t* buffer, uint32_t width, uint32_t height, size_t stride_bytes, size_t bytes_per_pixel,
+              uint32_t x, uint32_t y, const std::string& text, const uint8_t* color) {
     uint32_t cursor_x = x;
     for (char ch : text) {
-        DrawChar(buffer, width, height, stride_bytes, cursor_x, y, ch, r, g, b);
+        DrawChar(buffer, width, height, stride_bytes, bytes_per_pixel, cursor_x, y, ch, color);
         cursor_x += kFontWidth;
         if (cursor_x >= width) {
             break;
@@ -171,7 +520,13 @@ int main(int argc, char** argv) {
     const Options options = ParseOptions(argc, argv);
     if (options.shm_name.empty() || options.width == 0 || options.height == 0) {
         std::cerr << "Usage: ili9488_daemon --shm <name> --width <w> --height <h>"
-                     " [--rotation <deg>] [--fps <0|1>]\n"
+                     " [--rotation <deg>] [--fps <0|1>] [--panel-rotation <0|1>]"
+                     " [--damage-tracking <0|1>] [--damage-tile <px>] [--export-socket <path>]"
+                     " [--direct-dma <0|1>] [--bus <spidev|sim>] [--sim-dump <file.ppm>]"
+                     " [--pixel-format <rgb666|rgb565>] [--worker-threads <n>] [--worker-cpus <list>]"
+                     " [--stats-socket <path>] [--stats-file <path>] [--stats-interval <ms>]"
+                     " [--rt-priority <0-99>] [--ingest-cpus <list>] [--transmit-cpus <list>]"
+                     " [--mlock <0|1>] [--prefault <0|1>] [--record <file>] [--replay <file>]\n"
                      "Or set ILI9488_SHM_NAME/ILI9488_WIDTH/ILI9488_HEIGHT/ILI9488_ROTATION/ILI9488_FPS"
                      " in /etc/default/ili9488-daemon.\n";
         return 1;
@@ -181,23 +536,86 @@ int main(int argc, char** argv) {
         std::cerr << "Rotation must be 0, 90, 180, or 270 degrees.\n";
         return 1;
     }
-    std::signal(SIGINT, HandleSignal);
-    std::signal(SIGTERM, HandleSignal);
+    if (options.bus != "spidev" && options.bus != "sim") {
+        std::cerr << "Bus must be spidev or sim.\n";
+        return 1;
+    }
+    if (options.pixel_format != "rgb666" && options.pixel_format != "rgb565") {
+        std::cerr << "Pixel format must be rgb666 or rgb565.\n";
+        return 1;
+    }
+    if (options.worker_threads == 0 || options.worker_threads > 16) {
+        std::cerr << "Worker threads must be between 1 and 16.\n";
+        return 1;
+    }
+    if (options.stats_interval_ms == 0) {
+        std::cerr << "Stats interval must be at least 1 ms.\n";
+        return 1;
+    }
+    if (options.rt_priority > 99) {
+        std::cerr << "Real-time priority must be between 0 (off) and 99.\n";
+        return 1;
+    }
+    if (!options.record_path.empty() && !options.replay_path.empty()) {
+        std::cerr << "Use either --record or --replay, not both.\n";
+        return 1;
+    }
+    // Blocked before any thread starts, so they are only seen through the
+    // signalfd: SIGINT/SIGTERM stop, SIGUSR1 dumps counters, SIGHUP forces a
+    // full refresh.
+    sigset_t handled_signals;
+    sigemptyset(&handled_signals);
+    sigaddset(&handled_signals, SIGINT);
+    sigaddset(&handled_signals, SIGTERM);
+    sigaddset(&handled_signals, SIGHUP);
+    sigaddset(&handled_signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &handled_signals, nullptr);
 
     const bool swap_axes = options.rotation_degrees == 90 || options.rotation_degrees == 270;
     const uint32_t framebuffer_width = swap_axes ? options.height : options.width;
     const uint32_t framebuffer_height = swap_axes ? options.width : options.height;
     const int rotation_to_apply = (360 - options.rotation_degrees) % 360;
-    const size_t stride_bytes = static_cast<size_t>(framebuffer_width) * 3U;
-    const size_t framebuffer_bytes = stride_bytes * static_cast<size_t>(framebuffer_height);
-    const size_t display_bytes = static_cast<size_t>(options.width) * options.height * 3U;
+    const bool rgb565 = options.pixel_format == "rgb565";
+    const size_t bytes_per_pixel = rgb565 ? 2U : 3U;
+    const ili9488::pixel::PixelFormat pixel_format =
+        rgb565 ? ili9488::pixel::PixelFormat::Rgb565 : ili9488::pixel::PixelFormat::Rgb666;
+    const size_t stride_bytes = static_cast<size_t>(framebuffer_width) * bytes_per_pixel;
+
+    ili9488::FramePlayer player;
+    ili9488::FrameRecorder recorder;
+    std::string recording_status = "- Disabled";
+    if (!options.replay_path.empty()) {
+        if (!player.open(options.replay_path)) {
+            std::cerr << "ERROR: Failed to open recording " << options.replay_path << ".\n";
+            return 1;
+        }
+        if (player.width() != framebuffer_width || player.height() != framebuffer_height ||
+            player.bytesPerPixel() != bytes_per_pixel) {
+            std::cerr << "ERROR: " << options.replay_path << " holds " << player.width() << "x" << player.height()
+                      << " frames at " << player.bytesPerPixel() << " bytes/pixel, the daemon expects "
+                      << framebuffer_width << "x" << framebuffer_height << " at " << bytes_per_pixel << ".\n";
+            return 1;
+        }
+        recording_status = "✓ Replaying " + options.replay_path + " (" + std::to_string(player.frameCount()) +
+                           " frames, SHM clients ignored)";
+    } else if (!options.record_path.empty()) {
+        if (!recorder.open(options.record_path, framebuffer_width, framebuffer_height, bytes_per_pixel)) {
+            std::cerr << "ERROR: Failed to create recording " << options.record_path << ".\n";
+            return 1;
+        }
+        recording_status = "✓ Recording to " + options.record_path;
+    }
 
     ili9488::DisplayConfig cfg;
     cfg.width = options.width;
     cfg.height = options.height;
-    cfg.output_format = ili9488::OutputFormat::Rgb666;
-    cfg.rotation = ili9488::Rotation::Deg0;
+    cfg.output_format = rgb565 ? ili9488::OutputFormat::Rgb565 : ili9488::OutputFormat::Rgb666;
+    cfg.rotation = options.panel_rotation ? RotationFromDegrees(rotation_to_apply)
+                                          : ili9488::Rotation::Deg0;
+    cfg.panel_rotation = options.panel_rotation;
     cfg.use_gpu_mailbox = true;
+    cfg.use_direct_spi_dma = options.direct_dma;
+    cfg.bus_backend = options.bus == "sim" ? ili9488::BusBackend::Simulator : ili9488::BusBackend::Spidev;
     ili9488::ILI9488Driver driver(cfg);
     if (!driver.initialize()) {
         std::cerr << "ERROR: Failed to initialize SPI DMA driver.\n";
@@ -215,124 +633,577 @@ int main(int argc, char** argv) {
     }
 
     header->rotation_degrees = options.rotation_degrees;
-    header->daemon_ready = 1;
 
     const bool use_zero_copy = driver.isUsingGpuMailbox();
+    const bool panel_rotation = driver.getTransport()->panelRotationActive();
+
+    ili9488::BufferExportServer export_server;
+    std::string export_status = "✗ Disabled";
+    if (!options.export_socket.empty()) {
+        ili9488::ILI9488Framebuffer* fb = driver.getFramebuffer();
+        int export_fds[ili9488::kBufferExportCount];
+        bool exportable = true;
+        for (uint32_t i = 0; i < ili9488::kBufferExportCount; ++i) {
+            export_fds[i] = fb->exportBufferFd(i);
+            exportable = exportable && export_fds[i] >= 0;
+        }
+        if (options.rotation_degrees != 0 && !panel_rotation) {
+            export_status = "✗ Unavailable (needs panel rotation or 0°)";
+        } else if (!exportable) {
+            export_status = "✗ Unavailable (mailbox buffers cannot be exported)";
+        } else {
+            ili9488::BufferExportInfo info {};
+            info.magic = ili9488::kShmMagic;
+            info.version = ili9488::kBufferExportVersion;
+            info.width = framebuffer_width;
+            info.height = framebuffer_height;
+            info.bytes_per_pixel = static_cast<uint32_t>(bytes_per_pixel);
+            info.stride = static_cast<uint32_t>(stride_bytes);
+            info.buffer_size = static_cast<uint32_t>(fb->bufferSize());
+            info.buffer_count = ili9488::kBufferExportCount;
+            info.flags = fb->buffersAreDmaBufs() ? ili9488::kBufferExportDmaBuf : 0U;
+            info.bus_addr[0] = header->buffer_a_bus_addr;
+            info.bus_addr[1] = header->buffer_b_bus_addr;
+            info.bus_addr[2] = header->buffer_c_bus_addr;
+            if (export_server.start(options.export_socket, info, export_fds)) {
+                header->features |= ili9488::kShmFeatureBufferExport;
+                export_status = "✓ " + options.export_socket + (fb->buffersAreDmaBufs() ? " (dmabuf)" : " (memfd)");
+            } else {
+                export_status = "✗ Failed to open " + options.export_socket;
+            }
+        }
+    }
+    // Before daemon_ready, so no client is writing yet. The daemon writes its
+    // own buffers and only reads the SHM slots. Exporting clients draw into
+    // the frame buffers directly, so the SHM slots are left alone then.
+    std::string prefault_status = "- Disabled";
+    if (options.prefault) {
+        ili9488::ILI9488Framebuffer* fb = driver.getFramebuffer();
+        const bool exporting = (header->features & ili9488::kShmFeatureBufferExport) != 0;
+        const size_t slot_bytes = stride_bytes * framebuffer_height;
+        size_t pages = 0;
+        for (uint32_t i = 0; i < 3; ++i) {
+            pages += ili9488::PrefaultPages(fb->getBuffer(i), fb->bufferSize(), true);
+            if (!exporting) {
+                pages += ili9488::PrefaultPages(fb->getShmBuffer(i), slot_bytes, false);
+            }
+        }
+        ili9488::PrefaultStack(kPrefaultStackBytes);
+        prefault_status = "✓ " + std::to_string(pages) + " pages (frame buffers" +
+                          (exporting ? "" : ", SHM slots") + ") + " +
+                          std::to_string(kPrefaultStackBytes / 1024) + " kB stack";
+    }
+    header->daemon_ready = 1;
+
+    std::unique_ptr<ili9488::WorkerPool> worker_pool;
+    std::string worker_status = "- Disabled (1 thread)";
+    if (options.worker_threads > 1) {
+        worker_pool = std::make_unique<ili9488::WorkerPool>(options.worker_threads, options.worker_cpus);
+        worker_status = "✓ " + std::to_string(options.worker_threads) + " threads";
+        if (!options.worker_cpus.empty()) {
+            worker_status += " (" + std::to_string(worker_pool->pinnedHelpers()) + "/" +
+                             std::to_string(options.worker_threads - 1) + " helpers pinned)";
+        }
+    }
+    ili9488::FrameStats frame_stats;
+    ili9488::StatsReporter stats_reporter(frame_stats);
+    std::string stats_status = "✗ Disabled";
+    if (!options.stats_socket.empty() || !options.stats_file.empty()) {
+        if (stats_reporter.start(options.stats_socket, options.stats_file, options.stats_interval_ms)) {
+            stats_status = "✓";
+            if (!options.stats_socket.empty()) {
+                stats_status += " " + options.stats_socket;
+            }
+            if (!options.stats_file.empty()) {
+                stats_status += " " + options.stats_file + " (every " + std::to_string(options.stats_interval_ms) +
+                                " ms)";
+            }
+        } else {
+            stats_status = "✗ Failed to open " + options.stats_socket;
+        }
+    }
+    // The ingest (main) thread is tuned after the stats reporter starts, so
+    // the reporter stays on CFS, and before the frame notifier, which
+    // inherits its policy and CPUs.
+    std::string affinity_status = "- Not set";
+    if (!options.ingest_cpus.empty() || !options.transmit_cpus.empty()) {
+        affinity_status.clear();
+        if (!options.ingest_cpus.empty()) {
+            const bool pinned = ili9488::SetThreadAffinity(pthread_self(), options.ingest_cpus);
+            affinity_status += std::string(pinned ? "✓" : "✗") + " ingest " +
+                               ili9488::FormatCpuList(options.ingest_cpus);
+        }
+        if (!options.transmit_cpus.empty()) {
+            const bool pinned = driver.setTransmitThreadPolicy(0, options.transmit_cpus);
+            affinity_status += std::string(affinity_status.empty() ? "" : ", ") + (pinned ? "✓" : "✗") +
+                               " transmit " + ili9488::FormatCpuList(options.transmit_cpus);
+        }
+    }
+    std::string rt_status = "- Disabled (CFS)";
+    if (options.rt_priority > 0) {
+        const int priority = static_cast<int>(options.rt_priority);
+        std::string threads;
+        if (ili9488::SetThreadRealtime(pthread_self(), priority)) {
+            threads = "ingest";
+        }
+        if (driver.setTransmitThreadPolicy(priority, {})) {
+            threads += threads.empty() ? "transmit" : ", transmit";
+        }
+        if (worker_pool && worker_pool->size() > 1 && worker_pool->setRealtimePriority(priority)) {
+            threads += (threads.empty() ? "" : ", ") + std::to_string(worker_pool->size() - 1) + " workers";
+        }
+        rt_status = threads.empty() ? "✗ Failed (needs CAP_SYS_NICE or LimitRTPRIO)"
+                                    : "✓ SCHED_FIFO " + std::to_string(priority) + " (" + threads + ")";
+    }
+    std::string mlock_status = "- Disabled";
+    if (options.mlock) {
+        mlock_status = ili9488::LockAllMemory()
+                           ? "✓ mlockall (" + std::to_string(ili9488::LockedMemoryKb()) + " kB locked)"
+                           : "✗ Failed (needs CAP_IPC_LOCK or LimitMEMLOCK)";
+    }
     std::cerr << "\n=== ili9488-daemon startup (Zero-Copy Triple-Buffer) ===\n";
-    std::cerr << "Display: " << options.width << "x" << options.height << " (RGB666)\n";
+    std::cerr << "Display: " << options.width << "x" << options.height << (rgb565 ? " (RGB565)" : " (RGB666)") << "\n";
     std::cerr << "Rotation: " << options.rotation_degrees << "°\n";
     std::cerr << "Max FPS: " << options.max_fps << "\n";
     std::cerr << "FPS Overlay: " << (options.overlay_fps ? "enabled" : "disabled") << "\n";
+    std::cerr << "Bus: " << (driver.getSimulator() != nullptr ? "panel simulator (no hardware)" : "spidev") << "\n";
     std::cerr << "\nFeature Status:\n";
     std::cerr << "  GPU Mailbox/CMA: " << (use_zero_copy ? "✓ AVAILABLE (zero-copy mode)" : "✗ UNAVAILABLE") << "\n";
-    std::cerr << "  GPU Rotation: " << (options.rotation_degrees != 0 ? (use_zero_copy ? "✓ Available" : "✗ Fallback") : "- Not needed") << "\n";
-    std::cerr << "  Shared Memory: " << options.shm_name << "\n";
+    std::cerr << "  Panel Rotation (MADCTL): " << (panel_rotation ? "✓ Active" : (options.rotation_degrees != 0 ? "✗ Disabled" : "- Not needed")) << "\n";
+    std::cerr << "  GPU Rotation: " << (options.rotation_degrees != 0 && !panel_rotation ? (use_zero_copy ? "✓ Available" : "✗ Fallback") : "- Not needed") << "\n";
+    std::cerr << "  Direct SPI DMA: " << (driver.getTransport()->supportsBusAddrTransfer() ? "✓ Active (full frames bypass spidev)" : (options.direct_dma ? "✗ Unavailable" : "- Disabled")) << "\n";
+    std::cerr << "  Damage Tracking: " << (options.damage_tracking ? "✓ Enabled (" + std::to_string(options.damage_tile) + "px tiles, SIGUSR1 dumps counters)" : "✗ Disabled") << "\n";
+    std::cerr << "  Buffer Export: " << export_status << "\n";
+    std::string kernel_status = ili9488::pixel::SimdLevelName(ili9488::pixel::ActiveSimdLevel());
+    if (options.rotation_degrees != 0 && !panel_rotation) {
+        kernel_status += ili9488::pixel::HasFixedRotation(framebuffer_width, framebuffer_height, bytes_per_pixel,
+                                                          options.rotation_degrees)
+                             ? " (fixed " + std::to_string(framebuffer_width) + "x" +
+                                   std::to_string(framebuffer_height) + " rotation)"
+                             : " (generic rotation)";
+    }
+    std::cerr << "  Pixel Kernels: " << kernel_status << "\n";
+    std::cerr << "  Worker Pool: " << worker_status << "\n";
+    std::cerr << "  Frame Stats: " << stats_status << "\n";
+    std::cerr << "  Real-time: " << rt_status << "\n";
+    std::cerr << "  CPU Affinity: " << affinity_status << "\n";
+    std::cerr << "  Memory Lock: " << mlock_status << "\n";
+    std::cerr << "  Prefault: " << prefault_status << "\n";
+    std::cerr << "  Record/Replay: " << recording_status << "\n";
+    std::cerr << "  Shared Memory: " << options.shm_name << " (protocol v" << header->version << ", v1 clients accepted)\n";
     std::cerr << "==================================================\n\n";
     auto fps_start = std::chrono::steady_clock::now();
     size_t frames = 0;
     double fps = 0.0;
-    const uint64_t frame_time_us = options.max_fps > 0 ? 1000000ULL / options.max_fps : 0ULL;
-    auto frame_start = std::chrono::steady_clock::now();
+    const uint64_t frame_period_ns = options.max_fps > 0 ? 1000000000ULL / options.max_fps : 0ULL;
     uint32_t last_frame_counter = 0;
 
-    while (g_running) {
-        if (sem_trywait(&header->pending_sem) != 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ili9488::ILI9488Transport* transport = driver.getTransport();
+    ili9488::DamageTracker damage;
+    damage.configure(framebuffer_width, framebuffer_height, bytes_per_pixel, options.damage_tile);
+    if (worker_pool) {
+        ili9488::pixel::SetWorkerPool(worker_pool.get());
+        damage.setWorkerPool(worker_pool.get());
+    }
+    std::vector<ili9488::Rect> dirty_rects;
+    const size_t display_stride_bytes = static_cast<size_t>(options.width) * bytes_per_pixel;
+    const uint8_t overlay_white[3] = {0xFF, 0xFF, 0xFF};
+    uint8_t overlay_color[3] = {};
+    if (rgb565) {
+        ili9488::pixel::ConvertRgb888ToRgb565(overlay_white, overlay_color, 1);
+    } else {
+        ili9488::pixel::ConvertRgb888ToRgb666(overlay_white, overlay_color, 1);
+    }
+    ili9488::TripleBufferControlV2* shared_control = driver.getFramebuffer()->getSharedControl();
+
+    // Without panel or DMA rotation the CPU rotates every frame. Client
+    // frames are then composed straight into the back buffer.
+    const bool cpu_rotation = options.rotation_degrees != 0 && !panel_rotation &&
+                              (header->buffer_b_bus_addr == 0 || header->buffer_c_bus_addr == 0);
+    std::vector<uint8_t> overlay_pixels;
+    ili9488::pixel::Overlay overlay {};
+    std::string overlay_text;
+    bool overlay_changed = false;
+
+    auto update_overlay = [&]() {
+        ++frames;
+        const auto now = std::chrono::steady_clock::now();
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - fps_start);
+        if (elapsed.count() >= 1000) {
+            fps = (frames * 1000.0) / static_cast<double>(elapsed.count());
+            frames = 0;
+            fps_start = now;
+        }
+        char fps_text[32];
+        std::snprintf(fps_text, sizeof(fps_text), "FPS:%5.1f", fps);
+        overlay_changed = overlay_text != fps_text;
+        if (!overlay_changed) {
+            return;
+        }
+        overlay_text = fps_text;
+        overlay.x = 8;
+        overlay.y = 8;
+        overlay.width = static_cast<uint32_t>(overlay_text.size()) * kFontWidth;
+        overlay.height = kFontHeight;
+        overlay_pixels.assign(static_cast<size_t>(overlay.width) * overlay.height * bytes_per_pixel, 0);
+        DrawText(overlay_pixels.data(), overlay.width, overlay.height, overlay.width * bytes_per_pixel,
+                 bytes_per_pixel, 0, 0, overlay_text, overlay_color);
+        overlay.pixels = overlay_pixels.data();
+    };
+
+    // Timestamps of the frame being built and of the one on the bus. The
+    // callback of present N finishes before fence N signals, and transmit()
+    // waits for that fence before overwriting in_flight, so one record is
+    // enough.
+    struct FrameTiming {
+        uint64_t acquire_ns = 0;
+        uint64_t post_ns = 0;
+    };
+    FrameTiming current_frame;
+    FrameTiming in_flight;
+
+    std::atomic<bool> transmit_failed{false};
+    driver.mirrorFences(&header->present_fence, &header->complete_fence);
+    driver.setFrameStats(&frame_stats);
+    driver.setPresentCallback([header, &transmit_failed, &frame_stats, &in_flight](uint64_t, uint32_t tag, bool ok) {
+        if (!ok) {
+            transmit_failed.store(true, std::memory_order_relaxed);
+            frame_stats.add(ili9488::FrameCounter::TransmitFailures);
+        }
+        __atomic_store_n(&header->scanout_sequence, tag, __ATOMIC_RELEASE);
+        frame_stats.add(ili9488::FrameCounter::Frames);
+        if (in_flight.acquire_ns != 0) {
+            frame_stats.recordSince(ili9488::FrameStage::Frame, in_flight.acquire_ns);
+        }
+        if (in_flight.post_ns != 0) {
+            frame_stats.recordSince(ili9488::FrameStage::PostToScanout, in_flight.post_ns);
+        }
+    });
+    uint32_t frame_tag = 0;
+
+    auto transmit = [&](const uint8_t* front, size_t front_stride, int rect_rotation) {
+        const uint64_t wait_start = ili9488::MonotonicNs();
+        driver.waitFence(driver.lastPresentedFence());
+        frame_stats.recordSince(ili9488::FrameStage::FenceWait, wait_start);
+        in_flight = current_frame;
+        const ili9488::DamageStats& damage_stats = damage.stats();
+        frame_stats.set(ili9488::FrameCounter::TilesScanned, damage_stats.tiles_scanned);
+        frame_stats.set(ili9488::FrameCounter::TilesDirty, damage_stats.tiles_dirty);
+        frame_stats.set(ili9488::FrameCounter::BytesSaved, damage_stats.bytesSaved());
+        if (!options.damage_tracking) {
+            return driver.presentAsync(front, frame_tag);
+        }
+        if (rect_rotation != 0) {
+            for (auto& rect : dirty_rects) {
+                rect = ili9488::RotateRect(rect, framebuffer_width, framebuffer_height, rect_rotation);
+            }
+        }
+        return driver.presentRegionsAsync(front, front_stride, dirty_rects.data(), dirty_rects.size(), frame_tag);
+    };
+
+    EventLoop events;
+    if (!events.open(handled_signals)) {
+        std::cerr << "ERROR: Failed to set up the event loop.\n";
+        return 1;
+    }
+    ili9488::shm::FrameNotifier frame_notifier;
+    if (shared_control != nullptr && frame_notifier.start(shared_control)) {
+        events.watch(frame_notifier.fd(), kEventFrame);
+    }
+    if (export_server.listenFd() >= 0) {
+        events.watch(export_server.listenFd(), kEventExport);
+    }
+
+    bool running = true;
+    bool pacing = false;
+    uint64_t next_deadline_ns = 0;
+    const bool replaying = !options.replay_path.empty();
+    uint64_t replay_start_ns = 0;
+    while (running) {
+        int timeout_ms = -1;
+        if (replaying) {
+            timeout_ms = pacing ? -1 : 0;
+        } else if (!pacing) {
+            timeout_ms = header->client_version >= ili9488::kShmProtocolV2 ? kLegacyCheckMs : kLegacyPollMs;
+        }
+        epoll_event ready[4];
+        const int ready_count = events.wait(ready, 4, timeout_ms);
+        for (int i = 0; i < ready_count; ++i) {
+            switch (ready[i].data.u32) {
+                case kEventSignal: {
+                    int signo = 0;
+                    while (events.readSignal(&signo)) {
+                        if (signo == SIGUSR1) {
+                            PrintDamageStats(damage.stats());
+                            PrintBusStats(transport->busStats());
+                            PrintBusMappingStats(transport->busMappingStats());
+                            DumpSimulator(driver, options.sim_dump);
+                        } else if (signo == SIGHUP) {
+                            damage.invalidate();
+                        } else {
+                            running = false;
+                        }
+                    }
+                    break;
+                }
+                case kEventTimer:
+                    events.readTimer();
+                    frame_stats.recordSince(ili9488::FrameStage::PaceLate, next_deadline_ns);
+                    pacing = false;
+                    break;
+                case kEventFrame:
+                    frame_notifier.drain();
+                    break;
+                case kEventExport:
+                    export_server.poll();
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (!running) {
+            break;
+        }
+        if (pacing) {
             continue;
         }
 
+        if (transmit_failed.exchange(false, std::memory_order_relaxed)) {
+            damage.invalidate();
+        }
+
         uint8_t* pending_cpu = driver.getFramebuffer()->getPendingBuffer();
         uint8_t* back_cpu = driver.getFramebuffer()->getBackBuffer();
 
         if (pending_cpu == nullptr || back_cpu == nullptr) {
-            sem_post(&header->pending_sem);
             break;
         }
 
-        const uint32_t current_frame_counter = header->frame_counter;
-        if (current_frame_counter != last_frame_counter) {
-            uint8_t* shm_pending = driver.getFramebuffer()->getShmPendingBuffer();
-            if (shm_pending != nullptr) {
-                std::memcpy(pending_cpu, shm_pending, framebuffer_bytes);
+        // Copy, overlay, damage hashing and CPU rotation of a client frame in
+        // one pass: each band is hashed and then composed while in cache.
+        bool ingested = false;
+        auto ingest = [&](const uint8_t* shm_src) {
+            if (options.overlay_fps) {
+                const uint64_t overlay_start = ili9488::MonotonicNs();
+                update_overlay();
+                frame_stats.recordSince(ili9488::FrameStage::Overlay, overlay_start);
+            }
+            const uint64_t ingest_start = ili9488::MonotonicNs();
+            ili9488::pixel::BandHook hook;
+            if (options.damage_tracking) {
+                hook = [&](uint32_t y0, uint32_t y1) { damage.hashRows(shm_src, stride_bytes, y0, y1); };
             }
-            last_frame_counter = current_frame_counter;
+            ili9488::pixel::ComposeFrame(shm_src, ili9488::pixel::SourceFormat::Output, stride_bytes,
+                                         cpu_rotation ? back_cpu : pending_cpu,
+                                         framebuffer_width, framebuffer_height, bytes_per_pixel,
+                                         cpu_rotation ? rotation_to_apply : 0,
+                                         options.overlay_fps ? &overlay : nullptr, damage.tileSize(), hook);
+            if (options.damage_tracking) {
+                if (options.overlay_fps && overlay_changed) {
+                    damage.markDirty(ili9488::Rect{overlay.x, overlay.y, overlay.width, overlay.height});
+                }
+                damage.finish(dirty_rects);
+            }
+            frame_stats.recordSince(ili9488::FrameStage::Ingest, ingest_start);
+            ingested = true;
+        };
+
+        if (header->client_version >= ili9488::kShmProtocolV2 && header->frame_counter != last_frame_counter) {
+            header->client_version = ili9488::kShmProtocolV1;
         }
 
-        sem_post(&header->pending_sem);
+        export_server.poll();
+        uint8_t* frame_cpu = pending_cpu;
+        int frame_dmabuf = -1;
+        bool zero_copy_frame = false;
+        // Client frame as published, recorded once damage is known.
+        const uint8_t* record_src = nullptr;
 
-        if (options.overlay_fps) {
-            ++frames;
-            const auto now = std::chrono::steady_clock::now();
-            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - fps_start);
-            if (elapsed.count() >= 1000) {
-                fps = (frames * 1000.0) / static_cast<double>(elapsed.count());
-                frames = 0;
-                fps_start = now;
+        if (replaying) {
+            ili9488::PlaybackFrame playback {};
+            if (!player.next(&playback)) {
+                driver.waitFence(driver.lastPresentedFence());
+                const double seconds =
+                    replay_start_ns != 0 ? static_cast<double>(ili9488::MonotonicNs() - replay_start_ns) / 1e9 : 0.0;
+                std::fprintf(stderr, "Replay: %zu frames in %.3f s (%.1f fps)\n", player.frameCount(), seconds,
+                             seconds > 0.0 ? static_cast<double>(player.frameCount()) / seconds : 0.0);
+                break;
+            }
+            current_frame.acquire_ns = ili9488::MonotonicNs();
+            current_frame.post_ns = 0;
+            if (replay_start_ns == 0) {
+                replay_start_ns = current_frame.acquire_ns;
+            }
+            frame_tag = playback.sequence;
+            ingest(playback.pixels);
+        } else if (shared_control != nullptr && header->client_version >= ili9488::kShmProtocolV2) {
+            uint32_t slot = 0;
+            const uint64_t acquire_start = ili9488::MonotonicNs();
+            if (!ili9488::shm::AcquireFrame(shared_control, &slot, &frame_tag)) {
+                continue;
+            }
+            current_frame.acquire_ns = ili9488::MonotonicNs();
+            current_frame.post_ns = __atomic_load_n(&shared_control->publish_ns, __ATOMIC_RELAXED);
+            frame_stats.record(ili9488::FrameStage::Acquire, current_frame.acquire_ns - acquire_start);
+            if (current_frame.post_ns != 0 && current_frame.post_ns <= current_frame.acquire_ns) {
+                frame_stats.record(ili9488::FrameStage::PostToAcquire,
+                                   current_frame.acquire_ns - current_frame.post_ns);
+            } else {
+                current_frame.post_ns = 0;
+            }
+            frame_stats.observeSequence(frame_tag);
+            if (export_server.clientConnected()) {
+                frame_cpu = driver.getFramebuffer()->getBuffer(slot);
+                zero_copy_frame = frame_cpu != nullptr;
+                if (driver.getFramebuffer()->buffersAreDmaBufs()) {
+                    frame_dmabuf = driver.getFramebuffer()->exportBufferFd(slot);
+                }
+            }
+            if (!zero_copy_frame) {
+                frame_cpu = pending_cpu;
+                uint8_t* shm_frame = driver.getFramebuffer()->getShmBuffer(slot);
+                if (shm_frame != nullptr) {
+                    ingest(shm_frame);
+                    record_src = shm_frame;
+                }
+            } else {
+                record_src = frame_cpu;
+            }
+        } else {
+            const uint64_t acquire_start = ili9488::MonotonicNs();
+            if (sem_trywait(&header->pending_sem) != 0) {
+                continue;
+            }
+            current_frame.acquire_ns = ili9488::MonotonicNs();
+            current_frame.post_ns = 0;
 
-                FILE* fps_log = std::fopen("/tmp/ili9488_benchmark.log", "a");
-                if (fps_log != nullptr) {
-                    std::fprintf(fps_log, "%.1f\n", fps);
-                    std::fclose(fps_log);
+            const uint32_t current_frame_counter = header->frame_counter;
+            const bool new_frame = current_frame_counter != last_frame_counter;
+            if (new_frame || !options.damage_tracking) {
+                uint8_t* shm_pending = driver.getFramebuffer()->getShmPendingBuffer();
+                if (shm_pending != nullptr) {
+                    ingest(shm_pending);
+                    record_src = new_frame ? shm_pending : nullptr;
                 }
             }
-            char fps_text[32];
-            std::snprintf(fps_text, sizeof(fps_text), "FPS:%5.1f", fps);
-
-            const uint32_t clear_x = 8;
-            const uint32_t clear_y = 8;
-            const uint32_t clear_w = static_cast<uint32_t>(std::strlen(fps_text)) * kFontWidth;
-            const uint32_t clear_h = kFontHeight;
-            for (uint32_t row = clear_y; row < clear_y + clear_h && row < framebuffer_height; ++row) {
-                uint8_t* row_ptr = pending_cpu + static_cast<size_t>(row) * stride_bytes
-                                   + static_cast<size_t>(clear_x) * 3U;
-                std::memset(row_ptr, 0x00, static_cast<size_t>(clear_w) * 3U);
+            if (new_frame) {
+                frame_stats.record(ili9488::FrameStage::Acquire, current_frame.acquire_ns - acquire_start);
+                frame_stats.observeSequence(current_frame_counter);
+                last_frame_counter = current_frame_counter;
+                frame_tag = current_frame_counter;
             }
 
-            DrawText(pending_cpu, framebuffer_width, framebuffer_height, stride_bytes, 8, 8,
-                     fps_text, 0xFC, 0xFC, 0xFC);
+            sem_post(&header->pending_sem);
+
+            if (!new_frame && options.damage_tracking) {
+                continue;
+            }
         }
 
-        if (header->rotation_degrees == 0) {
+        if (frame_dmabuf >= 0) {
+            ili9488::DmaBufBeginCpuAccess(frame_dmabuf, options.overlay_fps);
+        }
+
+        if (!ingested) {
+            if (options.overlay_fps) {
+                const uint64_t overlay_start = ili9488::MonotonicNs();
+                update_overlay();
+                ili9488::pixel::BlitView(
+                    ili9488::pixel::MakeView(overlay.pixels, overlay.width, overlay.height, pixel_format),
+                    ili9488::pixel::MakeView(frame_cpu, framebuffer_width, framebuffer_height, pixel_format,
+                                             stride_bytes),
+                    static_cast<int32_t>(overlay.x), static_cast<int32_t>(overlay.y));
+                frame_stats.recordSince(ili9488::FrameStage::Overlay, overlay_start);
+            }
+            if (options.damage_tracking) {
+                const uint64_t damage_start = ili9488::MonotonicNs();
+                damage.detect(frame_cpu, stride_bytes, dirty_rects);
+                frame_stats.recordSince(ili9488::FrameStage::Damage, damage_start);
+            }
+        }
+
+        // Copies the frame into the recorder's queue; encoding and disk writes
+        // happen on its writer thread.
+        if (record_src != nullptr && recorder.isOpen()) {
+            recorder.append(record_src, current_frame.acquire_ns, frame_tag, dirty_rects.data(),
+                            options.damage_tracking ? dirty_rects.size() : 0);
+        }
+
+        if (zero_copy_frame) {
+            driver.waitFence(transmit(frame_cpu, stride_bytes, 0));
+            if (frame_dmabuf >= 0) {
+                ili9488::DmaBufEndCpuAccess(frame_dmabuf, options.overlay_fps);
+            }
+        } else if (header->rotation_degrees == 0 || panel_rotation) {
             driver.getFramebuffer()->rotateBufferIndices();
 
             uint8_t* front_cpu = driver.getFramebuffer()->getFrontBuffer();
-            driver.getTransport()->transferDma(front_cpu, display_bytes);
+            transmit(front_cpu, stride_bytes, 0);
         } else {
             uint32_t pending_bus_addr = header->buffer_c_bus_addr;
             uint32_t back_bus_addr = header->buffer_b_bus_addr;
 
-            bool rotated = false;
-            if (pending_bus_addr != 0 && back_bus_addr != 0) {
+            bool rotated = ingested && cpu_rotation;
+            if (!rotated && pending_bus_addr != 0 && back_bus_addr != 0) {
+                const uint64_t rotate_start = ili9488::MonotonicNs();
                 rotated = driver.getRotator()->rotateRgb666DmaMode(
                     pending_cpu, pending_bus_addr,
                     back_cpu, back_bus_addr,
                     framebuffer_width, framebuffer_height,
                     rotation_to_apply);
+                if (rotated) {
+                    frame_stats.recordSince(ili9488::FrameStage::RotateDma, rotate_start);
+                }
             }
             if (!rotated) {
-                ili9488::pixel::RotateRgb666(pending_cpu, back_cpu,
-                                             framebuffer_width, framebuffer_height,
-                                             rotation_to_apply);
+                const uint64_t rotate_start = ili9488::MonotonicNs();
+                ili9488::pixel::RotateFrame(pending_cpu, back_cpu,
+                                            framebuffer_width, framebuffer_height,
+                                            bytes_per_pixel, rotation_to_apply);
+                frame_stats.recordSince(ili9488::FrameStage::RotateCpu, rotate_start);
             }
 
             driver.getFramebuffer()->swapBackAndFront();
 
             uint8_t* front_cpu = driver.getFramebuffer()->getFrontBuffer();
-            driver.getTransport()->transferDma(front_cpu, display_bytes);
+            transmit(front_cpu, display_stride_bytes, rotation_to_apply);
         }
 
-        if (frame_time_us > 0) {
-            const auto now = std::chrono::steady_clock::now();
-            const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(now - frame_start).count();
-            if (elapsed_us < static_cast<int64_t>(frame_time_us)) {
-                const uint64_t sleep_us = frame_time_us - elapsed_us;
-                std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+        // Deadlines advance by whole periods, so pacing does not drift with
+        // the loop's own run time. Once the loop falls a full period behind,
+        // the schedule restarts from now.
+        if (frame_period_ns > 0) {
+            const uint64_t now = ili9488::MonotonicNs();
+            next_deadline_ns += frame_period_ns;
+            if (next_deadline_ns <= now) {
+                next_deadline_ns = now + frame_period_ns;
             }
-            frame_start = std::chrono::steady_clock::now();
+            pacing = events.armTimer(next_deadline_ns);
         }
     }
+    frame_notifier.stop();
 
+    if (options.damage_tracking) {
+        PrintDamageStats(damage.stats());
+    }
+    PrintBusStats(transport->busStats());
+    PrintBusMappingStats(transport->busMappingStats());
+
+    driver.waitFence(driver.lastPresentedFence());
+    DumpSimulator(driver, options.sim_dump);
+    if (recorder.isOpen()) {
+        recorder.close();
+        std::fprintf(stderr, "Recording: %u frames, %.1f MB in %s (%llu dropped)\n", recorder.frameCount(),
+                     static_cast<double>(recorder.bytesWritten()) / (1024.0 * 1024.0), options.record_path.c_str(),
+                     static_cast<unsigned long long>(recorder.droppedFrames()));
+    }
+    driver.mirrorFences(nullptr, nullptr);
+    driver.setPresentCallback(nullptr);
+    driver.setFrameStats(nullptr);
+    stats_reporter.stop();
+    export_server.stop();
     driver.getFramebuffer()->cleanupSharedMemory();
+    ili9488::pixel::SetWorkerPool(nullptr);
 
     return 0;
 }
@@ -1,20 +1,79 @@
 #include "ili9488_dma.h"
+#include "band_pipeline.h"
+#include "frame_stats.h"
 #include "ili9488_mailbox.h"
 #include "ili9488_rotate.h"
+#include "panel_simulator.h"
+#include "realtime.h"
 #include "spi_dma_linux.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace ili9488 {
 
+namespace {
+constexpr size_t kMaxQueuedPresents = 2;
+
+struct PresentRequest {
+    uint64_t fence;
+    uint32_t tag;
+    const uint8_t* buffer;
+    size_t stride;
+    bool full_frame;
+    uint64_t submit_ns;
+    std::vector<Rect> rects;
+};
+}
+
+struct PresentQueue {
+    std::mutex mutex;
+    std::condition_variable submitted;
+    std::condition_variable completed;
+    std::deque<PresentRequest> requests;
+    std::thread worker;
+    bool running = false;
+    uint64_t next_fence = 0;
+    uint64_t completed_fence = 0;
+    PresentCallback callback;
+    FrameStats* stats = nullptr;
+    volatile uint32_t* mirror_submitted = nullptr;
+    volatile uint32_t* mirror_completed = nullptr;
+};
+
 ILI9488Driver::ILI9488Driver(const DisplayConfig& cfg)
     : config_(cfg),
       spi_(std::make_unique<ILI9488Transport>()),
       gpu_(std::make_unique<ILI9488Framebuffer>()),
       gpu_rotate_(std::make_unique<gpu::ILI9488Rotate>()),
+      rotate_cb_buffer_(std::make_unique<DmaBuffer>()),
+      spi_cb_buffer_(std::make_unique<DmaBuffer>()),
+      present_queue_(std::make_unique<PresentQueue>()),
+      simulator_(nullptr),
       zero_copy_mode_(false),
       pending_bus_addr_(0) {}
 
-ILI9488Driver::~ILI9488Driver() = default;
+ILI9488Driver::~ILI9488Driver() {
+    stopTransmitThread();
+    band_pipeline_.reset();
+    gpu_rotate_.reset();
+    if (rotate_cb_buffer_->user_ptr != nullptr) {
+        gpu_->freeDmaBuffer(*rotate_cb_buffer_);
+    }
+    spi_.reset();
+    if (spi_cb_buffer_->user_ptr != nullptr) {
+        gpu_->freeDmaBuffer(*spi_cb_buffer_);
+    }
+}
 
 bool ILI9488Driver::initialize() {
     SpiConfig spi_config {};
@@ -23,7 +82,7 @@ bool ILI9488Driver::initialize() {
     spi_config.init_speed_hz = config_.spi_init_hz;
     spi_config.mode = config_.spi_mode;
     spi_config.bits_per_word = config_.bits_per_word;
-    spi_config.pixel_format = 0x66;
+    spi_config.pixel_format = config_.output_format == OutputFormat::Rgb565 ? 0x55 : 0x66;
     spi_config.width = config_.width;
     spi_config.height = config_.height;
     spi_config.transfer_chunk_bytes = 65536;
@@ -31,20 +90,38 @@ bool ILI9488Driver::initialize() {
                                                : config_.rotation == Rotation::Deg90  ? 90
                                                : config_.rotation == Rotation::Deg180 ? 180
                                                                                        : 270);
+    spi_config.panel_rotation = config_.panel_rotation;
+    spi_config.batch_transfers = true;
     spi_config.dc_gpio = config_.dc_gpio;
     spi_config.reset_gpio = config_.reset_gpio;
-    if (!spi_->initialize(spi_config)) {
+    if (config_.bus_backend == BusBackend::Simulator) {
+        SimulatorConfig sim_config;
+        sim_config.realtime = config_.simulator_realtime;
+        auto bus = std::make_unique<SimulatorBus>(sim_config);
+        simulator_ = bus.get();
+        if (!spi_->initialize(spi_config, std::move(bus))) {
+            return false;
+        }
+    } else if (!spi_->initialize(spi_config)) {
         return false;
     }
     bool enable_mailbox = config_.use_gpu_mailbox;
 #ifndef ILI9488_DMA_USE_GPU_MAILBOX
     enable_mailbox = false;
 #endif
-    if (!gpu_->initialize(config_.width, config_.height, enable_mailbox)) {
+    gpu_->setReleaseListener([this] {
+        if (spi_) {
+            spi_->invalidateBusMappings();
+        }
+    });
+    if (!gpu_->initialize(config_.width, config_.height, enable_mailbox, bytesPerPixel())) {
         return false;
     }
     if (gpu_->usingMailbox()) {
         zero_copy_mode_ = true;
+        for (uint32_t i = 0; i < 3; ++i) {
+            spi_->registerBusMapping(gpu_->bufferBusAddr(i), gpu_->getBuffer(i), gpu_->bufferSize());
+        }
     } else {
         zero_copy_mode_ = false;
         const size_t buffer_bytes = static_cast<size_t>(config_.width) * config_.height * bytesPerPixel();
@@ -52,17 +129,37 @@ bool ILI9488Driver::initialize() {
         backBuffer_.resize(buffer_bytes);
     }
     bool enable_gpu_rotation = zero_copy_mode_;
+    if (enable_gpu_rotation) {
+        const size_t cb_bytes = static_cast<size_t>(std::max(config_.width, config_.height)) *
+                                sizeof(DmaControlBlock);
+        if (gpu_->allocateDmaBuffer(cb_bytes, *rotate_cb_buffer_)) {
+            gpu_rotate_->setControlBlockMemory(rotate_cb_buffer_->user_ptr,
+                                               rotate_cb_buffer_->bus_addr,
+                                               rotate_cb_buffer_->size);
+        } else {
+            enable_gpu_rotation = false;
+        }
+    }
+    gpu_rotate_->setBytesPerPixel(bytesPerPixel());
     gpu_rotate_->initialize(enable_gpu_rotation);
+    if (config_.use_direct_spi_dma && zero_copy_mode_ && config_.bus_backend == BusBackend::Spidev) {
+        const size_t frame_bytes = static_cast<size_t>(config_.width) * config_.height * bytesPerPixel();
+        if (!gpu_->allocateDmaBuffer(spidma::ChainBytes(frame_bytes), *spi_cb_buffer_) ||
+            !spi_->enableDirectDma(spi_cb_buffer_->user_ptr, spi_cb_buffer_->bus_addr, spi_cb_buffer_->size)) {
+            std::fprintf(stderr, "WARNING: direct SPI DMA unavailable, using spidev\n");
+        }
+    }
+    startTransmitThread();
     return true;
 }
 
 void ILI9488Driver::renderFrameRgb666(const uint8_t* rgb666_pixels) {
     if (zero_copy_mode_) {
         uint8_t* back_buf = gpu_->backBuffer();
-        const size_t buffer_bytes = static_cast<size_t>(config_.width) * config_.height * 3U;
+        const size_t buffer_bytes = static_cast<size_t>(config_.width) * config_.height * bytesPerPixel();
         std::memcpy(back_buf, rgb666_pixels, buffer_bytes);
     } else {
-        const size_t buffer_bytes = static_cast<size_t>(config_.width) * config_.height * 3U;
+        const size_t buffer_bytes = static_cast<size_t>(config_.width) * config_.height * bytesPerPixel();
         if (config_.use_double_buffer) {
             std::memcpy(backBuffer_.data(), rgb666_pixels, buffer_bytes);
         } else {
@@ -73,7 +170,7 @@ void ILI9488Driver::renderFrameRgb666(const uint8_t* rgb666_pixels) {
 
 void ILI9488Driver::renderFrameRgb666ZeroCopy(uint32_t bus_addr, const uint8_t* cpu_addr) {
     if (!zero_copy_mode_) {
-        const size_t buffer_bytes = static_cast<size_t>(config_.width) * config_.height * 3U;
+        const size_t buffer_bytes = static_cast<size_t>(config_.width) * config_.height * bytesPerPixel();
         renderFrameRgb666(cpu_addr);
         return;
     }
@@ -97,22 +194,27 @@ bool ILI9488Driver::isUsingGpuMailbox() const {
 }
 
 void ILI9488Driver::swapBuffers() {
+    waitFence(lastPresentedFence());
+    uint64_t fence = 0;
     if (zero_copy_mode_) {
         if (config_.use_double_buffer) {
             gpu_->swapBuffers();
         }
-        writeFrameDma(gpu_->frontBuffer());
+        fence = presentAsync(gpu_->frontBuffer());
         pending_bus_addr_ = 0;
     } else {
         if (config_.use_double_buffer) {
             frontBuffer_.swap(backBuffer_);
         }
-        writeFrameDma(frontBuffer_.data());
+        fence = presentAsync(frontBuffer_.data());
+    }
+    if (!config_.use_double_buffer) {
+        waitFence(fence);
     }
 }
 
 size_t ILI9488Driver::bytesPerPixel() const {
-    return 3U;
+    return config_.output_format == OutputFormat::Rgb565 ? 2U : 3U;
 }
 
 void ILI9488Driver::writeFrameDma(const uint8_t* buf) {
@@ -123,6 +225,15 @@ void ILI9488Driver::writeFrameDmaFromBusAddr(uint32_t bus_addr, size_t size) {
     spi_->transferDmaFromBusAddr(bus_addr, size);
 }
 
+bool ILI9488Driver::transmitFullFrame(const uint8_t* buffer) {
+    const size_t frame_bytes = static_cast<size_t>(config_.width) * config_.height * bytesPerPixel();
+    const uint32_t bus_addr = spi_->supportsBusAddrTransfer() ? gpu_->busAddressOf(buffer) : 0U;
+    if (bus_addr != 0 && spi_->transferDmaFromBusAddr(bus_addr, frame_bytes)) {
+        return true;
+    }
+    return spi_->transferDma(buffer, frame_bytes);
+}
+
 bool ILI9488Driver::rotateFrameGpu(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height, int rotation_degrees) {
     if (!gpu_rotate_) {
         return false;
@@ -130,4 +241,185 @@ bool ILI9488Driver::rotateFrameGpu(const uint8_t* src, uint8_t* dst, uint32_t wi
     return gpu_rotate_->rotateRgb666(src, 0, dst, 0, width, height, rotation_degrees);
 }
 
+uint64_t ILI9488Driver::presentAsync(const uint8_t* buffer, uint32_t tag) {
+    return queuePresent(buffer, 0, nullptr, 0, true, tag);
+}
+
+uint64_t ILI9488Driver::presentRegionsAsync(const uint8_t* buffer, size_t stride, const Rect* rects, size_t count,
+                                            uint32_t tag) {
+    return queuePresent(buffer, stride, rects, count, false, tag);
+}
+
+uint64_t ILI9488Driver::queuePresent(const uint8_t* buffer, size_t stride, const Rect* rects, size_t count,
+                                     bool full_frame, uint32_t tag) {
+    PresentQueue& queue = *present_queue_;
+    PresentRequest request {};
+    request.tag = tag;
+    request.buffer = buffer;
+    request.stride = stride;
+    request.full_frame = full_frame;
+    if (rects != nullptr && count > 0) {
+        request.rects.assign(rects, rects + count);
+    }
+
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    if (!queue.running) {
+        request.fence = ++queue.next_fence;
+        PresentCallback callback = queue.callback;
+        FrameStats* stats = queue.stats;
+        lock.unlock();
+        const uint64_t start_ns = stats != nullptr ? MonotonicNs() : 0;
+        const bool ok = request.full_frame
+                            ? transmitFullFrame(buffer)
+                            : spi_->transferRegions(buffer, stride, request.rects.data(), request.rects.size());
+        if (stats != nullptr) {
+            stats->recordSince(FrameStage::Transmit, start_ns);
+        }
+        if (callback) {
+            callback(request.fence, tag, ok);
+        }
+        lock.lock();
+        queue.completed_fence = std::max(queue.completed_fence, request.fence);
+        queue.completed.notify_all();
+        return request.fence;
+    }
+
+    queue.completed.wait(lock, [&queue] { return queue.requests.size() < kMaxQueuedPresents; });
+    request.fence = ++queue.next_fence;
+    if (queue.mirror_submitted != nullptr) {
+        __atomic_store_n(queue.mirror_submitted, static_cast<uint32_t>(request.fence), __ATOMIC_RELEASE);
+    }
+    request.submit_ns = queue.stats != nullptr ? MonotonicNs() : 0;
+    const uint64_t fence = request.fence;
+    queue.requests.push_back(std::move(request));
+    queue.submitted.notify_one();
+    return fence;
+}
+
+bool ILI9488Driver::presentFrame(const uint8_t* pixels, InputFormat format, int rotation_degrees,
+                                 size_t stride) {
+    waitFence(lastPresentedFence());
+    if (!band_pipeline_) {
+        band_pipeline_ = std::make_unique<BandPipeline>(*spi_, BandPipeline::kDefaultBandRows, config_.dither);
+    }
+    return band_pipeline_->present(pixels, format, stride, rotation_degrees);
+}
+
+bool ILI9488Driver::waitFence(uint64_t fence, uint32_t timeout_ms) {
+    PresentQueue& queue = *present_queue_;
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    auto signaled = [&queue, fence] { return queue.completed_fence >= fence; };
+    if (timeout_ms == 0) {
+        queue.completed.wait(lock, signaled);
+        return true;
+    }
+    return queue.completed.wait_for(lock, std::chrono::milliseconds(timeout_ms), signaled);
+}
+
+bool ILI9488Driver::fenceSignaled(uint64_t fence) const {
+    std::lock_guard<std::mutex> lock(present_queue_->mutex);
+    return present_queue_->completed_fence >= fence;
+}
+
+uint64_t ILI9488Driver::lastPresentedFence() const {
+    std::lock_guard<std::mutex> lock(present_queue_->mutex);
+    return present_queue_->next_fence;
+}
+
+void ILI9488Driver::setPresentCallback(PresentCallback callback) {
+    std::lock_guard<std::mutex> lock(present_queue_->mutex);
+    present_queue_->callback = std::move(callback);
+}
+
+void ILI9488Driver::mirrorFences(volatile uint32_t* submitted, volatile uint32_t* completed) {
+    std::lock_guard<std::mutex> lock(present_queue_->mutex);
+    present_queue_->mirror_submitted = submitted;
+    present_queue_->mirror_completed = completed;
+}
+
+void ILI9488Driver::setFrameStats(FrameStats* stats) {
+    std::lock_guard<std::mutex> lock(present_queue_->mutex);
+    present_queue_->stats = stats;
+}
+
+bool ILI9488Driver::setTransmitThreadPolicy(int rt_priority, const std::vector<int>& cpus) {
+    PresentQueue& queue = *present_queue_;
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.running) {
+        return false;
+    }
+    bool ok = SetThreadAffinity(queue.worker.native_handle(), cpus);
+    if (rt_priority > 0) {
+        ok = SetThreadRealtime(queue.worker.native_handle(), rt_priority) && ok;
+    }
+    return ok;
+}
+
+void ILI9488Driver::startTransmitThread() {
+    PresentQueue& queue = *present_queue_;
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.running) {
+        return;
+    }
+    queue.running = true;
+    queue.worker = std::thread(&ILI9488Driver::transmitLoop, this);
+}
+
+void ILI9488Driver::stopTransmitThread() {
+    PresentQueue& queue = *present_queue_;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.running) {
+            return;
+        }
+        queue.running = false;
+    }
+    queue.submitted.notify_all();
+    if (queue.worker.joinable()) {
+        queue.worker.join();
+    }
+}
+
+void ILI9488Driver::transmitLoop() {
+    PresentQueue& queue = *present_queue_;
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    while (true) {
+        queue.submitted.wait(lock, [&queue] { return !queue.running || !queue.requests.empty(); });
+        if (queue.requests.empty()) {
+            break;
+        }
+        PresentRequest request = std::move(queue.requests.front());
+        queue.requests.pop_front();
+        PresentCallback callback = queue.callback;
+        FrameStats* stats = queue.stats;
+        lock.unlock();
+
+        uint64_t start_ns = 0;
+        if (stats != nullptr) {
+            start_ns = MonotonicNs();
+            if (request.submit_ns != 0) {
+                stats->record(FrameStage::TransmitQueue, start_ns - request.submit_ns);
+            }
+        }
+        const bool ok = request.full_frame
+                            ? transmitFullFrame(request.buffer)
+                            : spi_->transferRegions(request.buffer, request.stride,
+                                                    request.rects.data(), request.rects.size());
+        if (stats != nullptr) {
+            stats->recordSince(FrameStage::Transmit, start_ns);
+        }
+        if (callback) {
+            callback(request.fence, request.tag, ok);
+        }
+
+        lock.lock();
+        queue.completed_fence = request.fence;
+        if (queue.mirror_completed != nullptr) {
+            __atomic_store_n(queue.mirror_completed, static_cast<uint32_t>(request.fence), __ATOMIC_RELEASE);
+            syscall(SYS_futex, queue.mirror_completed, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+        queue.completed.notify_all();
+    }
+}
+
 }
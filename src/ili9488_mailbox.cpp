@@ -1,4 +1,5 @@
 #include "ili9488_mailbox.h"
+#include "triple_buffer_protocol.h"
 
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -132,6 +133,7 @@ struct alignas(16) MailboxBuffer {
 ILI9488Framebuffer::ILI9488Framebuffer()
     : width_(0),
       height_(0),
+      bytes_per_pixel_(3),
       buffer_size_(0),
       use_mailbox_(false),
       mailbox_fd_(-1),
@@ -145,24 +147,30 @@ ILI9488Framebuffer::ILI9488Framebuffer()
       using_cma_(false),
       vcsm_fd_(-1),
       vcsm_handle_{0, 0, 0},
+      memfd_{-1, -1, -1},
+      cpu_map_{nullptr, nullptr, nullptr},
       front_index_(0),
       back_index_(1),
       pending_index_(2),
       triple_buffer_header_(nullptr),
       triple_buffer_shm_fd_(-1),
       triple_buffer_base_(nullptr),
+      triple_buffer_control_(nullptr),
       triple_buffer_total_size_(0) {}
 
 ILI9488Framebuffer::~ILI9488Framebuffer() {
     cleanupSharedMemory();
     releaseCmaBuffers();
     releaseMailboxBuffers();
+    releaseCpuBuffers();
 }
 
-bool ILI9488Framebuffer::initialize(uint32_t width, uint32_t height, bool enable_mailbox) {
+bool ILI9488Framebuffer::initialize(uint32_t width, uint32_t height, bool enable_mailbox,
+                                    size_t bytes_per_pixel) {
     width_ = width;
     height_ = height;
-    buffer_size_ = static_cast<size_t>(width_) * height_ * 3;
+    bytes_per_pixel_ = bytes_per_pixel;
+    buffer_size_ = static_cast<size_t>(width_) * height_ * bytes_per_pixel_;
     use_mailbox_ = enable_mailbox;
 
     if (use_mailbox_) {
@@ -190,7 +198,7 @@ uint8_t* ILI9488Framebuffer::backBuffer() {
     } else if (use_mailbox_) {
         return static_cast<uint8_t*>(mailbox_map_[back_index_]);
     } else {
-        return cpu_buffers_[back_index_].data();
+        return static_cast<uint8_t*>(cpu_map_[back_index_]);
     }
 }
 
@@ -200,7 +208,7 @@ uint8_t* ILI9488Framebuffer::frontBuffer() {
     } else if (use_mailbox_) {
         return static_cast<uint8_t*>(mailbox_map_[front_index_]);
     } else {
-        return cpu_buffers_[front_index_].data();
+        return static_cast<uint8_t*>(cpu_map_[front_index_]);
     }
 }
 
@@ -210,7 +218,7 @@ uint8_t* ILI9488Framebuffer::pendingBuffer() {
     } else if (use_mailbox_) {
         return static_cast<uint8_t*>(mailbox_map_[pending_index_]);
     } else {
-        return cpu_buffers_[pending_index_].data();
+        return static_cast<uint8_t*>(cpu_map_[pending_index_]);
     }
 }
 
@@ -231,6 +239,10 @@ size_t ILI9488Framebuffer::bufferSize() const {
     return buffer_size_;
 }
 
+size_t ILI9488Framebuffer::bytesPerPixel() const {
+    return bytes_per_pixel_;
+}
+
 bool ILI9488Framebuffer::usingMailbox() const {
     return use_mailbox_;
 }
@@ -247,6 +259,33 @@ uint32_t ILI9488Framebuffer::pendingBufferBusAddr() const {
     return use_mailbox_ ? mailbox_bus_addr_[pending_index_] : 0;
 }
 
+uint32_t ILI9488Framebuffer::busAddressOf(const uint8_t* ptr) const {
+    if (!use_mailbox_ || ptr == nullptr) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        const auto* base = static_cast<const uint8_t*>(using_cma_ ? cma_map_[i] : mailbox_map_[i]);
+        if (base != nullptr && mailbox_bus_addr_[i] != 0 && ptr >= base && ptr < base + buffer_size_) {
+            return mailbox_bus_addr_[i] + static_cast<uint32_t>(ptr - base);
+        }
+    }
+    return 0;
+}
+
+uint32_t ILI9488Framebuffer::bufferBusAddr(uint32_t index) const {
+    return (use_mailbox_ && index < 3) ? mailbox_bus_addr_[index] : 0;
+}
+
+void ILI9488Framebuffer::setReleaseListener(std::function<void()> listener) {
+    release_listener_ = std::move(listener);
+}
+
+void ILI9488Framebuffer::notifyRelease() {
+    if (release_listener_) {
+        release_listener_();
+    }
+}
+
 bool ILI9488Framebuffer::openMailboxDevice() {
     if (mailbox_fd_ >= 0) {
         return true;
@@ -369,12 +408,50 @@ void* ILI9488Framebuffer::mapBusAddress(uint32_t bus_addr, size_t size) {
     return static_cast<uint8_t*>(map) + page_offset;
 }
 
-bool ILI9488Framebuffer::allocateDmaBuffer(size_t size, DmaBuffer& out_buffer) {
-    if (!openMailboxDevice()) {
+bool ILI9488Framebuffer::allocateCmaDmaBuffer(size_t size, DmaBuffer& out_buffer) {
+    if (dma_heap_fd_ < 0 || vcsm_fd_ < 0) {
         return false;
     }
 
+    const int dmabuf_fd = AllocateDmaHeapBuffer(dma_heap_fd_, size);
+    if (dmabuf_fd < 0) {
+        return false;
+    }
+
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, dmabuf_fd, 0);
+    if (map == MAP_FAILED) {
+        close(dmabuf_fd);
+        return false;
+    }
+
+    VcsmCmaIoctlImportDmabuf import_data {};
+    import_data.dmabuf_fd = dmabuf_fd;
+    import_data.cached = 0;
+    std::strncpy(reinterpret_cast<char*>(import_data.name), "ili9488_dma", kVcsmCmaResourceName);
+    if (ioctl(vcsm_fd_, VCSM_CMA_IOCTL_MEM_IMPORT_DMABUF, &import_data) < 0 || import_data.dma_addr == 0) {
+        munmap(map, size);
+        close(dmabuf_fd);
+        return false;
+    }
+
+    std::memset(map, 0, size);
+    out_buffer.user_ptr = map;
+    out_buffer.bus_addr = static_cast<uint32_t>(import_data.dma_addr);
+    out_buffer.handle = 0;
+    out_buffer.size = size;
+    out_buffer.dmabuf_fd = dmabuf_fd;
+    return true;
+}
+
+bool ILI9488Framebuffer::allocateDmaBuffer(size_t size, DmaBuffer& out_buffer) {
     const size_t aligned_size = (size + kPageAlign - 1) & ~(kPageAlign - 1);
+    if (using_cma_ && allocateCmaDmaBuffer(aligned_size, out_buffer)) {
+        return true;
+    }
+
+    if (!openMailboxDevice()) {
+        return false;
+    }
     const uint32_t flag_options[] = {
         kMboxMemFlagCoherent | kMboxMemFlagDirect | kMboxMemFlagZero,
         kMboxMemFlagCoherent | kMboxMemFlagDirect,
@@ -416,6 +493,14 @@ bool ILI9488Framebuffer::allocateDmaBuffer(size_t size, DmaBuffer& out_buffer) {
 }
 
 void ILI9488Framebuffer::freeDmaBuffer(DmaBuffer& buffer) {
+    if (buffer.dmabuf_fd >= 0) {
+        if (buffer.user_ptr != nullptr) {
+            munmap(buffer.user_ptr, buffer.size);
+        }
+        close(buffer.dmabuf_fd);
+        buffer = DmaBuffer{};
+        return;
+    }
     if (buffer.user_ptr != nullptr && buffer.size > 0) {
         const uint32_t phys_addr = buffer.bus_addr & kBusAddressMask;
         const uint32_t page_offset = phys_addr & (kPageAlign - 1);
@@ -607,6 +692,7 @@ bool ILI9488Framebuffer::allocateCmaBuffers() {
 }
 
 void ILI9488Framebuffer::releaseCmaBuffers() {
+    notifyRelease();
     for (int i = 0; i < 3; ++i) {
         vcsm_handle_[i] = 0;
         if (cma_map_[i] != nullptr && cma_map_[i] != MAP_FAILED) {
@@ -669,13 +755,39 @@ bool ILI9488Framebuffer::discoverCmaBusAddresses() {
 
 bool ILI9488Framebuffer::allocateCpuBuffers() {
     for (int i = 0; i < 3; ++i) {
-        cpu_buffers_[i].resize(buffer_size_);
-        std::memset(cpu_buffers_[i].data(), 0, buffer_size_);
+        memfd_[i] = memfd_create("ili9488_framebuffer", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (memfd_[i] < 0 || ftruncate(memfd_[i], static_cast<off_t>(buffer_size_)) < 0) {
+            std::perror("Failed to create framebuffer memfd");
+            releaseCpuBuffers();
+            return false;
+        }
+        void* map = mmap(nullptr, buffer_size_, PROT_READ | PROT_WRITE, MAP_SHARED, memfd_[i], 0);
+        if (map == MAP_FAILED) {
+            std::perror("Failed to mmap framebuffer memfd");
+            releaseCpuBuffers();
+            return false;
+        }
+        cpu_map_[i] = map;
     }
     return true;
 }
 
+void ILI9488Framebuffer::releaseCpuBuffers() {
+    notifyRelease();
+    for (int i = 0; i < 3; ++i) {
+        if (cpu_map_[i] != nullptr) {
+            munmap(cpu_map_[i], buffer_size_);
+            cpu_map_[i] = nullptr;
+        }
+        if (memfd_[i] >= 0) {
+            close(memfd_[i]);
+            memfd_[i] = -1;
+        }
+    }
+}
+
 void ILI9488Framebuffer::releaseMailboxBuffers() {
+    notifyRelease();
     for (int i = 0; i < 3; ++i) {
         if (mailbox_map_[i] != nullptr && mailbox_map_[i] != MAP_FAILED) {
             const uint32_t phys_addr = mailbox_bus_addr_[i] & kBusAddressMask;
@@ -717,21 +829,24 @@ bool ILI9488Framebuffer::createTripleBufferSharedMemory(
     if (buffer_size_ == 0) {
         width_ = width;
         height_ = height;
-        buffer_size_ = static_cast<size_t>(width_) * height_ * 3;
+        buffer_size_ = static_cast<size_t>(width_) * height_ * bytes_per_pixel_;
     }
 
     const size_t header_size = sizeof(TripleBufferShmHeader);
-    triple_buffer_total_size_ = header_size + (3 * buffer_size_);
+    const size_t control_offset = shm::ControlOffset(buffer_size_);
+    triple_buffer_total_size_ = control_offset + sizeof(TripleBufferControlV2);
 
     bool buffers_ready = false;
     if (using_cma_ && cma_map_[0] != nullptr && cma_map_[1] != nullptr && cma_map_[2] != nullptr) {
         buffers_ready = true;
     } else if (use_mailbox_ && mailbox_map_[0] != nullptr && mailbox_map_[1] != nullptr && mailbox_map_[2] != nullptr) {
         buffers_ready = true;
+    } else if (cpu_map_[0] != nullptr && cpu_map_[1] != nullptr && cpu_map_[2] != nullptr) {
+        buffers_ready = true;
     }
 
     if (!buffers_ready) {
-        std::fprintf(stderr, "ERROR: No DMA buffers available.\n");
+        std::fprintf(stderr, "ERROR: No frame buffers available.\n");
         std::fprintf(stderr, "       Ensure driver.initialize() was called first.\n");
         return false;
     }
@@ -746,7 +861,7 @@ bool ILI9488Framebuffer::createTripleBufferSharedMemory(
 
     shm_unlink(name.c_str());
 
-    const size_t shm_size = header_size + (3 * buffer_size_);
+    const size_t shm_size = triple_buffer_total_size_;
     umask(0);
     int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
     if (fd < 0 && errno == EEXIST) {
@@ -779,14 +894,16 @@ bool ILI9488Framebuffer::createTripleBufferSharedMemory(
 
     triple_buffer_header_ = static_cast<TripleBufferShmHeader*>(header_map);
     triple_buffer_base_ = static_cast<uint8_t*>(header_map) + header_size;
+    triple_buffer_control_ = reinterpret_cast<TripleBufferControlV2*>(
+        static_cast<uint8_t*>(header_map) + control_offset);
     triple_buffer_shm_fd_ = fd;
     shm_name_ = name;
 
-    triple_buffer_header_->magic = 0x49494C39;
-    triple_buffer_header_->version = 1;
+    triple_buffer_header_->magic = kShmMagic;
+    triple_buffer_header_->version = kShmProtocolV2;
     triple_buffer_header_->width = width;
     triple_buffer_header_->height = height;
-    triple_buffer_header_->bytes_per_pixel = 3;
+    triple_buffer_header_->bytes_per_pixel = static_cast<uint32_t>(bytes_per_pixel_);
 
     triple_buffer_header_->buffer_a_bus_addr = mailbox_bus_addr_[0];
     triple_buffer_header_->buffer_b_bus_addr = mailbox_bus_addr_[1];
@@ -812,12 +929,11 @@ bool ILI9488Framebuffer::createTripleBufferSharedMemory(
         return false;
     }
 
-    for (int i = 0; i < 3; ++i) {
-        void* buf = using_cma_ ? cma_map_[i] : mailbox_map_[i];
+    for (uint32_t i = 0; i < 3; ++i) {
+        uint8_t* buf = getBuffer(i);
         if (buf != nullptr) {
             std::memset(buf, 0x00, buffer_size_);
         }
-        std::memset(triple_buffer_base_ + i * buffer_size_, 0x00, buffer_size_);
     }
 
     triple_buffer_header_->frame_counter = 0;
@@ -825,7 +941,14 @@ bool ILI9488Framebuffer::createTripleBufferSharedMemory(
     triple_buffer_header_->daemon_ready = 0;
     triple_buffer_header_->app_connected = 0;
 
+    triple_buffer_header_->control_offset = static_cast<uint32_t>(control_offset);
+    triple_buffer_header_->client_version = 0;
+    triple_buffer_header_->features = 0;
+    triple_buffer_header_->present_fence = 0;
+    triple_buffer_header_->complete_fence = 0;
+    triple_buffer_header_->scanout_sequence = 0;
     std::memset(triple_buffer_header_->padding, 0, sizeof(triple_buffer_header_->padding));
+    shm::InitializeControl(triple_buffer_control_);
 
     *out_header = triple_buffer_header_;
     out_shm_fd = fd;
@@ -851,24 +974,15 @@ void ILI9488Framebuffer::rotateBufferIndices() {
 }
 
 uint8_t* ILI9488Framebuffer::getPendingBuffer() {
-    if (using_cma_) {
-        return static_cast<uint8_t*>(cma_map_[pending_index_]);
-    }
-    return static_cast<uint8_t*>(mailbox_map_[pending_index_]);
+    return getBuffer(static_cast<uint32_t>(pending_index_));
 }
 
 uint8_t* ILI9488Framebuffer::getBackBuffer() {
-    if (using_cma_) {
-        return static_cast<uint8_t*>(cma_map_[back_index_]);
-    }
-    return static_cast<uint8_t*>(mailbox_map_[back_index_]);
+    return getBuffer(static_cast<uint32_t>(back_index_));
 }
 
 uint8_t* ILI9488Framebuffer::getFrontBuffer() {
-    if (using_cma_) {
-        return static_cast<uint8_t*>(cma_map_[front_index_]);
-    }
-    return static_cast<uint8_t*>(mailbox_map_[front_index_]);
+    return getBuffer(static_cast<uint32_t>(front_index_));
 }
 
 uint8_t* ILI9488Framebuffer::getShmPendingBuffer() {
@@ -878,13 +992,54 @@ uint8_t* ILI9488Framebuffer::getShmPendingBuffer() {
     return triple_buffer_base_ + pending_index_ * buffer_size_;
 }
 
+uint8_t* ILI9488Framebuffer::getShmBuffer(uint32_t slot) {
+    if (triple_buffer_base_ == nullptr || slot > 2) {
+        return nullptr;
+    }
+    return triple_buffer_base_ + slot * buffer_size_;
+}
+
+TripleBufferControlV2* ILI9488Framebuffer::getSharedControl() {
+    return triple_buffer_control_;
+}
+
+uint8_t* ILI9488Framebuffer::getBuffer(uint32_t index) {
+    if (index > 2) {
+        return nullptr;
+    }
+    if (using_cma_) {
+        return static_cast<uint8_t*>(cma_map_[index]);
+    }
+    if (use_mailbox_) {
+        return static_cast<uint8_t*>(mailbox_map_[index]);
+    }
+    return static_cast<uint8_t*>(cpu_map_[index]);
+}
+
+int ILI9488Framebuffer::exportBufferFd(uint32_t index) const {
+    if (index > 2) {
+        return -1;
+    }
+    if (using_cma_) {
+        return dmabuf_fd_[index];
+    }
+    if (use_mailbox_) {
+        return -1;
+    }
+    return memfd_[index];
+}
+
+bool ILI9488Framebuffer::buffersAreDmaBufs() const {
+    return using_cma_;
+}
+
 void ILI9488Framebuffer::cleanupSharedMemory() {
     if (triple_buffer_header_ != nullptr) {
         sem_destroy(&triple_buffer_header_->pending_sem);
-        munmap(triple_buffer_header_,
-               sizeof(TripleBufferShmHeader) + 3 * buffer_size_);
+        munmap(triple_buffer_header_, triple_buffer_total_size_);
         triple_buffer_header_ = nullptr;
         triple_buffer_base_ = nullptr;
+        triple_buffer_control_ = nullptr;
     }
     if (triple_buffer_shm_fd_ >= 0) {
         close(triple_buffer_shm_fd_);
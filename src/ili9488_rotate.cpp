@@ -9,6 +9,7 @@
 #include <cstdio>
 #include <cstring>
 #include <thread>
+#include <vector>
 
 namespace ili9488::gpu {
 
@@ -19,7 +20,7 @@ constexpr uint32_t kDmaBaseOffset = 0x7000;
 constexpr uint32_t kPageSize = 4096;
 constexpr uint32_t kBusAddressMask = 0x3FFFFFFF;
 
-constexpr uint32_t kDefaultDmaChannel = 7;
+constexpr uint32_t kDefaultDmaChannel = 6;
 
 constexpr uint32_t kDmaCs = 0x00;
 constexpr uint32_t kDmaConblkAd = 0x04;
@@ -33,14 +34,15 @@ constexpr uint32_t kDmaNextconbk = 0x1C;
 constexpr uint32_t kDmaCsActive = 1 << 0;
 constexpr uint32_t kDmaCsEnd = 1 << 1;
 constexpr uint32_t kDmaCsInt = 1 << 2;
+constexpr uint32_t kDmaCsError = 1 << 8;
 constexpr uint32_t kDmaCsReset = 1 << 31;
 constexpr uint32_t kDmaCsWaitWriteResp = 1 << 28;
 
-constexpr uint32_t kDmaTiSrcInc = 1 << 8;
-constexpr uint32_t kDmaTiDestInc = 1 << 4;
-constexpr uint32_t kDmaTi2d = 1 << 1;
+constexpr uint32_t kRowTransferInfo = dma::kTiTdMode | dma::kTiSrcInc | dma::kTiDestInc |
+                                      dma::kTiWaitResp | dma::kTiNoWideBursts;
+constexpr uint32_t kCopyTransferInfo = dma::kTiSrcInc | dma::kTiDestInc | dma::kTiWaitResp;
 
-constexpr size_t kBytesPerPixel = 3;
+constexpr int kDmaTimeoutMs = 100;
 
 bool TryReadPeripheralBase(uint32_t* base_out) {
     if (base_out == nullptr) {
@@ -69,12 +71,132 @@ bool TryReadPeripheralBase(uint32_t* base_out) {
 
 }
 
+size_t RotationControlBlockCount(uint32_t height, int rotation_degrees) {
+    switch (rotation_degrees) {
+        case 0:
+            return 1;
+        case 90:
+        case 180:
+        case 270:
+            return height;
+        default:
+            return 0;
+    }
+}
+
+size_t BuildRotationControlBlocks(
+    DmaControlBlock* cbs, size_t max_cbs, uint32_t cb_bus_addr,
+    uint32_t src_bus_addr, uint32_t dst_bus_addr,
+    uint32_t width, uint32_t height, size_t bytes_per_pixel,
+    int rotation_degrees) {
+
+    const size_t count = RotationControlBlockCount(height, rotation_degrees);
+    if (cbs == nullptr || count == 0 || count > max_cbs || width == 0 || height == 0) {
+        return 0;
+    }
+
+    const int64_t bpp = static_cast<int64_t>(bytes_per_pixel);
+    const int64_t src_row_bytes = static_cast<int64_t>(width) * bpp;
+
+    if (rotation_degrees == 0) {
+        DmaControlBlock& cb = cbs[0];
+        std::memset(&cb, 0, sizeof(cb));
+        cb.transfer_info = kCopyTransferInfo;
+        cb.source_addr = src_bus_addr;
+        cb.dest_addr = dst_bus_addr;
+        cb.transfer_length = static_cast<uint32_t>(src_row_bytes * height);
+        return 1;
+    }
+
+    if (width > dma::kMaxYLength + 1 || bytes_per_pixel > dma::kMaxXLength) {
+        return 0;
+    }
+
+    int64_t dst_stride = 0;
+    switch (rotation_degrees) {
+        case 90:
+            dst_stride = static_cast<int64_t>(height) * bpp - bpp;
+            break;
+        case 180:
+            dst_stride = -2 * bpp;
+            break;
+        case 270:
+            dst_stride = -static_cast<int64_t>(height) * bpp - bpp;
+            break;
+    }
+    if (!dma::StrideFits(dst_stride)) {
+        return 0;
+    }
+
+    for (uint32_t y = 0; y < height; ++y) {
+        int64_t dst_offset = 0;
+        switch (rotation_degrees) {
+            case 90:
+                dst_offset = static_cast<int64_t>(height - 1 - y) * bpp;
+                break;
+            case 180:
+                dst_offset = (static_cast<int64_t>(height - 1 - y) * width + (width - 1)) * bpp;
+                break;
+            case 270:
+                dst_offset = (static_cast<int64_t>(width - 1) * height + y) * bpp;
+                break;
+        }
+
+        DmaControlBlock& cb = cbs[y];
+        std::memset(&cb, 0, sizeof(cb));
+        cb.transfer_info = kRowTransferInfo;
+        cb.source_addr = src_bus_addr + static_cast<uint32_t>(src_row_bytes * y);
+        cb.dest_addr = dst_bus_addr + static_cast<uint32_t>(dst_offset);
+        cb.transfer_length = dma::TransferLength2d(static_cast<uint32_t>(bytes_per_pixel), width);
+        cb.stride = dma::Stride2d(0, static_cast<int32_t>(dst_stride));
+        cb.next_cb = (y + 1 < height)
+                         ? cb_bus_addr + static_cast<uint32_t>((y + 1) * sizeof(DmaControlBlock))
+                         : 0;
+    }
+    return count;
+}
+
+bool SimulateDmaRotation(
+    const uint8_t* src, uint8_t* dst,
+    uint32_t width, uint32_t height, size_t bytes_per_pixel,
+    int rotation_degrees) {
+
+    constexpr uint32_t kSimCbBusAddr = 0x00100000;
+    constexpr uint32_t kSimSrcBusAddr = 0x01000000;
+    constexpr uint32_t kSimDstBusAddr = 0x02000000;
+
+    const size_t count = RotationControlBlockCount(height, rotation_degrees);
+    std::vector<DmaControlBlock> cbs(count);
+    if (BuildRotationControlBlocks(cbs.data(), cbs.size(), kSimCbBusAddr,
+                                   kSimSrcBusAddr, kSimDstBusAddr,
+                                   width, height, bytes_per_pixel, rotation_degrees) == 0) {
+        return false;
+    }
+
+    const size_t frame_bytes = static_cast<size_t>(width) * height * bytes_per_pixel;
+    dma::MemoryModel memory;
+    memory.map(kSimCbBusAddr, cbs.data(), cbs.size() * sizeof(DmaControlBlock));
+    memory.map(kSimSrcBusAddr, const_cast<uint8_t*>(src), frame_bytes);
+    memory.map(kSimDstBusAddr, dst, frame_bytes);
+    return dma::RunControlBlockChain(memory, kSimCbBusAddr);
+}
+
 ILI9488Rotate::ILI9488Rotate()
     : dma_available_(false),
       mem_fd_(-1),
       dma_channel_(kDefaultDmaChannel),
       dma_regs_map_(nullptr),
-      dma_regs_(nullptr) {}
+      dma_regs_(nullptr),
+      cb_mem_(nullptr),
+      cb_bus_addr_(0),
+      cb_capacity_(0),
+      cb_count_(0),
+      chain_src_bus_addr_(0),
+      chain_dst_bus_addr_(0),
+      chain_width_(0),
+      chain_height_(0),
+      chain_rotation_(-1),
+      bytes_per_pixel_(3) {}
 
 ILI9488Rotate::~ILI9488Rotate() {
     cleanupDmaController();
@@ -83,7 +205,7 @@ ILI9488Rotate::~ILI9488Rotate() {
 bool ILI9488Rotate::initialize(bool enable_dma) {
     dma_available_ = false;
 
-    if (!enable_dma) {
+    if (!enable_dma || cb_mem_ == nullptr || cb_bus_addr_ == 0) {
         return true;
     }
 
@@ -95,6 +217,22 @@ bool ILI9488Rotate::initialize(bool enable_dma) {
     return true;
 }
 
+void ILI9488Rotate::setControlBlockMemory(void* cpu_addr, uint32_t bus_addr, size_t size) {
+    cb_mem_ = static_cast<DmaControlBlock*>(cpu_addr);
+    cb_bus_addr_ = bus_addr;
+    cb_capacity_ = cpu_addr != nullptr ? size / sizeof(DmaControlBlock) : 0;
+    cb_count_ = 0;
+    chain_rotation_ = -1;
+}
+
+void ILI9488Rotate::setBytesPerPixel(size_t bytes_per_pixel) {
+    if (bytes_per_pixel != bytes_per_pixel_) {
+        bytes_per_pixel_ = bytes_per_pixel;
+        chain_rotation_ = -1;
+        cb_count_ = 0;
+    }
+}
+
 bool ILI9488Rotate::setupDmaController() {
     uint32_t periph_base = kBcm2835PeriphBase;
     TryReadPeripheralBase(&periph_base);
@@ -162,63 +300,44 @@ bool ILI9488Rotate::configureAndWaitDma(
         return false;
     }
 
-    uint32_t src_stride = 0;
-    uint32_t dst_stride = 0;
-    uint32_t xlen = 0;
-    uint32_t ylen = 0;
-
-    switch (rotation_degrees) {
-        case 0:
-        case 180: {
-            xlen = width * kBytesPerPixel;
-            ylen = height;
-            src_stride = xlen;
-            dst_stride = xlen;
-            break;
-        }
-        case 90: {
-            xlen = height * kBytesPerPixel;
-            ylen = width;
-            src_stride = width * kBytesPerPixel;
-            dst_stride = height * kBytesPerPixel;
-            break;
-        }
-        case 270: {
-            xlen = height * kBytesPerPixel;
-            ylen = width;
-            src_stride = width * kBytesPerPixel;
-            dst_stride = height * kBytesPerPixel;
-            break;
-        }
-        default:
+    const bool chain_valid = cb_count_ != 0 &&
+                             chain_src_bus_addr_ == src_bus_addr &&
+                             chain_dst_bus_addr_ == dst_bus_addr &&
+                             chain_width_ == width &&
+                             chain_height_ == height &&
+                             chain_rotation_ == rotation_degrees;
+    if (!chain_valid) {
+        cb_count_ = BuildRotationControlBlocks(cb_mem_, cb_capacity_, cb_bus_addr_,
+                                               src_bus_addr, dst_bus_addr,
+                                               width, height, bytes_per_pixel_,
+                                               rotation_degrees);
+        if (cb_count_ == 0) {
+            chain_rotation_ = -1;
             return false;
+        }
+        chain_src_bus_addr_ = src_bus_addr;
+        chain_dst_bus_addr_ = dst_bus_addr;
+        chain_width_ = width;
+        chain_height_ = height;
+        chain_rotation_ = rotation_degrees;
     }
 
-    dma_regs_[kDmaSourceAd / 4] = src_bus_addr;
-    dma_regs_[kDmaDestAd / 4] = dst_bus_addr;
-
-    dma_regs_[kDmaLen / 4] = xlen * ylen;
-
-    dma_regs_[kDmaStride / 4] = ((ylen - 1) << 16) | (xlen & 0xFFFF);
+    dma_regs_[kDmaCs / 4] = kDmaCsEnd | kDmaCsInt;
+    dma_regs_[kDmaConblkAd / 4] = cb_bus_addr_;
+    dma_regs_[kDmaCs / 4] = kDmaCsActive | kDmaCsWaitWriteResp;
 
-    uint32_t ti = kDmaTiSrcInc | kDmaTiDestInc | kDmaTi2d | kDmaCsWaitWriteResp;
-    dma_regs_[kDmaTi / 4] = ti;
-
-    dma_regs_[kDmaCs / 4] = kDmaCsActive;
-
-    const int max_wait_ms = 50;
     const auto start = std::chrono::steady_clock::now();
     while ((dma_regs_[kDmaCs / 4] & kDmaCsActive) != 0) {
         const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now() - start);
-        if (elapsed.count() > max_wait_ms) {
+        if (elapsed.count() > kDmaTimeoutMs) {
             dma_regs_[kDmaCs / 4] = kDmaCsReset;
             return false;
         }
         std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
 
-    return true;
+    return (dma_regs_[kDmaCs / 4] & kDmaCsError) == 0;
 }
 
 bool ILI9488Rotate::rotateRgb666DmaMode(
@@ -232,7 +351,7 @@ bool ILI9488Rotate::rotateRgb666DmaMode(
     }
 
     if (rotation_degrees == 0) {
-        const size_t bytes = static_cast<size_t>(width) * height * kBytesPerPixel;
+        const size_t bytes = static_cast<size_t>(width) * height * bytes_per_pixel_;
         std::memcpy(dst, src, bytes);
         return true;
     }
@@ -0,0 +1,254 @@
+#include "band_pipeline.h"
+#include "panel_simulator.h"
+#include "pixel_utils.h"
+#include "spi_bus.h"
+#include "spi_dma_chain.h"
+#include "spi_dma_linux.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct ReportOptions {
+    uint32_t width = 320;
+    uint32_t height = 480;
+    uint32_t frames = 60;
+    size_t bufsiz = 65536;
+    uint32_t speed_hz = 65000000;
+    uint64_t ioctl_cost_ns = 4000;
+};
+
+struct Scenario {
+    const char* name;
+    std::vector<ili9488::Rect> rects;
+};
+
+uint32_t ParseUint(const char* value) {
+    return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+}
+
+ReportOptions ParseOptions(int argc, char** argv) {
+    ReportOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        if (arg == "--width") {
+            options.width = ParseUint(argv[i + 1]);
+        } else if (arg == "--height") {
+            options.height = ParseUint(argv[i + 1]);
+        } else if (arg == "--frames") {
+            options.frames = ParseUint(argv[i + 1]);
+        } else if (arg == "--bufsiz") {
+            options.bufsiz = ParseUint(argv[i + 1]);
+        } else if (arg == "--speed") {
+            options.speed_hz = ParseUint(argv[i + 1]);
+        } else if (arg == "--ioctl-cost-ns") {
+            options.ioctl_cost_ns = ParseUint(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+        }
+    }
+    return options;
+}
+
+bool RunScenario(const ReportOptions& options, const Scenario& scenario, bool batched,
+                 const std::vector<uint8_t>& frame) {
+    ili9488::SpiConfig config {};
+    config.speed_hz = options.speed_hz;
+    config.init_speed_hz = options.speed_hz;
+    config.bits_per_word = 8;
+    config.pixel_format = 0x66;
+    config.width = options.width;
+    config.height = options.height;
+    config.transfer_chunk_bytes = 65536;
+    config.batch_transfers = batched;
+
+    auto bus = std::make_unique<ili9488::MockSpiBus>(options.bufsiz, options.ioctl_cost_ns);
+    ili9488::MockSpiBus* mock = bus.get();
+    ili9488::ILI9488Transport transport;
+    if (!transport.initialize(config, std::move(bus))) {
+        std::fprintf(stderr, "Mock transport initialization failed\n");
+        return false;
+    }
+    transport.resetBusStats();
+    const uint64_t init_wire_ns = mock->wireTimeNs();
+
+    const size_t stride = static_cast<size_t>(options.width) * 3U;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < options.frames; ++i) {
+        const bool ok = scenario.rects.empty()
+                            ? transport.transferDma(frame.data(), frame.size())
+                            : transport.transferRegions(frame.data(), stride,
+                                                        scenario.rects.data(), scenario.rects.size());
+        if (!ok) {
+            std::fprintf(stderr, "%s: transfer failed (bufsiz %zu)\n", scenario.name, options.bufsiz);
+            return false;
+        }
+    }
+    const double cpu_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+
+    const ili9488::BusStats stats = transport.busStats();
+    const double frames = static_cast<double>(options.frames);
+    std::printf("%-14s %-8s %9.1f %9.1f %9.1f %10.1f %10.1f %11.1f %9.2f\n",
+                scenario.name,
+                batched ? "batched" : "legacy",
+                static_cast<double>(stats.syscalls()) / frames,
+                static_cast<double>(stats.spi_messages) / frames,
+                static_cast<double>(stats.gpio_writes) / frames,
+                static_cast<double>(stats.spi_transfers) / frames,
+                cpu_us / frames,
+                static_cast<double>(stats.ioctl_ns) / frames / 1000.0,
+                static_cast<double>(mock->wireTimeNs() - init_wire_ns) / frames / 1e6);
+    return true;
+}
+
+bool InitSimulatedTransport(const ReportOptions& options, ili9488::ILI9488Transport& transport,
+                            ili9488::SimulatorBus** simulator) {
+    ili9488::SpiConfig config {};
+    config.speed_hz = options.speed_hz;
+    config.init_speed_hz = options.speed_hz;
+    config.bits_per_word = 8;
+    config.pixel_format = 0x66;
+    config.width = options.width;
+    config.height = options.height;
+    config.transfer_chunk_bytes = 65536;
+    config.batch_transfers = true;
+
+    ili9488::SimulatorConfig sim_config;
+    sim_config.bufsiz = options.bufsiz;
+    sim_config.realtime = true;
+    auto bus = std::make_unique<ili9488::SimulatorBus>(sim_config);
+    *simulator = bus.get();
+    return transport.initialize(config, std::move(bus));
+}
+
+// RGB888 source in landscape, rotated 90 degrees onto the panel: the full
+// convert -> rotate -> send sequence against the band pipeline, both paced by
+// the simulated wire.
+bool RunStreamingComparison(const ReportOptions& options) {
+    const uint32_t frames = std::min<uint32_t>(options.frames, 10);
+    const uint32_t src_width = options.height;
+    const uint32_t src_height = options.width;
+    const size_t pixels = static_cast<size_t>(src_width) * src_height;
+    std::vector<uint8_t> source(pixels * 3U);
+    for (size_t i = 0; i < source.size(); ++i) {
+        source[i] = static_cast<uint8_t>((i * 7U) ^ (i >> 9));
+    }
+
+    ili9488::ILI9488Transport serial_transport;
+    ili9488::ILI9488Transport band_transport;
+    ili9488::SimulatorBus* serial_sim = nullptr;
+    ili9488::SimulatorBus* band_sim = nullptr;
+    if (!InitSimulatedTransport(options, serial_transport, &serial_sim) ||
+        !InitSimulatedTransport(options, band_transport, &band_sim)) {
+        std::fprintf(stderr, "Simulator transport initialization failed\n");
+        return false;
+    }
+
+    std::vector<uint8_t> converted(pixels * 3U);
+    std::vector<uint8_t> rotated(pixels * 3U);
+    double serial_first_us = 0.0;
+    double serial_frame_us = 0.0;
+    for (uint32_t i = 0; i < frames; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        ili9488::pixel::ConvertRgb888ToRgb666(source.data(), converted.data(), pixels);
+        ili9488::pixel::RotateRgb666(converted.data(), rotated.data(), src_width, src_height, 90);
+        const auto first = std::chrono::steady_clock::now();
+        if (!serial_transport.transferDma(rotated.data(), rotated.size())) {
+            std::fprintf(stderr, "Serial streaming transfer failed\n");
+            return false;
+        }
+        serial_first_us += std::chrono::duration<double, std::micro>(first - start).count();
+        serial_frame_us += std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    ili9488::BandPipeline pipeline(band_transport);
+    double band_first_us = 0.0;
+    double band_frame_us = 0.0;
+    for (uint32_t i = 0; i < frames; ++i) {
+        if (!pipeline.present(source.data(), ili9488::InputFormat::Rgb888, 0, 90)) {
+            std::fprintf(stderr, "Band pipeline transfer failed\n");
+            return false;
+        }
+        const ili9488::BandPipelineStats stats = pipeline.stats();
+        band_first_us += static_cast<double>(stats.first_band_ns) / 1000.0;
+        band_frame_us += static_cast<double>(stats.frame_ns) / 1000.0;
+    }
+
+    const ili9488::PanelSimulator serial_panel = serial_sim->snapshot();
+    const ili9488::PanelSimulator band_panel = band_sim->snapshot();
+    bool match = true;
+    for (uint32_t y = 0; y < ili9488::kPanelNativeHeight && match; ++y) {
+        for (uint32_t x = 0; x < ili9488::kPanelNativeWidth; ++x) {
+            if (serial_panel.pixel(x, y) != band_panel.pixel(x, y)) {
+                match = false;
+                break;
+            }
+        }
+    }
+
+    const double n = static_cast<double>(frames);
+    std::printf("\nStreaming RGB888 %ux%u rotated 90, simulated wire, %u frames\n",
+                src_width, src_height, frames);
+    std::printf("%-22s %14s %12s %14s\n", "path", "first_pixel_us", "frame_us", "working_set");
+    std::printf("%-22s %14.1f %12.1f %12zu B\n", "convert+rotate+send",
+                serial_first_us / n, serial_frame_us / n, converted.size() + rotated.size());
+    std::printf("%-22s %14.1f %12.1f %12zu B\n", "band pipeline",
+                band_first_us / n, band_frame_us / n, pipeline.workingSetBytes());
+    std::printf("Panel contents %s\n", match ? "match" : "MISMATCH");
+    return match;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const ReportOptions options = ParseOptions(argc, argv);
+    if (options.width == 0 || options.height == 0 || options.frames == 0 || options.bufsiz == 0) {
+        std::fprintf(stderr, "Usage: %s [--width px] [--height px] [--frames n] [--bufsiz bytes]"
+                             " [--speed hz] [--ioctl-cost-ns ns]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<uint8_t> frame(static_cast<size_t>(options.width) * options.height * 3U);
+    for (size_t i = 0; i < frame.size(); ++i) {
+        frame[i] = static_cast<uint8_t>(i * 31U) & 0xFC;
+    }
+
+    const uint32_t w = options.width;
+    const uint32_t h = options.height;
+    const Scenario scenarios[] = {
+        {"full-frame", {}},
+        {"half-width", {{0, 0, w / 2, h}}},
+        {"damage-3rect", {{8, 8, 72, 8}, {w / 4, h / 3, w / 3, h / 4}, {0, h - 32, w, 32}}},
+    };
+
+    std::printf("Mock spidev: bufsiz=%zu speed=%u Hz ioctl cost=%llu ns, %ux%u RGB666, %u frames\n\n",
+                options.bufsiz, options.speed_hz,
+                static_cast<unsigned long long>(options.ioctl_cost_ns), w, h, options.frames);
+    std::printf("%-14s %-8s %9s %9s %9s %10s %10s %11s %9s\n",
+                "scenario", "mode", "syscalls", "spi_msgs", "gpio", "transfers",
+                "cpu_us", "ioctl_us", "wire_ms");
+    for (const Scenario& scenario : scenarios) {
+        if (!RunScenario(options, scenario, false, frame) || !RunScenario(options, scenario, true, frame)) {
+            return 1;
+        }
+    }
+    std::printf("\nPer-frame averages. ioctl_us models the kernel entry cost of each syscall.\n");
+
+    ili9488::spidma::ModelStats dma_stats;
+    const bool dma_ok = ili9488::spidma::SimulateTransfer(frame.data(), frame.size(), nullptr, &dma_stats);
+    std::printf("\nDirect SPI DMA (register model): %zu segments, %zu control blocks, %zu register writes,"
+                " 0 syscalls, wire stream %s\n",
+                dma_stats.segments, dma_stats.control_blocks, dma_stats.register_writes,
+                dma_ok ? "matches the frame" : "MISMATCH");
+    const bool streaming_ok = RunStreamingComparison(options);
+    return dma_ok && streaming_ok ? 0 : 1;
+}
@@ -0,0 +1,375 @@
+#include "panel_simulator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace ili9488 {
+
+namespace {
+constexpr uint8_t kCmdSoftwareReset = 0x01;
+constexpr uint8_t kCmdSleepIn = 0x10;
+constexpr uint8_t kCmdSleepOut = 0x11;
+constexpr uint8_t kCmdInversionOff = 0x20;
+constexpr uint8_t kCmdInversionOn = 0x21;
+constexpr uint8_t kCmdDisplayOff = 0x28;
+constexpr uint8_t kCmdDisplayOn = 0x29;
+constexpr uint8_t kCmdColumnAddressSet = 0x2A;
+constexpr uint8_t kCmdPageAddressSet = 0x2B;
+constexpr uint8_t kCmdMemoryWrite = 0x2C;
+constexpr uint8_t kCmdMemoryAccessControl = 0x36;
+constexpr uint8_t kCmdIdleOff = 0x38;
+constexpr uint8_t kCmdIdleOn = 0x39;
+constexpr uint8_t kCmdPixelFormat = 0x3A;
+constexpr uint8_t kCmdMemoryWriteContinue = 0x3C;
+
+constexpr uint8_t kMadctlMy = 0x80;
+constexpr uint8_t kMadctlMx = 0x40;
+constexpr uint8_t kMadctlMv = 0x20;
+constexpr uint8_t kMadctlBgr = 0x08;
+constexpr uint8_t kColmodDbiMask = 0x07;
+constexpr uint8_t kColmodDbi16 = 0x05;
+constexpr uint8_t kPowerOnColmod = 0x66;
+constexpr size_t kMaxRegisterBytes = 64;
+
+uint8_t Expand6(uint8_t value) {
+    const uint8_t v = value & 0xFC;
+    return static_cast<uint8_t>(v | (v >> 6));
+}
+
+uint8_t Expand5(uint8_t value) {
+    return static_cast<uint8_t>((value << 3) | (value >> 2));
+}
+}
+
+PanelSimulator::PanelSimulator()
+    : gram_(static_cast<size_t>(kPanelNativeWidth) * kPanelNativeHeight * 3U, 0) {
+    resetRegisters();
+}
+
+void PanelSimulator::reset() {
+    ++stats_.hardware_resets;
+    resetRegisters();
+}
+
+void PanelSimulator::resetRegisters() {
+    for (auto& value : registers_) {
+        value.clear();
+    }
+    command_ = 0;
+    parameter_index_ = 0;
+    writing_ = false;
+    madctl_ = 0;
+    colmod_ = kPowerOnColmod;
+    sleeping_ = true;
+    display_on_ = false;
+    inverted_ = false;
+    idle_ = false;
+    column_start_ = 0;
+    column_end_ = kPanelNativeWidth - 1;
+    page_start_ = 0;
+    page_end_ = kPanelNativeHeight - 1;
+    column_ = 0;
+    page_ = 0;
+    pending_length_ = 0;
+}
+
+void PanelSimulator::command(uint8_t command) {
+    ++stats_.commands;
+    command_ = command;
+    parameter_index_ = 0;
+    writing_ = false;
+    pending_length_ = 0;
+
+    switch (command) {
+        case kCmdSoftwareReset:
+            resetRegisters();
+            break;
+        case kCmdSleepIn:
+            sleeping_ = true;
+            break;
+        case kCmdSleepOut:
+            sleeping_ = false;
+            break;
+        case kCmdInversionOff:
+            inverted_ = false;
+            break;
+        case kCmdInversionOn:
+            inverted_ = true;
+            break;
+        case kCmdDisplayOff:
+            display_on_ = false;
+            break;
+        case kCmdDisplayOn:
+            display_on_ = true;
+            break;
+        case kCmdIdleOff:
+            idle_ = false;
+            break;
+        case kCmdIdleOn:
+            idle_ = true;
+            break;
+        case kCmdMemoryWrite:
+            beginMemoryWrite(true);
+            break;
+        case kCmdMemoryWriteContinue:
+            beginMemoryWrite(false);
+            break;
+        default:
+            registers_[command].clear();
+            break;
+    }
+}
+
+void PanelSimulator::beginMemoryWrite(bool restart) {
+    ++stats_.memory_writes;
+    writing_ = true;
+    if (restart) {
+        column_ = column_start_;
+        page_ = page_start_;
+    }
+}
+
+void PanelSimulator::data(const uint8_t* data, size_t length) {
+    if (!writing_) {
+        for (size_t i = 0; i < length; ++i) {
+            parameter(data[i]);
+        }
+        return;
+    }
+
+    const size_t bpp = bytesPerPixel();
+    size_t offset = 0;
+    // pending_length_ stays below bpp; the sizeof bound makes that visible.
+    while (pending_length_ > 0 && pending_length_ < sizeof(pending_) && offset < length) {
+        pending_[pending_length_++] = data[offset++];
+        if (pending_length_ == bpp) {
+            writePixel(pending_);
+            pending_length_ = 0;
+        }
+    }
+    for (; offset + bpp <= length; offset += bpp) {
+        writePixel(data + offset);
+    }
+    for (; offset < length && pending_length_ < sizeof(pending_); ++offset) {
+        pending_[pending_length_++] = data[offset];
+    }
+}
+
+void PanelSimulator::parameter(uint8_t value) {
+    if (command_ == 0 && stats_.commands == 0) {
+        ++stats_.stray_bytes;
+        return;
+    }
+    ++stats_.parameter_bytes;
+    std::vector<uint8_t>& reg = registers_[command_];
+    if (reg.size() < kMaxRegisterBytes) {
+        reg.push_back(value);
+    }
+
+    const size_t index = parameter_index_++;
+    switch (command_) {
+        case kCmdColumnAddressSet:
+        case kCmdPageAddressSet:
+            if (index == 3) {
+                const uint16_t start = static_cast<uint16_t>((reg[0] << 8) | reg[1]);
+                const uint16_t end = static_cast<uint16_t>((reg[2] << 8) | reg[3]);
+                if (command_ == kCmdColumnAddressSet) {
+                    column_start_ = start;
+                    column_end_ = end;
+                } else {
+                    page_start_ = start;
+                    page_end_ = end;
+                }
+            }
+            break;
+        case kCmdMemoryAccessControl:
+            if (index == 0) {
+                madctl_ = value;
+            }
+            break;
+        case kCmdPixelFormat:
+            if (index == 0) {
+                colmod_ = value;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+size_t PanelSimulator::bytesPerPixel() const {
+    return (colmod_ & kColmodDbiMask) == kColmodDbi16 ? 2U : 3U;
+}
+
+void PanelSimulator::writePixel(const uint8_t* bytes) {
+    uint32_t x = column_;
+    uint32_t y = page_;
+    if (column_ >= column_end_) {
+        column_ = column_start_;
+        page_ = page_ >= page_end_ ? page_start_ : static_cast<uint16_t>(page_ + 1);
+    } else {
+        ++column_;
+    }
+
+    if ((madctl_ & kMadctlMv) != 0) {
+        std::swap(x, y);
+    }
+    if (x >= kPanelNativeWidth || y >= kPanelNativeHeight) {
+        ++stats_.clipped_pixels;
+        return;
+    }
+    if ((madctl_ & kMadctlMx) != 0) {
+        x = kPanelNativeWidth - 1 - x;
+    }
+    if ((madctl_ & kMadctlMy) != 0) {
+        y = kPanelNativeHeight - 1 - y;
+    }
+
+    uint8_t* dst = gram_.data() + (static_cast<size_t>(y) * kPanelNativeWidth + x) * 3U;
+    if (bytesPerPixel() == 2U) {
+        dst[0] = Expand5(bytes[0] >> 3);
+        dst[1] = Expand6(static_cast<uint8_t>(((bytes[0] & 0x07) << 5) | ((bytes[1] >> 3) & 0x1C)));
+        dst[2] = Expand5(bytes[1] & 0x1F);
+    } else {
+        dst[0] = Expand6(bytes[0]);
+        dst[1] = Expand6(bytes[1]);
+        dst[2] = Expand6(bytes[2]);
+    }
+    ++stats_.pixels_written;
+}
+
+uint32_t PanelSimulator::pixel(uint32_t x, uint32_t y) const {
+    if (x >= kPanelNativeWidth || y >= kPanelNativeHeight || sleeping_ || !display_on_) {
+        return 0;
+    }
+    const uint8_t* src = gram_.data() +
+                         (static_cast<size_t>(y) * kPanelNativeWidth + (kPanelNativeWidth - 1 - x)) * 3U;
+    uint8_t r = src[0];
+    uint8_t g = src[1];
+    uint8_t b = src[2];
+    if ((madctl_ & kMadctlBgr) == 0) {
+        std::swap(r, b);
+    }
+    if (inverted_) {
+        r = static_cast<uint8_t>(~r);
+        g = static_cast<uint8_t>(~g);
+        b = static_cast<uint8_t>(~b);
+    }
+    if (idle_) {
+        r = (r & 0x80) ? 0xFF : 0x00;
+        g = (g & 0x80) ? 0xFF : 0x00;
+        b = (b & 0x80) ? 0xFF : 0x00;
+    }
+    return (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+}
+
+bool PanelSimulator::writePpm(const std::string& path) const {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        std::perror("Panel simulator: fopen");
+        return false;
+    }
+    std::fprintf(file, "P6\n%u %u\n255\n", kPanelNativeWidth, kPanelNativeHeight);
+    std::vector<uint8_t> row(static_cast<size_t>(kPanelNativeWidth) * 3U);
+    bool ok = true;
+    for (uint32_t y = 0; y < kPanelNativeHeight && ok; ++y) {
+        for (uint32_t x = 0; x < kPanelNativeWidth; ++x) {
+            const uint32_t rgb = pixel(x, y);
+            row[x * 3U] = static_cast<uint8_t>(rgb >> 16);
+            row[x * 3U + 1U] = static_cast<uint8_t>(rgb >> 8);
+            row[x * 3U + 2U] = static_cast<uint8_t>(rgb);
+        }
+        ok = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+SimulatorBus::SimulatorBus(const SimulatorConfig& config)
+    : config_(config),
+      data_mode_(true),
+      reset_low_(false),
+      wire_time_ns_(0),
+      busy_until_(std::chrono::steady_clock::now()) {}
+
+uint32_t SimulatorBus::effectiveSpeedHz(uint32_t speed_hz) const {
+    if (config_.core_clock_hz == 0 || speed_hz == 0) {
+        return speed_hz;
+    }
+    uint32_t divider = (config_.core_clock_hz + speed_hz - 1U) / speed_hz;
+    divider = std::max<uint32_t>(2U, (divider + 1U) & ~1U);
+    return config_.core_clock_hz / divider;
+}
+
+bool SimulatorBus::message(const SpiSegment* segments, size_t count, uint32_t speed_hz) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += segments[i].length;
+    }
+    if (bytes > config_.bufsiz || count > kMaxSpiTransfersPerMessage) {
+        std::fprintf(stderr, "Panel simulator: message of %zu bytes in %zu transfers exceeds spidev limits\n",
+                     bytes, count);
+        return false;
+    }
+
+    const uint32_t sclk = effectiveSpeedHz(speed_hz);
+    const uint64_t duration_ns = config_.message_overhead_ns +
+                                 (sclk > 0 ? static_cast<uint64_t>(bytes) * 8ULL * 1000000000ULL / sclk : 0ULL);
+    std::chrono::steady_clock::time_point done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!reset_low_) {
+            for (size_t i = 0; i < count; ++i) {
+                if (data_mode_) {
+                    panel_.data(segments[i].data, segments[i].length);
+                } else {
+                    for (size_t j = 0; j < segments[i].length; ++j) {
+                        panel_.command(segments[i].data[j]);
+                    }
+                }
+            }
+        }
+        wire_time_ns_ += duration_ns;
+        const auto now = std::chrono::steady_clock::now();
+        busy_until_ = std::max(busy_until_, now) + std::chrono::nanoseconds(duration_ns);
+        done = busy_until_;
+    }
+    recordMessage(count, bytes, 0);
+    if (config_.realtime) {
+        std::this_thread::sleep_until(done);
+    }
+    return true;
+}
+
+bool SimulatorBus::setDataCommand(bool data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_mode_ = data;
+    recordGpioWrite(0);
+    return true;
+}
+
+bool SimulatorBus::setReset(bool high) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!high && !reset_low_) {
+        panel_.reset();
+    }
+    reset_low_ = !high;
+    recordGpioWrite(0);
+    return true;
+}
+
+uint64_t SimulatorBus::wireTimeNs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return wire_time_ns_;
+}
+
+PanelSimulator SimulatorBus::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return panel_;
+}
+
+bool SimulatorBus::writePpm(const std::string& path) const {
+    return snapshot().writePpm(path);
+}
+
+}
@@ -0,0 +1,387 @@
+#include "pixel_simd.h"
+
+namespace ili9488::pixel::simd {
+
+namespace {
+
+constexpr uint8_t kBayer4[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5},
+};
+
+constexpr uint8_t kBayer8[8][8] = {
+    { 0, 32,  8, 40,  2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44,  4, 36, 14, 46,  6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    { 3, 35, 11, 43,  1, 33,  9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47,  7, 39, 13, 45,  5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+constexpr uint32_t kBlueNoiseSize = 64;
+
+// 64x64 void-and-cluster tile (Gaussian sigma 1.5, toroidal), ranks scaled
+// to 0-255. Every threshold occurs 16 times.
+constexpr uint8_t kBlueNoise[kBlueNoiseSize * kBlueNoiseSize] = {
+     80, 111,  20, 232,  40, 251, 103,  47,  10, 127, 229, 168, 112,  31, 142, 244,
+     93,  70, 209, 110, 232,  47, 157, 128, 192, 255, 116,  40, 125, 205, 106,  43,
+    128,  94, 175, 122, 150,  98,  51, 230, 179, 199,  93, 171,  72, 188, 104, 230,
+    135,  14, 202, 143, 224,  96, 170, 111, 150,  91, 213, 107, 240,  55,  29, 231,
+      7, 209, 147, 185, 118,  26, 193, 221, 161,  82,  26,  67, 190, 222,  57,   5,
+    161,  21, 141,  36,  94, 185,  73,  98,  10, 162,  73, 180, 236, 152,  21, 230,
+    148,  11, 227,  41,  21, 254, 167, 118,  84,   3, 239,  27, 115, 254,   4,  87,
+    216, 112,  59,  85,  11, 132, 250,  31, 188,  59,  21, 139,  76, 191, 166, 127,
+    175, 244,  48,  70, 214,  86, 150,  61, 112, 249, 198, 153,  12, 124, 179, 103,
+    228, 197,  56, 248, 152,  24, 243, 210,  44, 141, 216,   4,  96,  52,  82, 187,
+     64, 200,  85, 160, 211,  78,  12, 220,  43, 160, 131, 192,  40, 144, 168,  50,
+    183,  32, 163, 239, 182,  52, 214,  72, 128, 233, 161, 204,   4, 152, 103,  63,
+     34, 134, 100, 165,   5, 131, 227,  17, 178,  37, 135, 100, 242,  84, 208,  39,
+    129,  82, 174, 118, 199,  62, 137, 170, 107, 231,  58, 132, 207, 173, 243, 123,
+     33, 107, 247,  52, 129, 192, 103, 139, 203,  68,  99, 227,  81, 209, 126, 238,
+     75, 140, 221, 117,  28, 102, 157,   0, 200, 104,  48,  87, 225,  43, 248, 202,
+     73, 226,  20, 201, 242,  52, 171,  93, 235,  73, 215,  54,  21, 166,  67, 254,
+    151,  30, 222,  11,  89, 227,  15,  81,  30, 189,  86, 157,  33, 112,  12, 159,
+    224, 176, 138,   0, 179,  62, 233,  28, 177, 246,  15, 153,  60,  12, 101,  25,
+    205,  97,   6,  63, 194, 139, 241,  90, 168,  19, 254, 179, 117, 135,  16,  93,
+    150, 186, 118,  79, 145, 110,  30, 203, 142,   0, 117, 176, 232, 139, 109,   9,
+    192,  63, 105, 162,  43, 180, 127, 205, 239, 118,  17, 248, 221,  69, 201,  50,
+     91,  22,  68, 218, 116,  36, 157,  89, 122,  52, 111, 213, 181, 248, 162, 190,
+     42, 155, 252, 167, 213,  76,  39, 210,  56, 124, 147,  27,  64, 193, 166, 217,
+      1,  54, 234,  37, 192,  68, 252, 123,  49, 160, 195,  85,  29, 206,  49, 178,
+    122, 239, 203, 142, 250, 103,  68, 148,  55, 163, 183,  47, 125,  95, 148, 254,
+    128, 208, 152, 239,  80, 196, 249,   5, 223, 165,  33, 132,  88,  46, 120,  67,
+    234, 128,  83,  46, 125,  11, 178, 116, 230, 186,  80, 212, 101, 241,  47, 111,
+    253, 173,  93, 160, 217,   8, 182,  81, 221, 100, 247,  61, 120, 159,  78, 219,
+     91,  16,  50,  78,   0, 190,  35, 223,  11, 100,  77, 144, 196,  27, 174,   7,
+     78, 185,  37, 101,  14, 147, 126,  61, 206,  77, 191, 238,  24, 144, 208,   2,
+    106, 183,  16, 225,  93, 247, 150,  29,  71,   9, 238,  41, 154,  21,  84, 141,
+     31,  66, 122,  23, 132, 101, 149,  28, 174,  12,  38, 145, 227,   5, 248,  34,
+    168, 135, 180, 229, 130, 214, 161, 120, 253, 193, 217,   2, 242,  61, 212, 109,
+    233,  54, 119, 173, 203,  42,  92, 183,  26, 143,  97,  57, 218, 171,  77, 226,
+    151,  36, 205, 142, 188,  58, 102, 196, 136, 165, 108, 200, 126, 230, 182, 208,
+     97, 225, 184, 246,  56, 231, 202,  62, 240, 134, 211, 178,  89, 198, 108, 149,
+     69, 236, 111,  30,  97,  48,  88,  24,  71, 132,  37, 116,  88, 159, 135,  32,
+    197, 158,  20, 220,  59, 242, 161, 227, 113, 254,   7, 161, 116,  16,  99, 178,
+     58, 240,  72, 114,  23, 160, 232,  46, 213,  87,  56, 176,   5,  74,  53, 129,
+    199, 152,   7,  83, 166,  38,  91, 120, 163,  79, 110,  54,  21, 134,  51, 190,
+     20, 210,  59, 197, 145, 172, 234, 187, 150,  53, 172, 226, 187,  44, 221,  98,
+     66, 138, 251,  76, 133, 107,   8,  72,  40, 177, 129, 232,  72, 200, 250,  28,
+    137,  94, 168,  44, 221,  81,   2, 123, 242,  18, 143, 251,  94, 222, 167,  14,
+     77,  48, 112, 211, 138, 191,   4, 213,  47,  18, 194, 250, 162, 217,  81, 242,
+    123,  95, 162,  14, 217,  65,   6, 109, 208, 242,  98,  23,  71, 121,  12, 243,
+    182,   2,  95, 165,  25, 180, 216, 149, 203,  83,  51, 192,  33, 141,  49, 118,
+    219,  19, 195, 255, 128, 182, 207,  98, 174,  39, 191, 116,  29, 149, 109, 247,
+    140, 188, 237,  64,  22, 107, 255, 146, 182, 226, 130,  69, 100,  33, 183,   9,
+    153,  39, 255,  80, 120, 243, 140,  43,  82,  11, 161, 139, 252, 202, 167,  83,
+    126, 209,  50, 194, 235,  88,  53, 116,  17, 225, 104, 156,  93, 222, 164, 190,
+     77, 148, 104,   8,  61, 146,  27,  56, 153,  83, 227,  68, 215,  45, 204,  25,
+    102,  36, 163, 123, 224, 172,  77,  58, 101,  35, 156,   3, 232, 139, 112, 224,
+     57, 179, 136, 189,  34,  95, 202, 174, 230, 115, 197,  45,  92,  19, 144,  55,
+     31, 237, 154, 116,  38, 144, 190, 247, 167, 137,  27, 248,   0,  66, 106,  13,
+    245,  55, 211, 163,  88, 218, 112, 249, 204, 134,  11, 158, 181, 131,  84, 175,
+    242, 208,  12,  89,  45, 142,  28, 217, 124, 238,  85, 176, 202,  52, 164,  75,
+    206,  99,   4, 228,  56, 165,  19, 124,  60,  31, 224,  66, 183, 235, 109, 226,
+    178, 101,  71,  17, 219,  76,   4,  96,  45,  70, 175, 210, 123, 183, 234,  41,
+    130, 180,  29, 122, 239,  41, 176,  72,  20, 105, 236,  55,  99,   2, 223,  65,
+    125,  54, 148, 180, 247, 205,  96, 176,   9, 195,  61, 118,  26,  93, 245,  16,
+    125, 234,  69, 112, 146, 219,  74, 252, 156, 178, 128, 102, 154,  38,  74, 203,
+     13, 143, 197, 245, 133, 176, 211, 120, 235, 197, 113,  57,  35, 151,  85, 214,
+    157,  96, 229,  73, 187,  11, 127, 155, 188,  43, 210, 125, 194, 254, 151,  18,
+    192, 105, 233,  69,   1, 115,  56, 243, 158,  44, 144, 252, 213, 151,  40, 198,
+    171,  30, 158, 203,  25, 182, 105,   2,  88, 213,  22, 248,   5, 215, 171, 130,
+     90,  60, 165,  44,  94,  58, 160,  34, 148,   9,  91, 228, 133, 202,  17, 116,
+     65,   7, 201,  47, 150,  92, 225,  53, 244,  86, 166,  26,  77,  42,  95, 171,
+     73, 216,  37, 130, 198, 153,  19, 134,  88, 208, 103,  12,  76, 185, 108, 137,
+     80,  51, 249,  86, 129,  46, 237, 194, 144,  45,  75, 193, 136, 112,  50,  22,
+    255, 206,   7, 112, 222,  21, 249,  78, 181, 214,  25, 170,  75, 242,  53, 194,
+    251, 172, 138, 108, 247,  31, 198, 109,   7, 142, 114, 238, 174, 140, 213,  31,
+    135,  15, 166,  97, 227,  78, 190, 231,  64,  27, 169, 229, 130,  57,   0, 240,
+    215, 103, 186,   7, 224,  68, 137,  28, 114, 233, 153,  93,  58, 240, 188, 156,
+    106, 137, 236, 180, 128, 192, 141, 108,  51, 127, 254, 146,  29, 104, 163, 131,
+     36,  87,  24, 208,  63, 171, 135,  76, 179, 222,  64,  14, 202,  58, 110, 244,
+     90, 186, 252,  54,  27, 163,  40, 100, 178, 221, 121,  42, 192, 161, 207,  66,
+    154,  20, 120, 148, 178,  97, 168, 209,  57, 181,  11, 208, 165,  26,  84, 219,
+     66,  40,  83,  27,  60,  88,   2, 228, 196,  71, 100,  46, 223, 186,   5,  70,
+    220, 115, 232, 157,   1,  98, 240,  23, 206,  39, 159,  98, 128, 228,   4, 158,
+    207,  66, 117, 147, 216, 113, 246, 131,   3, 149,  73,  95, 236,  30,  87, 124,
+     38, 192, 233,  57,  35, 241,  10,  79, 250,  99, 124,  39, 230, 104, 144,   0,
+    195, 172, 227, 159, 204, 241, 165,  36, 150,  14, 173, 205, 119,  86, 237, 140,
+    175,  46, 187,  77, 123, 218,  49, 150, 120,  84, 251, 188,  29,  81, 181,  50,
+     34, 233,   6,  85, 179,  14,  71, 204,  54, 195, 249,  15, 143, 111, 223, 170,
+    254,  95,  74, 211, 113, 196, 155, 126,  35, 160, 223,  64, 132, 184,  49, 238,
+    124,  23, 110, 141,  43, 104,  69, 219,  96, 239, 134,  23,  63, 156,  32, 200,
+     94,  10, 144, 252,  33, 174, 194,  68, 235,   5, 136,  47, 213, 149, 240, 126,
+    173, 137, 164, 210,  50, 136, 224,  91, 161,  33, 106, 177,  63, 199,   8,  54,
+    142,  12, 162, 135,  18,  88,  50, 220, 189,  18,  82, 174,   9, 252,  73, 162,
+     90, 206,  69, 251,  10, 133, 177, 119,  55, 211,  80, 181, 246, 215,  53, 110,
+    243,  67, 212, 102,  59, 137,  18,  96, 165, 199, 105, 170,  71, 113,  20,  94,
+    204,  75,  26, 101, 250, 188,  22, 118, 234, 134, 217,  46, 155, 245,  80, 185,
+    104, 202,  46, 228, 176, 246, 142,  69, 107, 237, 145, 211,  97, 199, 115,  15,
+    225,  46, 152,  95, 186, 232,  28, 199,   8, 154,  43, 103,   1, 122, 146,  15,
+    167, 128,  20, 153, 205, 238, 116, 221,  32,  59, 229,  15, 245, 193,  57, 222,
+    110,  47, 238, 125,  67, 155,  42, 172,  76,   7,  86, 191, 117,  34, 134, 217,
+     24, 243, 125,  68, 102,  32, 204,   1, 171,  48, 117,  22,  56, 154,  37, 178,
+    132, 191,  18, 211,  64,  45, 143,  86, 252, 186, 127, 225, 165,  69, 186, 211,
+     81, 230, 180,  44,  89,   4,  74, 186, 152, 126,  85, 147,  40, 131, 157,   8,
+    189, 148, 172, 202,   1,  97, 211,  60, 195, 254, 144,  23, 230,  92, 172,  65,
+    154,  85, 169,   6, 219, 156,  82, 129, 249,  76, 192, 231, 130, 222,  82, 247,
+     63, 105, 239, 127, 170, 114, 217, 164, 108,  68,  31, 200,  91,  44, 254, 101,
+     33,  57, 112, 244, 162, 197, 141,  43, 255,  18, 217, 188, 101, 225,  83, 251,
+     66,  20,  87,  40, 231, 141, 244, 128,  31, 111, 164,  69, 205,   2, 238,  44,
+    115, 226,  37, 189, 114,  52, 186, 222,  38, 158,  27,  90, 172,   3, 202, 146,
+     25, 164,  41,  83,   2, 247,  74,  20,  49, 233, 147,  13, 237, 136,  18, 158,
+    203, 141, 191,  23, 125,  60, 229, 106,  79, 174, 113,  64,  10, 177,  33, 127,
+    104, 220, 193, 119, 168,  72,  19, 182,  88, 220,  47, 185, 107, 150, 126, 181,
+     16, 199, 143,  79, 253, 134,  15,  93, 113, 212, 136, 241,  70, 110,  50, 122,
+     92, 226, 182, 139, 200,  38, 185, 131, 207, 170, 119,  73, 177, 214, 115,  75,
+    227,   7,  96,  70, 223,  32, 178,  10, 160, 208,  47, 235, 149,  77, 202, 163,
+    232,  45, 142,  12, 218, 110,  46, 156, 205,  11, 134, 227,  31,  56, 212,  75,
+    245,  98,  59, 211,  27, 163, 236,  62, 178,  11,  57, 185,  36, 159, 244, 185,
+    212,  17,  71, 236, 103, 158,  90, 242,   7,  84, 197,  35, 102,  59, 168,  40,
+    127, 174, 249, 156, 201,  86, 135, 237,  66, 129,  23, 192, 123, 246,  55,   3,
+    181,  78, 253,  62,  91, 198, 230, 121,  61, 242, 100,  79, 168, 250,  93,  23,
+    160, 133,  10, 175, 103,  48, 199, 120, 229, 152, 105, 204, 127, 220,  12,  74,
+     43, 151, 119,  52,  13, 210,  59, 150, 108,  54, 227, 152, 247,   3, 198, 234,
+     89,  61,  35, 119,  12, 111, 215,  37,  98, 247, 156,  90,  37, 107, 213, 137,
+     29, 117, 155, 187,  35, 147,   6,  82, 168,  26, 151, 201,   9, 120, 144, 201,
+     50, 189, 235, 122, 220,  87, 144,  25,  77,  43, 252,  82,  24,  94, 140, 171,
+     99, 250, 198, 168, 223, 121,  27, 175, 214, 138,  16, 182, 126,  82, 139,  24,
+    187, 210, 145, 229, 184,  56, 168, 146, 200,   0,  59, 226, 175,  19, 158,  92,
+    236, 209,  18, 101, 237, 128, 180, 249, 105, 192,  40, 230,  61, 183,  40, 231,
+    109,  83,  31,  67, 158,   2, 248, 193, 169, 218,   6, 145, 176, 234,  58, 209,
+    130,   5,  83,  32,  68, 146, 238,  79,  39, 255,  93,  65, 217,  42, 241, 111,
+    155,   5,  99,  42,  80, 251,  18,  74, 118, 180, 209, 139,  73, 243, 197,  66,
+     42, 134, 176,  56, 203,  73,  23,  49, 214, 127,  77, 139, 103, 219,  80,   4,
+    170, 216, 145, 242, 186,  39, 114,  61,  99, 129, 189,  67, 108,  38, 193,  21,
+    229, 162, 112, 239, 184,  92, 201,   0, 189, 118, 168,  30, 106, 191, 165,  51,
+     75, 244, 126, 215, 158, 105, 191, 233,  45,  87,  27, 105,  48, 124,   6, 111,
+    165,  81, 248,   7, 162, 117, 226, 159,  68,   1, 177, 247,  17, 162, 130, 254,
+     53, 120,  14,  99,  54, 210, 140, 232,  15, 161,  48, 206, 241, 154, 120,  89,
+     69,  38, 191, 133,  13,  47, 136, 106, 157,  52, 202, 232, 150,   8,  91, 224,
+    179,  32, 195,  62,  10, 140,  34, 128, 216, 154, 253, 166, 224, 190, 153, 228,
+    207,  28, 125,  94, 217,  36,  87, 140, 200, 235, 114,  53, 207,  37,  98, 194,
+    151,  75, 200, 171, 130,  81, 178,  32,  88, 244, 115,  28,  83,   1, 179, 253,
+    144, 218,  55,  96, 160, 250, 211,  66, 226,  86,  13, 126,  74, 209, 136,  19,
+    113, 147,  87, 169, 238, 205,  91, 173,   6,  62, 132,  14,  80,  36,  95,  60,
+    142, 194, 226,  64, 148, 189, 255,  13, 100,  35, 168,  87, 143, 186,  67,  20,
+    214,  41, 232,  29, 245,   9, 223, 158, 196,  69, 220, 167, 133, 226,  48, 104,
+    169,   8, 200, 227,  76, 118,  18, 166,  29, 142, 245, 178,  47, 240,  64, 196,
+    249,  54, 220,  26, 118,  48,  70, 245, 113, 199,  97, 208, 175, 137, 249,  16,
+     78,  45, 108, 174,  22,  51, 115, 177,  60, 131, 216,  22, 228, 119, 243, 166,
+    108, 135,  90, 158, 116,  70, 102,  45, 121, 147,  19,  97, 187,  65, 207,  27,
+     75, 121, 140,  28, 177,  42, 190, 234, 104, 206,  39,  92, 114, 158,  34,  98,
+    167,   1, 137,  95, 187, 152, 218,  25, 163,  46, 239,  30,  67, 215, 120, 182,
+    231, 156,   2, 245, 133, 203,  78, 153, 240, 188,  76, 157,  61,   8,  90,  49,
+    224,   1, 183,  59, 217, 198, 136, 255,   3, 211,  56, 248,  35, 145, 118, 243,
+    181, 233,  61, 106, 245, 146,  95,  54, 131,  70, 150, 195,   4, 229, 182, 129,
+     71, 234, 201,  65, 255,   7, 108, 195, 131,  78, 181, 115, 156,   4,  51, 100,
+     30, 123, 190,  72, 100, 235,  16, 219,  44,   6, 106, 251, 182, 133, 204, 148,
+    188,  82, 250, 147,  40,  22, 170,  64, 188,  89, 172, 112, 203,  83,  14, 151,
+     94,  40, 161, 214,  17,  67, 205,   6, 185, 253,  19, 220, 124,  82,  24, 212,
+     44, 155, 115,  37, 176, 143,  85,  41, 231,   9, 142, 223,  89, 241, 165, 198,
+    252,  85, 215,  54, 166,  38, 142,  90, 121, 212, 145,  26,  96,  43, 239,  29,
+     63, 126,  19, 109, 187, 240,  94, 152,  34, 219, 137,  10, 161, 228, 189,  58,
+    209,   9, 193,  82, 127, 167, 238, 120, 157,  45, 107, 167,  62, 147, 251, 105,
+    188,  83,  16, 226, 125,  54, 242, 161, 103, 208,  60,  39, 192,  23, 138,  63,
+      9, 175, 136,  18, 226, 109, 175, 194,  66, 169,  51, 196, 222, 171,  79, 113,
+    230, 170, 205,  48,  80, 127,  13, 227, 110,  73, 242,  49,  70, 103,  30, 129,
+    236, 108, 143,  48, 225, 104,  33,  87, 213,  74, 232,  26, 203,  42, 171,   8,
+    132, 242, 163,  99, 210,  20, 186,  69,  27, 173, 253, 107, 130,  79, 211, 109,
+    225,  47,  97, 153, 201,  77,  10, 230,  29, 246, 130,  73, 111,  15, 158, 197,
+      8,  94, 139, 234, 157, 213,  56, 185, 132,  17, 166, 206, 124, 249, 172,  79,
+    159,  24, 255, 182,   1, 198,  59, 176,  11, 144, 183,  86, 135, 225,  93,  66,
+    217,  35,  60, 185,  76, 151, 112, 204, 135,  88, 151,  13, 221, 180,  34, 155,
+     68, 189, 242,  32, 124, 253,  48, 116, 154,  95,   0, 234, 146,  59, 254, 131,
+     53, 214,  34,  70,   7, 106, 172,  38, 237, 195,  87,  36, 145,   4, 215,  42,
+    195,  62,  92, 133,  74, 152, 248, 134, 223, 114,  53, 248, 117,  14, 196, 153,
+    116, 201, 139,   6, 250,  44, 224,   3, 237,  47, 199,  71, 159,  55, 244, 126,
+    102,  13, 169,  88,  59, 183, 137, 216,  74, 208, 173,  37, 204, 184,  25,  89,
+    152, 241, 117, 168, 201, 251,  76, 147,  99,  61, 118, 218, 181,  63,  96, 140,
+    118, 222, 173,  33, 233, 113,  26,  97,  42, 193,  19, 157,  71, 176,  51, 245,
+     19,  84, 235, 109, 169,  92, 128,  62, 177, 109,  31, 240, 119,   0,  86, 201,
+    149, 214, 133, 231,   3, 158,  97,  16, 189,  55, 115, 135,  78, 102, 226,  41,
+    180,  73, 191,  24,  93, 137,  27, 212,   0, 160, 253,  24, 107, 238, 199,  22,
+    246,  11, 110, 213,  52, 184, 206,  78, 164, 234, 102, 215,  37, 228, 142, 101,
+    181,  41, 159,  58, 212,  25, 190, 149,  84, 219, 129, 184,  96, 224, 166,  25,
+     61,  38,  76, 109, 190, 222,  41, 245, 146,  28, 241, 217,  10, 169, 126, 206,
+    108,   2, 144,  60, 219,  45, 110, 191, 230,  49, 138,  81, 167,  47, 153,  76,
+    169,  58, 145,  84, 160,  15, 141, 241,   3,  68, 132, 187,  88, 122,   1,  75,
+    218, 123, 197,  13, 138, 230,  40, 241,  12, 157,  21,  60, 209,  36, 130, 255,
+    175, 236, 198,  23, 140,  63,  84, 123, 177,  98,  70, 156,  46, 248,  66,  20,
+    161, 250, 199, 125, 235, 173, 154,  65, 122, 175, 207,  12, 226, 121,  32, 233,
+     98, 209, 186,  27, 252,  94,  58, 119, 199, 149,  49,  17, 166, 252, 196, 156,
+     28, 233,  65, 105, 180,  72, 119,  98, 207,  76, 245, 172, 142,  77, 194, 107,
+     85, 119, 160,  51, 250, 170, 208,  31, 235,   4, 199, 109, 191,  88, 147, 229,
+     52,  85,  32, 100,  10,  79, 246,  16,  90,  35, 106,  62, 195,  85, 184, 137,
+      2, 122,  43, 218, 115, 179, 223,  34, 173,  84, 243, 212,  65,  32, 107,  56,
+    174,  91, 147, 254,  29, 203, 164,  54, 179, 136,  41,  93,  10, 233,  52,  19,
+    145,   5, 216,  95, 124,   9, 106, 155,  55, 131, 220,  32, 136,  13, 211, 103,
+    183, 136, 215, 156, 187,  39, 139, 216, 182, 235, 159, 247, 145,  22, 219,  64,
+    197, 239,  80, 138,  67,  10, 154, 104, 210,  12, 111, 153,  94, 139, 205, 238,
+    131,   6, 209,  48,  83, 127,   1, 249,  25, 116, 221, 197, 110, 155, 181, 220,
+    247,  62, 185,  36, 231, 198,  72, 225, 184,  80, 166,  62, 236, 163,  42, 124,
+     23,  71, 233,  56, 119, 209, 100,  53, 130,  72,   5, 125,  46,  99, 163, 113,
+     50, 152,  21, 172, 244, 197,  51, 235,  70, 136, 193,  39, 231, 182,  20,  84,
+     42, 191, 114, 169, 227, 154, 217, 106, 189,  67, 163,  30, 250,  64, 123,  37,
+    166, 108, 134,  81, 157,  24, 141,  41,  99,  15, 245, 121,  96, 187,  78, 246,
+    195, 162,   6,  91, 253,  14, 164, 193,  22, 223,  92, 204, 183, 231,  13, 249,
+    177,  92, 207, 102,  33, 125,  89, 146,  23, 255,  57, 170,   4,  71, 122, 216,
+    153, 243,  71,  16,  97,  36,  61, 143,  86, 236,  50, 139,  87,   2, 208,  92,
+    194,  26, 240, 204,  57, 180, 119, 252, 196, 144, 206,  22,  52, 223,   1, 150,
+     49, 115, 204, 143, 176,  46,  82, 243, 149, 113, 171,  30,  65, 134,  81,  39,
+    129,   6, 232,  55, 164, 227,   0, 189, 167,  96, 127, 218, 109, 245, 162,  57,
+    102,  28, 179, 143, 246, 195, 174,  21, 209,  11, 121, 185, 225, 169, 141,  53,
+    218,  75, 148,   7, 106, 235,  85,  11,  65, 113,  39, 156, 178, 135, 110, 210,
+     89, 239,  38,  73, 123, 229, 107,  33,  66, 207,  51, 255, 105, 215, 154, 194,
+    224,  72, 184, 116, 141,  74, 212, 114,  41, 205,  29,  79, 148,  44, 190,   9,
+    229, 128, 214,  49, 117,  78, 125, 240,  98, 149, 203,  72,  25, 114, 243,  15,
+    160, 118,  50, 224, 164,  32, 212, 151, 175, 233,  87, 218,  70, 254,  33,  65,
+    171,  17, 183, 222,  21, 200, 157, 132, 234,  17, 124, 150,   3, 179,  24,  59,
+    100, 145,  30, 253,  16, 177,  59, 246,  84, 138, 228, 180,  16, 212,  93, 139,
+    170,  65,  90, 199,   5, 225,  33,  58, 169,  44, 254, 107,  41, 198,  67,  99,
+     38, 252, 179,  90, 132,  69, 187, 124,  50,  19, 190, 125,   9,  97, 196, 146,
+    225, 130, 103, 149,  63,  92,   0, 185,  79, 161, 196,  74, 223,  89, 120, 247,
+    164, 200,  50,  84, 204, 100,  28, 148, 173,   8,  65, 102, 250, 121,  73, 202,
+     39, 253,  20, 160, 102, 150, 187, 133, 221,  81,   4, 176, 153, 236, 134, 185,
+     86, 138,  15, 196,  42, 241,   0,  81, 246, 102, 141,  58, 237, 172, 122,  14,
+     55,  79, 251,  44, 210, 169, 246,  53, 220,  99,  37, 240,  54, 141, 206,  43,
+     13, 117, 221, 133, 156, 236, 121, 214,  53, 235, 195, 159,  47, 172,  25, 231,
+    101, 122, 184, 219,  61, 249,  75,  15, 104, 192, 138, 215,  90,  55,   8, 228,
+     29, 207,  70, 104, 219, 146, 112, 206, 154, 221,  33, 161, 207,  46,  82, 244,
+    208, 164,   8, 189, 129, 111,  35, 145, 121,   9, 176, 117, 167,  31, 184,  77,
+    237,  94, 177,   3,  67,  43, 184,  17, 105, 129,  86,  21, 138, 223,  60, 155,
+      0, 146,  80,  41, 134,  22, 200, 165, 241,  34,  64, 117,  23, 194, 124, 167,
+    111, 149, 236, 163,  26,  63, 173,  45,  17,  71, 193,  88, 114,  24, 155, 184,
+     32, 119,  91, 231,  26,  80, 214,  68, 194, 251,  85, 216,  13, 101, 228, 126,
+    154,  62,  36, 244, 197,  91, 228,  75, 164, 207,  41, 239, 108, 200,  89, 188,
+    244,  55, 203, 237, 174, 117,  90,  52, 123, 155, 225, 170, 246,  78, 221,  64,
+    248,  55,   5, 121, 187,  97, 255, 131, 183, 111, 243,   8, 216, 132, 230, 101,
+     69, 143, 180,  58, 151, 240, 177,  19, 157,  45, 140,  63, 198, 151,  57,   5,
+    214, 192, 123, 148, 108, 167,  28, 145, 250,   2, 179, 152,  74,  13, 129,  36,
+    113, 164,  14, 106,  30, 212, 234,   7, 204,  79,  15,  49, 107, 151,  37, 189,
+     21, 175,  84, 229,  40, 213,  22,  82, 228,  50, 138, 174,  64, 188,  51,   4,
+    239, 201,  38, 221, 104,   6, 133,  96, 232, 112,  29, 237, 122,  81, 253, 171,
+    105,  21, 229,  77,  14, 205, 127,  46,  98,  63, 115, 219,  53, 252, 170, 215,
+     67, 228, 138,  83, 159,  68, 146, 184, 101, 251, 141, 210, 179,   1, 128,  91,
+    215, 132, 201, 153,  72, 140, 165, 202,  12, 159,  79,  36, 224,  92, 149, 116,
+    167,  17, 131,  77, 162, 198,  53, 206,  76, 183, 209, 159,  18, 186,  34, 137,
+     52,  89, 178,  44, 251,  60, 222, 173, 193, 231, 136,  25, 184, 103, 143,   6,
+     95, 181,  49, 195, 255,  42, 126,  25,  57, 164,  31,  94,  60, 200, 232, 159,
+     70,  34, 105,  18, 243, 114,  52,  95, 122, 194, 248, 109, 162,  20, 253, 206,
+     85, 218, 101, 251,  28, 121, 244,  35, 147,   3,  67, 100,  49, 222, 114, 201,
+    239, 151, 210, 131, 160,  90, 115,   9,  80,  35, 166,  87, 203,  38,  78, 207,
+    241,  22, 129, 218,   3, 177,  92, 221, 193, 113, 224, 132, 244,  81,  45, 114,
+    253, 181, 222,  62, 191,   3, 210, 238,  31,  63, 147,   2, 201, 130,  66,  43,
+     26, 148,  51, 190,  68, 175,  86, 111, 170, 220, 135, 241, 171, 143,  86,   8,
+     74,  30, 110,   3, 188,  34, 240, 155, 212, 110, 248,  10, 123, 236, 163, 119,
+     45, 155,  99,  72, 117, 152, 238,  75, 138,   5,  71, 186,  17, 148, 173,  11,
+    140,  51, 162,  91, 133, 168,  75, 142, 181, 213,  96,  48, 237,  83, 173, 193,
+    120, 234, 169,   1, 135, 213,  16, 229,  60,  30,  89, 196,  14,  62, 249, 165,
+    190, 220,  58, 237,  72, 202, 133,  24,  65, 140,  48, 216, 149,  57,  24, 196,
+     69, 174, 247,  35, 191,  56,  18, 205,  44, 246, 169,  39, 121, 216,  95, 197,
+};
+
+// Each pattern row is stored once, repeated out to period + kDitherChunkPixels
+// entries, so a chunk starting at any x reads its thresholds contiguously.
+struct DitherRows {
+    uint8_t bayer4[4][4 + kDitherChunkPixels];
+    uint8_t bayer8[8][8 + kDitherChunkPixels];
+    uint8_t blue_noise[kBlueNoiseSize][kBlueNoiseSize + kDitherChunkPixels];
+
+    DitherRows() {
+        for (uint32_t y = 0; y < 4; ++y) {
+            for (uint32_t x = 0; x < 4 + kDitherChunkPixels; ++x) {
+                bayer4[y][x] = static_cast<uint8_t>((kBayer4[y][x & 3] * 2 + 1) * 8);
+            }
+        }
+        for (uint32_t y = 0; y < 8; ++y) {
+            for (uint32_t x = 0; x < 8 + kDitherChunkPixels; ++x) {
+                bayer8[y][x] = static_cast<uint8_t>((kBayer8[y][x & 7] * 2 + 1) * 2);
+            }
+        }
+        for (uint32_t y = 0; y < kBlueNoiseSize; ++y) {
+            for (uint32_t x = 0; x < kBlueNoiseSize + kDitherChunkPixels; ++x) {
+                blue_noise[y][x] = kBlueNoise[y * kBlueNoiseSize + (x & (kBlueNoiseSize - 1))];
+            }
+        }
+    }
+};
+
+const DitherRows& Rows() {
+    static const DitherRows rows;
+    return rows;
+}
+
+}
+
+const uint8_t* DitherThresholds(DitherMode mode, uint32_t x, uint32_t y) {
+    const DitherRows& rows = Rows();
+    switch (mode) {
+        case DitherMode::Bayer4:
+            return rows.bayer4[y & 3] + (x & 3);
+        case DitherMode::Bayer8:
+            return rows.bayer8[y & 7] + (x & 7);
+        case DitherMode::BlueNoise:
+            return rows.blue_noise[y & (kBlueNoiseSize - 1)] + (x & (kBlueNoiseSize - 1));
+        case DitherMode::None:
+            break;
+    }
+    return nullptr;
+}
+
+void ScalarRgb888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                const uint8_t* thresholds) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        const unsigned bias = thresholds[i] >> 6;
+        for (size_t c = 0; c < 3; ++c) {
+            const unsigned v = src[i * 3 + c] + bias;
+            dst[i * 3 + c] = static_cast<uint8_t>((v > 0xFF ? 0xFF : v) & 0xFC);
+        }
+    }
+}
+
+void ScalarRgba8888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                  const uint8_t* thresholds) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        const unsigned bias = thresholds[i] >> 6;
+        for (size_t c = 0; c < 3; ++c) {
+            const unsigned v = src[i * 4 + c] + bias;
+            dst[i * 3 + c] = static_cast<uint8_t>((v > 0xFF ? 0xFF : v) & 0xFC);
+        }
+    }
+}
+
+namespace {
+inline void StoreDitheredRgb565(const uint8_t* rgb, uint8_t threshold, uint8_t* dst) {
+    const unsigned bias5 = threshold >> 5;
+    const unsigned bias6 = threshold >> 6;
+    const unsigned r = rgb[0] + bias5;
+    const unsigned g = rgb[1] + bias6;
+    const unsigned b = rgb[2] + bias5;
+    const uint16_t value = static_cast<uint16_t>(((r > 0xFF ? 0xFF : r) & 0xF8) << 8 |
+                                                 ((g > 0xFF ? 0xFF : g) & 0xFC) << 3 |
+                                                 (b > 0xFF ? 0xFF : b) >> 3);
+    dst[0] = static_cast<uint8_t>(value >> 8);
+    dst[1] = static_cast<uint8_t>(value & 0xFF);
+}
+}
+
+void ScalarRgb888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                const uint8_t* thresholds) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        StoreDitheredRgb565(src + i * 3, thresholds[i], dst + i * 2);
+    }
+}
+
+void ScalarRgba8888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                  const uint8_t* thresholds) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        StoreDitheredRgb565(src + i * 4, thresholds[i], dst + i * 2);
+    }
+}
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+
+#include "pixel_utils.h"
+
+namespace ili9488::pixel::simd {
+
+using ConvertFn = void (*)(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+// thresholds holds one 0-255 dither threshold per pixel.
+using DitherConvertFn = void (*)(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                 const uint8_t* thresholds);
+
+// Transposes an 8x8 block of pixels: dst row i is src column i. Strides are
+// in bytes and may be negative, which flips the block vertically.
+using TransposeFn = void (*)(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride);
+// dst[i] = src[pixel_count - 1 - i].
+using ReverseFn = void (*)(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+
+constexpr uint32_t kTransposeBlock = 8;
+
+// Rotates source rows [y0, y0 + rows) of a frame whose size is fixed at
+// compile time. src points at row y0 with packed rows, dst at the rotated
+// frame; rows is a multiple of kTransposeBlock.
+using FixedRotateFn = void (*)(const uint8_t* src, uint8_t* dst, uint32_t y0, uint32_t rows);
+
+// 90 and 270 degree kernels for one source frame size; index 0 is 90.
+struct FixedRotateKernels {
+    uint32_t width;
+    uint32_t height;
+    FixedRotateFn rgb24[2];
+    FixedRotateFn rgb16[2];
+};
+
+// The panel in both orientations.
+constexpr size_t kFixedGeometryCount = 2;
+
+struct KernelTable {
+    ConvertFn rgb888_to_rgb666;
+    ConvertFn rgba8888_to_rgb666;
+    ConvertFn rgb888_to_rgb565;
+    ConvertFn rgba8888_to_rgb565;
+    DitherConvertFn rgb888_to_rgb666_dither;
+    DitherConvertFn rgba8888_to_rgb666_dither;
+    DitherConvertFn rgb888_to_rgb565_dither;
+    DitherConvertFn rgba8888_to_rgb565_dither;
+    TransposeFn transpose_rgb24;
+    TransposeFn transpose_rgb16;
+    ReverseFn reverse_rgb24;
+    ReverseFn reverse_rgb16;
+    FixedRotateKernels fixed_rotate[kFixedGeometryCount];
+};
+
+// With W, H and the transpose known, the strides are constants and the block
+// loop has no edges. Rows are walked in strips, one column of blocks at a
+// time, so each strip writes every destination row as one run of whole cache
+// lines: 32 rows of 2-byte pixels or 64 rows of 3-byte pixels.
+template <size_t Bpp, uint32_t W, uint32_t H, int Rotation, TransposeFn Transpose>
+inline void RotateFixedRows(const uint8_t* src, uint8_t* dst, uint32_t y0, uint32_t rows) {
+    static_assert(W % kTransposeBlock == 0 && H % kTransposeBlock == 0, "geometry must be whole blocks");
+    constexpr uint32_t kBlock = kTransposeBlock;
+    constexpr uint32_t kStrip = 64 / std::gcd<uint32_t>(64, Bpp);
+    constexpr ptrdiff_t kSrcStride = static_cast<ptrdiff_t>(W * Bpp);
+    constexpr ptrdiff_t kDstStride = static_cast<ptrdiff_t>(H * Bpp);
+    for (uint32_t strip_y = 0; strip_y < rows; strip_y += kStrip) {
+        const uint32_t strip_end = strip_y + kStrip < rows ? strip_y + kStrip : rows;
+        for (uint32_t tile_x = 0; tile_x < W; tile_x += kBlock) {
+            for (uint32_t tile_y = strip_y; tile_y < strip_end; tile_y += kBlock) {
+                const uint32_t frame_y = y0 + tile_y;
+                if constexpr (Rotation == 90) {
+                    Transpose(src + (tile_y + kBlock - 1) * kSrcStride + tile_x * Bpp, -kSrcStride,
+                              dst + tile_x * kDstStride + (H - frame_y - kBlock) * Bpp, kDstStride);
+                } else {
+                    Transpose(src + tile_y * kSrcStride + tile_x * Bpp, kSrcStride,
+                              dst + (W - tile_x - 1) * kDstStride + frame_y * Bpp, -kDstStride);
+                }
+            }
+        }
+    }
+}
+
+template <uint32_t W, uint32_t H, TransposeFn Transpose24, TransposeFn Transpose16>
+constexpr FixedRotateKernels MakeFixedRotateKernels() {
+    return {W, H,
+            {RotateFixedRows<3, W, H, 90, Transpose24>, RotateFixedRows<3, W, H, 270, Transpose24>},
+            {RotateFixedRows<2, W, H, 90, Transpose16>, RotateFixedRows<2, W, H, 270, Transpose16>}};
+}
+
+template <TransposeFn Transpose24, TransposeFn Transpose16>
+void FillFixedRotateKernels(KernelTable& table) {
+    table.fixed_rotate[0] = MakeFixedRotateKernels<320, 480, Transpose24, Transpose16>();
+    table.fixed_rotate[1] = MakeFixedRotateKernels<480, 320, Transpose24, Transpose16>();
+}
+
+// Dithered conversions are issued in chunks of at most this many pixels.
+constexpr uint32_t kDitherChunkPixels = 256;
+
+// Thresholds for kDitherChunkPixels pixels starting at (x, y), or nullptr for
+// DitherMode::None.
+const uint8_t* DitherThresholds(DitherMode mode, uint32_t x, uint32_t y);
+
+void ScalarRgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+void ScalarRgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+void ScalarRgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+void ScalarRgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+void ScalarRgb888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                const uint8_t* thresholds);
+void ScalarRgba8888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                  const uint8_t* thresholds);
+void ScalarRgb888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                const uint8_t* thresholds);
+void ScalarRgba8888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                  const uint8_t* thresholds);
+void ScalarTransposeRgb24(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride);
+void ScalarTransposeRgb16(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride);
+void ScalarReverseRgb24(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+void ScalarReverseRgb16(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+
+bool CpuSupportsNeon();
+bool CpuSupportsSsse3();
+bool CpuSupportsAvx2();
+
+void FillNeonKernels(KernelTable& table);
+void FillSsse3Kernels(KernelTable& table);
+void FillAvx2Kernels(KernelTable& table);
+
+}
@@ -0,0 +1,255 @@
+#include "pixel_simd.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON_OPTIMIZATION 1
+#else
+#define USE_NEON_OPTIMIZATION 0
+#endif
+
+namespace ili9488::pixel::simd {
+
+#if USE_NEON_OPTIMIZATION
+
+namespace {
+
+inline uint8x16x2_t PackRgb565(uint8x16_t r, uint8x16_t g, uint8x16_t b) {
+    uint8x16x2_t out;
+    out.val[0] = vorrq_u8(vandq_u8(r, vdupq_n_u8(0xF8)), vshrq_n_u8(g, 5));
+    out.val[1] = vorrq_u8(vandq_u8(vshlq_n_u8(g, 3), vdupq_n_u8(0xE0)), vshrq_n_u8(b, 3));
+    return out;
+}
+
+void NeonRgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const uint8x16_t mask = vdupq_n_u8(0xFC);
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8_t* s = src + i * 3;
+        uint8_t* d = dst + i * 3;
+        vst1q_u8(d, vandq_u8(vld1q_u8(s), mask));
+        vst1q_u8(d + 16, vandq_u8(vld1q_u8(s + 16), mask));
+        vst1q_u8(d + 32, vandq_u8(vld1q_u8(s + 32), mask));
+    }
+    ScalarRgb888ToRgb666(src + i * 3, dst + i * 3, pixel_count - i);
+}
+
+void NeonRgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const uint8x16_t mask = vdupq_n_u8(0xFC);
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8x16x4_t rgba = vld4q_u8(src + i * 4);
+        uint8x16x3_t rgb;
+        rgb.val[0] = vandq_u8(rgba.val[0], mask);
+        rgb.val[1] = vandq_u8(rgba.val[1], mask);
+        rgb.val[2] = vandq_u8(rgba.val[2], mask);
+        vst3q_u8(dst + i * 3, rgb);
+    }
+    ScalarRgba8888ToRgb666(src + i * 4, dst + i * 3, pixel_count - i);
+}
+
+void NeonRgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        vst2q_u8(dst + i * 2, PackRgb565(rgb.val[0], rgb.val[1], rgb.val[2]));
+    }
+    ScalarRgb888ToRgb565(src + i * 3, dst + i * 2, pixel_count - i);
+}
+
+void NeonRgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8x16x4_t rgba = vld4q_u8(src + i * 4);
+        vst2q_u8(dst + i * 2, PackRgb565(rgba.val[0], rgba.val[1], rgba.val[2]));
+    }
+    ScalarRgba8888ToRgb565(src + i * 4, dst + i * 2, pixel_count - i);
+}
+
+
+void NeonRgb888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                              const uint8_t* thresholds) {
+    const uint8x16_t mask = vdupq_n_u8(0xFC);
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8x16_t bias = vshrq_n_u8(vld1q_u8(thresholds + i), 6);
+        uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        rgb.val[0] = vandq_u8(vqaddq_u8(rgb.val[0], bias), mask);
+        rgb.val[1] = vandq_u8(vqaddq_u8(rgb.val[1], bias), mask);
+        rgb.val[2] = vandq_u8(vqaddq_u8(rgb.val[2], bias), mask);
+        vst3q_u8(dst + i * 3, rgb);
+    }
+    ScalarRgb888ToRgb666Dither(src + i * 3, dst + i * 3, pixel_count - i, thresholds + i);
+}
+
+void NeonRgba8888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                const uint8_t* thresholds) {
+    const uint8x16_t mask = vdupq_n_u8(0xFC);
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8x16_t bias = vshrq_n_u8(vld1q_u8(thresholds + i), 6);
+        const uint8x16x4_t rgba = vld4q_u8(src + i * 4);
+        uint8x16x3_t rgb;
+        rgb.val[0] = vandq_u8(vqaddq_u8(rgba.val[0], bias), mask);
+        rgb.val[1] = vandq_u8(vqaddq_u8(rgba.val[1], bias), mask);
+        rgb.val[2] = vandq_u8(vqaddq_u8(rgba.val[2], bias), mask);
+        vst3q_u8(dst + i * 3, rgb);
+    }
+    ScalarRgba8888ToRgb666Dither(src + i * 4, dst + i * 3, pixel_count - i, thresholds + i);
+}
+
+inline uint8x16x2_t PackDitheredRgb565(uint8x16_t r, uint8x16_t g, uint8x16_t b, const uint8_t* thresholds) {
+    const uint8x16_t t = vld1q_u8(thresholds);
+    const uint8x16_t bias5 = vshrq_n_u8(t, 5);
+    const uint8x16_t bias6 = vshrq_n_u8(t, 6);
+    return PackRgb565(vqaddq_u8(r, bias5), vqaddq_u8(g, bias6), vqaddq_u8(b, bias5));
+}
+
+void NeonRgb888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                              const uint8_t* thresholds) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        vst2q_u8(dst + i * 2, PackDitheredRgb565(rgb.val[0], rgb.val[1], rgb.val[2], thresholds + i));
+    }
+    ScalarRgb888ToRgb565Dither(src + i * 3, dst + i * 2, pixel_count - i, thresholds + i);
+}
+
+void NeonRgba8888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                const uint8_t* thresholds) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8x16x4_t rgba = vld4q_u8(src + i * 4);
+        vst2q_u8(dst + i * 2, PackDitheredRgb565(rgba.val[0], rgba.val[1], rgba.val[2], thresholds + i));
+    }
+    ScalarRgba8888ToRgb565Dither(src + i * 4, dst + i * 2, pixel_count - i, thresholds + i);
+}
+
+inline void Transpose8x8(uint8x8_t r[8]) {
+    const uint8x8x2_t b0 = vtrn_u8(r[0], r[1]);
+    const uint8x8x2_t b1 = vtrn_u8(r[2], r[3]);
+    const uint8x8x2_t b2 = vtrn_u8(r[4], r[5]);
+    const uint8x8x2_t b3 = vtrn_u8(r[6], r[7]);
+    const uint16x4x2_t c0 = vtrn_u16(vreinterpret_u16_u8(b0.val[0]), vreinterpret_u16_u8(b1.val[0]));
+    const uint16x4x2_t c1 = vtrn_u16(vreinterpret_u16_u8(b0.val[1]), vreinterpret_u16_u8(b1.val[1]));
+    const uint16x4x2_t c2 = vtrn_u16(vreinterpret_u16_u8(b2.val[0]), vreinterpret_u16_u8(b3.val[0]));
+    const uint16x4x2_t c3 = vtrn_u16(vreinterpret_u16_u8(b2.val[1]), vreinterpret_u16_u8(b3.val[1]));
+    const uint32x2x2_t d0 = vtrn_u32(vreinterpret_u32_u16(c0.val[0]), vreinterpret_u32_u16(c2.val[0]));
+    const uint32x2x2_t d1 = vtrn_u32(vreinterpret_u32_u16(c1.val[0]), vreinterpret_u32_u16(c3.val[0]));
+    const uint32x2x2_t d2 = vtrn_u32(vreinterpret_u32_u16(c0.val[1]), vreinterpret_u32_u16(c2.val[1]));
+    const uint32x2x2_t d3 = vtrn_u32(vreinterpret_u32_u16(c1.val[1]), vreinterpret_u32_u16(c3.val[1]));
+    r[0] = vreinterpret_u8_u32(d0.val[0]);
+    r[1] = vreinterpret_u8_u32(d1.val[0]);
+    r[2] = vreinterpret_u8_u32(d2.val[0]);
+    r[3] = vreinterpret_u8_u32(d3.val[0]);
+    r[4] = vreinterpret_u8_u32(d0.val[1]);
+    r[5] = vreinterpret_u8_u32(d1.val[1]);
+    r[6] = vreinterpret_u8_u32(d2.val[1]);
+    r[7] = vreinterpret_u8_u32(d3.val[1]);
+}
+
+// vld3 splits the block into R, G and B planes, each plane is transposed as
+// 8x8 bytes and vst3 interleaves the rows again.
+void NeonTransposeRgb24(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride) {
+    uint8x8_t planes[3][8];
+    for (int row = 0; row < 8; ++row) {
+        const uint8x8x3_t rgb = vld3_u8(src + row * src_stride);
+        planes[0][row] = rgb.val[0];
+        planes[1][row] = rgb.val[1];
+        planes[2][row] = rgb.val[2];
+    }
+    Transpose8x8(planes[0]);
+    Transpose8x8(planes[1]);
+    Transpose8x8(planes[2]);
+    for (int row = 0; row < 8; ++row) {
+        uint8x8x3_t rgb;
+        rgb.val[0] = planes[0][row];
+        rgb.val[1] = planes[1][row];
+        rgb.val[2] = planes[2][row];
+        vst3_u8(dst + row * dst_stride, rgb);
+    }
+}
+
+void NeonTransposeRgb16(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride) {
+    uint16x8_t r[8];
+    for (int row = 0; row < 8; ++row) {
+        r[row] = vreinterpretq_u16_u8(vld1q_u8(src + row * src_stride));
+    }
+    const uint16x8x2_t t0 = vtrnq_u16(r[0], r[1]);
+    const uint16x8x2_t t1 = vtrnq_u16(r[2], r[3]);
+    const uint16x8x2_t t2 = vtrnq_u16(r[4], r[5]);
+    const uint16x8x2_t t3 = vtrnq_u16(r[6], r[7]);
+    const uint32x4x2_t u0 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[0]), vreinterpretq_u32_u16(t1.val[0]));
+    const uint32x4x2_t u1 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[1]), vreinterpretq_u32_u16(t1.val[1]));
+    const uint32x4x2_t u2 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[0]), vreinterpretq_u32_u16(t3.val[0]));
+    const uint32x4x2_t u3 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[1]), vreinterpretq_u32_u16(t3.val[1]));
+    const uint32x4_t top[4] = {u0.val[0], u1.val[0], u0.val[1], u1.val[1]};
+    const uint32x4_t bottom[4] = {u2.val[0], u3.val[0], u2.val[1], u3.val[1]};
+    for (int row = 0; row < 4; ++row) {
+        const uint32x4_t low = vcombine_u32(vget_low_u32(top[row]), vget_low_u32(bottom[row]));
+        const uint32x4_t high = vcombine_u32(vget_high_u32(top[row]), vget_high_u32(bottom[row]));
+        vst1q_u8(dst + row * dst_stride, vreinterpretq_u8_u32(low));
+        vst1q_u8(dst + (row + 4) * dst_stride, vreinterpretq_u8_u32(high));
+    }
+}
+
+inline uint8x16_t ReverseBytes(uint8x16_t v) {
+    v = vrev64q_u8(v);
+    return vextq_u8(v, v, 8);
+}
+
+void NeonReverseRgb24(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        uint8x16x3_t rgb = vld3q_u8(src + (pixel_count - i - 16) * 3);
+        rgb.val[0] = ReverseBytes(rgb.val[0]);
+        rgb.val[1] = ReverseBytes(rgb.val[1]);
+        rgb.val[2] = ReverseBytes(rgb.val[2]);
+        vst3q_u8(dst + i * 3, rgb);
+    }
+    ScalarReverseRgb24(src, dst + i * 3, pixel_count - i);
+}
+
+void NeonReverseRgb16(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    for (; i + 8 <= pixel_count; i += 8) {
+        uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(src + (pixel_count - i - 8) * 2));
+        v = vrev64q_u16(v);
+        v = vextq_u16(v, v, 4);
+        vst1q_u8(dst + i * 2, vreinterpretq_u8_u16(v));
+    }
+    ScalarReverseRgb16(src, dst + i * 2, pixel_count - i);
+}
+
+}
+
+bool CpuSupportsNeon() {
+    return true;
+}
+
+void FillNeonKernels(KernelTable& table) {
+    table.rgb888_to_rgb666 = NeonRgb888ToRgb666;
+    table.rgba8888_to_rgb666 = NeonRgba8888ToRgb666;
+    table.rgb888_to_rgb565 = NeonRgb888ToRgb565;
+    table.rgba8888_to_rgb565 = NeonRgba8888ToRgb565;
+    table.rgb888_to_rgb666_dither = NeonRgb888ToRgb666Dither;
+    table.rgba8888_to_rgb666_dither = NeonRgba8888ToRgb666Dither;
+    table.rgb888_to_rgb565_dither = NeonRgb888ToRgb565Dither;
+    table.rgba8888_to_rgb565_dither = NeonRgba8888ToRgb565Dither;
+    table.transpose_rgb24 = NeonTransposeRgb24;
+    table.transpose_rgb16 = NeonTransposeRgb16;
+    table.reverse_rgb24 = NeonReverseRgb24;
+    table.reverse_rgb16 = NeonReverseRgb16;
+    FillFixedRotateKernels<NeonTransposeRgb24, NeonTransposeRgb16>(table);
+}
+
+#else
+
+bool CpuSupportsNeon() {
+    return false;
+}
+
+void FillNeonKernels(KernelTable&) {}
+
+#endif
+
+}
@@ -0,0 +1,493 @@
+#include "pixel_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define USE_X86_OPTIMIZATION 1
+#else
+#define USE_X86_OPTIMIZATION 0
+#endif
+
+namespace ili9488::pixel::simd {
+
+#if USE_X86_OPTIMIZATION
+
+namespace {
+
+#define ILI9488_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define ILI9488_TARGET_AVX2 __attribute__((target("avx2")))
+
+ILI9488_TARGET_SSSE3
+inline void DeinterleaveRgb888(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b) {
+    const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+    const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+
+    const __m128i r0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i r1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+    const __m128i r2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+    const __m128i g0 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i g1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i g2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+    const __m128i b0 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i b1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i b2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+    r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, r0), _mm_shuffle_epi8(v1, r1)),
+                     _mm_shuffle_epi8(v2, r2));
+    g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, g0), _mm_shuffle_epi8(v1, g1)),
+                     _mm_shuffle_epi8(v2, g2));
+    b = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, b0), _mm_shuffle_epi8(v1, b1)),
+                     _mm_shuffle_epi8(v2, b2));
+}
+
+ILI9488_TARGET_SSSE3
+inline void DeinterleaveRgba8888(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b) {
+    const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    const __m128i t0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), gather);
+    const __m128i t1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), gather);
+    const __m128i t2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32)), gather);
+    const __m128i t3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48)), gather);
+
+    const __m128i rg01 = _mm_unpacklo_epi32(t0, t1);
+    const __m128i ba01 = _mm_unpackhi_epi32(t0, t1);
+    const __m128i rg23 = _mm_unpacklo_epi32(t2, t3);
+    const __m128i ba23 = _mm_unpackhi_epi32(t2, t3);
+
+    r = _mm_unpacklo_epi64(rg01, rg23);
+    g = _mm_unpackhi_epi64(rg01, rg23);
+    b = _mm_unpacklo_epi64(ba01, ba23);
+}
+
+ILI9488_TARGET_SSSE3
+inline void StoreRgb565(uint8_t* dst, __m128i r, __m128i g, __m128i b) {
+    const __m128i hi = _mm_or_si128(
+        _mm_and_si128(r, _mm_set1_epi8(static_cast<char>(0xF8))),
+        _mm_and_si128(_mm_srli_epi16(g, 5), _mm_set1_epi8(0x07)));
+    const __m128i lo = _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi16(g, 3), _mm_set1_epi8(static_cast<char>(0xE0))),
+        _mm_and_si128(_mm_srli_epi16(b, 3), _mm_set1_epi8(0x1F)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(hi, lo));
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(0xFC));
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8_t* s = src + i * 3;
+        uint8_t* d = dst + i * 3;
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+        const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_and_si128(v0, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16), _mm_and_si128(v1, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 32), _mm_and_si128(v2, mask));
+    }
+    ScalarRgb888ToRgb666(src + i * 3, dst + i * 3, pixel_count - i);
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(0xFC));
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8_t* s = src + i * 4;
+        uint8_t* d = dst + i * 3;
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), pack);
+        const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16)), pack);
+        const __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32)), pack);
+        const __m128i e = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48)), pack);
+        const __m128i out0 = _mm_or_si128(a, _mm_slli_si128(b, 12));
+        const __m128i out1 = _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8));
+        const __m128i out2 = _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(e, 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_and_si128(out0, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16), _mm_and_si128(out1, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 32), _mm_and_si128(out2, mask));
+    }
+    ScalarRgba8888ToRgb666(src + i * 4, dst + i * 3, pixel_count - i);
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m128i r;
+        __m128i g;
+        __m128i b;
+        DeinterleaveRgb888(src + i * 3, r, g, b);
+        StoreRgb565(dst + i * 2, r, g, b);
+    }
+    ScalarRgb888ToRgb565(src + i * 3, dst + i * 2, pixel_count - i);
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m128i r;
+        __m128i g;
+        __m128i b;
+        DeinterleaveRgba8888(src + i * 4, r, g, b);
+        StoreRgb565(dst + i * 2, r, g, b);
+    }
+    ScalarRgba8888ToRgb565(src + i * 4, dst + i * 2, pixel_count - i);
+}
+
+// Spreads 16 per-pixel biases over the 48 bytes of 16 packed RGB pixels.
+ILI9488_TARGET_SSSE3
+inline void ExpandBiasRgb(__m128i bias, __m128i& e0, __m128i& e1, __m128i& e2) {
+    e0 = _mm_shuffle_epi8(bias, _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5));
+    e1 = _mm_shuffle_epi8(bias, _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10));
+    e2 = _mm_shuffle_epi8(bias, _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15));
+}
+
+ILI9488_TARGET_SSSE3
+inline __m128i ThresholdBits(const uint8_t* thresholds, int shift, uint8_t mask) {
+    const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(thresholds));
+    return _mm_and_si128(_mm_srl_epi16(t, _mm_cvtsi32_si128(shift)), _mm_set1_epi8(static_cast<char>(mask)));
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgb888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                               const uint8_t* thresholds) {
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(0xFC));
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8_t* s = src + i * 3;
+        uint8_t* d = dst + i * 3;
+        __m128i e0;
+        __m128i e1;
+        __m128i e2;
+        ExpandBiasRgb(ThresholdBits(thresholds + i, 6, 0x03), e0, e1, e2);
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+        const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_and_si128(_mm_adds_epu8(v0, e0), mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16), _mm_and_si128(_mm_adds_epu8(v1, e1), mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 32), _mm_and_si128(_mm_adds_epu8(v2, e2), mask));
+    }
+    ScalarRgb888ToRgb666Dither(src + i * 3, dst + i * 3, pixel_count - i, thresholds + i);
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgba8888ToRgb666Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                 const uint8_t* thresholds) {
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(0xFC));
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8_t* s = src + i * 4;
+        uint8_t* d = dst + i * 3;
+        __m128i e0;
+        __m128i e1;
+        __m128i e2;
+        ExpandBiasRgb(ThresholdBits(thresholds + i, 6, 0x03), e0, e1, e2);
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), pack);
+        const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16)), pack);
+        const __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32)), pack);
+        const __m128i e = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48)), pack);
+        const __m128i out0 = _mm_or_si128(a, _mm_slli_si128(b, 12));
+        const __m128i out1 = _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8));
+        const __m128i out2 = _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(e, 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_and_si128(_mm_adds_epu8(out0, e0), mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16), _mm_and_si128(_mm_adds_epu8(out1, e1), mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 32), _mm_and_si128(_mm_adds_epu8(out2, e2), mask));
+    }
+    ScalarRgba8888ToRgb666Dither(src + i * 4, dst + i * 3, pixel_count - i, thresholds + i);
+}
+
+ILI9488_TARGET_SSSE3
+inline void StoreDitheredRgb565(uint8_t* dst, __m128i r, __m128i g, __m128i b, const uint8_t* thresholds) {
+    const __m128i bias5 = ThresholdBits(thresholds, 5, 0x07);
+    const __m128i bias6 = ThresholdBits(thresholds, 6, 0x03);
+    StoreRgb565(dst, _mm_adds_epu8(r, bias5), _mm_adds_epu8(g, bias6), _mm_adds_epu8(b, bias5));
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgb888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                               const uint8_t* thresholds) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m128i r;
+        __m128i g;
+        __m128i b;
+        DeinterleaveRgb888(src + i * 3, r, g, b);
+        StoreDitheredRgb565(dst + i * 2, r, g, b, thresholds + i);
+    }
+    ScalarRgb888ToRgb565Dither(src + i * 3, dst + i * 2, pixel_count - i, thresholds + i);
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3Rgba8888ToRgb565Dither(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                 const uint8_t* thresholds) {
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m128i r;
+        __m128i g;
+        __m128i b;
+        DeinterleaveRgba8888(src + i * 4, r, g, b);
+        StoreDitheredRgb565(dst + i * 2, r, g, b, thresholds + i);
+    }
+    ScalarRgba8888ToRgb565Dither(src + i * 4, dst + i * 2, pixel_count - i, thresholds + i);
+}
+
+ILI9488_TARGET_SSSE3
+inline void Transpose4x32(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3) {
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+    r0 = _mm_unpacklo_epi64(t0, t1);
+    r1 = _mm_unpackhi_epi64(t0, t1);
+    r2 = _mm_unpacklo_epi64(t2, t3);
+    r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Each 24-bit pixel is widened to a 32-bit lane, the 8x8 block is transposed
+// as four 4x4 blocks and the rows are packed back to 24 bytes.
+ILI9488_TARGET_SSSE3
+void Ssse3TransposeRgb24(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride) {
+    const __m128i widen_lo = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i widen_hi = _mm_setr_epi8(4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+    const __m128i narrow = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i lo[8];
+    __m128i hi[8];
+    for (int row = 0; row < 8; ++row) {
+        const uint8_t* s = src + row * src_stride;
+        lo[row] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), widen_lo);
+        hi[row] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 8)), widen_hi);
+    }
+    Transpose4x32(lo[0], lo[1], lo[2], lo[3]);
+    Transpose4x32(lo[4], lo[5], lo[6], lo[7]);
+    Transpose4x32(hi[0], hi[1], hi[2], hi[3]);
+    Transpose4x32(hi[4], hi[5], hi[6], hi[7]);
+    for (int row = 0; row < 8; ++row) {
+        // Output row i is column i: rows 0-3 of the source come from the
+        // first four registers, rows 4-7 from the second four.
+        const __m128i first = _mm_shuffle_epi8(row < 4 ? lo[row] : hi[row - 4], narrow);
+        const __m128i second = _mm_shuffle_epi8(row < 4 ? lo[row + 4] : hi[row], narrow);
+        uint8_t* d = dst + row * dst_stride;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_or_si128(first, _mm_slli_si128(second, 12)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(d + 16), _mm_srli_si128(second, 4));
+    }
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3TransposeRgb16(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride) {
+    __m128i r[8];
+    for (int row = 0; row < 8; ++row) {
+        r[row] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + row * src_stride));
+    }
+    const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    const __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    const __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    const __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    const __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+    const __m128i out[8] = {
+        _mm_unpacklo_epi64(b0, b4), _mm_unpackhi_epi64(b0, b4),
+        _mm_unpacklo_epi64(b1, b5), _mm_unpackhi_epi64(b1, b5),
+        _mm_unpacklo_epi64(b2, b6), _mm_unpackhi_epi64(b2, b6),
+        _mm_unpacklo_epi64(b3, b7), _mm_unpackhi_epi64(b3, b7),
+    };
+    for (int row = 0; row < 8; ++row) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + row * dst_stride), out[row]);
+    }
+}
+
+// 16 pixels per step: each output register gathers its bytes from up to
+// three source registers.
+ILI9488_TARGET_SSSE3
+void Ssse3ReverseRgb24(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const __m128i m0_1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 14);
+    const __m128i m0_2 = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -1);
+    const __m128i m1_0 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1);
+    const __m128i m1_1 = _mm_setr_epi8(15, -1, 11, 12, 13, 8, 9, 10, 5, 6, 7, 2, 3, 4, -1, 0);
+    const __m128i m1_2 = _mm_setr_epi8(-1, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m2_0 = _mm_setr_epi8(-1, 12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2);
+    const __m128i m2_1 = _mm_setr_epi8(1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        const uint8_t* s = src + (pixel_count - i - 16) * 3;
+        uint8_t* d = dst + i * 3;
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+        const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+        const __m128i out0 = _mm_or_si128(_mm_shuffle_epi8(v1, m0_1), _mm_shuffle_epi8(v2, m0_2));
+        const __m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, m1_0), _mm_shuffle_epi8(v1, m1_1)),
+                                          _mm_shuffle_epi8(v2, m1_2));
+        const __m128i out2 = _mm_or_si128(_mm_shuffle_epi8(v0, m2_0), _mm_shuffle_epi8(v1, m2_1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), out0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16), out1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 32), out2);
+    }
+    ScalarReverseRgb24(src, dst + i * 3, pixel_count - i);
+}
+
+ILI9488_TARGET_SSSE3
+void Ssse3ReverseRgb16(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const __m128i reverse = _mm_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+    size_t i = 0;
+    for (; i + 8 <= pixel_count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (pixel_count - i - 8) * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_shuffle_epi8(v, reverse));
+    }
+    ScalarReverseRgb16(src, dst + i * 2, pixel_count - i);
+}
+
+// The generic RotateFixedRows has no target attribute, so it is wrapped to
+// let the SSSE3 transpose inline into it.
+template <size_t Bpp, uint32_t W, uint32_t H, int Rotation, TransposeFn Transpose>
+ILI9488_TARGET_SSSE3 void Ssse3RotateFixedRows(const uint8_t* src, uint8_t* dst, uint32_t y0, uint32_t rows) {
+    RotateFixedRows<Bpp, W, H, Rotation, Transpose>(src, dst, y0, rows);
+}
+
+template <uint32_t W, uint32_t H>
+FixedRotateKernels Ssse3FixedRotateKernels() {
+    return {W, H,
+            {Ssse3RotateFixedRows<3, W, H, 90, Ssse3TransposeRgb24>,
+             Ssse3RotateFixedRows<3, W, H, 270, Ssse3TransposeRgb24>},
+            {Ssse3RotateFixedRows<2, W, H, 90, Ssse3TransposeRgb16>,
+             Ssse3RotateFixedRows<2, W, H, 270, Ssse3TransposeRgb16>}};
+}
+
+ILI9488_TARGET_AVX2
+void Avx2Rgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(0xFC));
+    size_t i = 0;
+    for (; i + 32 <= pixel_count; i += 32) {
+        const uint8_t* s = src + i * 3;
+        uint8_t* d = dst + i * 3;
+        const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 32));
+        const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 64));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), _mm256_and_si256(v0, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + 32), _mm256_and_si256(v1, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + 64), _mm256_and_si256(v2, mask));
+    }
+    ScalarRgb888ToRgb666(src + i * 3, dst + i * 3, pixel_count - i);
+}
+
+ILI9488_TARGET_AVX2
+void Avx2Rgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(0xFC));
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 8 <= pixel_count; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        const __m256i packed = _mm256_and_si256(
+            _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pack), compact), mask);
+        uint8_t* d = dst + i * 3;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm256_castsi256_si128(packed));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(d + 16), _mm256_extracti128_si256(packed, 1));
+    }
+    ScalarRgba8888ToRgb666(src + i * 4, dst + i * 3, pixel_count - i);
+}
+
+ILI9488_TARGET_AVX2
+void Avx2Rgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const __m256i gather = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                            0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    const __m256i group = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256i high_mask = _mm256_set1_epi8(static_cast<char>(0xF8));
+    const __m256i g_high_mask = _mm256_set1_epi8(0x07);
+    const __m256i g_low_mask = _mm256_set1_epi8(static_cast<char>(0xE0));
+    const __m256i b_mask = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= pixel_count; i += 32) {
+        const uint8_t* s = src + i * 4;
+        __m256i t[4];
+        for (int k = 0; k < 4; ++k) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + k * 32));
+            t[k] = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, gather), group);
+        }
+        const __m256i rb01 = _mm256_unpacklo_epi64(t[0], t[1]);
+        const __m256i ga01 = _mm256_unpackhi_epi64(t[0], t[1]);
+        const __m256i rb23 = _mm256_unpacklo_epi64(t[2], t[3]);
+        const __m256i ga23 = _mm256_unpackhi_epi64(t[2], t[3]);
+        const __m256i r = _mm256_permute2x128_si256(rb01, rb23, 0x20);
+        const __m256i b = _mm256_permute2x128_si256(rb01, rb23, 0x31);
+        const __m256i g = _mm256_permute2x128_si256(ga01, ga23, 0x20);
+
+        const __m256i hi = _mm256_or_si256(_mm256_and_si256(r, high_mask),
+                                           _mm256_and_si256(_mm256_srli_epi16(g, 5), g_high_mask));
+        const __m256i lo = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi16(g, 3), g_low_mask),
+                                           _mm256_and_si256(_mm256_srli_epi16(b, 3), b_mask));
+        const __m256i lo_half = _mm256_unpacklo_epi8(hi, lo);
+        const __m256i hi_half = _mm256_unpackhi_epi8(hi, lo);
+        uint8_t* d = dst + i * 2;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d),
+                            _mm256_permute2x128_si256(lo_half, hi_half, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + 32),
+                            _mm256_permute2x128_si256(lo_half, hi_half, 0x31));
+    }
+    Ssse3Rgba8888ToRgb565(src + i * 4, dst + i * 2, pixel_count - i);
+}
+
+}
+
+bool CpuSupportsSsse3() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+bool CpuSupportsAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+void FillSsse3Kernels(KernelTable& table) {
+    table.rgb888_to_rgb666 = Ssse3Rgb888ToRgb666;
+    table.rgba8888_to_rgb666 = Ssse3Rgba8888ToRgb666;
+    table.rgb888_to_rgb565 = Ssse3Rgb888ToRgb565;
+    table.rgba8888_to_rgb565 = Ssse3Rgba8888ToRgb565;
+    table.rgb888_to_rgb666_dither = Ssse3Rgb888ToRgb666Dither;
+    table.rgba8888_to_rgb666_dither = Ssse3Rgba8888ToRgb666Dither;
+    table.rgb888_to_rgb565_dither = Ssse3Rgb888ToRgb565Dither;
+    table.rgba8888_to_rgb565_dither = Ssse3Rgba8888ToRgb565Dither;
+    table.transpose_rgb24 = Ssse3TransposeRgb24;
+    table.transpose_rgb16 = Ssse3TransposeRgb16;
+    table.reverse_rgb24 = Ssse3ReverseRgb24;
+    table.reverse_rgb16 = Ssse3ReverseRgb16;
+    table.fixed_rotate[0] = Ssse3FixedRotateKernels<320, 480>();
+    table.fixed_rotate[1] = Ssse3FixedRotateKernels<480, 320>();
+}
+
+void FillAvx2Kernels(KernelTable& table) {
+    FillSsse3Kernels(table);
+    table.rgb888_to_rgb666 = Avx2Rgb888ToRgb666;
+    table.rgba8888_to_rgb666 = Avx2Rgba8888ToRgb666;
+    table.rgba8888_to_rgb565 = Avx2Rgba8888ToRgb565;
+}
+
+#else
+
+bool CpuSupportsSsse3() {
+    return false;
+}
+
+bool CpuSupportsAvx2() {
+    return false;
+}
+
+void FillSsse3Kernels(KernelTable&) {}
+
+void FillAvx2Kernels(KernelTable&) {}
+
+#endif
+
+}
@@ -1,17 +1,18 @@
 #include "pixel_utils.h"
+#include "pixel_simd.h"
+#include "worker_pool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
-
-#if defined(__ARM_NEON) || defined(__ARM_NEON__)
-#include <arm_neon.h>
-#define USE_NEON_OPTIMIZATION 1
-#else
-#define USE_NEON_OPTIMIZATION 0
-#endif
+#include <numeric>
+#include <vector>
 
 namespace ili9488::pixel {
 
-void ConvertRgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+namespace simd {
+
+void ScalarRgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
     for (size_t i = 0; i < pixel_count; ++i) {
         const uint8_t r = src[i * 3 + 0] & 0xFC;
         const uint8_t g = src[i * 3 + 1] & 0xFC;
@@ -22,7 +23,7 @@ void ConvertRgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count)
     }
 }
 
-void ConvertRgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+void ScalarRgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
     for (size_t i = 0; i < pixel_count; ++i) {
         const uint8_t r = src[i * 4 + 0] & 0xFC;
         const uint8_t g = src[i * 4 + 1] & 0xFC;
@@ -33,7 +34,7 @@ void ConvertRgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_coun
     }
 }
 
-void ConvertRgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+void ScalarRgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
     for (size_t i = 0; i < pixel_count; ++i) {
         const uint8_t r = src[i * 3 + 0];
         const uint8_t g = src[i * 3 + 1];
@@ -44,7 +45,7 @@ void ConvertRgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count)
     }
 }
 
-void ConvertRgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+void ScalarRgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
     for (size_t i = 0; i < pixel_count; ++i) {
         const uint8_t r = src[i * 4 + 0];
         const uint8_t g = src[i * 4 + 1];
@@ -56,119 +57,802 @@ void ConvertRgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_coun
 }
 
 namespace {
+template <size_t Bpp>
+void ScalarTranspose(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride) {
+    for (uint32_t row = 0; row < kTransposeBlock; ++row) {
+        uint8_t* d = dst + row * dst_stride;
+        for (uint32_t col = 0; col < kTransposeBlock; ++col) {
+            std::memcpy(d + col * Bpp, src + col * src_stride + row * Bpp, Bpp);
+        }
+    }
+}
+
+template <size_t Bpp>
+void ScalarReverse(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    const uint8_t* s = src + pixel_count * Bpp;
+    for (size_t i = 0; i < pixel_count; ++i) {
+        s -= Bpp;
+        std::memcpy(dst + i * Bpp, s, Bpp);
+    }
+}
+}
+
+void ScalarTransposeRgb24(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride) {
+    ScalarTranspose<3>(src, src_stride, dst, dst_stride);
+}
+
+void ScalarTransposeRgb16(const uint8_t* src, ptrdiff_t src_stride, uint8_t* dst, ptrdiff_t dst_stride) {
+    ScalarTranspose<2>(src, src_stride, dst, dst_stride);
+}
+
+void ScalarReverseRgb24(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ScalarReverse<3>(src, dst, pixel_count);
+}
+
+void ScalarReverseRgb16(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ScalarReverse<2>(src, dst, pixel_count);
+}
+
+}
+
+namespace {
+
+constexpr simd::KernelTable kScalarKernels = {
+    simd::ScalarRgb888ToRgb666,
+    simd::ScalarRgba8888ToRgb666,
+    simd::ScalarRgb888ToRgb565,
+    simd::ScalarRgba8888ToRgb565,
+    simd::ScalarRgb888ToRgb666Dither,
+    simd::ScalarRgba8888ToRgb666Dither,
+    simd::ScalarRgb888ToRgb565Dither,
+    simd::ScalarRgba8888ToRgb565Dither,
+    simd::ScalarTransposeRgb24,
+    simd::ScalarTransposeRgb16,
+    simd::ScalarReverseRgb24,
+    simd::ScalarReverseRgb16,
+    {},
+};
+
+bool LevelSupported(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return true;
+        case SimdLevel::Neon:
+            return simd::CpuSupportsNeon();
+        case SimdLevel::Ssse3:
+            return simd::CpuSupportsSsse3();
+        case SimdLevel::Avx2:
+            return simd::CpuSupportsAvx2();
+    }
+    return false;
+}
 
-void Rotate180Optimized(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height) {
-    const size_t row_bytes = static_cast<size_t>(width) * 3;
-    const size_t total_pixels = static_cast<size_t>(width) * height;
+simd::KernelTable BuildKernelTable(SimdLevel level) {
+    simd::KernelTable table = kScalarKernels;
+    switch (level) {
+        case SimdLevel::Scalar:
+            break;
+        case SimdLevel::Neon:
+            simd::FillNeonKernels(table);
+            break;
+        case SimdLevel::Ssse3:
+            simd::FillSsse3Kernels(table);
+            break;
+        case SimdLevel::Avx2:
+            simd::FillAvx2Kernels(table);
+            break;
+    }
+    return table;
+}
 
-    const uint8_t* src_end = src + total_pixels * 3;
-    uint8_t* dst_ptr = dst;
+struct Dispatch {
+    simd::KernelTable tables[4];
+    std::atomic<int> active;
 
-    const size_t pixels_4 = total_pixels & ~3UL;
-    for (size_t i = 0; i < pixels_4; i += 4) {
-        const uint8_t* s = src_end - (i + 4) * 3;
-        dst_ptr[0]  = s[9];  dst_ptr[1]  = s[10]; dst_ptr[2]  = s[11];
-        dst_ptr[3]  = s[6];  dst_ptr[4]  = s[7];  dst_ptr[5]  = s[8];
-        dst_ptr[6]  = s[3];  dst_ptr[7]  = s[4];  dst_ptr[8]  = s[5];
-        dst_ptr[9]  = s[0];  dst_ptr[10] = s[1];  dst_ptr[11] = s[2];
-        dst_ptr += 12;
+    Dispatch() : active(static_cast<int>(DetectSimdLevel())) {
+        for (int i = 0; i < 4; ++i) {
+            tables[i] = BuildKernelTable(static_cast<SimdLevel>(i));
+        }
     }
+};
 
-    for (size_t i = pixels_4; i < total_pixels; ++i) {
-        const uint8_t* s = src_end - (i + 1) * 3;
-        dst_ptr[0] = s[0];
-        dst_ptr[1] = s[1];
-        dst_ptr[2] = s[2];
-        dst_ptr += 3;
+Dispatch& GetDispatch() {
+    static Dispatch dispatch;
+    return dispatch;
+}
+
+const simd::KernelTable& Kernels() {
+    Dispatch& dispatch = GetDispatch();
+    return dispatch.tables[dispatch.active.load(std::memory_order_relaxed)];
+}
+
+std::atomic<WorkerPool*> g_worker_pool{nullptr};
+
+// 64 pixels is a whole number of cache lines at 2, 3 and 4 bytes per pixel,
+// so bands of a packed buffer never share a line.
+constexpr size_t kBandAlignPixels = 64;
+
+template <typename Fn>
+void ForEachBand(size_t count, size_t align, size_t pixels, const Fn& fn) {
+    WorkerPool* pool = g_worker_pool.load(std::memory_order_acquire);
+    if (pool == nullptr || pool->size() < 2 || pixels < kParallelMinPixels) {
+        fn(0, count);
+        return;
     }
+    pool->parallelFor(count, align, fn);
+}
+
+template <size_t SrcBpp, size_t DstBpp>
+void ConvertBands(simd::ConvertFn kernel, const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ForEachBand(pixel_count, kBandAlignPixels, pixel_count, [&](size_t begin, size_t end) {
+        kernel(src + begin * SrcBpp, dst + begin * DstBpp, end - begin);
+    });
 }
 
-void Rotate90Tiled(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height) {
-    const uint32_t dst_width = height;
-    const uint32_t dst_height = width;
-    constexpr uint32_t kTileSize = 8;
+}
 
-    for (uint32_t tile_y = 0; tile_y < height; tile_y += kTileSize) {
-        for (uint32_t tile_x = 0; tile_x < width; tile_x += kTileSize) {
-            const uint32_t tile_h = (tile_y + kTileSize <= height) ? kTileSize : (height - tile_y);
-            const uint32_t tile_w = (tile_x + kTileSize <= width) ? kTileSize : (width - tile_x);
+SimdLevel DetectSimdLevel() {
+    if (LevelSupported(SimdLevel::Neon)) {
+        return SimdLevel::Neon;
+    }
+    if (LevelSupported(SimdLevel::Avx2)) {
+        return SimdLevel::Avx2;
+    }
+    if (LevelSupported(SimdLevel::Ssse3)) {
+        return SimdLevel::Ssse3;
+    }
+    return SimdLevel::Scalar;
+}
 
-            for (uint32_t y = 0; y < tile_h; ++y) {
-                const uint32_t src_y = tile_y + y;
-                for (uint32_t x = 0; x < tile_w; ++x) {
-                    const uint32_t src_x = tile_x + x;
-                    const uint32_t dst_x = dst_width - 1 - src_y;
-                    const uint32_t dst_y = src_x;
+SimdLevel ActiveSimdLevel() {
+    return static_cast<SimdLevel>(GetDispatch().active.load(std::memory_order_relaxed));
+}
 
-                    const size_t src_idx = (static_cast<size_t>(src_y) * width + src_x) * 3;
-                    const size_t dst_idx = (static_cast<size_t>(dst_y) * dst_width + dst_x) * 3;
+bool SelectSimdLevel(SimdLevel level) {
+    if (!LevelSupported(level)) {
+        return false;
+    }
+    GetDispatch().active.store(static_cast<int>(level), std::memory_order_relaxed);
+    return true;
+}
 
-                    dst[dst_idx + 0] = src[src_idx + 0];
-                    dst[dst_idx + 1] = src[src_idx + 1];
-                    dst[dst_idx + 2] = src[src_idx + 2];
-                }
-            }
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+        case SimdLevel::Neon:
+            return "neon";
+        case SimdLevel::Ssse3:
+            return "ssse3";
+        case SimdLevel::Avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+const char* DitherModeName(DitherMode mode) {
+    switch (mode) {
+        case DitherMode::None:
+            return "none";
+        case DitherMode::Bayer4:
+            return "bayer4";
+        case DitherMode::Bayer8:
+            return "bayer8";
+        case DitherMode::BlueNoise:
+            return "bluenoise";
+    }
+    return "unknown";
+}
+
+bool ParseDitherMode(const char* name, DitherMode* mode) {
+    for (DitherMode candidate : {DitherMode::None, DitherMode::Bayer4, DitherMode::Bayer8, DitherMode::BlueNoise}) {
+        if (std::strcmp(name, DitherModeName(candidate)) == 0) {
+            *mode = candidate;
+            return true;
         }
     }
+    return false;
 }
 
-void Rotate270Tiled(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height) {
-    const uint32_t dst_width = height;
-    const uint32_t dst_height = width;
-    constexpr uint32_t kTileSize = 8;
+void SetWorkerPool(WorkerPool* pool) {
+    g_worker_pool.store(pool, std::memory_order_release);
+}
 
-    for (uint32_t tile_y = 0; tile_y < height; tile_y += kTileSize) {
-        for (uint32_t tile_x = 0; tile_x < width; tile_x += kTileSize) {
-            const uint32_t tile_h = (tile_y + kTileSize <= height) ? kTileSize : (height - tile_y);
-            const uint32_t tile_w = (tile_x + kTileSize <= width) ? kTileSize : (width - tile_x);
+void ConvertRgb888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ConvertBands<3, 3>(Kernels().rgb888_to_rgb666, src, dst, pixel_count);
+}
 
-            for (uint32_t y = 0; y < tile_h; ++y) {
-                const uint32_t src_y = tile_y + y;
-                for (uint32_t x = 0; x < tile_w; ++x) {
-                    const uint32_t src_x = tile_x + x;
-                    const uint32_t dst_x = src_y;
-                    const uint32_t dst_y = dst_height - 1 - src_x;
+void ConvertRgba8888ToRgb666(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ConvertBands<4, 3>(Kernels().rgba8888_to_rgb666, src, dst, pixel_count);
+}
 
-                    const size_t src_idx = (static_cast<size_t>(src_y) * width + src_x) * 3;
-                    const size_t dst_idx = (static_cast<size_t>(dst_y) * dst_width + dst_x) * 3;
+void ConvertRgb888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ConvertBands<3, 2>(Kernels().rgb888_to_rgb565, src, dst, pixel_count);
+}
 
-                    dst[dst_idx + 0] = src[src_idx + 0];
-                    dst[dst_idx + 1] = src[src_idx + 1];
-                    dst[dst_idx + 2] = src[src_idx + 2];
-                }
+void ConvertRgba8888ToRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ConvertBands<4, 2>(Kernels().rgba8888_to_rgb565, src, dst, pixel_count);
+}
+
+namespace {
+template <size_t SrcBpp, size_t DstBpp>
+void ConvertDithered(simd::DitherConvertFn kernel, simd::ConvertFn plain,
+                     const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                     uint32_t x, uint32_t y, DitherMode mode) {
+    if (mode == DitherMode::None) {
+        ConvertBands<SrcBpp, DstBpp>(plain, src, dst, pixel_count);
+        return;
+    }
+    ForEachBand(pixel_count, simd::kDitherChunkPixels, pixel_count, [&](size_t begin, size_t end) {
+        size_t done = begin;
+        while (done < end) {
+            const size_t count = std::min<size_t>(end - done, simd::kDitherChunkPixels);
+            kernel(src + done * SrcBpp, dst + done * DstBpp, count,
+                   simd::DitherThresholds(mode, x + static_cast<uint32_t>(done), y));
+            done += count;
+        }
+    });
+}
+}
+
+void ConvertRgb888ToRgb666Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                   uint32_t x, uint32_t y, DitherMode mode) {
+    const simd::KernelTable& kernels = Kernels();
+    ConvertDithered<3, 3>(kernels.rgb888_to_rgb666_dither, kernels.rgb888_to_rgb666,
+                          src, dst, pixel_count, x, y, mode);
+}
+
+void ConvertRgba8888ToRgb666Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                     uint32_t x, uint32_t y, DitherMode mode) {
+    const simd::KernelTable& kernels = Kernels();
+    ConvertDithered<4, 3>(kernels.rgba8888_to_rgb666_dither, kernels.rgba8888_to_rgb666,
+                          src, dst, pixel_count, x, y, mode);
+}
+
+void ConvertRgb888ToRgb565Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                   uint32_t x, uint32_t y, DitherMode mode) {
+    const simd::KernelTable& kernels = Kernels();
+    ConvertDithered<3, 2>(kernels.rgb888_to_rgb565_dither, kernels.rgb888_to_rgb565,
+                          src, dst, pixel_count, x, y, mode);
+}
+
+void ConvertRgba8888ToRgb565Dithered(const uint8_t* src, uint8_t* dst, size_t pixel_count,
+                                     uint32_t x, uint32_t y, DitherMode mode) {
+    const simd::KernelTable& kernels = Kernels();
+    ConvertDithered<4, 2>(kernels.rgba8888_to_rgb565_dither, kernels.rgba8888_to_rgb565,
+                          src, dst, pixel_count, x, y, mode);
+}
+
+namespace {
+
+template <size_t Bpp>
+inline void CopyPixel(uint8_t* dst, const uint8_t* src) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    if (Bpp == 3) {
+        dst[2] = src[2];
+    }
+}
+
+// Scalar rotation of the pixels with src_x in [x0, x1) and src_y in [y0, y1),
+// for the edges that do not fill a whole transpose block.
+template <size_t Bpp>
+void RotateRegion(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                  uint32_t width, uint32_t height, int rotation_degrees,
+                  uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1) {
+    for (uint32_t src_y = y0; src_y < y1; ++src_y) {
+        for (uint32_t src_x = x0; src_x < x1; ++src_x) {
+            const uint32_t dst_x = rotation_degrees == 90 ? height - 1 - src_y : src_y;
+            const uint32_t dst_y = rotation_degrees == 90 ? src_x : width - 1 - src_x;
+            CopyPixel<Bpp>(dst + dst_y * dst_stride + static_cast<size_t>(dst_x) * Bpp,
+                           src + src_y * src_stride + static_cast<size_t>(src_x) * Bpp);
+        }
+    }
+}
+
+// 90 and 270 are a transpose of each 8x8 block with one side flipped: for 90
+// the block's source rows are read bottom-up, for 270 its destination rows
+// are written bottom-up. Only source columns [x0, x1) are rotated; x0 is a
+// multiple of the block size.
+template <size_t Bpp>
+void RotateColumns(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                   uint32_t width, uint32_t height, int rotation_degrees, simd::TransposeFn transpose,
+                   uint32_t x0, uint32_t x1) {
+    constexpr uint32_t kBlock = simd::kTransposeBlock;
+    const ptrdiff_t src_step = static_cast<ptrdiff_t>(src_stride);
+    const ptrdiff_t dst_step = static_cast<ptrdiff_t>(dst_stride);
+    const uint32_t full_w = width - width % kBlock;
+    const uint32_t full_h = height - height % kBlock;
+    const uint32_t block_x1 = std::min(x1, full_w);
+    for (uint32_t tile_y = 0; tile_y < full_h; tile_y += kBlock) {
+        for (uint32_t tile_x = x0; tile_x < block_x1; tile_x += kBlock) {
+            if (rotation_degrees == 90) {
+                const uint8_t* s = src + (tile_y + kBlock - 1) * src_stride + static_cast<size_t>(tile_x) * Bpp;
+                uint8_t* d = dst + tile_x * dst_stride + static_cast<size_t>(height - tile_y - kBlock) * Bpp;
+                transpose(s, -src_step, d, dst_step);
+            } else {
+                const uint8_t* s = src + tile_y * src_stride + static_cast<size_t>(tile_x) * Bpp;
+                uint8_t* d = dst + (width - tile_x - 1) * dst_stride + static_cast<size_t>(tile_y) * Bpp;
+                transpose(s, src_step, d, -dst_step);
             }
         }
     }
+    if (block_x1 < x1) {
+        RotateRegion<Bpp>(src, src_stride, dst, dst_stride, width, height, rotation_degrees, block_x1, x1, 0, height);
+    }
+    if (x0 < block_x1) {
+        RotateRegion<Bpp>(src, src_stride, dst, dst_stride, width, height, rotation_degrees, x0, block_x1, full_h,
+                          height);
+    }
 }
 
+template <size_t Bpp>
+void RotateTransposed(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                      uint32_t width, uint32_t height, int rotation_degrees, simd::TransposeFn transpose) {
+    constexpr uint32_t kBlock = simd::kTransposeBlock;
+    const size_t columns = (width + kBlock - 1) / kBlock;
+
+    // Bands are runs of block columns, i.e. runs of whole destination rows.
+    ForEachBand(columns, 1, static_cast<size_t>(width) * height, [&](size_t begin, size_t end) {
+        RotateColumns<Bpp>(src, src_stride, dst, dst_stride, width, height, rotation_degrees, transpose,
+                           static_cast<uint32_t>(begin) * kBlock,
+                           std::min(static_cast<uint32_t>(end) * kBlock, width));
+    });
 }
 
-void RotateRgb666(const uint8_t* src,
-                  uint8_t* dst,
-                  uint32_t width,
-                  uint32_t height,
-                  int rotation_degrees) {
-    switch (rotation_degrees) {
-        case 0: {
-            const size_t bytes = static_cast<size_t>(width) * height * 3;
-            std::memcpy(dst, src, bytes);
-            return;
+// Kernels built for this exact frame size, or nullptr.
+simd::FixedRotateFn FindFixedRotate(const simd::KernelTable& kernels, uint32_t width, uint32_t height,
+                                    size_t bytes_per_pixel, int rotation_degrees) {
+    if (rotation_degrees != 90 && rotation_degrees != 270) {
+        return nullptr;
+    }
+    // The scalar table leaves these empty: inlining the per-pixel transpose
+    // spills registers and is slower than calling it.
+    for (const simd::FixedRotateKernels& fixed : kernels.fixed_rotate) {
+        if (fixed.width != 0 && fixed.width == width && fixed.height == height) {
+            const simd::FixedRotateFn* fns = bytes_per_pixel == 3 ? fixed.rgb24 : fixed.rgb16;
+            return fns[rotation_degrees == 90 ? 0 : 1];
         }
+    }
+    return nullptr;
+}
+
+template <size_t Bpp>
+void RotateFixed(simd::FixedRotateFn rotate, const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height) {
+    // Bands of 64 source rows are 64-pixel runs of every destination row.
+    // Those runs share a cache line with the neighbouring band whenever the
+    // destination stride is not a multiple of 64 bytes (1440 bytes is 32 mod
+    // 64), so threads contend for one line per row at each band edge.
+    ForEachBand(height, 64, static_cast<size_t>(width) * height, [&](size_t begin, size_t end) {
+        rotate(src + begin * width * Bpp, dst, static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin));
+    });
+}
+
+template <size_t Bpp>
+void ReverseBands(simd::ReverseFn reverse, const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    ForEachBand(pixel_count, kBandAlignPixels, pixel_count, [&](size_t begin, size_t end) {
+        reverse(src + (pixel_count - end) * Bpp, dst + begin * Bpp, end - begin);
+    });
+}
+
+template <size_t Bpp>
+void RotatePixels(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height, int rotation_degrees) {
+    switch (rotation_degrees) {
         case 90:
-            Rotate90Tiled(src, dst, width, height);
+        case 270:
+            if (const simd::FixedRotateFn fixed = FindFixedRotate(Kernels(), width, height, Bpp, rotation_degrees)) {
+                RotateFixed<Bpp>(fixed, src, dst, width, height);
+                return;
+            }
+            RotateTransposed<Bpp>(src, static_cast<size_t>(width) * Bpp, dst, static_cast<size_t>(height) * Bpp,
+                                  width, height, rotation_degrees,
+                                  Bpp == 3 ? Kernels().transpose_rgb24 : Kernels().transpose_rgb16);
             return;
         case 180:
-            Rotate180Optimized(src, dst, width, height);
-            return;
-        case 270:
-            Rotate270Tiled(src, dst, width, height);
+            ReverseBands<Bpp>(Bpp == 3 ? Kernels().reverse_rgb24 : Kernels().reverse_rgb16, src, dst,
+                              static_cast<size_t>(width) * height);
             return;
         default:
             break;
     }
 
-    const size_t bytes = static_cast<size_t>(width) * height * 3;
+    const size_t bytes = static_cast<size_t>(width) * height * Bpp;
     std::memcpy(dst, src, bytes);
 }
 
+
+template <size_t Bpp>
+void ConvertRow(SourceFormat format, const uint8_t* src, uint8_t* dst, uint32_t count) {
+    const simd::KernelTable& kernels = Kernels();
+    if (format == SourceFormat::Output) {
+        std::memcpy(dst, src, static_cast<size_t>(count) * Bpp);
+    } else if (format == SourceFormat::Rgba8888) {
+        (Bpp == 2 ? kernels.rgba8888_to_rgb565 : kernels.rgba8888_to_rgb666)(src, dst, count);
+    } else {
+        (Bpp == 2 ? kernels.rgb888_to_rgb565 : kernels.rgb888_to_rgb666)(src, dst, count);
+    }
+}
+
+template <size_t Bpp>
+void ComposePixels(const uint8_t* src, SourceFormat format, size_t src_stride, uint8_t* dst,
+                   uint32_t width, uint32_t height, int rotation_degrees, const Overlay* overlay,
+                   uint32_t band_rows, const BandHook& hook) {
+    const size_t src_bpp = format == SourceFormat::Output ? Bpp : (format == SourceFormat::Rgba8888 ? 4U : 3U);
+    if (src_stride == 0) {
+        src_stride = static_cast<size_t>(width) * src_bpp;
+    }
+    const size_t row_bytes = static_cast<size_t>(width) * Bpp;
+    const simd::KernelTable& kernels = Kernels();
+    const simd::TransposeFn transpose = Bpp == 3 ? kernels.transpose_rgb24 : kernels.transpose_rgb16;
+    const simd::ReverseFn reverse = Bpp == 3 ? kernels.reverse_rgb24 : kernels.reverse_rgb16;
+    const simd::FixedRotateFn fixed = FindFixedRotate(kernels, width, height, Bpp, rotation_degrees);
+
+    uint32_t ov_x0 = 0;
+    uint32_t ov_x1 = 0;
+    uint32_t ov_y0 = 0;
+    uint32_t ov_y1 = 0;
+    if (overlay != nullptr && overlay->pixels != nullptr && overlay->x < width && overlay->y < height) {
+        ov_x0 = overlay->x;
+        ov_y0 = overlay->y;
+        ov_x1 = std::min(width, overlay->x + overlay->width);
+        ov_y1 = std::min(height, overlay->y + overlay->height);
+    }
+
+    auto compose_band = [&](uint32_t y0, uint32_t y1) {
+        if (hook) {
+            hook(y0, y1);
+        }
+        const uint32_t rows = y1 - y0;
+        const bool staged = format != SourceFormat::Output || (ov_y0 < y1 && y0 < ov_y1);
+        const uint8_t* band = src + y0 * src_stride;
+        size_t band_stride = src_stride;
+        if (staged) {
+            // At 0 degrees the band is composed straight into place;
+            // otherwise into a per-thread band buffer that stays in cache.
+            thread_local std::vector<uint8_t> scratch;
+            uint8_t* out = dst + static_cast<size_t>(y0) * row_bytes;
+            if (rotation_degrees != 0) {
+                scratch.resize(static_cast<size_t>(rows) * row_bytes);
+                out = scratch.data();
+            }
+            for (uint32_t y = y0; y < y1; ++y) {
+                uint8_t* row = out + static_cast<size_t>(y - y0) * row_bytes;
+                ConvertRow<Bpp>(format, src + y * src_stride, row, width);
+                if (y >= ov_y0 && y < ov_y1) {
+                    std::memcpy(row + static_cast<size_t>(ov_x0) * Bpp,
+                                overlay->pixels + static_cast<size_t>(y - ov_y0) * overlay->width * Bpp,
+                                static_cast<size_t>(ov_x1 - ov_x0) * Bpp);
+                }
+            }
+            if (rotation_degrees == 0) {
+                return;
+            }
+            band = out;
+            band_stride = row_bytes;
+        }
+
+        if (fixed != nullptr && band_stride == row_bytes && rows % simd::kTransposeBlock == 0) {
+            fixed(band, dst, y0, rows);
+            return;
+        }
+        switch (rotation_degrees) {
+            case 90:
+                RotateColumns<Bpp>(band, band_stride, dst + static_cast<size_t>(height - y1) * Bpp,
+                                   static_cast<size_t>(height) * Bpp, width, rows, 90, transpose, 0, width);
+                break;
+            case 270:
+                RotateColumns<Bpp>(band, band_stride, dst + static_cast<size_t>(y0) * Bpp,
+                                   static_cast<size_t>(height) * Bpp, width, rows, 270, transpose, 0, width);
+                break;
+            case 180:
+                if (band_stride == row_bytes) {
+                    reverse(band, dst + static_cast<size_t>(height - y1) * row_bytes,
+                            static_cast<size_t>(rows) * width);
+                } else {
+                    for (uint32_t row = 0; row < rows; ++row) {
+                        reverse(band + row * band_stride,
+                                dst + static_cast<size_t>(height - 1 - y0 - row) * row_bytes, width);
+                    }
+                }
+                break;
+            default:
+                for (uint32_t row = 0; row < rows; ++row) {
+                    std::memcpy(dst + static_cast<size_t>(y0 + row) * row_bytes, band + row * band_stride,
+                                row_bytes);
+                }
+                break;
+        }
+    };
+
+    // Worker bands are a whole number of hook bands and of 64 rows, which
+    // keeps the rotated column strips 64 pixels wide. A strip is only whole
+    // cache lines when destination rows start on one, so with 1440-byte rows
+    // (32 mod 64) neighbouring threads share one line per row at band edges.
+    const size_t bands = (height + band_rows - 1) / band_rows;
+    const size_t align = 64 / std::gcd<size_t>(band_rows, 64);
+    ForEachBand(bands, align, static_cast<size_t>(width) * height, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            const uint32_t y0 = static_cast<uint32_t>(band) * band_rows;
+            compose_band(y0, std::min(height, y0 + band_rows));
+        }
+    });
+}
+
+}
+
+void RotateRgb666(const uint8_t* src,
+                  uint8_t* dst,
+                  uint32_t width,
+                  uint32_t height,
+                  int rotation_degrees) {
+    RotatePixels<3>(src, dst, width, height, rotation_degrees);
+}
+
+void RotateRgb565(const uint8_t* src,
+                  uint8_t* dst,
+                  uint32_t width,
+                  uint32_t height,
+                  int rotation_degrees) {
+    RotatePixels<2>(src, dst, width, height, rotation_degrees);
+}
+
+bool HasFixedRotation(uint32_t width, uint32_t height, size_t bytes_per_pixel, int rotation_degrees) {
+    return FindFixedRotate(Kernels(), width, height, bytes_per_pixel, rotation_degrees) != nullptr;
+}
+
+void RotateFrame(const uint8_t* src,
+                 uint8_t* dst,
+                 uint32_t width,
+                 uint32_t height,
+                 size_t bytes_per_pixel,
+                 int rotation_degrees) {
+    if (bytes_per_pixel == 2) {
+        RotateRgb565(src, dst, width, height, rotation_degrees);
+    } else {
+        RotateRgb666(src, dst, width, height, rotation_degrees);
+    }
+}
+
+bool ComposeFrame(const uint8_t* src, SourceFormat format, size_t src_stride, uint8_t* dst,
+                  uint32_t width, uint32_t height, size_t bytes_per_pixel, int rotation_degrees,
+                  const Overlay* overlay, uint32_t band_rows, const BandHook& hook) {
+    if (src == nullptr || dst == nullptr || band_rows == 0 || (bytes_per_pixel != 2 && bytes_per_pixel != 3)) {
+        return false;
+    }
+    if (rotation_degrees != 0 && rotation_degrees != 90 && rotation_degrees != 180 && rotation_degrees != 270) {
+        return false;
+    }
+    if (bytes_per_pixel == 2) {
+        ComposePixels<2>(src, format, src_stride, dst, width, height, rotation_degrees, overlay, band_rows, hook);
+    } else {
+        ComposePixels<3>(src, format, src_stride, dst, width, height, rotation_degrees, overlay, band_rows, hook);
+    }
+    return true;
+}
+
+size_t BytesPerPixel(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::Rgb565:
+            return 2;
+        case PixelFormat::Rgba8888:
+            return 4;
+        case PixelFormat::Rgb666:
+        case PixelFormat::Rgb888:
+            break;
+    }
+    return 3;
+}
+
+namespace {
+
+using RowConvertFn = void (*)(const uint8_t*, uint8_t*, size_t, uint32_t, uint32_t, DitherMode);
+
+// nullptr when src cannot be turned into dst.
+RowConvertFn ViewConverter(PixelFormat src, PixelFormat dst) {
+    const bool src_rgb = src == PixelFormat::Rgb888 || src == PixelFormat::Rgb666;
+    if (dst == PixelFormat::Rgb666) {
+        if (src == PixelFormat::Rgb888) {
+            return ConvertRgb888ToRgb666Dithered;
+        }
+        if (src == PixelFormat::Rgba8888) {
+            return ConvertRgba8888ToRgb666Dithered;
+        }
+    } else if (dst == PixelFormat::Rgb565) {
+        if (src_rgb) {
+            return ConvertRgb888ToRgb565Dithered;
+        }
+        if (src == PixelFormat::Rgba8888) {
+            return ConvertRgba8888ToRgb565Dithered;
+        }
+    }
+    return nullptr;
+}
+
+template <typename View>
+View Normalized(View view) {
+    if (view.stride == 0) {
+        view.stride = static_cast<size_t>(view.width) * BytesPerPixel(view.format);
+    }
+    return view;
+}
+
+template <typename View>
+bool IsPacked(const View& view) {
+    return view.stride == static_cast<size_t>(view.width) * BytesPerPixel(view.format);
+}
+
+template <typename View>
+View ClipView(const View& view, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    View out = Normalized(view);
+    if (x >= view.width || y >= view.height) {
+        out.width = 0;
+        out.height = 0;
+        return out;
+    }
+    out.data += y * out.stride + static_cast<size_t>(x) * BytesPerPixel(view.format);
+    out.width = std::min(width, view.width - x);
+    out.height = std::min(height, view.height - y);
+    return out;
+}
+
+template <size_t Bpp>
+void RotateViewPixels(const ConstImageView& src, const ImageView& dst, int rotation_degrees) {
+    const simd::KernelTable& kernels = Kernels();
+    if (rotation_degrees == 90 || rotation_degrees == 270) {
+        const simd::FixedRotateFn fixed = FindFixedRotate(kernels, src.width, src.height, Bpp, rotation_degrees);
+        if (fixed != nullptr && IsPacked(src) && IsPacked(dst)) {
+            RotateFixed<Bpp>(fixed, src.data, dst.data, src.width, src.height);
+            return;
+        }
+        RotateTransposed<Bpp>(src.data, src.stride, dst.data, dst.stride, src.width, src.height, rotation_degrees,
+                              Bpp == 3 ? kernels.transpose_rgb24 : kernels.transpose_rgb16);
+        return;
+    }
+    const simd::ReverseFn reverse = Bpp == 3 ? kernels.reverse_rgb24 : kernels.reverse_rgb16;
+    if (IsPacked(src) && IsPacked(dst)) {
+        ReverseBands<Bpp>(reverse, src.data, dst.data, static_cast<size_t>(src.width) * src.height);
+        return;
+    }
+    ForEachBand(src.height, 1, static_cast<size_t>(src.width) * src.height, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            reverse(src.data + y * src.stride, dst.data + (src.height - 1 - y) * dst.stride, src.width);
+        }
+    });
+}
+
+}
+
+ImageView MakeView(uint8_t* data, uint32_t width, uint32_t height, PixelFormat format, size_t stride) {
+    return Normalized(ImageView{data, width, height, stride, format});
+}
+
+ConstImageView MakeView(const uint8_t* data, uint32_t width, uint32_t height, PixelFormat format, size_t stride) {
+    return Normalized(ConstImageView(data, width, height, stride, format));
+}
+
+ImageView SubView(const ImageView& view, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    return ClipView(view, x, y, width, height);
+}
+
+ConstImageView SubView(const ConstImageView& view, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    return ClipView(view, x, y, width, height);
+}
+
+bool ConvertView(const ConstImageView& src_view, const ImageView& dst_view, DitherMode mode,
+                 uint32_t dither_x, uint32_t dither_y) {
+    const ConstImageView src = Normalized(src_view);
+    const ImageView dst = Normalized(dst_view);
+    if (src.width != dst.width || src.height != dst.height) {
+        return false;
+    }
+    const bool copy = src.format == dst.format;
+    const RowConvertFn convert = copy ? nullptr : ViewConverter(src.format, dst.format);
+    if (!copy && convert == nullptr) {
+        return false;
+    }
+    if (src.width == 0 || src.height == 0) {
+        return true;
+    }
+    if (src.data == nullptr || dst.data == nullptr) {
+        return false;
+    }
+
+    const size_t src_bpp = BytesPerPixel(src.format);
+    auto run = [&](const uint8_t* s, uint8_t* d, size_t pixel_count, uint32_t y) {
+        if (copy) {
+            std::memcpy(d, s, pixel_count * src_bpp);
+        } else {
+            convert(s, d, pixel_count, dither_x, y, mode);
+        }
+    };
+    if (mode == DitherMode::None && IsPacked(src) && IsPacked(dst)) {
+        run(src.data, dst.data, static_cast<size_t>(src.width) * src.height, dither_y);
+        return true;
+    }
+    ForEachBand(src.height, 1, static_cast<size_t>(src.width) * src.height, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            run(src.data + y * src.stride, dst.data + y * dst.stride, src.width, dither_y + static_cast<uint32_t>(y));
+        }
+    });
+    return true;
+}
+
+bool RotateView(const ConstImageView& src_view, const ImageView& dst_view, int rotation_degrees) {
+    const ConstImageView src = Normalized(src_view);
+    const ImageView dst = Normalized(dst_view);
+    const size_t bpp = BytesPerPixel(src.format);
+    if (src.format != dst.format || bpp == 4) {
+        return false;
+    }
+    const bool swap_axes = rotation_degrees == 90 || rotation_degrees == 270;
+    if (rotation_degrees != 0 && rotation_degrees != 180 && !swap_axes) {
+        return false;
+    }
+    if (dst.width != (swap_axes ? src.height : src.width) || dst.height != (swap_axes ? src.width : src.height)) {
+        return false;
+    }
+    if (rotation_degrees == 0) {
+        return ConvertView(src, dst);
+    }
+    if (src.width == 0 || src.height == 0) {
+        return true;
+    }
+    if (src.data == nullptr || dst.data == nullptr) {
+        return false;
+    }
+    if (bpp == 2) {
+        RotateViewPixels<2>(src, dst, rotation_degrees);
+    } else {
+        RotateViewPixels<3>(src, dst, rotation_degrees);
+    }
+    return true;
+}
+
+bool FillView(const ImageView& dst_view, uint8_t r, uint8_t g, uint8_t b) {
+    const ImageView dst = Normalized(dst_view);
+    if (dst.width == 0 || dst.height == 0) {
+        return true;
+    }
+    if (dst.data == nullptr) {
+        return false;
+    }
+    uint8_t pixel[4] = {r, g, b, 0xFF};
+    if (dst.format == PixelFormat::Rgb666) {
+        pixel[0] &= 0xFC;
+        pixel[1] &= 0xFC;
+        pixel[2] &= 0xFC;
+    } else if (dst.format == PixelFormat::Rgb565) {
+        simd::ScalarRgb888ToRgb565(pixel, pixel, 1);
+    }
+
+    // Fill the first row by doubling, then copy it down.
+    const size_t bpp = BytesPerPixel(dst.format);
+    const size_t row_bytes = static_cast<size_t>(dst.width) * bpp;
+    std::memcpy(dst.data, pixel, bpp);
+    for (size_t filled = bpp; filled < row_bytes; filled *= 2) {
+        std::memcpy(dst.data + filled, dst.data, std::min(filled, row_bytes - filled));
+    }
+    for (uint32_t y = 1; y < dst.height; ++y) {
+        std::memcpy(dst.data + y * dst.stride, dst.data, row_bytes);
+    }
+    return true;
+}
+
+bool BlitView(const ConstImageView& src, const ImageView& dst, int32_t x, int32_t y) {
+    if (src.format != dst.format && ViewConverter(src.format, dst.format) == nullptr) {
+        return false;
+    }
+    const int64_t x0 = std::max<int64_t>(x, 0);
+    const int64_t y0 = std::max<int64_t>(y, 0);
+    const int64_t x1 = std::min<int64_t>(static_cast<int64_t>(x) + src.width, dst.width);
+    const int64_t y1 = std::min<int64_t>(static_cast<int64_t>(y) + src.height, dst.height);
+    if (x0 >= x1 || y0 >= y1) {
+        return true;
+    }
+    const uint32_t width = static_cast<uint32_t>(x1 - x0);
+    const uint32_t height = static_cast<uint32_t>(y1 - y0);
+    return ConvertView(SubView(src, static_cast<uint32_t>(x0 - x), static_cast<uint32_t>(y0 - y), width, height),
+                       SubView(dst, static_cast<uint32_t>(x0), static_cast<uint32_t>(y0), width, height));
+}
+
 }
@@ -0,0 +1,110 @@
+#include "realtime.h"
+
+#include <alloca.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace ili9488 {
+
+bool SetThreadRealtime(pthread_t thread, int priority) {
+    sched_param param {};
+    param.sched_priority = priority;
+    const int rc = pthread_setschedparam(thread, SCHED_FIFO, &param);
+    if (rc != 0) {
+        std::fprintf(stderr, "Realtime: cannot set SCHED_FIFO %d (%s)\n", priority, std::strerror(rc));
+        return false;
+    }
+    return true;
+}
+
+bool SetThreadAffinity(pthread_t thread, const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    const int rc = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (rc != 0) {
+        std::fprintf(stderr, "Realtime: cannot pin thread to CPUs %s (%s)\n", FormatCpuList(cpus).c_str(),
+                     std::strerror(rc));
+        return false;
+    }
+    return true;
+}
+
+bool LockAllMemory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::fprintf(stderr, "Realtime: mlockall failed (%s)\n", std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+size_t LockedMemoryKb() {
+    FILE* status = std::fopen("/proc/self/status", "r");
+    if (status == nullptr) {
+        return 0;
+    }
+    char line[128];
+    unsigned long kb = 0;
+    while (std::fgets(line, sizeof(line), status) != nullptr) {
+        if (std::sscanf(line, "VmLck: %lu kB", &kb) == 1) {
+            break;
+        }
+    }
+    std::fclose(status);
+    return kb;
+}
+
+size_t PrefaultPages(void* data, size_t size, bool write) {
+    if (data == nullptr || size == 0) {
+        return 0;
+    }
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    volatile uint8_t* bytes = static_cast<volatile uint8_t*>(data);
+    const uintptr_t first = reinterpret_cast<uintptr_t>(data) & ~(page - 1);
+    size_t pages = 0;
+    for (uintptr_t address = first; address < reinterpret_cast<uintptr_t>(data) + size; address += page) {
+        const size_t offset = address < reinterpret_cast<uintptr_t>(data)
+                                  ? 0
+                                  : static_cast<size_t>(address - reinterpret_cast<uintptr_t>(data));
+        const uint8_t value = bytes[offset];
+        if (write) {
+            bytes[offset] = value;
+        }
+        ++pages;
+    }
+    return pages;
+}
+
+void PrefaultStack(size_t bytes) {
+    volatile uint8_t* stack = static_cast<volatile uint8_t*>(alloca(bytes));
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < bytes; offset += page) {
+        stack[offset] = 0;
+    }
+}
+
+std::string FormatCpuList(const std::vector<int>& cpus) {
+    std::string list;
+    for (int cpu : cpus) {
+        if (!list.empty()) {
+            list += ",";
+        }
+        list += std::to_string(cpu);
+    }
+    return list;
+}
+
+}
@@ -0,0 +1,232 @@
+#include "spi_bus.h"
+
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <linux/spi/spidev.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace ili9488 {
+
+namespace {
+constexpr size_t kDefaultSpidevBufsiz = 4096;
+constexpr const char* kSpidevBufsizPath = "/sys/module/spidev/parameters/bufsiz";
+
+uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+}
+
+BusStats SpiBus::stats() const {
+    BusStats out;
+    out.spi_messages = spi_messages_.load(std::memory_order_relaxed);
+    out.spi_transfers = spi_transfers_.load(std::memory_order_relaxed);
+    out.gpio_writes = gpio_writes_.load(std::memory_order_relaxed);
+    out.bytes = bytes_.load(std::memory_order_relaxed);
+    out.ioctl_ns = ioctl_ns_.load(std::memory_order_relaxed);
+    out.max_ioctl_ns = max_ioctl_ns_.load(std::memory_order_relaxed);
+    return out;
+}
+
+void SpiBus::resetStats() {
+    spi_messages_.store(0, std::memory_order_relaxed);
+    spi_transfers_.store(0, std::memory_order_relaxed);
+    gpio_writes_.store(0, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+    ioctl_ns_.store(0, std::memory_order_relaxed);
+    max_ioctl_ns_.store(0, std::memory_order_relaxed);
+}
+
+void SpiBus::recordMessage(size_t segments, size_t bytes, uint64_t elapsed_ns) {
+    spi_messages_.fetch_add(1, std::memory_order_relaxed);
+    spi_transfers_.fetch_add(segments, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    recordIoctl(elapsed_ns);
+}
+
+void SpiBus::recordGpioWrite(uint64_t elapsed_ns) {
+    gpio_writes_.fetch_add(1, std::memory_order_relaxed);
+    recordIoctl(elapsed_ns);
+}
+
+void SpiBus::recordIoctl(uint64_t elapsed_ns) {
+    ioctl_ns_.fetch_add(elapsed_ns, std::memory_order_relaxed);
+    uint64_t current = max_ioctl_ns_.load(std::memory_order_relaxed);
+    while (elapsed_ns > current &&
+           !max_ioctl_ns_.compare_exchange_weak(current, elapsed_ns, std::memory_order_relaxed)) {
+    }
+}
+
+SpidevBus::SpidevBus()
+    : spi_fd_(-1),
+      gpio_chip_fd_(-1),
+      dc_line_fd_(-1),
+      reset_line_fd_(-1),
+      bits_per_word_(8),
+      bufsiz_(kDefaultSpidevBufsiz) {}
+
+SpidevBus::~SpidevBus() {
+    if (dc_line_fd_ >= 0) {
+        close(dc_line_fd_);
+    }
+    if (reset_line_fd_ >= 0) {
+        close(reset_line_fd_);
+    }
+    if (gpio_chip_fd_ >= 0) {
+        close(gpio_chip_fd_);
+    }
+    if (spi_fd_ >= 0) {
+        close(spi_fd_);
+    }
+}
+
+size_t SpidevBus::ReadSpidevBufsiz() {
+    FILE* file = std::fopen(kSpidevBufsizPath, "r");
+    if (file == nullptr) {
+        return kDefaultSpidevBufsiz;
+    }
+    unsigned long value = 0;
+    const int parsed = std::fscanf(file, "%lu", &value);
+    std::fclose(file);
+    return (parsed == 1 && value > 0) ? static_cast<size_t>(value) : kDefaultSpidevBufsiz;
+}
+
+bool SpidevBus::open(const SpidevConfig& config) {
+    spi_fd_ = ::open(config.device.c_str(), O_RDWR | O_CLOEXEC);
+    if (spi_fd_ < 0) {
+        return false;
+    }
+
+    uint8_t mode = config.mode;
+    uint8_t bits = config.bits_per_word;
+    uint32_t speed = config.speed_hz;
+    if (ioctl(spi_fd_, SPI_IOC_WR_MODE, &mode) < 0) {
+        return false;
+    }
+    if (ioctl(spi_fd_, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0) {
+        return false;
+    }
+    if (ioctl(spi_fd_, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+        return false;
+    }
+    bits_per_word_ = bits;
+    bufsiz_ = ReadSpidevBufsiz();
+
+    gpio_chip_fd_ = ::open("/dev/gpiochip0", O_RDWR | O_CLOEXEC);
+    if (gpio_chip_fd_ < 0) {
+        return false;
+    }
+
+    dc_line_fd_ = configureGpioOutput(config.dc_gpio, true);
+    reset_line_fd_ = configureGpioOutput(config.reset_gpio, true);
+    return dc_line_fd_ >= 0 && reset_line_fd_ >= 0;
+}
+
+size_t SpidevBus::maxMessageSegments() const {
+    return kMaxSpiTransfersPerMessage;
+}
+
+bool SpidevBus::message(const SpiSegment* segments, size_t count, uint32_t speed_hz) {
+    if (count == 0) {
+        return true;
+    }
+    if (count > kMaxSpiTransfersPerMessage) {
+        return false;
+    }
+
+    transfers_.assign(count * sizeof(spi_ioc_transfer), 0);
+    auto* transfers = reinterpret_cast<spi_ioc_transfer*>(transfers_.data());
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        transfers[i].tx_buf = reinterpret_cast<uint64_t>(segments[i].data);
+        transfers[i].len = static_cast<uint32_t>(segments[i].length);
+        transfers[i].speed_hz = speed_hz;
+        transfers[i].bits_per_word = bits_per_word_;
+        bytes += segments[i].length;
+    }
+
+    const uint64_t start = NowNs();
+    const int result = ioctl(spi_fd_, SPI_IOC_MESSAGE(count), transfers);
+    recordMessage(count, bytes, NowNs() - start);
+    if (result < 0) {
+        std::fprintf(stderr, "SPI: SPI_IOC_MESSAGE(%zu) of %zu bytes failed: %s\n",
+                     count, bytes, std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool SpidevBus::setDataCommand(bool data) {
+    return setLine(dc_line_fd_, data);
+}
+
+bool SpidevBus::setReset(bool high) {
+    return setLine(reset_line_fd_, high);
+}
+
+bool SpidevBus::setLine(int line_fd, bool value) {
+    if (line_fd < 0) {
+        return false;
+    }
+    struct gpiohandle_data data {};
+    data.values[0] = value ? 1 : 0;
+    const uint64_t start = NowNs();
+    const bool ok = ioctl(line_fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) == 0;
+    recordGpioWrite(NowNs() - start);
+    return ok;
+}
+
+int SpidevBus::configureGpioOutput(int gpio, bool value) {
+    struct gpiohandle_request request {};
+    request.lineoffsets[0] = gpio;
+    request.flags = GPIOHANDLE_REQUEST_OUTPUT;
+    request.default_values[0] = value ? 1 : 0;
+    request.lines = 1;
+    std::snprintf(request.consumer_label, sizeof(request.consumer_label), "ili9488_dma");
+    if (ioctl(gpio_chip_fd_, GPIO_GET_LINEHANDLE_IOCTL, &request) < 0) {
+        return -1;
+    }
+    return request.fd;
+}
+
+MockSpiBus::MockSpiBus(size_t bufsiz, uint64_t ioctl_cost_ns)
+    : bufsiz_(bufsiz),
+      ioctl_cost_ns_(ioctl_cost_ns),
+      wire_time_ns_(0) {}
+
+size_t MockSpiBus::maxMessageSegments() const {
+    return kMaxSpiTransfersPerMessage;
+}
+
+bool MockSpiBus::message(const SpiSegment* segments, size_t count, uint32_t speed_hz) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += segments[i].length;
+    }
+    if (bytes > bufsiz_ || count > kMaxSpiTransfersPerMessage) {
+        return false;
+    }
+    if (speed_hz > 0) {
+        wire_time_ns_ += (static_cast<uint64_t>(bytes) * 8ULL * 1000000000ULL) / speed_hz;
+    }
+    recordMessage(count, bytes, ioctl_cost_ns_);
+    return true;
+}
+
+bool MockSpiBus::setDataCommand(bool) {
+    recordGpioWrite(ioctl_cost_ns_);
+    return true;
+}
+
+bool MockSpiBus::setReset(bool) {
+    recordGpioWrite(ioctl_cost_ns_);
+    return true;
+}
+
+}
@@ -0,0 +1,399 @@
+#include "spi_dma_chain.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace ili9488::spidma {
+
+namespace {
+constexpr size_t kCbAlign = 32;
+constexpr size_t kFifoBytes = 64;
+constexpr size_t kMaxModelSteps = 1U << 28;
+
+constexpr uint32_t kTxTransferInfo = dma::kTiSrcInc | dma::kTiDestDreq | dma::kTiWaitResp |
+                                     (kDreqSpiTx << dma::kTiPermapShift);
+constexpr uint32_t kRxTransferInfo = dma::kTiSrcDreq | dma::kTiWaitResp |
+                                     (kDreqSpiRx << dma::kTiPermapShift);
+constexpr uint32_t kCopyTransferInfo = dma::kTiSrcInc | dma::kTiDestInc | dma::kTiWaitResp;
+
+size_t ControlBlockCount(size_t segments) {
+    return 2 * segments + 3 * segments - 1;
+}
+
+uint32_t ChannelRegister(uint32_t channel, uint32_t offset) {
+    return kDmaBusBase + channel * kDmaChannelStride + offset;
+}
+
+DmaControlBlock MakeControlBlock(uint32_t transfer_info, uint32_t src, uint32_t dst,
+                                 uint32_t length, uint32_t next) {
+    DmaControlBlock cb {};
+    cb.transfer_info = transfer_info;
+    cb.source_addr = src;
+    cb.dest_addr = dst;
+    cb.transfer_length = length;
+    cb.next_cb = next;
+    return cb;
+}
+}
+
+size_t SegmentCount(size_t length) {
+    return (length + kMaxSegmentBytes - 1) / kMaxSegmentBytes;
+}
+
+size_t ChainBytes(size_t length) {
+    const size_t segments = SegmentCount(length);
+    if (segments == 0) {
+        return 0;
+    }
+    return ControlBlockCount(segments) * sizeof(DmaControlBlock) + (2 * segments + 4) * sizeof(uint32_t);
+}
+
+bool BuildChain(void* cb_mem, uint32_t cb_bus_addr, size_t cb_mem_size,
+                uint32_t src_bus_addr, size_t length,
+                const ChainConfig& config, Chain* out) {
+    const size_t segments = SegmentCount(length);
+    if (cb_mem == nullptr || out == nullptr || segments == 0 || length % 4 != 0 ||
+        (cb_bus_addr % kCbAlign) != 0 || ChainBytes(length) > cb_mem_size) {
+        return false;
+    }
+
+    auto* cbs = static_cast<DmaControlBlock*>(cb_mem);
+    const size_t cb_count = ControlBlockCount(segments);
+    auto cb_addr = [cb_bus_addr](size_t index) {
+        return cb_bus_addr + static_cast<uint32_t>(index * sizeof(DmaControlBlock));
+    };
+    const size_t tx_base = 0;
+    const size_t rx_base = 2 * segments;
+
+    const size_t words_offset = cb_count * sizeof(DmaControlBlock);
+    auto* words = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(cb_mem) + words_offset);
+    const uint32_t words_bus = cb_bus_addr + static_cast<uint32_t>(words_offset);
+    auto word_addr = [words_bus](size_t index) {
+        return words_bus + static_cast<uint32_t>(index * sizeof(uint32_t));
+    };
+    const size_t header_word = 0;
+    const size_t next_tx_word = segments;
+    const size_t active_word = 2 * segments;
+    const size_t scratch_word = active_word + 1;
+    const size_t sequence_word = active_word + 2;
+    const size_t completion_word = active_word + 3;
+
+    words[active_word] = kDmaCsActive | kDmaCsWaitWriteResp;
+    words[scratch_word] = 0;
+    words[sequence_word] = 0;
+    words[completion_word] = 0;
+
+    const uint32_t fifo = kSpi0BusBase + kSpiFifo;
+    size_t rx_index = rx_base;
+    for (size_t s = 0; s < segments; ++s) {
+        const size_t offset = s * kMaxSegmentBytes;
+        const uint32_t seg_len = static_cast<uint32_t>(std::min(kMaxSegmentBytes, length - offset));
+        const size_t tx_header = tx_base + 2 * s;
+        const bool last = s + 1 == segments;
+
+        words[header_word + s] = (seg_len << 16) | (config.spi_mode_bits & kSpiCsModeMask) | kSpiCsTa;
+        words[next_tx_word + s] = cb_addr(tx_header);
+
+        cbs[tx_header] = MakeControlBlock(kTxTransferInfo, word_addr(header_word + s), fifo, 4,
+                                          cb_addr(tx_header + 1));
+        cbs[tx_header + 1] = MakeControlBlock(kTxTransferInfo, src_bus_addr + static_cast<uint32_t>(offset),
+                                              fifo, seg_len, 0);
+
+        const size_t drain = rx_index++;
+        cbs[drain] = MakeControlBlock(kRxTransferInfo, fifo, word_addr(scratch_word), seg_len,
+                                      cb_addr(rx_index));
+        if (last) {
+            cbs[rx_index++] = MakeControlBlock(kCopyTransferInfo, word_addr(sequence_word),
+                                               word_addr(completion_word), 4, 0);
+        } else {
+            const size_t kick = rx_index++;
+            cbs[kick] = MakeControlBlock(kCopyTransferInfo, word_addr(next_tx_word + s + 1),
+                                         ChannelRegister(config.tx_channel, kDmaConblkAd), 4,
+                                         cb_addr(rx_index));
+            const size_t start = rx_index++;
+            cbs[start] = MakeControlBlock(kCopyTransferInfo, word_addr(active_word),
+                                          ChannelRegister(config.tx_channel, kDmaCs), 4,
+                                          cb_addr(rx_index));
+        }
+    }
+
+    out->tx_cb_bus_addr = cb_addr(tx_base);
+    out->rx_cb_bus_addr = cb_addr(rx_base);
+    out->sequence_offset = words_offset + sequence_word * sizeof(uint32_t);
+    out->completion_offset = words_offset + completion_word * sizeof(uint32_t);
+    out->segments = segments;
+    out->control_blocks = cb_count;
+    return true;
+}
+
+SpiDmaModel::SpiDmaModel(const dma::MemoryModel& memory)
+    : memory_(memory),
+      spi_cs_(0),
+      dlen_(0) {
+    for (uint32_t i = 0; i < kDmaChannelCount; ++i) {
+        channels_[i].number = i;
+    }
+}
+
+void SpiDmaModel::writeSpiCs(uint32_t value) {
+    if ((value & kSpiCsClearTx) != 0) {
+        tx_fifo_.clear();
+    }
+    if ((value & kSpiCsClearRx) != 0) {
+        rx_fifo_.clear();
+    }
+    spi_cs_ = value & ~(kSpiCsClearTx | kSpiCsClearRx);
+}
+
+void SpiDmaModel::startChannel(uint32_t channel, uint32_t cb_bus_addr) {
+    writeRegister(ChannelRegister(channel, kDmaConblkAd), cb_bus_addr);
+    writeRegister(ChannelRegister(channel, kDmaCs), kDmaCsActive | kDmaCsWaitWriteResp);
+}
+
+bool SpiDmaModel::fail(const std::string& message) {
+    if (error_.empty()) {
+        error_ = message;
+    }
+    return false;
+}
+
+SpiDmaModel::Channel* SpiDmaModel::channelAt(uint32_t bus_addr, uint32_t* offset) {
+    const uint32_t base = kDmaBusBase & dma::kBusAddressMask;
+    const uint32_t masked = bus_addr & dma::kBusAddressMask;
+    if (masked < base || masked >= base + kDmaChannelCount * kDmaChannelStride) {
+        return nullptr;
+    }
+    *offset = (masked - base) % kDmaChannelStride;
+    return &channels_[(masked - base) / kDmaChannelStride];
+}
+
+bool SpiDmaModel::writeRegister(uint32_t bus_addr, uint32_t value) {
+    ++stats_.register_writes;
+    if ((bus_addr & dma::kBusAddressMask) == ((kSpi0BusBase + kSpiCs) & dma::kBusAddressMask)) {
+        writeSpiCs(value);
+        return true;
+    }
+    uint32_t offset = 0;
+    Channel* channel = channelAt(bus_addr, &offset);
+    if (channel == nullptr) {
+        return false;
+    }
+    if (offset == kDmaConblkAd) {
+        if (channel->active) {
+            return fail("CONBLK_AD written while channel is active");
+        }
+        channel->cb_addr = value;
+    } else if (offset == kDmaCs) {
+        if ((value & kDmaCsReset) != 0) {
+            channel->active = false;
+            channel->loaded = false;
+        } else if ((value & kDmaCsActive) != 0) {
+            channel->active = true;
+        }
+    } else {
+        return fail("write to unmodeled DMA register");
+    }
+    return true;
+}
+
+bool SpiDmaModel::stepChannel(Channel& channel) {
+    if (!channel.active) {
+        return false;
+    }
+    if (!channel.loaded) {
+        if (channel.cb_addr == 0) {
+            channel.active = false;
+            return true;
+        }
+        const uint8_t* cb_ptr = memory_.translate(channel.cb_addr, sizeof(DmaControlBlock));
+        if (cb_ptr == nullptr || (channel.cb_addr % kCbAlign) != 0) {
+            channel.active = false;
+            return fail("control block is unmapped or misaligned");
+        }
+        std::memcpy(&channel.cb, cb_ptr, sizeof(channel.cb));
+        if ((channel.cb.transfer_info & dma::kTiTdMode) != 0) {
+            channel.active = false;
+            return fail("2D mode is not used by the SPI chain");
+        }
+        channel.current_cb = channel.cb_addr;
+        channel.src = channel.cb.source_addr & dma::kBusAddressMask;
+        channel.dst = channel.cb.dest_addr & dma::kBusAddressMask;
+        channel.remaining = channel.cb.transfer_length;
+        channel.loaded = true;
+        ++stats_.control_blocks;
+        return true;
+    }
+    if (channel.remaining == 0) {
+        channel.cb_addr = channel.cb.next_cb;
+        channel.loaded = false;
+        return true;
+    }
+
+    const uint32_t ti = channel.cb.transfer_info;
+    const uint32_t permap = (ti >> dma::kTiPermapShift) & 0x1F;
+    const uint32_t fifo = (kSpi0BusBase + kSpiFifo) & dma::kBusAddressMask;
+    const uint32_t unit = std::min<uint32_t>(4, channel.remaining);
+    uint8_t bytes[4] = {};
+
+    if (channel.src == fifo) {
+        if ((ti & dma::kTiSrcDreq) == 0 || permap != kDreqSpiRx) {
+            channel.active = false;
+            return fail("FIFO read without SPI RX DREQ pacing");
+        }
+        if (rx_fifo_.size() < unit) {
+            return false;
+        }
+        for (uint32_t i = 0; i < unit; ++i) {
+            bytes[i] = rx_fifo_.front();
+            rx_fifo_.pop_front();
+        }
+    } else {
+        const uint8_t* src = memory_.translate(channel.src, unit);
+        if (src == nullptr) {
+            channel.active = false;
+            return fail("DMA source is unmapped");
+        }
+        std::memcpy(bytes, src, unit);
+    }
+
+    uint32_t dst_offset = 0;
+    if (channel.dst == fifo) {
+        if ((ti & dma::kTiDestDreq) == 0 || permap != kDreqSpiTx) {
+            channel.active = false;
+            return fail("FIFO write without SPI TX DREQ pacing");
+        }
+        if (tx_fifo_.size() + unit > kFifoBytes) {
+            if (channel.src == fifo) {
+                return fail("RX data lost while TX FIFO is full");
+            }
+            return false;
+        }
+        tx_fifo_.insert(tx_fifo_.end(), bytes, bytes + unit);
+    } else if (channelAt(channel.dst, &dst_offset) != nullptr ||
+               channel.dst == ((kSpi0BusBase + kSpiCs) & dma::kBusAddressMask)) {
+        uint32_t value = 0;
+        std::memcpy(&value, bytes, sizeof(value));
+        if (unit != 4 || !writeRegister(channel.dst, value)) {
+            channel.active = false;
+            return fail("invalid peripheral register write");
+        }
+    } else {
+        uint8_t* dst = memory_.translate(channel.dst, unit);
+        if (dst == nullptr) {
+            channel.active = false;
+            return fail("DMA destination is unmapped");
+        }
+        std::memcpy(dst, bytes, unit);
+    }
+
+    if ((ti & dma::kTiSrcInc) != 0) {
+        channel.src += unit;
+    }
+    if ((ti & dma::kTiDestInc) != 0) {
+        channel.dst += unit;
+    }
+    channel.remaining -= unit;
+    return true;
+}
+
+bool SpiDmaModel::stepSpi() {
+    if ((spi_cs_ & kSpiCsTa) != 0) {
+        if (dlen_ == 0 || tx_fifo_.empty() || rx_fifo_.size() >= kFifoBytes) {
+            return false;
+        }
+        wire_.push_back(tx_fifo_.front());
+        tx_fifo_.pop_front();
+        rx_fifo_.push_back(0);
+        if (--dlen_ == 0 && (spi_cs_ & kSpiCsAdcs) != 0) {
+            spi_cs_ &= ~kSpiCsTa;
+        }
+        return true;
+    }
+
+    if ((spi_cs_ & kSpiCsDmaen) == 0 || tx_fifo_.size() < 4) {
+        return false;
+    }
+    uint32_t header = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        header |= static_cast<uint32_t>(tx_fifo_.front()) << (8 * i);
+        tx_fifo_.pop_front();
+    }
+    dlen_ = header >> 16;
+    if (dlen_ == 0 || (header & kSpiCsTa) == 0) {
+        return fail("DMA header word does not start a transfer");
+    }
+    spi_cs_ = (spi_cs_ & ~0xFFU) | (header & 0xFF);
+    ++stats_.segments;
+    return true;
+}
+
+bool SpiDmaModel::run() {
+    size_t steps = 0;
+    bool progress = true;
+    while (progress && error_.empty()) {
+        if (++steps > kMaxModelSteps) {
+            return fail("model did not settle");
+        }
+        progress = stepSpi();
+        for (Channel& channel : channels_) {
+            progress = stepChannel(channel) || progress;
+        }
+    }
+    if (!error_.empty()) {
+        return false;
+    }
+    for (const Channel& channel : channels_) {
+        if (channel.active) {
+            return fail("DMA channel stalled with work pending");
+        }
+    }
+    if (dlen_ != 0 || !tx_fifo_.empty()) {
+        return fail("SPI transfer incomplete");
+    }
+    return true;
+}
+
+bool SimulateTransfer(const uint8_t* src, size_t length, std::vector<uint8_t>* wire, ModelStats* stats) {
+    constexpr uint32_t kSimCbBusAddr = 0x00100000;
+    constexpr uint32_t kSimSrcBusAddr = 0x01000000;
+    constexpr uint32_t kSimSequence = 0x5A5A0001;
+    const ChainConfig config{5, 4, 0};
+
+    std::vector<DmaControlBlock> cb_mem((ChainBytes(length) + sizeof(DmaControlBlock) - 1) /
+                                        sizeof(DmaControlBlock));
+    Chain chain;
+    if (!BuildChain(cb_mem.data(), kSimCbBusAddr, cb_mem.size() * sizeof(DmaControlBlock),
+                    kSimSrcBusAddr, length, config, &chain)) {
+        return false;
+    }
+    uint8_t* base = reinterpret_cast<uint8_t*>(cb_mem.data());
+    const uint32_t sequence = kSimSequence;
+    std::memcpy(base + chain.sequence_offset, &sequence, sizeof(sequence));
+
+    dma::MemoryModel memory;
+    memory.map(kSimCbBusAddr, cb_mem.data(), cb_mem.size() * sizeof(DmaControlBlock));
+    memory.map(kSimSrcBusAddr, const_cast<uint8_t*>(src), length);
+
+    SpiDmaModel model(memory);
+    model.writeSpiCs(kSpiCsClearTx | kSpiCsClearRx | kSpiCsDmaen | kSpiCsAdcs);
+    model.startChannel(config.rx_channel, chain.rx_cb_bus_addr);
+    model.startChannel(config.tx_channel, chain.tx_cb_bus_addr);
+    if (!model.run()) {
+        std::fprintf(stderr, "SPI DMA model: %s\n", model.error().c_str());
+        return false;
+    }
+
+    uint32_t completion = 0;
+    std::memcpy(&completion, base + chain.completion_offset, sizeof(completion));
+    if (stats != nullptr) {
+        *stats = model.stats();
+    }
+    if (wire != nullptr) {
+        *wire = model.wire();
+    }
+    return completion == sequence && model.wire().size() == length &&
+           std::memcmp(model.wire().data(), src, length) == 0;
+}
+
+}
@@ -1,9 +1,6 @@
 #include "spi_dma_linux.h"
 
 #include <fcntl.h>
-#include <linux/gpio.h>
-#include <linux/spi/spidev.h>
-#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
@@ -26,6 +23,10 @@ constexpr uint8_t kIli9488CmdPageAddressSet = 0x2B;
 constexpr uint8_t kIli9488CmdMemoryWrite = 0x2C;
 constexpr uint8_t kIli9488PixelFormatRgb666 = 0x66;
 constexpr uint8_t kIli9488PixelFormatRgb565 = 0x55;
+constexpr uint8_t kMadctlMy = 0x80;
+constexpr uint8_t kMadctlMx = 0x40;
+constexpr uint8_t kMadctlMv = 0x20;
+constexpr uint8_t kMadctlBgr = 0x08;
 constexpr size_t kDefaultChunkSize = 4096;
 
 constexpr uint32_t kBcm2835PeriphBase = 0x20000000;
@@ -63,27 +64,69 @@ bool TryReadPeripheralBase(uint32_t* base_out) {
     return true;
 }
 
-constexpr uint32_t kDmaCs = 0x00;
-constexpr uint32_t kDmaConblkAd = 0x04;
-constexpr uint32_t kDmaTi = 0x08;
-constexpr uint32_t kDmaSourceAd = 0x0C;
-constexpr uint32_t kDmaDestAd = 0x10;
+constexpr uint32_t kDefaultDmaTxChannel = 5;
+constexpr uint32_t kDefaultDmaRxChannel = 4;
+constexpr uint64_t kDirectDmaSlackUs = 20000;
+constexpr size_t kMaxOwnedBusMappings = 4;
+// Kept rects CoalesceRects tries to merge each new rect into.
+constexpr size_t kCoalesceWindow = 8;
+}
+
+void CoalesceRects(std::vector<Rect>& rects, size_t overhead_pixels) {
+    rects.erase(std::remove_if(rects.begin(), rects.end(),
+                               [](const Rect& r) { return r.width == 0 || r.height == 0; }),
+                rects.end());
 
-constexpr uint32_t kDmaCsActive = 1 << 0;
-constexpr uint32_t kDmaCsEnd = 1 << 1;
-constexpr uint32_t kDmaCsReset = 1 << 31;
+    auto area = [](const Rect& r) {
+        return static_cast<size_t>(r.width) * r.height;
+    };
+    auto by_position = [](const Rect& a, const Rect& b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    };
 
-constexpr uint32_t kDmaTiSrcInc = 1 << 8;
-constexpr uint32_t kDmaTiDestDreq = 1 << 6;
-constexpr uint32_t kDmaTiPerMapSpi = 6 << 16;
-constexpr uint32_t kDmaTiWaitResp = 1 << 3;
+    // One sweep over the y-sorted list. Each rect is folded into one of the
+    // last kCoalesceWindow kept rects when the bounding box costs less than
+    // a separate window; the grown rect may then absorb another neighbour.
+    // Kept rects are compacted into the front of the vector, so this is
+    // O(n * kCoalesceWindow) with no allocation.
+    std::sort(rects.begin(), rects.end(), by_position);
+    size_t kept = 0;
+    for (size_t next = 0; next < rects.size(); ++next) {
+        Rect rect = rects[next];
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            const size_t first = kept > kCoalesceWindow ? kept - kCoalesceWindow : 0;
+            for (size_t i = kept; i-- > first;) {
+                const Rect& other = rects[i];
+                const uint32_t x0 = std::min(rect.x, other.x);
+                const uint32_t y0 = std::min(rect.y, other.y);
+                const uint32_t x1 = std::max(rect.x + rect.width, other.x + other.width);
+                const uint32_t y1 = std::max(rect.y + rect.height, other.y + other.height);
+                const Rect bounds{x0, y0, x1 - x0, y1 - y0};
+                if (area(bounds) <= area(rect) + area(other) + overhead_pixels) {
+                    rect = bounds;
+                    std::copy(rects.begin() + static_cast<std::ptrdiff_t>(i + 1),
+                              rects.begin() + static_cast<std::ptrdiff_t>(kept),
+                              rects.begin() + static_cast<std::ptrdiff_t>(i));
+                    --kept;
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        rects[kept++] = rect;
+    }
+    rects.resize(kept);
+
+    std::sort(rects.begin(), rects.end(), by_position);
 }
 
 ILI9488Transport::ILI9488Transport()
-    : spi_fd_(-1),
-      gpio_chip_fd_(-1),
-      dc_line_fd_(-1),
-      reset_line_fd_(-1),
+    : dc_state_(-1),
+      window_valid_(false),
+      window_{0, 0, 0, 0},
+      segment_bytes_(0),
       current_speed_hz_(0),
       config_{},
       direct_dma_available_(false),
@@ -92,55 +135,46 @@ ILI9488Transport::ILI9488Transport()
       spi_regs_map_(nullptr),
       dma_regs_(nullptr),
       spi_regs_(nullptr),
-      dma_channel_(5),
+      dma_channel_(kDefaultDmaTxChannel),
+      dma_rx_channel_(kDefaultDmaRxChannel),
       dma_cb_mem_(nullptr),
-      dma_cb_bus_addr_(0) {}
+      dma_cb_bus_addr_(0),
+      dma_cb_size_(0),
+      dma_chain_src_(0),
+      dma_chain_length_(0),
+      dma_sequence_(0),
+      bus_mapping_clock_(0) {}
 
 ILI9488Transport::~ILI9488Transport() {
     cleanupDirectDma();
-
-    if (dc_line_fd_ >= 0) {
-        close(dc_line_fd_);
-    }
-    if (reset_line_fd_ >= 0) {
-        close(reset_line_fd_);
-    }
-    if (gpio_chip_fd_ >= 0) {
-        close(gpio_chip_fd_);
-    }
-    if (spi_fd_ >= 0) {
-        close(spi_fd_);
-    }
+    invalidateBusMappings();
 }
 
 bool ILI9488Transport::initialize(const SpiConfig& config) {
-    config_ = config;
-    current_speed_hz_ = config_.speed_hz;
-    spi_fd_ = open(config_.device.c_str(), O_RDWR | O_CLOEXEC);
-    if (spi_fd_ < 0) {
-        return false;
-    }
-
-    if (ioctl(spi_fd_, SPI_IOC_WR_MODE, &config_.mode) < 0) {
-        return false;
-    }
-    if (ioctl(spi_fd_, SPI_IOC_WR_BITS_PER_WORD, &config_.bits_per_word) < 0) {
-        return false;
-    }
-    if (ioctl(spi_fd_, SPI_IOC_WR_MAX_SPEED_HZ, &config_.speed_hz) < 0) {
-        return false;
-    }
+    SpidevConfig spidev_config {};
+    spidev_config.device = config.device;
+    spidev_config.mode = config.mode;
+    spidev_config.bits_per_word = config.bits_per_word;
+    spidev_config.speed_hz = config.speed_hz;
+    spidev_config.dc_gpio = config.dc_gpio;
+    spidev_config.reset_gpio = config.reset_gpio;
 
-    gpio_chip_fd_ = open("/dev/gpiochip0", O_RDWR | O_CLOEXEC);
-    if (gpio_chip_fd_ < 0) {
+    auto bus = std::make_unique<SpidevBus>();
+    if (!bus->open(spidev_config)) {
         return false;
     }
+    return initialize(config, std::move(bus));
+}
 
-    dc_line_fd_ = configureGpioOutput(config_.dc_gpio, true);
-    reset_line_fd_ = configureGpioOutput(config_.reset_gpio, true);
-    if (dc_line_fd_ < 0 || reset_line_fd_ < 0) {
+bool ILI9488Transport::initialize(const SpiConfig& config, std::unique_ptr<SpiBus> bus) {
+    if (!bus) {
         return false;
     }
+    config_ = config;
+    current_speed_hz_ = config_.speed_hz;
+    bus_ = std::move(bus);
+    dc_state_ = -1;
+    window_valid_ = false;
 
     if (!initializePanel()) {
         return false;
@@ -150,109 +184,275 @@ bool ILI9488Transport::initialize(const SpiConfig& config) {
     return true;
 }
 
+uint8_t ILI9488Transport::MadctlForRotation(int rotation_degrees) {
+    switch (rotation_degrees) {
+        case 90:
+            return kMadctlMv | kMadctlBgr;
+        case 180:
+            return kMadctlMy | kMadctlBgr;
+        case 270:
+            return kMadctlMy | kMadctlMx | kMadctlMv | kMadctlBgr;
+        default:
+            return kMadctlMx | kMadctlBgr;
+    }
+}
+
+bool ILI9488Transport::panelRotationActive() const {
+    return config_.panel_rotation && config_.rotation_degrees != 0;
+}
+
+uint32_t ILI9488Transport::windowWidth() const {
+    const bool swap_axes = config_.panel_rotation &&
+                           (config_.rotation_degrees == 90 || config_.rotation_degrees == 270);
+    return swap_axes ? config_.height : config_.width;
+}
+
+uint32_t ILI9488Transport::windowHeight() const {
+    const bool swap_axes = config_.panel_rotation &&
+                           (config_.rotation_degrees == 90 || config_.rotation_degrees == 270);
+    return swap_axes ? config_.width : config_.height;
+}
+
+size_t ILI9488Transport::bytesPerPixel() const {
+    return config_.pixel_format == kIli9488PixelFormatRgb565 ? 2U : 3U;
+}
+
 bool ILI9488Transport::transferDma(const uint8_t* buf, size_t length) {
-    const size_t bytes_per_pixel = config_.pixel_format == kIli9488PixelFormatRgb565 ? 2U : 3U;
-    const size_t line_bytes = static_cast<size_t>(config_.width) * bytes_per_pixel;
-    const size_t expected_length = line_bytes * config_.height;
+    const uint32_t window_width = windowWidth();
+    const uint32_t window_height = windowHeight();
+
+    const size_t line_bytes = static_cast<size_t>(window_width) * bytesPerPixel();
+    const size_t expected_length = line_bytes * window_height;
     if (length < expected_length) {
         return false;
     }
-    const size_t transfer_length = expected_length;
 
-    const uint32_t window_width = config_.width;
-    const uint32_t window_height = config_.height;
+    return transferRegion(buf, line_bytes, 0, 0, window_width, window_height);
+}
 
-    if (!sendCommand(kIli9488CmdColumnAddressSet)) {
-        return false;
+BusStats ILI9488Transport::busStats() const {
+    return bus_ ? bus_->stats() : BusStats{};
+}
+
+void ILI9488Transport::resetBusStats() {
+    if (bus_) {
+        bus_->resetStats();
     }
-    const uint16_t col_end = static_cast<uint16_t>(window_width - 1);
-    const uint8_t col_data[] = {
-        static_cast<uint8_t>(0x00),
-        static_cast<uint8_t>(0x00),
-        static_cast<uint8_t>(col_end >> 8),
-        static_cast<uint8_t>(col_end & 0xFF)
-    };
-    if (!sendData(col_data, sizeof(col_data))) {
-        return false;
+}
+
+bool ILI9488Transport::setAddressWindow(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) {
+    const bool cached = config_.batch_transfers && window_valid_;
+    const bool columns_set = cached && window_[0] == x0 && window_[2] == x1;
+    const bool pages_set = cached && window_[1] == y0 && window_[3] == y1;
+    window_valid_ = false;
+
+    if (!columns_set) {
+        if (!sendCommand(kIli9488CmdColumnAddressSet)) {
+            return false;
+        }
+        const uint8_t col_data[] = {
+            static_cast<uint8_t>(x0 >> 8),
+            static_cast<uint8_t>(x0 & 0xFF),
+            static_cast<uint8_t>(x1 >> 8),
+            static_cast<uint8_t>(x1 & 0xFF)
+        };
+        if (!sendData(col_data, sizeof(col_data))) {
+            return false;
+        }
     }
 
-    if (!sendCommand(kIli9488CmdPageAddressSet)) {
+    if (!pages_set) {
+        if (!sendCommand(kIli9488CmdPageAddressSet)) {
+            return false;
+        }
+        const uint8_t page_data[] = {
+            static_cast<uint8_t>(y0 >> 8),
+            static_cast<uint8_t>(y0 & 0xFF),
+            static_cast<uint8_t>(y1 >> 8),
+            static_cast<uint8_t>(y1 & 0xFF)
+        };
+        if (!sendData(page_data, sizeof(page_data))) {
+            return false;
+        }
+    }
+
+    if (!sendCommand(kIli9488CmdMemoryWrite)) {
         return false;
     }
-    const uint16_t page_end = static_cast<uint16_t>(window_height - 1);
-    const uint8_t page_data[] = {
-        static_cast<uint8_t>(0x00),
-        static_cast<uint8_t>(0x00),
-        static_cast<uint8_t>(page_end >> 8),
-        static_cast<uint8_t>(page_end & 0xFF)
-    };
-    if (!sendData(page_data, sizeof(page_data))) {
+    window_[0] = x0;
+    window_[1] = y0;
+    window_[2] = x1;
+    window_[3] = y1;
+    window_valid_ = true;
+    return true;
+}
+
+bool ILI9488Transport::transferRegion(const uint8_t* buf, size_t stride,
+                                      uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    const uint32_t window_width = windowWidth();
+    const uint32_t window_height = windowHeight();
+    if (buf == nullptr || x >= window_width || y >= window_height) {
         return false;
     }
+    width = std::min(width, window_width - x);
+    height = std::min(height, window_height - y);
+    if (width == 0 || height == 0) {
+        return true;
+    }
 
-    if (!sendCommand(kIli9488CmdMemoryWrite)) {
+    if (!setAddressWindow(x, y, x + width - 1, y + height - 1)) {
         return false;
     }
 
-    const size_t chunk_size = config_.transfer_chunk_bytes > 0 ? config_.transfer_chunk_bytes
-                                                               : kDefaultChunkSize;
-    size_t offset = 0;
-    while (offset < transfer_length) {
-        const size_t remaining = transfer_length - offset;
-        const size_t send_size = std::min(chunk_size, remaining);
-        if (!sendData(buf + offset, send_size)) {
-            return false;
+    const size_t bytes_per_pixel = bytesPerPixel();
+    const size_t row_bytes = static_cast<size_t>(width) * bytes_per_pixel;
+    const uint8_t* origin = buf + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * bytes_per_pixel;
+
+    if (stride == row_bytes) {
+        return sendData(origin, row_bytes * height);
+    }
+    if (config_.batch_transfers) {
+        return sendRows(origin, stride, row_bytes, height);
+    }
+
+    const size_t chunk_size = std::min(config_.transfer_chunk_bytes > 0 ? config_.transfer_chunk_bytes
+                                                                       : kDefaultChunkSize,
+                                       bus_->maxMessageBytes());
+    if (region_staging_.size() < std::max(chunk_size, row_bytes)) {
+        region_staging_.resize(std::max(chunk_size, row_bytes));
+    }
+    uint8_t* staging = region_staging_.data();
+    const size_t staging_capacity = region_staging_.size();
+    size_t staged = 0;
+    for (uint32_t row = 0; row < height; ++row) {
+        if (staged + row_bytes > staging_capacity) {
+            if (!sendData(staging, staged)) {
+                return false;
+            }
+            staged = 0;
         }
-        offset += send_size;
+        std::memcpy(staging + staged, origin + static_cast<size_t>(row) * stride, row_bytes);
+        staged += row_bytes;
     }
+    return staged == 0 || sendData(staging, staged);
+}
 
-    return true;
+bool ILI9488Transport::beginWrite(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    const uint32_t window_width = windowWidth();
+    const uint32_t window_height = windowHeight();
+    if (width == 0 || height == 0 || x >= window_width || y >= window_height ||
+        width > window_width - x || height > window_height - y) {
+        return false;
+    }
+    return setAddressWindow(x, y, x + width - 1, y + height - 1);
 }
 
-bool ILI9488Transport::setGpioValue(int line_fd, bool value) {
-    if (line_fd < 0) {
+bool ILI9488Transport::writePixels(const uint8_t* data, size_t length) {
+    if (data == nullptr) {
         return false;
     }
-    struct gpiohandle_data data {};
-    data.values[0] = value ? 1 : 0;
-    return ioctl(line_fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) == 0;
+    return length == 0 || sendData(data, length);
+}
+
+bool ILI9488Transport::transferRegions(const uint8_t* buf, size_t stride, const Rect* rects, size_t count) {
+    if (rects == nullptr || count == 0) {
+        return true;
+    }
+
+    region_scratch_.assign(rects, rects + count);
+    CoalesceRects(region_scratch_, kRegionOverheadBytes / bytesPerPixel());
+
+    for (const Rect& rect : region_scratch_) {
+        if (!transferRegion(buf, stride, rect.x, rect.y, rect.width, rect.height)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-int ILI9488Transport::configureGpioOutput(int gpio, bool value) {
-    struct gpiohandle_request request {};
-    request.lineoffsets[0] = gpio;
-    request.flags = GPIOHANDLE_REQUEST_OUTPUT;
-    request.default_values[0] = value ? 1 : 0;
-    request.lines = 1;
-    std::snprintf(request.consumer_label, sizeof(request.consumer_label), "ili9488_dma");
-    if (ioctl(gpio_chip_fd_, GPIO_GET_LINEHANDLE_IOCTL, &request) < 0) {
-        return -1;
+bool ILI9488Transport::setDataCommand(bool data) {
+    const int state = data ? 1 : 0;
+    if (config_.batch_transfers && dc_state_ == state) {
+        return true;
     }
-    return request.fd;
+    if (!bus_->setDataCommand(data)) {
+        dc_state_ = -1;
+        return false;
+    }
+    dc_state_ = state;
+    return true;
 }
 
 bool ILI9488Transport::sendCommand(uint8_t command) {
-    if (!setGpioValue(dc_line_fd_, false)) {
+    if (!setDataCommand(false)) {
         return false;
     }
-    struct spi_ioc_transfer transfer {};
-    transfer.tx_buf = reinterpret_cast<uint64_t>(&command);
-    transfer.len = 1;
-    transfer.speed_hz = current_speed_hz_;
-    transfer.bits_per_word = config_.bits_per_word;
-    return ioctl(spi_fd_, SPI_IOC_MESSAGE(1), &transfer) >= 0;
+    const SpiSegment segment{&command, 1};
+    if (!bus_->message(&segment, 1, current_speed_hz_)) {
+        window_valid_ = false;
+        return false;
+    }
+    return true;
 }
 
 bool ILI9488Transport::sendData(const uint8_t* data, size_t length) {
-    if (!setGpioValue(dc_line_fd_, true)) {
+    if (!setDataCommand(true)) {
         return false;
     }
-    struct spi_ioc_transfer transfer {};
-    transfer.tx_buf = reinterpret_cast<uint64_t>(data);
-    transfer.len = static_cast<uint32_t>(length);
-    transfer.speed_hz = current_speed_hz_;
-    transfer.bits_per_word = config_.bits_per_word;
-    return ioctl(spi_fd_, SPI_IOC_MESSAGE(1), &transfer) >= 0;
+    size_t chunk_size = bus_->maxMessageBytes();
+    if (!config_.batch_transfers && config_.transfer_chunk_bytes > 0) {
+        chunk_size = std::min(chunk_size, config_.transfer_chunk_bytes);
+    }
+    size_t offset = 0;
+    while (offset < length) {
+        const SpiSegment segment{data + offset, std::min(chunk_size, length - offset)};
+        if (!bus_->message(&segment, 1, current_speed_hz_)) {
+            window_valid_ = false;
+            return false;
+        }
+        offset += segment.length;
+    }
+    return true;
+}
+
+bool ILI9488Transport::sendRows(const uint8_t* origin, size_t stride, size_t row_bytes, uint32_t rows) {
+    if (!setDataCommand(true)) {
+        return false;
+    }
+    const size_t max_bytes = bus_->maxMessageBytes();
+    const size_t max_segments = bus_->maxMessageSegments();
+    segments_.clear();
+    segment_bytes_ = 0;
+
+    for (uint32_t row = 0; row < rows; ++row) {
+        const uint8_t* row_ptr = origin + static_cast<size_t>(row) * stride;
+        size_t offset = 0;
+        while (offset < row_bytes) {
+            if (segment_bytes_ == max_bytes || segments_.size() == max_segments) {
+                if (!flushSegments()) {
+                    return false;
+                }
+            }
+            const size_t piece = std::min(row_bytes - offset, max_bytes - segment_bytes_);
+            segments_.push_back(SpiSegment{row_ptr + offset, piece});
+            segment_bytes_ += piece;
+            offset += piece;
+        }
+    }
+    return flushSegments();
+}
+
+bool ILI9488Transport::flushSegments() {
+    if (segments_.empty()) {
+        return true;
+    }
+    const bool ok = bus_->message(segments_.data(), segments_.size(), current_speed_hz_);
+    segments_.clear();
+    segment_bytes_ = 0;
+    if (!ok) {
+        window_valid_ = false;
+    }
+    return ok;
 }
 
 bool ILI9488Transport::initializePanel() {
@@ -272,9 +472,9 @@ bool ILI9488Transport::initializePanel() {
                                     : config_.speed_hz;
     current_speed_hz_ = init_speed;
 
-    setGpioValue(reset_line_fd_, false);
+    bus_->setReset(false);
     std::this_thread::sleep_for(std::chrono::milliseconds(120));
-    setGpioValue(reset_line_fd_, true);
+    bus_->setReset(true);
     std::this_thread::sleep_for(std::chrono::milliseconds(120));
 
     const uint8_t gamma_positive[] = {
@@ -312,8 +512,7 @@ bool ILI9488Transport::initializePanel() {
         return false;
     }
 
-    uint8_t madctl = 0x40;
-    madctl |= 0x08;
+    const uint8_t madctl = MadctlForRotation(config_.panel_rotation ? config_.rotation_degrees : 0);
 
     if (!sendData(&madctl, 1)) {
         return false;
@@ -381,15 +580,76 @@ bool ILI9488Transport::initializePanel() {
 }
 
 bool ILI9488Transport::transferDmaFromBusAddr(uint32_t bus_addr, size_t length) {
+    if (!setAddressWindow(0, 0, windowWidth() - 1, windowHeight() - 1)) {
+        return false;
+    }
+
+    if (direct_dma_available_ && length % 4 == 0 && spidma::ChainBytes(length) <= dma_cb_size_) {
+        if (runDirectDma(bus_addr, length)) {
+            return true;
+        }
+        std::fprintf(stderr, "WARNING: direct SPI DMA failed – disabling, using spidev\n");
+        cleanupDirectDma();
+        window_valid_ = false;
+        if (!setAddressWindow(0, 0, windowWidth() - 1, windowHeight() - 1)) {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(bus_mapping_mutex_);
+    const uint8_t* data = lookupBusMapping(bus_addr, length);
+    return data != nullptr && sendData(data, length);
+}
+
+void ILI9488Transport::registerBusMapping(uint32_t bus_addr, const uint8_t* cpu_addr, size_t length) {
+    if (bus_addr == 0 || cpu_addr == nullptr || length == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(bus_mapping_mutex_);
+    bus_mappings_.push_back(BusMapping{bus_addr & kBusAddressMask, length, cpu_addr, nullptr, 0, 0});
+    bus_mapping_stats_.entries = bus_mappings_.size();
+}
+
+void ILI9488Transport::invalidateBusMappings() {
+    std::lock_guard<std::mutex> lock(bus_mapping_mutex_);
+    while (!bus_mappings_.empty()) {
+        releaseBusMapping(bus_mappings_.size() - 1);
+    }
+}
+
+BusMappingStats ILI9488Transport::busMappingStats() const {
+    std::lock_guard<std::mutex> lock(bus_mapping_mutex_);
+    return bus_mapping_stats_;
+}
+
+void ILI9488Transport::releaseBusMapping(size_t index) {
+    if (bus_mappings_[index].map_base != nullptr) {
+        munmap(bus_mappings_[index].map_base, bus_mappings_[index].map_size);
+    }
+    bus_mappings_.erase(bus_mappings_.begin() + static_cast<std::ptrdiff_t>(index));
+    bus_mapping_stats_.entries = bus_mappings_.size();
+}
+
+const uint8_t* ILI9488Transport::lookupBusMapping(uint32_t bus_addr, size_t length) {
+    const uint32_t masked_bus_addr = bus_addr & kBusAddressMask;
+    ++bus_mapping_clock_;
+    for (BusMapping& mapping : bus_mappings_) {
+        if (masked_bus_addr >= mapping.bus_addr &&
+            masked_bus_addr - mapping.bus_addr + length <= mapping.length) {
+            mapping.last_use = bus_mapping_clock_;
+            ++bus_mapping_stats_.hits;
+            return mapping.data + (masked_bus_addr - mapping.bus_addr);
+        }
+    }
+    ++bus_mapping_stats_.misses;
 
     if (mem_fd_ < 0) {
         mem_fd_ = open("/dev/mem", O_RDONLY | O_SYNC | O_CLOEXEC);
         if (mem_fd_ < 0) {
-            return false;
+            return nullptr;
         }
     }
 
-    const uint32_t masked_bus_addr = bus_addr & kBusAddressMask;
     const uint32_t page_size = kPageSize;
     const uint32_t phys_addr = masked_bus_addr & ~(page_size - 1U);
     const uint32_t offset = masked_bus_addr - phys_addr;
@@ -397,15 +657,29 @@ bool ILI9488Transport::transferDmaFromBusAddr(uint32_t bus_addr, size_t length)
 
     void* mapped = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, mem_fd_, phys_addr);
     if (mapped == MAP_FAILED) {
-        return false;
+        return nullptr;
     }
 
-    uint8_t* data_ptr = static_cast<uint8_t*>(mapped) + offset;
-    const bool result = sendData(data_ptr, length);
-
-    munmap(mapped, map_size);
+    size_t owned = 0;
+    size_t oldest = bus_mappings_.size();
+    for (size_t i = 0; i < bus_mappings_.size(); ++i) {
+        if (bus_mappings_[i].map_base == nullptr) {
+            continue;
+        }
+        ++owned;
+        if (oldest == bus_mappings_.size() || bus_mappings_[i].last_use < bus_mappings_[oldest].last_use) {
+            oldest = i;
+        }
+    }
+    if (owned >= kMaxOwnedBusMappings) {
+        releaseBusMapping(oldest);
+        ++bus_mapping_stats_.evictions;
+    }
 
-    return result;
+    const uint8_t* data = static_cast<const uint8_t*>(mapped) + offset;
+    bus_mappings_.push_back(BusMapping{masked_bus_addr, length, data, mapped, map_size, bus_mapping_clock_});
+    bus_mapping_stats_.entries = bus_mappings_.size();
+    return data;
 }
 
 bool ILI9488Transport::supportsBusAddrTransfer() const {
@@ -416,14 +690,131 @@ bool ILI9488Transport::sendDataFromBusAddr(uint32_t bus_addr, size_t length) {
     return transferDmaFromBusAddr(bus_addr, length);
 }
 
+bool ILI9488Transport::enableDirectDma(void* cb_cpu, uint32_t cb_bus_addr, size_t cb_size) {
+    cleanupDirectDma();
+    dma_cb_mem_ = cb_cpu;
+    dma_cb_bus_addr_ = cb_bus_addr;
+    dma_cb_size_ = cb_cpu != nullptr ? cb_size : 0;
+    dma_chain_length_ = 0;
+    return setupDirectDma();
+}
+
 bool ILI9488Transport::setupDirectDma() {
     direct_dma_available_ = false;
-    return false;
+    if (dma_cb_mem_ == nullptr || dma_cb_bus_addr_ == 0 || !bus_) {
+        return false;
+    }
+
+    uint32_t periph_base = kBcm2835PeriphBase;
+    TryReadPeripheralBase(&periph_base);
+
+    mem_fd_ = open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC);
+    if (mem_fd_ < 0) {
+        return false;
+    }
+
+    void* dma_map = mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         mem_fd_, periph_base + kDmaBaseOffset);
+    void* spi_map = mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         mem_fd_, periph_base + kSpi0BaseOffset);
+    if (dma_map != MAP_FAILED) {
+        dma_regs_map_ = dma_map;
+        dma_regs_ = static_cast<volatile uint32_t*>(dma_map);
+    }
+    if (spi_map != MAP_FAILED) {
+        spi_regs_map_ = spi_map;
+        spi_regs_ = static_cast<volatile uint32_t*>(spi_map);
+    }
+    if (dma_regs_ == nullptr || spi_regs_ == nullptr) {
+        cleanupDirectDma();
+        return false;
+    }
+
+    for (const uint32_t channel : {dma_channel_, dma_rx_channel_}) {
+        volatile uint32_t* regs = dma_regs_ + channel * spidma::kDmaChannelStride / 4;
+        regs[spidma::kDmaCs / 4] = spidma::kDmaCsReset;
+    }
+    usleep(10);
+
+    direct_dma_available_ = true;
+    return true;
+}
+
+bool ILI9488Transport::runDirectDma(uint32_t bus_addr, size_t length) {
+    const uint32_t saved_cs = spi_regs_[spidma::kSpiCs / 4];
+    if (dma_chain_length_ != length || dma_chain_src_ != bus_addr) {
+        const spidma::ChainConfig chain_config{dma_channel_, dma_rx_channel_, saved_cs & spidma::kSpiCsModeMask};
+        if (!spidma::BuildChain(dma_cb_mem_, dma_cb_bus_addr_, dma_cb_size_, bus_addr, length,
+                                chain_config, &dma_chain_)) {
+            dma_chain_length_ = 0;
+            return false;
+        }
+        dma_chain_src_ = bus_addr;
+        dma_chain_length_ = length;
+    }
+
+    auto* words = static_cast<uint8_t*>(dma_cb_mem_);
+    auto* sequence = reinterpret_cast<volatile uint32_t*>(words + dma_chain_.sequence_offset);
+    auto* completion = reinterpret_cast<volatile uint32_t*>(words + dma_chain_.completion_offset);
+    const uint32_t expected = ++dma_sequence_;
+    *sequence = expected;
+    *completion = 0;
+    __sync_synchronize();
+
+    if (!setDataCommand(true)) {
+        return false;
+    }
+
+    // The clock divider and mode bits stay as spidev left them after the
+    // address window commands.
+    const uint32_t mode = saved_cs & spidma::kSpiCsModeMask;
+    spi_regs_[spidma::kSpiCs / 4] = mode | spidma::kSpiCsClearTx | spidma::kSpiCsClearRx;
+    spi_regs_[spidma::kSpiCs / 4] = mode | spidma::kSpiCsDmaen | spidma::kSpiCsAdcs;
+
+    volatile uint32_t* tx = dma_regs_ + dma_channel_ * spidma::kDmaChannelStride / 4;
+    volatile uint32_t* rx = dma_regs_ + dma_rx_channel_ * spidma::kDmaChannelStride / 4;
+    rx[spidma::kDmaCs / 4] = spidma::kDmaCsEnd;
+    tx[spidma::kDmaCs / 4] = spidma::kDmaCsEnd;
+    rx[spidma::kDmaConblkAd / 4] = dma_chain_.rx_cb_bus_addr;
+    rx[spidma::kDmaCs / 4] = spidma::kDmaCsActive | spidma::kDmaCsWaitWriteResp;
+    tx[spidma::kDmaConblkAd / 4] = dma_chain_.tx_cb_bus_addr;
+    tx[spidma::kDmaCs / 4] = spidma::kDmaCsActive | spidma::kDmaCsWaitWriteResp;
+
+    const uint64_t wire_us = current_speed_hz_ > 0
+                                 ? static_cast<uint64_t>(length) * 8ULL * 1000000ULL / current_speed_hz_
+                                 : 0ULL;
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::microseconds(wire_us * 2 + kDirectDmaSlackUs);
+    std::this_thread::sleep_for(std::chrono::microseconds(wire_us * 9 / 10));
+
+    bool ok = true;
+    while (*completion != expected) {
+        if (((tx[spidma::kDmaCs / 4] | rx[spidma::kDmaCs / 4]) & spidma::kDmaCsError) != 0 ||
+            std::chrono::steady_clock::now() > deadline) {
+            ok = false;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    if (!ok) {
+        tx[spidma::kDmaCs / 4] = spidma::kDmaCsReset;
+        rx[spidma::kDmaCs / 4] = spidma::kDmaCsReset;
+    }
+    spi_regs_[spidma::kSpiCs / 4] = mode | spidma::kSpiCsClearTx | spidma::kSpiCsClearRx;
+    spi_regs_[spidma::kSpiCs / 4] = saved_cs & ~spidma::kSpiCsTa;
+    if (!ok) {
+        window_valid_ = false;
+    }
+    return ok;
 }
 
 void ILI9488Transport::cleanupDirectDma() {
-    if (dma_regs_ != nullptr && dma_regs_map_ != nullptr) {
-        dma_regs_[kDmaCs / 4] = kDmaCsReset;
+    if (dma_regs_ != nullptr) {
+        for (const uint32_t channel : {dma_channel_, dma_rx_channel_}) {
+            volatile uint32_t* regs = dma_regs_ + channel * spidma::kDmaChannelStride / 4;
+            regs[spidma::kDmaCs / 4] = spidma::kDmaCsReset;
+        }
     }
 
     if (dma_regs_map_ != nullptr) {
@@ -438,16 +829,12 @@ void ILI9488Transport::cleanupDirectDma() {
         spi_regs_ = nullptr;
     }
 
-    if (dma_cb_mem_ != nullptr) {
-        munmap(dma_cb_mem_, sizeof(DmaControlBlock));
-        dma_cb_mem_ = nullptr;
-    }
-
     if (mem_fd_ >= 0) {
         close(mem_fd_);
         mem_fd_ = -1;
     }
 
+    dma_chain_length_ = 0;
     direct_dma_available_ = false;
 }
 
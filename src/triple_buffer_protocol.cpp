@@ -0,0 +1,184 @@
+#include "triple_buffer_protocol.h"
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+
+namespace ili9488::shm {
+
+namespace {
+
+long Futex(uint32_t* addr, int op, uint32_t value, const struct timespec* timeout) {
+    return syscall(SYS_futex, addr, op, value, timeout, nullptr, 0);
+}
+
+}
+
+size_t ControlOffset(size_t buffer_size) {
+    const size_t end = sizeof(TripleBufferShmHeader) + 3 * buffer_size;
+    return (end + kCacheLineSize - 1) & ~(kCacheLineSize - 1);
+}
+
+void InitializeControl(TripleBufferControlV2* control) {
+    __atomic_store_n(&control->producer_slot, 0U, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->frame_futex, 0U, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->frames_published, 0ULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->frames_dropped, 0ULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->publish_ns, 0ULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->consumer_slot, 2U, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->consumer_waiting, 0U, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->frames_consumed, 0ULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&control->state, MakeState(1, false, 0), __ATOMIC_RELEASE);
+}
+
+uint32_t PublishFrame(TripleBufferControlV2* control) {
+    const uint32_t slot = __atomic_load_n(&control->producer_slot, __ATOMIC_RELAXED);
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    __atomic_store_n(&control->publish_ns,
+                     static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec),
+                     __ATOMIC_RELAXED);
+    uint32_t previous = __atomic_load_n(&control->state, __ATOMIC_RELAXED);
+    uint32_t desired;
+    do {
+        desired = MakeState(slot, true, StateSequence(previous) + 1);
+    } while (!__atomic_compare_exchange_n(&control->state, &previous, desired, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    const uint32_t next_slot = StateSlot(previous);
+    __atomic_store_n(&control->producer_slot, next_slot, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&control->frames_published, 1ULL, __ATOMIC_RELAXED);
+    if (StateDirty(previous)) {
+        __atomic_add_fetch(&control->frames_dropped, 1ULL, __ATOMIC_RELAXED);
+    }
+
+    __atomic_add_fetch(&control->frame_futex, 1U, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&control->consumer_waiting, __ATOMIC_SEQ_CST) != 0) {
+        WakeConsumer(control);
+    }
+    return next_slot;
+}
+
+bool AcquireFrame(TripleBufferControlV2* control, uint32_t* out_slot, uint32_t* out_sequence) {
+    const uint32_t slot = __atomic_load_n(&control->consumer_slot, __ATOMIC_RELAXED);
+    uint32_t previous = __atomic_load_n(&control->state, __ATOMIC_ACQUIRE);
+    uint32_t desired;
+    do {
+        if (!StateDirty(previous)) {
+            return false;
+        }
+        desired = MakeState(slot, false, StateSequence(previous));
+    } while (!__atomic_compare_exchange_n(&control->state, &previous, desired, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    __atomic_store_n(&control->consumer_slot, StateSlot(previous), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&control->frames_consumed, 1ULL, __ATOMIC_RELAXED);
+    if (out_slot != nullptr) {
+        *out_slot = StateSlot(previous);
+    }
+    if (out_sequence != nullptr) {
+        *out_sequence = StateSequence(previous);
+    }
+    return true;
+}
+
+bool WaitForFrame(TripleBufferControlV2* control, uint32_t timeout_us) {
+    __atomic_store_n(&control->consumer_waiting, 1U, __ATOMIC_SEQ_CST);
+    const uint32_t observed = __atomic_load_n(&control->frame_futex, __ATOMIC_SEQ_CST);
+
+    if (!StateDirty(__atomic_load_n(&control->state, __ATOMIC_SEQ_CST))) {
+        struct timespec timeout;
+        timeout.tv_sec = static_cast<time_t>(timeout_us / 1000000U);
+        timeout.tv_nsec = static_cast<long>(timeout_us % 1000000U) * 1000L;
+        if (Futex(&control->frame_futex, FUTEX_WAIT, observed, &timeout) != 0 &&
+            errno != EAGAIN && errno != ETIMEDOUT && errno != EINTR) {
+            __atomic_store_n(&control->consumer_waiting, 0U, __ATOMIC_SEQ_CST);
+            return false;
+        }
+    }
+
+    __atomic_store_n(&control->consumer_waiting, 0U, __ATOMIC_SEQ_CST);
+    return StateDirty(__atomic_load_n(&control->state, __ATOMIC_ACQUIRE));
+}
+
+void WakeConsumer(TripleBufferControlV2* control) {
+    Futex(&control->frame_futex, FUTEX_WAKE, 1, nullptr);
+}
+
+FrameNotifier::FrameNotifier() : control_(nullptr), event_fd_(-1), running_(false) {}
+
+FrameNotifier::~FrameNotifier() {
+    stop();
+}
+
+bool FrameNotifier::start(TripleBufferControlV2* control) {
+    stop();
+    event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event_fd_ < 0) {
+        std::perror("Frame notifier: eventfd");
+        return false;
+    }
+    control_ = control;
+    running_.store(true, std::memory_order_seq_cst);
+    thread_ = std::thread(&FrameNotifier::run, this);
+    pthread_setname_np(thread_.native_handle(), "ili9488-frames");
+    return true;
+}
+
+void FrameNotifier::stop() {
+    if (thread_.joinable()) {
+        running_.store(false, std::memory_order_seq_cst);
+        // Changing the word makes a FUTEX_WAIT that has not started yet
+        // return at once; the wake covers one that has.
+        __atomic_add_fetch(&control_->frame_futex, 1U, __ATOMIC_SEQ_CST);
+        WakeConsumer(control_);
+        thread_.join();
+    }
+    if (event_fd_ >= 0) {
+        close(event_fd_);
+        event_fd_ = -1;
+    }
+    control_ = nullptr;
+}
+
+void FrameNotifier::drain() {
+    uint64_t count = 0;
+    while (read(event_fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+}
+
+void FrameNotifier::signal() {
+    const uint64_t one = 1;
+    while (write(event_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+void FrameNotifier::run() {
+    // The helper is the only waiter and never leaves, so consumer_waiting
+    // stays set and every publish issues a FUTEX_WAKE.
+    uint32_t observed = __atomic_load_n(&control_->frame_futex, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&control_->consumer_waiting, 1U, __ATOMIC_SEQ_CST);
+    if (StateDirty(__atomic_load_n(&control_->state, __ATOMIC_ACQUIRE))) {
+        signal();
+    }
+    while (running_.load(std::memory_order_seq_cst)) {
+        Futex(&control_->frame_futex, FUTEX_WAIT, observed, nullptr);
+        const uint32_t current = __atomic_load_n(&control_->frame_futex, __ATOMIC_SEQ_CST);
+        if (current == observed) {
+            continue;
+        }
+        observed = current;
+        if (running_.load(std::memory_order_seq_cst)) {
+            signal();
+        }
+    }
+    __atomic_store_n(&control_->consumer_waiting, 0U, __ATOMIC_SEQ_CST);
+}
+
+}
@@ -0,0 +1,115 @@
+#include "worker_pool.h"
+#include "realtime.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+
+namespace ili9488 {
+
+WorkerPool::WorkerPool(size_t threads, const std::vector<int>& cpus)
+    : pinned_(0),
+      generation_(0),
+      running_(true),
+      busy_(false),
+      job_(nullptr),
+      job_count_(0),
+      job_band_(0),
+      job_bands_(0),
+      remaining_(0) {
+    const size_t helper_count = threads > 1 ? threads - 1 : 0;
+    helpers_.reserve(helper_count);
+    for (size_t i = 0; i < helper_count; ++i) {
+        helpers_.emplace_back(&WorkerPool::helperLoop, this, i);
+        pthread_setname_np(helpers_.back().native_handle(), "ili9488-worker");
+        if (!cpus.empty() && SetThreadAffinity(helpers_.back().native_handle(), {cpus[(i + 1) % cpus.size()]})) {
+            ++pinned_;
+        }
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex_);
+        running_ = false;
+    }
+    dispatch_.notify_all();
+    for (std::thread& helper : helpers_) {
+        helper.join();
+    }
+}
+
+bool WorkerPool::setRealtimePriority(int priority) {
+    bool ok = true;
+    for (std::thread& helper : helpers_) {
+        ok = SetThreadRealtime(helper.native_handle(), priority) && ok;
+    }
+    return ok;
+}
+
+void WorkerPool::parallelFor(size_t count, size_t align, const BandFn& fn) {
+    if (count == 0) {
+        return;
+    }
+    if (helpers_.empty() || busy_.exchange(true, std::memory_order_acquire)) {
+        fn(0, count);
+        return;
+    }
+
+    align = std::max<size_t>(align, 1);
+    const size_t per_thread = (count + size() - 1) / size();
+    const size_t band = (per_thread + align - 1) / align * align;
+    const size_t bands = (count + band - 1) / band;
+    if (bands < 2) {
+        busy_.store(false, std::memory_order_release);
+        fn(0, count);
+        return;
+    }
+
+    remaining_.store(bands - 1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex_);
+        job_ = &fn;
+        job_count_ = count;
+        job_band_ = band;
+        job_bands_ = bands;
+        ++generation_;
+    }
+    dispatch_.notify_all();
+
+    fn(0, band);
+    // The other bands take about as long as ours, so spinning here is short
+    // and avoids a second futex round trip per job.
+    while (remaining_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    busy_.store(false, std::memory_order_release);
+}
+
+void WorkerPool::helperLoop(size_t index) {
+    const size_t band_index = index + 1;
+    uint64_t seen = 0;
+    while (true) {
+        const BandFn* job = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        {
+            std::unique_lock<std::mutex> lock(dispatch_mutex_);
+            dispatch_.wait(lock, [this, seen] { return !running_ || generation_ != seen; });
+            if (!running_) {
+                return;
+            }
+            seen = generation_;
+            if (band_index >= job_bands_) {
+                continue;
+            }
+            job = job_;
+            begin = band_index * job_band_;
+            end = std::min(job_count_, begin + job_band_);
+        }
+        (*job)(begin, end);
+        remaining_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+}
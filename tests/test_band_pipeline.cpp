@@ -0,0 +1,92 @@
+#include "band_pipeline.h"
+#include "panel_simulator.h"
+#include "spi_dma_linux.h"
+
+#include "test_panel.h"
+
+#include <memory>
+#include <vector>
+
+using namespace ili9488;
+
+namespace {
+
+constexpr uint32_t kWidth = kPanelNativeWidth;
+constexpr uint32_t kHeight = kPanelNativeHeight;
+// Divides neither 480 nor 320, so the last band of every rotation is short.
+constexpr uint32_t kBandRows = 37;
+
+// Whole-frame reference: convert with the packed kernels, row by row so the
+// dither pattern is anchored to source coordinates, then rotate.
+std::vector<uint8_t> Reference(const std::vector<uint8_t>& src, size_t stride, bool rgba, uint32_t width,
+                               uint32_t height, size_t bpp, int rotation, pixel::DitherMode dither) {
+    std::vector<uint8_t> converted(static_cast<size_t>(width) * height * bpp);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* in = src.data() + y * stride;
+        uint8_t* out = converted.data() + static_cast<size_t>(y) * width * bpp;
+        if (bpp == 3) {
+            (rgba ? pixel::ConvertRgba8888ToRgb666Dithered : pixel::ConvertRgb888ToRgb666Dithered)(in, out, width, 0,
+                                                                                                 y, dither);
+        } else {
+            (rgba ? pixel::ConvertRgba8888ToRgb565Dithered : pixel::ConvertRgb888ToRgb565Dithered)(in, out, width, 0,
+                                                                                                 y, dither);
+        }
+    }
+    std::vector<uint8_t> rotated(converted.size());
+    pixel::RotateFrame(converted.data(), rotated.data(), width, height, bpp, rotation);
+    return rotated;
+}
+
+// Every present rewrites the whole window, so one transport serves them all.
+void CheckPresent(ILI9488Transport& transport, const SimulatorBus& simulator, bool rgba, int rotation,
+                  size_t padding, pixel::DitherMode dither) {
+    const size_t bpp = transport.bytesPerPixel();
+    const bool swap = rotation == 90 || rotation == 270;
+    const uint32_t src_w = swap ? kHeight : kWidth;
+    const uint32_t src_h = swap ? kWidth : kHeight;
+    const size_t src_bpp = rgba ? 4 : 3;
+    const size_t stride = src_w * src_bpp + padding;
+    std::vector<uint8_t> src(stride * src_h);
+    test::FillPattern(src, static_cast<uint32_t>(rotation + bpp * 1000 + rgba * 7));
+
+    BandPipeline pipeline(transport, kBandRows, dither);
+    CHECK(pipeline.present(src.data(), rgba ? InputFormat::Rgba8888 : InputFormat::Rgb888, padding > 0 ? stride : 0,
+                           rotation));
+
+    const std::vector<uint8_t> expected = Reference(src, stride, rgba, src_w, src_h, bpp, rotation, dither);
+    const size_t mismatches = test::PanelMismatches(simulator.snapshot(), expected.data(), kWidth * bpp, bpp);
+    CHECK_MSG(mismatches == 0, "%zu pixels differ: %zu bpp, %s, %d degrees, padding %zu, dither %d", mismatches,
+              bpp, rgba ? "RGBA8888" : "RGB888", rotation, padding, static_cast<int>(dither));
+
+    const BandPipelineStats stats = pipeline.stats();
+    CHECK(stats.frames == 1);
+    CHECK(stats.bands == (kHeight + kBandRows - 1) / kBandRows);
+    CHECK(simulator.snapshot().stats().clipped_pixels == 0);
+}
+
+void CheckFormat(size_t bpp) {
+    auto bus = std::make_unique<SimulatorBus>();
+    SimulatorBus* simulator = bus.get();
+    ILI9488Transport transport;
+    if (!transport.initialize(test::PanelSpiConfig(bpp), std::move(bus))) {
+        CHECK_MSG(false, "transport init failed");
+        return;
+    }
+    for (bool rgba : {false, true}) {
+        for (int rotation : {0, 90, 180, 270}) {
+            CheckPresent(transport, *simulator, rgba, rotation, 0, pixel::DitherMode::None);
+        }
+    }
+    for (int rotation : {90, 180}) {
+        CheckPresent(transport, *simulator, true, rotation, 12, pixel::DitherMode::None);
+        CheckPresent(transport, *simulator, false, rotation, 0, pixel::DitherMode::Bayer4);
+    }
+}
+
+}
+
+int main() {
+    CheckFormat(3);
+    CheckFormat(2);
+    return test::Finish("test_band_pipeline");
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "pixel_utils.h"
+
+// Minimal check macros shared by the test executables. Each test is its own
+// binary that returns non-zero when any check failed, which is all ctest
+// needs.
+namespace test {
+
+inline int g_checks = 0;
+inline int g_failures = 0;
+constexpr int kMaxReportedFailures = 20;
+
+inline void Fail(const char* file, int line, const char* what) {
+    if (++g_failures <= kMaxReportedFailures) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    }
+}
+
+#define CHECK(cond)                                   \
+    do {                                              \
+        ++::test::g_checks;                           \
+        if (!(cond)) {                                \
+            ::test::Fail(__FILE__, __LINE__, #cond);  \
+        }                                             \
+    } while (0)
+
+// Like CHECK, with a printf-style description of the case on failure.
+#define CHECK_MSG(cond, ...)                                            \
+    do {                                                                \
+        ++::test::g_checks;                                             \
+        if (!(cond)) {                                                  \
+            char check_msg_[256];                                       \
+            std::snprintf(check_msg_, sizeof(check_msg_), __VA_ARGS__); \
+            ::test::Fail(__FILE__, __LINE__, check_msg_);               \
+        }                                                               \
+    } while (0)
+
+inline int Finish(const char* name) {
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%s: %d of %d checks failed\n", name, g_failures, g_checks);
+        return 1;
+    }
+    std::printf("%s: %d checks passed\n", name, g_checks);
+    return 0;
+}
+
+// Deterministic noise, so a failure reproduces and nothing is symmetric.
+inline void FillPattern(std::vector<uint8_t>& data, uint32_t seed) {
+    uint32_t state = seed * 2654435761U + 1U;
+    for (uint8_t& byte : data) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        byte = static_cast<uint8_t>(state >> 7);
+    }
+}
+
+// Reference clockwise rotation of a packed width x height frame, one pixel
+// at a time. 90/270 produce a height x width frame.
+inline void NaiveRotate(const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height, size_t bpp,
+                        int rotation_degrees) {
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            size_t dst_index;
+            switch (rotation_degrees) {
+                case 90:
+                    dst_index = static_cast<size_t>(x) * height + (height - 1 - y);
+                    break;
+                case 180:
+                    dst_index = static_cast<size_t>(height - 1 - y) * width + (width - 1 - x);
+                    break;
+                case 270:
+                    dst_index = static_cast<size_t>(width - 1 - x) * height + y;
+                    break;
+                default:
+                    dst_index = static_cast<size_t>(y) * width + x;
+                    break;
+            }
+            std::memcpy(dst + dst_index * bpp, src + (static_cast<size_t>(y) * width + x) * bpp, bpp);
+        }
+    }
+}
+
+// The 0xRRGGBB colour the panel simulator shows for one pixel in wire
+// format (RGB565 high byte first, or RGB666 in the top bits of each byte).
+inline uint32_t WireColor(const uint8_t* pixel, size_t bpp) {
+    auto expand6 = [](uint32_t v) { return (v & 0xFC) | ((v & 0xFC) >> 6); };
+    auto expand5 = [](uint32_t v) { return (v << 3) | (v >> 2); };
+    if (bpp == 2) {
+        const uint32_t r = expand5(pixel[0] >> 3);
+        const uint32_t g = expand6(((pixel[0] & 0x07U) << 5) | ((pixel[1] >> 3) & 0x1CU));
+        const uint32_t b = expand5(pixel[1] & 0x1FU);
+        return (r << 16) | (g << 8) | b;
+    }
+    return (expand6(pixel[0]) << 16) | (expand6(pixel[1]) << 8) | expand6(pixel[2]);
+}
+
+// Kernel levels this CPU can run, scalar first.
+inline std::vector<ili9488::pixel::SimdLevel> SupportedLevels() {
+    using ili9488::pixel::SimdLevel;
+    const SimdLevel active = ili9488::pixel::ActiveSimdLevel();
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Neon, SimdLevel::Ssse3, SimdLevel::Avx2}) {
+        if (ili9488::pixel::SelectSimdLevel(level)) {
+            levels.push_back(level);
+        }
+    }
+    ili9488::pixel::SelectSimdLevel(active);
+    return levels;
+}
+
+}
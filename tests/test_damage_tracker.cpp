@@ -0,0 +1,224 @@
+#include "damage_tracker.h"
+#include "worker_pool.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+using namespace ili9488;
+
+namespace {
+
+// Not a multiple of the 32-pixel tile in either direction, so the last
+// column of tiles is 4 pixels wide and the last row 6 pixels tall.
+constexpr uint32_t kWidth = 100;
+constexpr uint32_t kHeight = 70;
+constexpr size_t kBpp = 3;
+constexpr uint32_t kTile = 32;
+
+struct Point {
+    uint32_t x;
+    uint32_t y;
+};
+
+bool Covered(const std::vector<Rect>& rects, uint32_t x, uint32_t y) {
+    for (const Rect& r : rects) {
+        if (x >= r.x && x < r.x + r.width && y >= r.y && y < r.y + r.height) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool InBounds(const std::vector<Rect>& rects, uint32_t width, uint32_t height) {
+    for (const Rect& r : rects) {
+        if (r.width == 0 || r.height == 0 || r.x + r.width > width || r.y + r.height > height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Touch(std::vector<uint8_t>& frame, size_t stride, const Point& p) {
+    frame[p.y * stride + p.x * kBpp + 1] ^= 0x5A;
+}
+
+void CheckDetect(size_t stride, WorkerPool* pool) {
+    DamageTracker tracker;
+    tracker.configure(kWidth, kHeight, kBpp, kTile);
+    tracker.setWorkerPool(pool);
+    std::vector<uint8_t> frame(stride * kHeight);
+    test::FillPattern(frame, 11);
+    std::vector<Rect> rects;
+
+    // The first frame is all damage.
+    CHECK(tracker.detect(frame.data(), stride, rects) == 4 * 3);
+    size_t uncovered = 0;
+    for (uint32_t y = 0; y < kHeight; ++y) {
+        for (uint32_t x = 0; x < kWidth; ++x) {
+            uncovered += Covered(rects, x, y) ? 0 : 1;
+        }
+    }
+    CHECK(uncovered == 0);
+    CHECK(InBounds(rects, kWidth, kHeight));
+
+    // An unchanged frame, or changes only in the stride padding, is none.
+    CHECK(tracker.detect(frame.data(), stride, rects) == 0 && rects.empty());
+    if (stride > kWidth * kBpp) {
+        frame[5 * stride + kWidth * kBpp] ^= 0xFF;
+        CHECK(tracker.detect(frame.data(), stride, rects) == 0 && rects.empty());
+    }
+
+    // Single pixels, including the corners of the partial edge tiles.
+    const Point points[] = {{0, 0}, {kWidth - 1, 0}, {0, kHeight - 1}, {kWidth - 1, kHeight - 1},
+                            {96, 33}, {33, 64}, {31, 31}, {32, 32}};
+    for (const Point& p : points) {
+        Touch(frame, stride, p);
+        CHECK_MSG(tracker.detect(frame.data(), stride, rects) == 1, "(%u, %u) dirtied more than one tile", p.x, p.y);
+        CHECK_MSG(rects.size() == 1 && Covered(rects, p.x, p.y), "(%u, %u) not covered", p.x, p.y);
+        CHECK(InBounds(rects, kWidth, kHeight));
+        const Rect tile {p.x / kTile * kTile, p.y / kTile * kTile, 0, 0};
+        CHECK(rects.size() == 1 && rects[0].x == tile.x && rects[0].y == tile.y);
+    }
+
+    // Several at once are all covered.
+    for (const Point& p : points) {
+        Touch(frame, stride, p);
+    }
+    tracker.detect(frame.data(), stride, rects);
+    for (const Point& p : points) {
+        CHECK_MSG(Covered(rects, p.x, p.y), "(%u, %u) not covered in a batch", p.x, p.y);
+    }
+    CHECK(InBounds(rects, kWidth, kHeight));
+
+    // A column of dirty tiles is merged vertically into one rect, with the
+    // short last tile row included.
+    for (uint32_t y : {0U, 40U, kHeight - 1}) {
+        Touch(frame, stride, {40, y});
+    }
+    CHECK(tracker.detect(frame.data(), stride, rects) == 3);
+    CHECK(rects.size() == 1 && rects[0].x == 32 && rects[0].y == 0 && rects[0].width == 32 &&
+          rects[0].height == kHeight);
+
+    // The same for the narrow last tile column.
+    for (uint32_t y : {5U, 33U, 64U}) {
+        Touch(frame, stride, {kWidth - 2, y});
+    }
+    CHECK(tracker.detect(frame.data(), stride, rects) == 3);
+    CHECK(rects.size() == 1 && rects[0].x == 96 && rects[0].width == 4 && rects[0].height == kHeight);
+
+    // invalidate() makes the next frame all damage again.
+    tracker.invalidate();
+    CHECK(tracker.detect(frame.data(), stride, rects) == 12);
+}
+
+// hashRows for every band in any order, markDirty, then finish gives the
+// same tiles as detect plus the marked area.
+void CheckSteps() {
+    const size_t stride = kWidth * kBpp;
+    DamageTracker stepped;
+    DamageTracker whole;
+    stepped.configure(kWidth, kHeight, kBpp, kTile);
+    whole.configure(kWidth, kHeight, kBpp, kTile);
+    std::vector<uint8_t> frame(stride * kHeight);
+    test::FillPattern(frame, 5);
+    std::vector<Rect> rects;
+    std::vector<Rect> expected;
+
+    for (uint32_t band : {64U, 0U, 32U}) {
+        stepped.hashRows(frame.data(), stride, band, std::min(kHeight, band + kTile));
+    }
+    CHECK(stepped.finish(rects) == 12);
+    whole.detect(frame.data(), stride, expected);
+
+    Touch(frame, stride, {70, 66});
+    for (uint32_t band : {32U, 64U, 0U}) {
+        stepped.hashRows(frame.data(), stride, band, std::min(kHeight, band + kTile));
+    }
+    // An overlay drawn after hashing is reported through markDirty.
+    stepped.markDirty(Rect {2, 2, 3, 3});
+    CHECK(stepped.finish(rects) == 2);
+    CHECK(Covered(rects, 70, 66) && Covered(rects, 2, 2) && Covered(rects, 4, 4));
+    CHECK(!Covered(rects, 50, 10));
+    CHECK(InBounds(rects, kWidth, kHeight));
+
+    whole.detect(frame.data(), stride, expected);
+    CHECK(expected.size() == 1 && Covered(expected, 70, 66) && !Covered(expected, 2, 2));
+
+    // markDirty outside the frame is ignored, a rect past the edge clamps.
+    stepped.hashRows(frame.data(), stride, 0, kHeight);
+    stepped.markDirty(Rect {kWidth, 0, 10, 10});
+    stepped.markDirty(Rect {97, 66, 50, 50});
+    CHECK(stepped.finish(rects) == 1);
+    CHECK(rects.size() == 1 && rects[0].x == 96 && rects[0].y == 64 && InBounds(rects, kWidth, kHeight));
+}
+
+// Damage found in the source frame, rotated with RotateRect, covers every
+// pixel that differs between the rotated frames.
+void CheckRotatedDamage() {
+    const size_t stride = kWidth;
+    uint32_t state = 99;
+    for (int rotation : {0, 90, 180, 270}) {
+        DamageTracker tracker;
+        tracker.configure(kWidth, kHeight, 1, 8);
+        std::vector<uint8_t> before(stride * kHeight);
+        test::FillPattern(before, static_cast<uint32_t>(rotation + 1));
+        std::vector<Rect> rects;
+        tracker.detect(before.data(), stride, rects);
+
+        std::vector<uint8_t> after = before;
+        for (int i = 0; i < 6; ++i) {
+            state = state * 1103515245U + 12345U;
+            after[(state >> 8) % after.size()] ^= 0x81;
+        }
+        after[kHeight * stride - 1] ^= 0x81;
+        tracker.detect(after.data(), stride, rects);
+
+        const bool swap = rotation == 90 || rotation == 270;
+        const uint32_t out_w = swap ? kHeight : kWidth;
+        const uint32_t out_h = swap ? kWidth : kHeight;
+        std::vector<Rect> rotated;
+        for (const Rect& r : rects) {
+            rotated.push_back(RotateRect(r, kWidth, kHeight, rotation));
+        }
+        CHECK_MSG(InBounds(rotated, out_w, out_h), "rotated rects out of bounds at %d degrees", rotation);
+
+        std::vector<uint8_t> before_rotated(before.size());
+        std::vector<uint8_t> after_rotated(after.size());
+        test::NaiveRotate(before.data(), before_rotated.data(), kWidth, kHeight, 1, rotation);
+        test::NaiveRotate(after.data(), after_rotated.data(), kWidth, kHeight, 1, rotation);
+        size_t uncovered = 0;
+        for (uint32_t y = 0; y < out_h; ++y) {
+            for (uint32_t x = 0; x < out_w; ++x) {
+                const size_t i = static_cast<size_t>(y) * out_w + x;
+                if (before_rotated[i] != after_rotated[i] && !Covered(rotated, x, y)) {
+                    ++uncovered;
+                }
+            }
+        }
+        CHECK_MSG(uncovered == 0, "%zu changed pixels outside the rotated damage at %d degrees", uncovered,
+                  rotation);
+    }
+
+    // Exact mapping of one rect.
+    const Rect r {10, 20, 5, 7};
+    const Rect r90 = RotateRect(r, kWidth, kHeight, 90);
+    const Rect r180 = RotateRect(r, kWidth, kHeight, 180);
+    const Rect r270 = RotateRect(r, kWidth, kHeight, 270);
+    CHECK(r90.x == kHeight - 27 && r90.y == 10 && r90.width == 7 && r90.height == 5);
+    CHECK(r180.x == kWidth - 15 && r180.y == kHeight - 27 && r180.width == 5 && r180.height == 7);
+    CHECK(r270.x == 20 && r270.y == kWidth - 15 && r270.width == 7 && r270.height == 5);
+}
+
+}
+
+int main() {
+    WorkerPool pool(3);
+    for (size_t stride : {kWidth * kBpp, kWidth * kBpp + 20}) {
+        CheckDetect(stride, nullptr);
+        CheckDetect(stride, &pool);
+    }
+    CheckSteps();
+    CheckRotatedDamage();
+    return test::Finish("test_damage_tracker");
+}
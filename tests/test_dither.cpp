@@ -0,0 +1,96 @@
+#include "pixel_utils.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+using namespace ili9488::pixel;
+
+namespace {
+
+using DitherFn = void (*)(const uint8_t*, uint8_t*, size_t, uint32_t, uint32_t, DitherMode);
+
+struct Format {
+    const char* name;
+    DitherFn convert;
+    void (*plain)(const uint8_t*, uint8_t*, size_t);
+    size_t src_bpp;
+    size_t dst_bpp;
+};
+
+const Format kFormats[] = {
+    {"rgb888->rgb666", ConvertRgb888ToRgb666Dithered, ConvertRgb888ToRgb666, 3, 3},
+    {"rgba8888->rgb666", ConvertRgba8888ToRgb666Dithered, ConvertRgba8888ToRgb666, 4, 3},
+    {"rgb888->rgb565", ConvertRgb888ToRgb565Dithered, ConvertRgb888ToRgb565, 3, 2},
+    {"rgba8888->rgb565", ConvertRgba8888ToRgb565Dithered, ConvertRgba8888ToRgb565, 4, 2},
+};
+
+struct Run {
+    size_t count;
+    uint32_t x;
+    uint32_t y;
+};
+
+// Runs straddle the 256-pixel chunk the kernels work in, the 4/8/64-pixel
+// pattern periods and non-zero frame positions.
+const Run kRuns[] = {
+    {1, 0, 0},     {7, 3, 5},     {16, 61, 17},   {255, 0, 1},    {256, 0, 2},
+    {257, 0, 3},   {300, 5, 7},   {513, 250, 63}, {1000, 13, 64}, {1920, 0, 479},
+};
+
+std::vector<uint8_t> Convert(const Format& format, const std::vector<uint8_t>& src, const Run& run,
+                             DitherMode mode) {
+    std::vector<uint8_t> dst(run.count * format.dst_bpp + 1, 0xA5);
+    format.convert(src.data(), dst.data(), run.count, run.x, run.y, mode);
+    return dst;
+}
+
+}
+
+int main() {
+    const SimdLevel active = ActiveSimdLevel();
+    const std::vector<SimdLevel> levels = test::SupportedLevels();
+    const DitherMode modes[] = {DitherMode::Bayer4, DitherMode::Bayer8, DitherMode::BlueNoise};
+
+    for (const Format& format : kFormats) {
+        for (const Run& run : kRuns) {
+            std::vector<uint8_t> src(run.count * format.src_bpp);
+            test::FillPattern(src, static_cast<uint32_t>(run.count * 7 + run.x + format.src_bpp));
+
+            // DitherMode::None is plain truncation.
+            SelectSimdLevel(SimdLevel::Scalar);
+            std::vector<uint8_t> plain(run.count * format.dst_bpp + 1, 0xA5);
+            format.plain(src.data(), plain.data(), run.count);
+            CHECK_MSG(Convert(format, src, run, DitherMode::None) == plain, "%s none, %zu at (%u, %u)", format.name,
+                      run.count, run.x, run.y);
+
+            for (DitherMode mode : modes) {
+                SelectSimdLevel(SimdLevel::Scalar);
+                const std::vector<uint8_t> reference = Convert(format, src, run, mode);
+                CHECK_MSG(reference != plain || run.count < 16, "%s %s changed nothing", format.name,
+                          DitherModeName(mode));
+
+                // A run split anywhere gives the same pixels, since the
+                // threshold depends only on the frame position.
+                if (run.count > 1) {
+                    const size_t head = run.count / 2 + 1;
+                    std::vector<uint8_t> split(run.count * format.dst_bpp + 1, 0xA5);
+                    format.convert(src.data(), split.data(), head, run.x, run.y, mode);
+                    format.convert(src.data() + head * format.src_bpp, split.data() + head * format.dst_bpp,
+                                   run.count - head, run.x + static_cast<uint32_t>(head), run.y, mode);
+                    CHECK_MSG(split == reference, "%s %s split at %zu, (%u, %u)", format.name,
+                              DitherModeName(mode), head, run.x, run.y);
+                }
+
+                for (SimdLevel level : levels) {
+                    SelectSimdLevel(level);
+                    CHECK_MSG(Convert(format, src, run, mode) == reference, "%s %s %s, %zu at (%u, %u)",
+                              SimdLevelName(level), format.name, DitherModeName(mode), run.count, run.x, run.y);
+                }
+            }
+        }
+    }
+
+    SelectSimdLevel(active);
+    return test::Finish("test_dither");
+}
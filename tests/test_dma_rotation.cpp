@@ -0,0 +1,45 @@
+#include "ili9488_rotate.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+using namespace ili9488::gpu;
+
+int main() {
+    struct Case {
+        uint32_t width;
+        uint32_t height;
+    };
+    const Case sizes[] = {{1, 1}, {1, 7}, {7, 1}, {3, 5}, {37, 53}, {53, 37}, {33, 480}, {320, 480}, {480, 320}};
+
+    for (const Case& size : sizes) {
+        for (size_t bpp : {2U, 3U}) {
+            const size_t frame_bytes = static_cast<size_t>(size.width) * size.height * bpp;
+            std::vector<uint8_t> src(frame_bytes);
+            test::FillPattern(src, size.width * 131U + size.height + static_cast<uint32_t>(bpp));
+
+            for (int rotation : {0, 90, 180, 270}) {
+                std::vector<uint8_t> expected(frame_bytes);
+                test::NaiveRotate(src.data(), expected.data(), size.width, size.height, bpp, rotation);
+                std::vector<uint8_t> actual(frame_bytes, 0xA5);
+                CHECK_MSG(SimulateDmaRotation(src.data(), actual.data(), size.width, size.height, bpp, rotation),
+                          "chain failed: %ux%u, %zu bpp, %d degrees", size.width, size.height, bpp, rotation);
+                CHECK_MSG(expected == actual, "%ux%u, %zu bpp, %d degrees", size.width, size.height, bpp,
+                          rotation);
+            }
+        }
+    }
+
+    // One control block per source row for a rotation, one copy otherwise.
+    CHECK(RotationControlBlockCount(480, 0) == 1);
+    CHECK(RotationControlBlockCount(480, 90) == 480);
+    CHECK(RotationControlBlockCount(53, 270) == 53);
+    CHECK(RotationControlBlockCount(480, 45) == 0);
+
+    std::vector<uint8_t> src(12), dst(12);
+    CHECK(!SimulateDmaRotation(src.data(), dst.data(), 2, 2, 3, 45));
+    CHECK(!SimulateDmaRotation(src.data(), dst.data(), 0, 2, 3, 90));
+
+    return test::Finish("test_dma_rotation");
+}
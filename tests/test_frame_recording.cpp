@@ -0,0 +1,157 @@
+#include "frame_recording.h"
+
+#include "test_common.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace ili9488;
+
+namespace {
+
+constexpr uint32_t kWidth = 37;
+constexpr uint32_t kHeight = 23;
+constexpr size_t kBpp = 3;
+constexpr size_t kFrameBytes = static_cast<size_t>(kWidth) * kHeight * kBpp;
+
+std::string TempPath() {
+    char path[] = "/tmp/ili9488_recording_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    return path;
+}
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::vector<uint8_t> contents;
+    if (FILE* file = std::fopen(path.c_str(), "rb")) {
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            contents.insert(contents.end(), buffer, buffer + n);
+        }
+        std::fclose(file);
+    }
+    return contents;
+}
+
+void WriteFile(const std::string& path, const std::vector<uint8_t>& contents) {
+    if (FILE* file = std::fopen(path.c_str(), "wb")) {
+        std::fwrite(contents.data(), 1, contents.size(), file);
+        std::fclose(file);
+    }
+}
+
+// Frames that change a few scattered bytes each, so most records are small
+// deltas with several spans.
+std::vector<std::vector<uint8_t>> MakeFrames(size_t count) {
+    std::vector<std::vector<uint8_t>> frames(count, std::vector<uint8_t>(kFrameBytes));
+    test::FillPattern(frames[0], 1);
+    for (size_t i = 1; i < count; ++i) {
+        frames[i] = frames[i - 1];
+        for (size_t j = 0; j < 5; ++j) {
+            frames[i][(i * 997 + j * 331) % kFrameBytes] ^= static_cast<uint8_t>(i + j + 1);
+        }
+    }
+    return frames;
+}
+
+void CheckRoundTrip(const std::string& path) {
+    const std::vector<std::vector<uint8_t>> frames = MakeFrames(40);
+    FrameRecorder recorder;
+    CHECK(recorder.open(path, kWidth, kHeight, kBpp));
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const Rect rects[2] = {{static_cast<uint32_t>(i % kWidth), 1, 2, 3}, {0, 0, kWidth, 1}};
+        recorder.append(frames[i].data(), 1000000000ULL + i * 16000000ULL, static_cast<uint32_t>(i), rects,
+                        i % 3);
+    }
+    recorder.close();
+    // The writer may drop frames under load, but every frame is accounted for.
+    CHECK(recorder.frameCount() + recorder.droppedFrames() == frames.size());
+    CHECK(recorder.frameCount() > 0);
+
+    FramePlayer player;
+    CHECK(player.open(path));
+    CHECK(player.frameCount() == recorder.frameCount());
+    CHECK(player.width() == kWidth && player.height() == kHeight && player.bytesPerPixel() == kBpp);
+    PlaybackFrame frame {};
+    size_t played = 0;
+    while (player.next(&frame)) {
+        const uint32_t i = frame.sequence;
+        CHECK(i < frames.size());
+        if (i >= frames.size()) {
+            break;
+        }
+        CHECK_MSG(std::equal(frames[i].begin(), frames[i].end(), frame.pixels), "frame %u pixels", i);
+        CHECK(frame.rect_count == i % 3);
+        if (frame.rect_count > 0) {
+            CHECK(frame.rects[0].x == i % kWidth && frame.rects[0].height == 3);
+        }
+        ++played;
+    }
+    CHECK(played == recorder.frameCount());
+
+    // rewind() restarts from the first frame.
+    player.rewind();
+    CHECK(player.next(&frame) && frame.timestamp_ns == 0);
+}
+
+void CheckMalformed(const std::string& path) {
+    const std::vector<uint8_t> good = ReadFile(path);
+    CHECK(good.size() > sizeof(RecordingHeader) + sizeof(RecordedFrame));
+    if (good.size() <= sizeof(RecordingHeader) + sizeof(RecordedFrame)) {
+        return;
+    }
+    FramePlayer player;
+
+    // A truncated tail plays up to the last complete frame.
+    std::vector<uint8_t> truncated(good.begin(), good.end() - 5);
+    WriteFile(path, truncated);
+    CHECK(player.open(path));
+
+    // A huge rect count must not wrap the size arithmetic; the frame is
+    // rejected and nothing before it is valid, so the file does not open.
+    std::vector<uint8_t> huge = good;
+    RecordedFrame record;
+    std::memcpy(&record, huge.data() + sizeof(RecordingHeader), sizeof(record));
+    for (uint32_t count : {0xFFFFFFFFU, 0x10000000U, 0x80000001U}) {
+        record.rect_count = count;
+        std::memcpy(huge.data() + sizeof(RecordingHeader), &record, sizeof(record));
+        WriteFile(path, huge);
+        CHECK_MSG(!player.open(path), "rect_count 0x%08X accepted", count);
+    }
+
+    // Spans outside the frame are rejected.
+    std::vector<uint8_t> span = good;
+    const size_t span_offset = sizeof(RecordingHeader) + sizeof(RecordedFrame);
+    const uint32_t bad_span[2] = {static_cast<uint32_t>(kFrameBytes), 4};
+    std::memcpy(&record, span.data() + sizeof(RecordingHeader), sizeof(record));
+    std::memcpy(span.data() + span_offset + record.rect_count * sizeof(Rect), bad_span, sizeof(bad_span));
+    WriteFile(path, span);
+    CHECK(!player.open(path));
+
+    // Wrong magic and a bare header.
+    std::vector<uint8_t> magic = good;
+    magic[0] ^= 0xFF;
+    WriteFile(path, magic);
+    CHECK(!player.open(path));
+    WriteFile(path, std::vector<uint8_t>(good.begin(), good.begin() + sizeof(RecordingHeader)));
+    CHECK(!player.open(path));
+}
+
+}
+
+int main() {
+    const std::string path = TempPath();
+    CheckRoundTrip(path);
+    CheckMalformed(path);
+    std::remove(path.c_str());
+    return test::Finish("test_frame_recording");
+}
@@ -0,0 +1,335 @@
+#include "pixel_utils.h"
+#include "worker_pool.h"
+
+#include "test_common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace ili9488::pixel;
+
+namespace {
+
+constexpr uint8_t kGuard = 0xA5;
+constexpr size_t kGuardBytes = 64;
+
+// width x height pixels at a padded stride, with guard bytes before, after
+// and at the end of every row that a view operation must never touch.
+struct PaddedImage {
+    std::vector<uint8_t> bytes;
+    uint32_t width;
+    uint32_t height;
+    size_t stride;
+    PixelFormat format;
+
+    PaddedImage(uint32_t w, uint32_t h, PixelFormat f, size_t padding)
+        : width(w), height(h), stride(w * BytesPerPixel(f) + padding), format(f) {
+        bytes.assign(kGuardBytes * 2 + stride * h, kGuard);
+    }
+
+    uint8_t* data() { return bytes.data() + kGuardBytes; }
+    ImageView view() { return MakeView(data(), width, height, format, stride); }
+    ConstImageView constView() { return MakeView(static_cast<const uint8_t*>(data()), width, height, format, stride); }
+    size_t rowBytes() const { return width * BytesPerPixel(format); }
+
+    void load(const std::vector<uint8_t>& packed) {
+        for (uint32_t y = 0; y < height; ++y) {
+            std::memcpy(data() + y * stride, packed.data() + y * rowBytes(), rowBytes());
+        }
+    }
+
+    std::vector<uint8_t> packed() {
+        std::vector<uint8_t> out(rowBytes() * height);
+        for (uint32_t y = 0; y < height; ++y) {
+            std::memcpy(out.data() + y * rowBytes(), data() + y * stride, rowBytes());
+        }
+        return out;
+    }
+
+    bool guardsIntact() {
+        auto guard = [](uint8_t byte) { return byte == kGuard; };
+        if (!std::all_of(bytes.begin(), bytes.begin() + kGuardBytes, guard) ||
+            !std::all_of(bytes.end() - kGuardBytes, bytes.end(), guard)) {
+            return false;
+        }
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* row = data() + y * stride;
+            if (!std::all_of(row + rowBytes(), row + stride, guard)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// The packed-buffer kernels, which the view functions must agree with.
+void ReferenceConvert(PixelFormat src, PixelFormat dst, const uint8_t* in, uint8_t* out, size_t pixels,
+                      DitherMode mode, uint32_t x, uint32_t y) {
+    if (src == dst) {
+        std::memcpy(out, in, pixels * BytesPerPixel(src));
+        return;
+    }
+    const bool rgba = src == PixelFormat::Rgba8888;
+    if (mode == DitherMode::None) {
+        if (dst == PixelFormat::Rgb666) {
+            (rgba ? ConvertRgba8888ToRgb666 : ConvertRgb888ToRgb666)(in, out, pixels);
+        } else {
+            (rgba ? ConvertRgba8888ToRgb565 : ConvertRgb888ToRgb565)(in, out, pixels);
+        }
+        return;
+    }
+    if (dst == PixelFormat::Rgb666) {
+        (rgba ? ConvertRgba8888ToRgb666Dithered : ConvertRgb888ToRgb666Dithered)(in, out, pixels, x, y, mode);
+    } else {
+        (rgba ? ConvertRgba8888ToRgb565Dithered : ConvertRgb888ToRgb565Dithered)(in, out, pixels, x, y, mode);
+    }
+}
+
+std::vector<uint8_t> ReferenceConvertImage(PixelFormat src, PixelFormat dst, const std::vector<uint8_t>& in,
+                                           uint32_t width, uint32_t height, DitherMode mode = DitherMode::None,
+                                           uint32_t dither_x = 0, uint32_t dither_y = 0) {
+    const size_t src_bpp = BytesPerPixel(src);
+    const size_t dst_bpp = BytesPerPixel(dst);
+    std::vector<uint8_t> out(static_cast<size_t>(width) * height * dst_bpp);
+    for (uint32_t y = 0; y < height; ++y) {
+        ReferenceConvert(src, dst, in.data() + y * width * src_bpp, out.data() + y * width * dst_bpp, width, mode,
+                         dither_x, dither_y + y);
+    }
+    return out;
+}
+
+std::vector<uint8_t> Noise(uint32_t width, uint32_t height, PixelFormat format, uint32_t seed) {
+    std::vector<uint8_t> data(static_cast<size_t>(width) * height * BytesPerPixel(format));
+    test::FillPattern(data, seed);
+    if (format == PixelFormat::Rgb666) {
+        for (uint8_t& byte : data) {
+            byte &= 0xFC;
+        }
+    }
+    return data;
+}
+
+struct FormatPair {
+    PixelFormat src;
+    PixelFormat dst;
+};
+
+const FormatPair kConversions[] = {
+    {PixelFormat::Rgb888, PixelFormat::Rgb666},   {PixelFormat::Rgba8888, PixelFormat::Rgb666},
+    {PixelFormat::Rgb888, PixelFormat::Rgb565},   {PixelFormat::Rgba8888, PixelFormat::Rgb565},
+    {PixelFormat::Rgb666, PixelFormat::Rgb565},   {PixelFormat::Rgb666, PixelFormat::Rgb666},
+    {PixelFormat::Rgb565, PixelFormat::Rgb565},
+};
+
+void CheckConvert(const char* level) {
+    struct Size {
+        uint32_t width;
+        uint32_t height;
+    };
+    for (const Size& size : {Size {37, 23}, Size {1, 5}, Size {320, 480}}) {
+        for (const FormatPair& pair : kConversions) {
+            for (DitherMode mode : {DitherMode::None, DitherMode::Bayer4}) {
+                if (mode != DitherMode::None && pair.src == pair.dst) {
+                    continue;
+                }
+                const std::vector<uint8_t> input = Noise(size.width, size.height, pair.src, size.width + 3);
+                const std::vector<uint8_t> expected =
+                    ReferenceConvertImage(pair.src, pair.dst, input, size.width, size.height, mode, 5, 9);
+                for (size_t padding : {0U, 7U}) {
+                    PaddedImage src(size.width, size.height, pair.src, padding * 2);
+                    PaddedImage dst(size.width, size.height, pair.dst, padding);
+                    src.load(input);
+                    CHECK(ConvertView(src.constView(), dst.view(), mode, 5, 9));
+                    CHECK_MSG(dst.packed() == expected, "%s convert %ux%u format %d->%d dither %d padding %zu",
+                              level, size.width, size.height, static_cast<int>(pair.src),
+                              static_cast<int>(pair.dst), static_cast<int>(mode), padding);
+                    CHECK(dst.guardsIntact() && src.guardsIntact());
+                }
+            }
+        }
+    }
+
+    // Size mismatches and impossible conversions are refused.
+    PaddedImage a(8, 8, PixelFormat::Rgb888, 4);
+    PaddedImage b(8, 7, PixelFormat::Rgb666, 4);
+    PaddedImage c(8, 8, PixelFormat::Rgba8888, 4);
+    CHECK(!ConvertView(a.constView(), b.view()));
+    CHECK(!ConvertView(b.constView(), c.view()));
+    CHECK(b.guardsIntact() && c.guardsIntact());
+}
+
+void CheckRotate(const char* level) {
+    struct Size {
+        uint32_t width;
+        uint32_t height;
+    };
+    for (const Size& size : {Size {37, 23}, Size {16, 16}, Size {320, 480}}) {
+        for (PixelFormat format : {PixelFormat::Rgb666, PixelFormat::Rgb565}) {
+            const size_t bpp = BytesPerPixel(format);
+            const std::vector<uint8_t> input = Noise(size.width, size.height, format, size.height * 7);
+            for (int rotation : {0, 90, 180, 270}) {
+                const bool swap = rotation == 90 || rotation == 270;
+                const uint32_t out_w = swap ? size.height : size.width;
+                const uint32_t out_h = swap ? size.width : size.height;
+                std::vector<uint8_t> expected(input.size());
+                RotateFrame(input.data(), expected.data(), size.width, size.height, bpp, rotation);
+                for (size_t padding : {0U, 5U}) {
+                    PaddedImage src(size.width, size.height, format, padding);
+                    PaddedImage dst(out_w, out_h, format, padding * 3);
+                    src.load(input);
+                    CHECK(RotateView(src.constView(), dst.view(), rotation));
+                    CHECK_MSG(dst.packed() == expected, "%s rotate %ux%u %zu bpp %d degrees padding %zu", level,
+                              size.width, size.height, bpp, rotation, padding);
+                    CHECK(dst.guardsIntact());
+                }
+            }
+        }
+    }
+
+    // Mismatched formats or sizes, RGBA and odd angles are refused.
+    PaddedImage src(6, 4, PixelFormat::Rgb666, 2);
+    PaddedImage wrong_size(6, 4, PixelFormat::Rgb666, 2);
+    PaddedImage wrong_format(4, 6, PixelFormat::Rgb565, 2);
+    PaddedImage rgba(4, 4, PixelFormat::Rgba8888, 2);
+    CHECK(!RotateView(src.constView(), wrong_size.view(), 90));
+    CHECK(!RotateView(src.constView(), wrong_format.view(), 90));
+    CHECK(!RotateView(rgba.constView(), rgba.view(), 180));
+    CHECK(!RotateView(src.constView(), wrong_size.view(), 45));
+    CHECK(wrong_size.guardsIntact() && wrong_format.guardsIntact());
+}
+
+// Fills and blits into a window of a larger padded image; everything
+// outside the window keeps its old contents.
+void CheckFillAndSubView() {
+    for (PixelFormat format : {PixelFormat::Rgb666, PixelFormat::Rgb565, PixelFormat::Rgb888}) {
+        const size_t bpp = BytesPerPixel(format);
+        PaddedImage image(41, 29, format, 11);
+        const std::vector<uint8_t> background = Noise(41, 29, format, 77);
+        image.load(background);
+
+        const ImageView window = SubView(image.view(), 5, 7, 19, 13);
+        CHECK(window.width == 19 && window.height == 13 && window.stride == image.stride);
+        CHECK(window.data == image.data() + 7 * image.stride + 5 * bpp);
+        CHECK(FillView(window, 0xC7, 0x3B, 0x91));
+
+        const uint8_t rgb[3] = {0xC7, 0x3B, 0x91};
+        uint8_t pixel[3] = {};
+        ReferenceConvert(PixelFormat::Rgb888, format, rgb, pixel, 1, DitherMode::None, 0, 0);
+        const std::vector<uint8_t> result = image.packed();
+        size_t wrong = 0;
+        for (uint32_t y = 0; y < image.height; ++y) {
+            for (uint32_t x = 0; x < image.width; ++x) {
+                const size_t i = (static_cast<size_t>(y) * image.width + x) * bpp;
+                const bool inside = x >= 5 && x < 24 && y >= 7 && y < 20;
+                const uint8_t* want = inside ? pixel : background.data() + i;
+                wrong += std::memcmp(result.data() + i, want, bpp) != 0 ? 1 : 0;
+            }
+        }
+        CHECK_MSG(wrong == 0, "fill format %d: %zu pixels wrong", static_cast<int>(format), wrong);
+        CHECK(image.guardsIntact());
+    }
+
+    // SubView clips to the view and is empty past its edges.
+    PaddedImage image(40, 30, PixelFormat::Rgb565, 6);
+    const ImageView clipped = SubView(image.view(), 30, 20, 50, 50);
+    CHECK(clipped.width == 10 && clipped.height == 10);
+    const ImageView outside = SubView(image.view(), 40, 0, 5, 5);
+    CHECK(outside.width == 0 || outside.height == 0);
+    const ConstImageView nested = SubView(SubView(image.constView(), 3, 4, 20, 20), 2, 1, 100, 100);
+    CHECK(nested.width == 18 && nested.height == 19);
+    CHECK(nested.data == image.data() + 5 * image.stride + 5 * 2);
+    CHECK(FillView(outside, 1, 2, 3));
+    CHECK(FillView(clipped, 1, 2, 3));
+    CHECK(image.guardsIntact());
+}
+
+void CheckBlit(const char* level) {
+    struct Offset {
+        int32_t x;
+        int32_t y;
+    };
+    const Offset offsets[] = {{10, 6}, {-5, -3}, {35, 25}, {-12, 20}, {30, -8}, {-20, 0}, {0, 40}, {0, 0}};
+    constexpr uint32_t kDstW = 40;
+    constexpr uint32_t kDstH = 30;
+    constexpr uint32_t kSrcW = 13;
+    constexpr uint32_t kSrcH = 9;
+
+    for (const FormatPair& pair : kConversions) {
+        const size_t dst_bpp = BytesPerPixel(pair.dst);
+        const std::vector<uint8_t> input = Noise(kSrcW, kSrcH, pair.src, 31);
+        const std::vector<uint8_t> converted = ReferenceConvertImage(pair.src, pair.dst, input, kSrcW, kSrcH);
+        const std::vector<uint8_t> background = Noise(kDstW, kDstH, pair.dst, 41);
+        for (const Offset& offset : offsets) {
+            PaddedImage src(kSrcW, kSrcH, pair.src, 3);
+            PaddedImage dst(kDstW, kDstH, pair.dst, 9);
+            src.load(input);
+            dst.load(background);
+            CHECK(BlitView(src.constView(), dst.view(), offset.x, offset.y));
+
+            const std::vector<uint8_t> result = dst.packed();
+            size_t wrong = 0;
+            for (uint32_t y = 0; y < kDstH; ++y) {
+                for (uint32_t x = 0; x < kDstW; ++x) {
+                    const int32_t sx = static_cast<int32_t>(x) - offset.x;
+                    const int32_t sy = static_cast<int32_t>(y) - offset.y;
+                    const bool inside = sx >= 0 && sy >= 0 && sx < static_cast<int32_t>(kSrcW) &&
+                                        sy < static_cast<int32_t>(kSrcH);
+                    const uint8_t* want = inside ? converted.data() + (sy * kSrcW + sx) * dst_bpp
+                                                 : background.data() + (y * kDstW + x) * dst_bpp;
+                    wrong += std::memcmp(result.data() + (y * kDstW + x) * dst_bpp, want, dst_bpp) != 0 ? 1 : 0;
+                }
+            }
+            CHECK_MSG(wrong == 0, "%s blit format %d->%d at (%d, %d): %zu pixels wrong", level,
+                      static_cast<int>(pair.src), static_cast<int>(pair.dst), offset.x, offset.y, wrong);
+            CHECK(dst.guardsIntact());
+        }
+    }
+
+    // A blit into a sub-view is clipped to the sub-view, not the image.
+    PaddedImage src(kSrcW, kSrcH, PixelFormat::Rgb888, 3);
+    PaddedImage dst(kDstW, kDstH, PixelFormat::Rgb666, 9);
+    src.load(Noise(kSrcW, kSrcH, PixelFormat::Rgb888, 5));
+    const std::vector<uint8_t> background = Noise(kDstW, kDstH, PixelFormat::Rgb666, 6);
+    dst.load(background);
+    const ImageView window = SubView(dst.view(), 8, 8, 6, 6);
+    CHECK(BlitView(src.constView(), window, -4, -2));
+    const std::vector<uint8_t> result = dst.packed();
+    size_t changed_outside = 0;
+    for (uint32_t y = 0; y < kDstH; ++y) {
+        for (uint32_t x = 0; x < kDstW; ++x) {
+            const bool inside = x >= 8 && x < 14 && y >= 8 && y < 14;
+            const size_t i = (y * kDstW + x) * 3;
+            if (!inside && std::memcmp(result.data() + i, background.data() + i, 3) != 0) {
+                ++changed_outside;
+            }
+        }
+    }
+    CHECK(changed_outside == 0);
+    CHECK(dst.guardsIntact());
+
+    // Formats that cannot be converted are refused.
+    PaddedImage rgba(4, 4, PixelFormat::Rgba8888, 2);
+    CHECK(!BlitView(src.constView(), rgba.view(), 0, 0));
+    CHECK(rgba.guardsIntact());
+}
+
+}
+
+int main() {
+    const SimdLevel active = ActiveSimdLevel();
+    ili9488::WorkerPool pool(3);
+    for (SimdLevel level : test::SupportedLevels()) {
+        SelectSimdLevel(level);
+        for (bool threaded : {false, true}) {
+            SetWorkerPool(threaded ? &pool : nullptr);
+            CheckConvert(SimdLevelName(level));
+            CheckRotate(SimdLevelName(level));
+            CheckBlit(SimdLevelName(level));
+        }
+        SetWorkerPool(nullptr);
+    }
+    SelectSimdLevel(active);
+    CheckFillAndSubView();
+    return test::Finish("test_image_views");
+}
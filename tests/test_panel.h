@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "panel_simulator.h"
+#include "spi_dma_linux.h"
+#include "test_common.h"
+
+// Helpers for tests that drive ILI9488Transport into a SimulatorBus.
+namespace test {
+
+inline ili9488::SpiConfig PanelSpiConfig(size_t bpp, int rotation_degrees = 0, bool panel_rotation = false,
+                                         bool batch_transfers = true) {
+    ili9488::SpiConfig config {};
+    config.speed_hz = 65000000;
+    config.init_speed_hz = 4000000;
+    config.bits_per_word = 8;
+    config.pixel_format = bpp == 2 ? 0x55 : 0x66;
+    config.width = ili9488::kPanelNativeWidth;
+    config.height = ili9488::kPanelNativeHeight;
+    config.transfer_chunk_bytes = 65536;
+    config.rotation_degrees = rotation_degrees;
+    config.panel_rotation = panel_rotation;
+    config.batch_transfers = batch_transfers;
+    config.dc_gpio = -1;
+    config.reset_gpio = -1;
+    return config;
+}
+
+// Pixels of a native-portrait frame (wire format, rows of stride bytes)
+// that the panel does not show.
+inline size_t PanelMismatches(const ili9488::PanelSimulator& panel, const uint8_t* frame, size_t stride,
+                              size_t bpp) {
+    size_t mismatches = 0;
+    for (uint32_t y = 0; y < ili9488::kPanelNativeHeight; ++y) {
+        for (uint32_t x = 0; x < ili9488::kPanelNativeWidth; ++x) {
+            if (panel.pixel(x, y) != WireColor(frame + y * stride + x * bpp, bpp)) {
+                ++mismatches;
+            }
+        }
+    }
+    return mismatches;
+}
+
+}
@@ -0,0 +1,284 @@
+#include "panel_simulator.h"
+
+#include "test_common.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+using namespace ili9488;
+
+namespace {
+
+void Send(PanelSimulator& panel, uint8_t command, std::initializer_list<uint8_t> params = {}) {
+    panel.command(command);
+    const std::vector<uint8_t> bytes(params);
+    if (!bytes.empty()) {
+        panel.data(bytes.data(), bytes.size());
+    }
+}
+
+void SetWindow(PanelSimulator& panel, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    Send(panel, 0x2A, {static_cast<uint8_t>(x0 >> 8), static_cast<uint8_t>(x0), static_cast<uint8_t>(x1 >> 8),
+                       static_cast<uint8_t>(x1)});
+    Send(panel, 0x2B, {static_cast<uint8_t>(y0 >> 8), static_cast<uint8_t>(y0), static_cast<uint8_t>(y1 >> 8),
+                       static_cast<uint8_t>(y1)});
+}
+
+// Awake, display on, RGB666 and the driver's upright MADCTL.
+void PowerUp(PanelSimulator& panel, uint8_t madctl = 0x48, uint8_t colmod = 0x66) {
+    Send(panel, 0x11);
+    Send(panel, 0x29);
+    Send(panel, 0x36, {madctl});
+    Send(panel, 0x3A, {colmod});
+}
+
+// One RGB666 pixel whose visible colour is 0xRRGGBB with the low bits
+// restored by the panel's expansion (top two bits copied down).
+uint32_t Rgb666Color(uint8_t r, uint8_t g, uint8_t b) {
+    auto expand = [](uint8_t v) { return static_cast<uint32_t>((v & 0xFC) | ((v & 0xFC) >> 6)); };
+    return (expand(r) << 16) | (expand(g) << 8) | expand(b);
+}
+
+void CheckWindowAndWrap() {
+    PanelSimulator panel;
+    PowerUp(panel);
+    SetWindow(panel, 10, 20, 12, 21);
+    CHECK(panel.registerValue(0x2A) == std::vector<uint8_t>({0, 10, 0, 12}));
+
+    // Six pixels fill the 3x2 window in row-major order; the first pixel is
+    // split across calls to exercise partial pixel buffering.
+    std::vector<uint8_t> bytes;
+    for (uint8_t i = 1; i <= 6; ++i) {
+        bytes.push_back(static_cast<uint8_t>(i * 4));
+        bytes.push_back(0x40);
+        bytes.push_back(0x80);
+    }
+    panel.command(0x2C);
+    panel.data(bytes.data(), 2);
+    panel.data(bytes.data() + 2, bytes.size() - 2);
+    for (uint32_t i = 0; i < 6; ++i) {
+        CHECK_MSG(panel.pixel(10 + i % 3, 20 + i / 3) == Rgb666Color(static_cast<uint8_t>((i + 1) * 4), 0x40, 0x80),
+                  "window pixel %u", i);
+    }
+    CHECK(panel.pixel(13, 20) == 0);
+    CHECK(panel.pixel(10, 22) == 0);
+    CHECK(panel.pixel(9, 20) == 0);
+
+    // Past the last page the address wraps to the window's first pixel.
+    const uint8_t wrap[] = {0xFC, 0xFC, 0xFC};
+    panel.data(wrap, sizeof(wrap));
+    CHECK(panel.pixel(10, 20) == 0xFFFFFF);
+    CHECK(panel.pixel(11, 20) == Rgb666Color(8, 0x40, 0x80));
+
+    // RAMWR restarts at the window origin; RAMWRC continues where the last
+    // write stopped.
+    const uint8_t red[] = {0xFC, 0x00, 0x00};
+    panel.command(0x2C);
+    panel.data(red, sizeof(red));
+    panel.command(0x3C);
+    panel.data(red, sizeof(red));
+    CHECK(panel.pixel(10, 20) == 0xFF0000);
+    CHECK(panel.pixel(11, 20) == 0xFF0000);
+    CHECK(panel.pixel(12, 20) == Rgb666Color(12, 0x40, 0x80));
+    CHECK(panel.stats().memory_writes == 3);
+    CHECK(panel.stats().pixels_written == 9);
+}
+
+void CheckPixelFormats() {
+    PanelSimulator panel;
+    CHECK(panel.pixelFormat() == 0x66);
+    PowerUp(panel, 0x48, 0x55);
+    CHECK(panel.pixelFormat() == 0x55);
+    SetWindow(panel, 0, 0, 319, 0);
+
+    // RGB565 is two bytes per pixel, high byte first.
+    const uint8_t rgb565[] = {0xF8, 0x00, 0x07, 0xE0, 0x00, 0x1F, 0x84, 0x10};
+    panel.command(0x2C);
+    panel.data(rgb565, sizeof(rgb565));
+    CHECK(panel.pixel(0, 0) == 0xFF0000);
+    CHECK(panel.pixel(1, 0) == 0x00FF00);
+    CHECK(panel.pixel(2, 0) == 0x0000FF);
+    CHECK(panel.pixel(3, 0) == 0x848284);
+    CHECK(panel.stats().pixels_written == 4);
+
+    // The same bytes as RGB666 are three bytes per pixel.
+    Send(panel, 0x3A, {0x66});
+    panel.command(0x2C);
+    panel.data(rgb565, 6);
+    CHECK(panel.pixel(0, 0) == Rgb666Color(0xF8, 0x00, 0x07));
+    CHECK(panel.pixel(1, 0) == Rgb666Color(0xE0, 0x00, 0x1F));
+    CHECK(panel.pixel(2, 0) == 0x0000FF);
+}
+
+// Writes one pixel at controller (column, page) under a MADCTL value and
+// returns where it shows up in visible portrait coordinates.
+bool VisiblePosition(uint8_t madctl, uint16_t column, uint16_t page, uint32_t* x_out, uint32_t* y_out) {
+    PanelSimulator panel;
+    PowerUp(panel, madctl);
+    SetWindow(panel, column, page, column, page);
+    const uint8_t white[] = {0xFC, 0xFC, 0xFC};
+    panel.command(0x2C);
+    panel.data(white, sizeof(white));
+    for (uint32_t y = 0; y < kPanelNativeHeight; ++y) {
+        for (uint32_t x = 0; x < kPanelNativeWidth; ++x) {
+            if (panel.pixel(x, y) != 0) {
+                *x_out = x;
+                *y_out = y;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CheckMadctl() {
+    struct Case {
+        uint8_t madctl;
+        uint32_t x;
+        uint32_t y;
+    };
+    // Controller (column 5, page 2). pixel() mirrors X, so MX clear lands on
+    // the right-hand side and the driver's 0x48 is upright.
+    const Case cases[] = {
+        {0x08, 314, 2},    // no flags
+        {0x48, 5, 2},      // MX
+        {0x88, 314, 477},  // MY
+        {0xC8, 5, 477},    // MX | MY
+        {0x28, 317, 5},    // MV
+        {0x68, 2, 5},      // MV | MX
+        {0xA8, 317, 474},  // MV | MY
+        {0xE8, 2, 474},    // MV | MX | MY
+    };
+    for (const Case& c : cases) {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        CHECK_MSG(VisiblePosition(c.madctl, 5, 2, &x, &y) && x == c.x && y == c.y,
+                  "MADCTL 0x%02X put (5, 2) at (%u, %u)", c.madctl, x, y);
+    }
+
+    // BGR clear swaps red and blue on the visible side.
+    PanelSimulator panel;
+    PowerUp(panel, 0x40);
+    SetWindow(panel, 0, 0, 0, 0);
+    const uint8_t red[] = {0xFC, 0x00, 0x00};
+    panel.command(0x2C);
+    panel.data(red, sizeof(red));
+    CHECK(panel.pixel(0, 0) == 0x0000FF);
+    Send(panel, 0x36, {0x48});
+    CHECK(panel.pixel(0, 0) == 0xFF0000);
+
+    // Without MV a column past the native width is clipped, not wrapped.
+    SetWindow(panel, 400, 0, 400, 0);
+    panel.command(0x2C);
+    panel.data(red, sizeof(red));
+    CHECK(panel.stats().clipped_pixels == 1);
+}
+
+void CheckMirroredReadout() {
+    // pixel() reads GRAM mirrored in X: a pixel stored at controller column
+    // 0 without MX shows at the right edge. This pins the module wiring the
+    // driver's 0x48 upright MADCTL compensates for.
+    PanelSimulator panel;
+    PowerUp(panel, 0x08);
+    SetWindow(panel, 0, 0, 0, 0);
+    const uint8_t green[] = {0x00, 0xFC, 0x00};
+    panel.command(0x2C);
+    panel.data(green, sizeof(green));
+    CHECK(panel.pixel(kPanelNativeWidth - 1, 0) == 0x00FF00);
+    CHECK(panel.pixel(0, 0) == 0);
+}
+
+void CheckStateAndReset() {
+    PanelSimulator panel;
+    CHECK(panel.sleeping());
+    CHECK(!panel.displayOn());
+    PowerUp(panel);
+    SetWindow(panel, 0, 0, 0, 0);
+    const uint8_t white[] = {0xFC, 0xFC, 0xFC};
+    panel.command(0x2C);
+    panel.data(white, sizeof(white));
+    CHECK(panel.pixel(0, 0) == 0xFFFFFF);
+
+    Send(panel, 0x21);
+    CHECK(panel.inverted() && panel.pixel(0, 0) == 0);
+    Send(panel, 0x20);
+    Send(panel, 0x28);
+    CHECK(panel.pixel(0, 0) == 0);
+    Send(panel, 0x29);
+    Send(panel, 0x10);
+    CHECK(panel.pixel(0, 0) == 0);
+
+    // Software reset restores the registers but keeps GRAM.
+    Send(panel, 0x01);
+    CHECK(panel.madctl() == 0 && panel.pixelFormat() == 0x66 && panel.sleeping());
+    PowerUp(panel);
+    CHECK(panel.pixel(0, 0) == 0xFFFFFF);
+    panel.reset();
+    CHECK(panel.stats().hardware_resets == 1);
+}
+
+void CheckPpm() {
+    PanelSimulator panel;
+    PowerUp(panel);
+    SetWindow(panel, 0, 0, kPanelNativeWidth - 1, kPanelNativeHeight - 1);
+    std::vector<uint8_t> frame(static_cast<size_t>(kPanelNativeWidth) * kPanelNativeHeight * 3U);
+    test::FillPattern(frame, 7);
+    panel.command(0x2C);
+    panel.data(frame.data(), frame.size());
+
+    char path[] = "/tmp/ili9488_panel_XXXXXX";
+    const int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    ::close(fd);
+    CHECK(panel.writePpm(path));
+
+    std::vector<uint8_t> contents;
+    if (FILE* file = std::fopen(path, "rb")) {
+        uint8_t buffer[65536];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            contents.insert(contents.end(), buffer, buffer + n);
+        }
+        std::fclose(file);
+    }
+    std::remove(path);
+
+    const std::string header = "P6\n320 480\n255\n";
+    CHECK(contents.size() == header.size() + frame.size());
+    if (contents.size() != header.size() + frame.size()) {
+        return;
+    }
+    CHECK(std::string(contents.begin(), contents.begin() + header.size()) == header);
+    size_t mismatches = 0;
+    for (uint32_t y = 0; y < kPanelNativeHeight; ++y) {
+        for (uint32_t x = 0; x < kPanelNativeWidth; ++x) {
+            const uint8_t* p = contents.data() + header.size() + (static_cast<size_t>(y) * kPanelNativeWidth + x) * 3U;
+            const uint32_t rgb = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+            const uint8_t* src = frame.data() + (static_cast<size_t>(y) * kPanelNativeWidth + x) * 3U;
+            if (rgb != panel.pixel(x, y) || rgb != Rgb666Color(src[0], src[1], src[2])) {
+                ++mismatches;
+            }
+        }
+    }
+    CHECK_MSG(mismatches == 0, "%zu PPM pixels differ", mismatches);
+}
+
+}
+
+int main() {
+    CheckWindowAndWrap();
+    CheckPixelFormats();
+    CheckMadctl();
+    CheckMirroredReadout();
+    CheckStateAndReset();
+    CheckPpm();
+    return test::Finish("test_panel_simulator");
+}
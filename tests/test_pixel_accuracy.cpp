@@ -0,0 +1,124 @@
+#include "pixel_utils.h"
+#include "worker_pool.h"
+
+#include "test_common.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace ili9488::pixel;
+
+namespace {
+
+void ReferenceConvert(const uint8_t* src, size_t src_bpp, uint8_t* dst, size_t dst_bpp, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i) {
+        const uint8_t* s = src + i * src_bpp;
+        uint8_t* d = dst + i * dst_bpp;
+        if (dst_bpp == 3) {
+            d[0] = s[0] & 0xFC;
+            d[1] = s[1] & 0xFC;
+            d[2] = s[2] & 0xFC;
+        } else {
+            d[0] = static_cast<uint8_t>((s[0] & 0xF8) | (s[1] >> 5));
+            d[1] = static_cast<uint8_t>(((s[1] << 3) & 0xE0) | (s[2] >> 3));
+        }
+    }
+}
+
+void Convert(size_t src_bpp, size_t dst_bpp, const uint8_t* src, uint8_t* dst, size_t pixels) {
+    if (src_bpp == 3) {
+        (dst_bpp == 3 ? ConvertRgb888ToRgb666 : ConvertRgb888ToRgb565)(src, dst, pixels);
+    } else {
+        (dst_bpp == 3 ? ConvertRgba8888ToRgb666 : ConvertRgba8888ToRgb565)(src, dst, pixels);
+    }
+}
+
+void CheckConversions(const char* level) {
+    // Every tail length of the SIMD loops, plus sizes large enough to be
+    // split across the worker pool.
+    std::vector<size_t> counts;
+    for (size_t n = 0; n <= 70; ++n) {
+        counts.push_back(n);
+    }
+    counts.push_back(333);
+    counts.push_back(kParallelMinPixels + 17);
+    counts.push_back(320 * 480);
+
+    for (size_t src_bpp : {3U, 4U}) {
+        for (size_t dst_bpp : {3U, 2U}) {
+            for (size_t pixels : counts) {
+                std::vector<uint8_t> src(pixels * src_bpp + 1);
+                test::FillPattern(src, static_cast<uint32_t>(pixels + src_bpp * 7 + dst_bpp));
+                std::vector<uint8_t> expected(pixels * dst_bpp + 1, 0xA5);
+                std::vector<uint8_t> actual(pixels * dst_bpp + 1, 0xA5);
+                ReferenceConvert(src.data(), src_bpp, expected.data(), dst_bpp, pixels);
+                Convert(src_bpp, dst_bpp, src.data(), actual.data(), pixels);
+                CHECK_MSG(expected == actual, "%s convert %zu->%zu bpp, %zu pixels", level, src_bpp, dst_bpp,
+                          pixels);
+            }
+        }
+    }
+}
+
+void CheckCompose(const char* level) {
+    struct Case {
+        uint32_t width;
+        uint32_t height;
+    };
+    const Case sizes[] = {{37, 53}, {64, 17}, {320, 480}, {480, 320}};
+    const uint8_t overlay_pixels[5 * 3 * 3] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60};
+
+    for (const Case& size : sizes) {
+        const size_t pixels = static_cast<size_t>(size.width) * size.height;
+        for (SourceFormat format : {SourceFormat::Output, SourceFormat::Rgb888, SourceFormat::Rgba8888}) {
+            for (size_t bpp : {3U, 2U}) {
+                const size_t src_bpp = format == SourceFormat::Output ? bpp
+                                       : format == SourceFormat::Rgb888 ? 3U
+                                                                        : 4U;
+                std::vector<uint8_t> src(pixels * src_bpp);
+                test::FillPattern(src, size.width * 31U + static_cast<uint32_t>(src_bpp));
+
+                std::vector<uint8_t> converted(pixels * bpp);
+                if (format == SourceFormat::Output) {
+                    converted = src;
+                } else {
+                    ReferenceConvert(src.data(), src_bpp, converted.data(), bpp, pixels);
+                }
+                Overlay overlay {3, 2, 5, 3, overlay_pixels};
+                for (uint32_t y = 0; y < overlay.height; ++y) {
+                    std::memcpy(converted.data() + ((overlay.y + y) * size.width + overlay.x) * bpp,
+                                overlay_pixels + y * overlay.width * bpp, overlay.width * bpp);
+                }
+
+                for (int rotation : {0, 90, 180, 270}) {
+                    std::vector<uint8_t> expected(pixels * bpp);
+                    test::NaiveRotate(converted.data(), expected.data(), size.width, size.height, bpp, rotation);
+                    std::vector<uint8_t> actual(pixels * bpp);
+                    CHECK(ComposeFrame(src.data(), format, 0, actual.data(), size.width, size.height, bpp, rotation,
+                                       &overlay));
+                    CHECK_MSG(expected == actual, "%s compose format %d, %u bpp, %ux%u, %d degrees", level,
+                              static_cast<int>(format), static_cast<unsigned>(bpp), size.width, size.height,
+                              rotation);
+                }
+            }
+        }
+    }
+}
+
+}
+
+int main() {
+    const SimdLevel active = ActiveSimdLevel();
+    ili9488::WorkerPool pool(3);
+    for (SimdLevel level : test::SupportedLevels()) {
+        SelectSimdLevel(level);
+        for (bool threaded : {false, true}) {
+            SetWorkerPool(threaded ? &pool : nullptr);
+            CheckConversions(SimdLevelName(level));
+            CheckCompose(SimdLevelName(level));
+        }
+        SetWorkerPool(nullptr);
+    }
+    SelectSimdLevel(active);
+    return test::Finish("test_pixel_accuracy");
+}
@@ -0,0 +1,176 @@
+#include "ili9488_dma.h"
+#include "panel_simulator.h"
+#include "spi_dma_linux.h"
+
+#include "test_common.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ili9488;
+
+namespace {
+
+constexpr uint32_t kWidth = kPanelNativeWidth;
+constexpr uint32_t kHeight = kPanelNativeHeight;
+constexpr size_t kBpp = 3;
+
+using Clock = std::chrono::steady_clock;
+
+long long ElapsedMs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// A simulator-backed driver that paces like the real bus, so a full frame
+// stays in flight for about 57 ms.
+DisplayConfig PacedConfig() {
+    DisplayConfig config {};
+    config.width = kWidth;
+    config.height = kHeight;
+    config.bus_backend = BusBackend::Simulator;
+    config.simulator_realtime = true;
+    config.rotation = Rotation::Deg0;
+    config.use_gpu_mailbox = false;
+    config.dc_gpio = -1;
+    config.reset_gpio = -1;
+    return config;
+}
+
+void CheckZeroDamage(ILI9488Driver& driver, const std::vector<uint8_t>& frame) {
+    SimulatorBus* simulator = driver.getSimulator();
+    driver.waitFence(driver.lastPresentedFence());
+    const uint64_t wire_before = simulator->wireTimeNs();
+    const uint64_t writes_before = simulator->snapshot().stats().memory_writes;
+
+    // No rects, whether passed as nullptr or an empty vector's data(), sends
+    // nothing; the fences still signal.
+    const std::vector<Rect> none;
+    const uint64_t a = driver.presentRegionsAsync(frame.data(), kWidth * kBpp, nullptr, 0);
+    const uint64_t b = driver.presentRegionsAsync(frame.data(), kWidth * kBpp, none.data(), none.size());
+    CHECK(b == a + 1);
+    CHECK(driver.waitFence(b, 1000));
+    CHECK_MSG(simulator->wireTimeNs() == wire_before, "zero damage put %llu ns on the wire",
+              static_cast<unsigned long long>(simulator->wireTimeNs() - wire_before));
+    CHECK(simulator->snapshot().stats().memory_writes == writes_before);
+
+    // One small rect sends far less than a frame.
+    const Rect rect {10, 20, 8, 8};
+    CHECK(driver.waitFence(driver.presentRegionsAsync(frame.data(), kWidth * kBpp, &rect, 1), 1000));
+    const uint64_t rect_ns = simulator->wireTimeNs() - wire_before;
+    CHECK(rect_ns > 0 && rect_ns < 2000000);
+}
+
+// Fences are handed out in order, signal in order, and the completion
+// callback sees them in order.
+void CheckOrdering(ILI9488Driver& driver, const std::vector<uint8_t>& frame) {
+    std::mutex mutex;
+    std::vector<uint64_t> completed;
+    driver.setPresentCallback([&](uint64_t fence, uint32_t, bool ok) {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed.push_back(ok ? fence : 0);
+    });
+
+    std::vector<uint64_t> fences;
+    for (uint32_t i = 0; i < 5; ++i) {
+        fences.push_back(i % 2 == 0 ? driver.presentAsync(frame.data(), i)
+                                    : driver.presentRegionsAsync(frame.data(), kWidth * kBpp, nullptr, 0, i));
+        CHECK(driver.lastPresentedFence() == fences.back());
+    }
+    for (size_t i = 1; i < fences.size(); ++i) {
+        CHECK(fences[i] == fences[i - 1] + 1);
+    }
+
+    // Whenever a fence is signaled, every earlier one is too.
+    bool ordered = true;
+    while (!driver.fenceSignaled(fences.back())) {
+        for (size_t i = fences.size(); i-- > 1;) {
+            if (driver.fenceSignaled(fences[i]) && !driver.fenceSignaled(fences[i - 1])) {
+                ordered = false;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    CHECK(ordered);
+
+    driver.setPresentCallback(nullptr);
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(completed == fences);
+}
+
+void CheckWaitTimeout(ILI9488Driver& driver, const std::vector<uint8_t>& frame) {
+    driver.waitFence(driver.lastPresentedFence());
+
+    // Three full frames are ~170 ms of wire time, so a short wait on the
+    // last one times out and an unbounded one succeeds.
+    uint64_t fence = 0;
+    for (int i = 0; i < 3; ++i) {
+        fence = driver.presentAsync(frame.data());
+    }
+    Clock::time_point start = Clock::now();
+    CHECK(!driver.waitFence(fence, 5));
+    CHECK(ElapsedMs(start) < 100);
+    CHECK(!driver.fenceSignaled(fence));
+    CHECK(driver.waitFence(fence, 5000));
+    CHECK(driver.fenceSignaled(fence));
+    CHECK(driver.waitFence(fence));
+
+    // A fence that was never submitted waits out the whole timeout.
+    start = Clock::now();
+    CHECK(!driver.waitFence(fence + 10, 30));
+    CHECK(ElapsedMs(start) >= 25);
+}
+
+// The fence words mirrored into the SHM header: submitted moves at queue
+// time, completed follows it up without ever passing it.
+void CheckMirroredFences(ILI9488Driver& driver, const std::vector<uint8_t>& frame) {
+    driver.waitFence(driver.lastPresentedFence());
+    volatile uint32_t submitted = 0;
+    volatile uint32_t completed = 0;
+    driver.mirrorFences(&submitted, &completed);
+
+    uint64_t fence = 0;
+    for (int i = 0; i < 2; ++i) {
+        fence = driver.presentAsync(frame.data());
+        CHECK(__atomic_load_n(&submitted, __ATOMIC_ACQUIRE) == static_cast<uint32_t>(fence));
+    }
+    uint32_t last_completed = 0;
+    bool monotonic = true;
+    bool ahead = false;
+    while (!driver.fenceSignaled(fence)) {
+        const uint32_t now = __atomic_load_n(&completed, __ATOMIC_ACQUIRE);
+        monotonic = monotonic && now >= last_completed;
+        ahead = ahead || now > __atomic_load_n(&submitted, __ATOMIC_ACQUIRE);
+        last_completed = now;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    CHECK(monotonic);
+    CHECK(!ahead);
+    CHECK(__atomic_load_n(&completed, __ATOMIC_ACQUIRE) == static_cast<uint32_t>(fence));
+
+    // Zero-damage presents advance both words too.
+    fence = driver.presentRegionsAsync(frame.data(), kWidth * kBpp, nullptr, 0);
+    CHECK(driver.waitFence(fence, 1000));
+    CHECK(__atomic_load_n(&submitted, __ATOMIC_ACQUIRE) == static_cast<uint32_t>(fence));
+    CHECK(__atomic_load_n(&completed, __ATOMIC_ACQUIRE) == static_cast<uint32_t>(fence));
+    driver.mirrorFences(nullptr, nullptr);
+}
+
+}
+
+int main() {
+    ILI9488Driver driver(PacedConfig());
+    if (!driver.initialize() || driver.getSimulator() == nullptr) {
+        CHECK_MSG(false, "driver init failed");
+        return test::Finish("test_present_fences");
+    }
+    std::vector<uint8_t> frame(static_cast<size_t>(kWidth) * kHeight * kBpp);
+    test::FillPattern(frame, 8);
+
+    CheckZeroDamage(driver, frame);
+    CheckOrdering(driver, frame);
+    CheckWaitTimeout(driver, frame);
+    CheckMirroredFences(driver, frame);
+    return test::Finish("test_present_fences");
+}
@@ -0,0 +1,61 @@
+#include "pixel_utils.h"
+#include "worker_pool.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+using namespace ili9488::pixel;
+
+int main() {
+    struct Case {
+        uint32_t width;
+        uint32_t height;
+    };
+    // Sizes below, at and around the 8x8 transpose block, odd in either
+    // direction, the fixed 320x480/480x320 kernels, and frames large enough
+    // to be split across the worker pool.
+    const Case sizes[] = {
+        {1, 1},    {1, 9},    {9, 1},     {7, 7},     {8, 8},     {9, 9},      {16, 3},     {37, 53},
+        {64, 17},  {17, 64},  {33, 480},  {480, 33},  {200, 177}, {177, 200},  {320, 480},  {480, 320},
+    };
+
+    const SimdLevel active = ActiveSimdLevel();
+    const std::vector<SimdLevel> levels = test::SupportedLevels();
+    ili9488::WorkerPool pool(3);
+
+    for (const Case& size : sizes) {
+        for (size_t bpp : {3U, 2U}) {
+            const size_t frame_bytes = static_cast<size_t>(size.width) * size.height * bpp;
+            std::vector<uint8_t> src(frame_bytes);
+            test::FillPattern(src, size.width * 977U + size.height * 3U + static_cast<uint32_t>(bpp));
+
+            for (int rotation : {0, 90, 180, 270}) {
+                std::vector<uint8_t> expected(frame_bytes);
+                test::NaiveRotate(src.data(), expected.data(), size.width, size.height, bpp, rotation);
+
+                SelectSimdLevel(SimdLevel::Scalar);
+                SetWorkerPool(nullptr);
+                std::vector<uint8_t> scalar(frame_bytes, 0xA5);
+                RotateFrame(src.data(), scalar.data(), size.width, size.height, bpp, rotation);
+                CHECK_MSG(scalar == expected, "scalar %ux%u, %zu bpp, %d degrees", size.width, size.height, bpp,
+                          rotation);
+
+                for (SimdLevel level : levels) {
+                    SelectSimdLevel(level);
+                    for (bool threaded : {false, true}) {
+                        SetWorkerPool(threaded ? &pool : nullptr);
+                        std::vector<uint8_t> actual(frame_bytes, 0xA5);
+                        RotateFrame(src.data(), actual.data(), size.width, size.height, bpp, rotation);
+                        CHECK_MSG(actual == scalar, "%s%s %ux%u, %zu bpp, %d degrees", SimdLevelName(level),
+                                  threaded ? " threaded" : "", size.width, size.height, bpp, rotation);
+                    }
+                }
+            }
+        }
+    }
+
+    SetWorkerPool(nullptr);
+    SelectSimdLevel(active);
+    return test::Finish("test_rotate_simd");
+}
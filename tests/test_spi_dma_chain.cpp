@@ -0,0 +1,83 @@
+#include "spi_dma_chain.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+using namespace ili9488;
+using namespace ili9488::spidma;
+
+namespace {
+
+void CheckSegmentMath() {
+    CHECK(SegmentCount(0) == 0);
+    CHECK(SegmentCount(4) == 1);
+    CHECK(SegmentCount(kMaxSegmentBytes) == 1);
+    CHECK(SegmentCount(kMaxSegmentBytes + 4) == 2);
+    CHECK(SegmentCount(2 * kMaxSegmentBytes) == 2);
+    CHECK(SegmentCount(2 * kMaxSegmentBytes + 4) == 3);
+    CHECK(ChainBytes(0) == 0);
+    CHECK(ChainBytes(2 * kMaxSegmentBytes) > ChainBytes(kMaxSegmentBytes));
+    // DLEN is 16 bits and each segment is word aligned.
+    CHECK(kMaxSegmentBytes <= 0xFFFF && kMaxSegmentBytes % 4 == 0);
+}
+
+void CheckBuildRejects() {
+    constexpr uint32_t kCbBusAddr = 0x00100000;
+    const ChainConfig config {5, 4, 0};
+    std::vector<DmaControlBlock> cbs(64);
+    const size_t size = cbs.size() * sizeof(DmaControlBlock);
+    Chain chain;
+
+    CHECK(BuildChain(cbs.data(), kCbBusAddr, size, 0x01000000, 4096, config, &chain));
+    CHECK(chain.segments == 1);
+    CHECK(chain.tx_cb_bus_addr != chain.rx_cb_bus_addr);
+    CHECK(chain.completion_offset + sizeof(uint32_t) <= ChainBytes(4096));
+
+    CHECK(!BuildChain(cbs.data(), kCbBusAddr, size, 0x01000000, 0, config, &chain));
+    CHECK(!BuildChain(cbs.data(), kCbBusAddr, size, 0x01000000, 4098, config, &chain));
+    CHECK(!BuildChain(cbs.data(), kCbBusAddr + 4, size, 0x01000000, 4096, config, &chain));
+    CHECK(!BuildChain(cbs.data(), kCbBusAddr, ChainBytes(4096) - 4, 0x01000000, 4096, config, &chain));
+    CHECK(!BuildChain(nullptr, kCbBusAddr, size, 0x01000000, 4096, config, &chain));
+}
+
+// Runs the chain through the register model and checks the bytes clocked
+// out match the source exactly, segment boundaries included.
+void CheckTransfers() {
+    const size_t lengths[] = {
+        4,
+        8,
+        kMaxSegmentBytes - 4,
+        kMaxSegmentBytes,
+        kMaxSegmentBytes + 4,
+        65536,
+        2 * kMaxSegmentBytes - 4,
+        2 * kMaxSegmentBytes,
+        2 * kMaxSegmentBytes + 4,
+        131072,
+        3 * kMaxSegmentBytes,
+        320 * 480 * 2,
+        320 * 480 * 3,
+    };
+    for (size_t length : lengths) {
+        std::vector<uint8_t> src(length);
+        test::FillPattern(src, static_cast<uint32_t>(length));
+        std::vector<uint8_t> wire;
+        ModelStats stats;
+        CHECK_MSG(SimulateTransfer(src.data(), length, &wire, &stats), "transfer of %zu bytes failed", length);
+        CHECK_MSG(wire == src, "wire bytes differ for %zu bytes (got %zu)", length, wire.size());
+        CHECK_MSG(stats.segments == SegmentCount(length), "%zu bytes took %zu segments", length, stats.segments);
+    }
+
+    std::vector<uint8_t> odd(6);
+    CHECK(!SimulateTransfer(odd.data(), odd.size(), nullptr));
+}
+
+}
+
+int main() {
+    CheckSegmentMath();
+    CheckBuildRejects();
+    CheckTransfers();
+    return test::Finish("test_spi_dma_chain");
+}
@@ -0,0 +1,176 @@
+#include "panel_simulator.h"
+#include "spi_dma_linux.h"
+
+#include "test_panel.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace ili9488;
+
+namespace {
+
+constexpr uint32_t kWidth = kPanelNativeWidth;
+constexpr uint32_t kHeight = kPanelNativeHeight;
+
+uint32_t Next(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Random damage: scattered rects (some overlapping, some running past the
+// frame edge), pairs that touch along an edge, DamageTracker-like tiles, and
+// columns and rows sharing a window axis so the CASET/PASET skip is used.
+std::vector<Rect> RandomRects(uint32_t& state) {
+    std::vector<Rect> rects;
+    const uint32_t scattered = 1 + Next(state) % 12;
+    for (uint32_t i = 0; i < scattered; ++i) {
+        const uint32_t x = Next(state) % kWidth;
+        const uint32_t y = Next(state) % kHeight;
+        rects.push_back({x, y, 1 + Next(state) % 90, 1 + Next(state) % 90});
+    }
+    const uint32_t x = Next(state) % (kWidth - 40);
+    const uint32_t y = Next(state) % (kHeight - 40);
+    rects.push_back({x, y, 20, 17});
+    rects.push_back({x + 20, y, 13, 17});
+    rects.push_back({x, y + 17, 33, 5});
+    for (uint32_t t = 0; t < Next(state) % 20; ++t) {
+        rects.push_back({(Next(state) % 20) * 16, (Next(state) % 30) * 16, 16, 16});
+    }
+    rects.push_back({x, (y + 200) % kHeight, 11, 3});
+    rects.push_back({x, (y + 300) % kHeight, 11, 9});
+    rects.push_back({(x + 100) % kWidth, y, 7, 17});
+    rects.push_back({0, 0, 0, 5});
+    return rects;
+}
+
+// New noise inside the rect, as a client redrawing only its damage.
+void Damage(std::vector<uint8_t>& frame, size_t stride, const Rect& rect, size_t bpp, uint32_t& state) {
+    const uint32_t x1 = std::min(kWidth, rect.x + rect.width);
+    const uint32_t y1 = std::min(kHeight, rect.y + rect.height);
+    for (uint32_t y = rect.y; y < y1; ++y) {
+        for (size_t i = rect.x * bpp; i < x1 * bpp; ++i) {
+            frame[y * stride + i] = static_cast<uint8_t>(Next(state) >> 11);
+        }
+    }
+}
+
+void CheckRegions(size_t bpp, bool batch, bool padded) {
+    auto bus = std::make_unique<SimulatorBus>();
+    SimulatorBus* simulator = bus.get();
+    ILI9488Transport transport;
+    if (!transport.initialize(test::PanelSpiConfig(bpp, 0, false, batch), std::move(bus))) {
+        CHECK_MSG(false, "transport init failed");
+        return;
+    }
+
+    const size_t row_bytes = kWidth * bpp;
+    const size_t stride = padded ? row_bytes + 24 : row_bytes;
+    std::vector<uint8_t> frame(stride * kHeight);
+    test::FillPattern(frame, static_cast<uint32_t>(bpp * 10 + batch));
+    CHECK(transport.transferRegion(frame.data(), stride, 0, 0, kWidth, kHeight));
+
+    // Coalescing may send the pixels between damaged rects too; they are
+    // unchanged, so the panel must match the whole frame after every round.
+    uint32_t state = static_cast<uint32_t>(bpp * 7919 + batch * 13 + padded) | 1U;
+    for (int round = 0; round < 12; ++round) {
+        const std::vector<Rect> rects = RandomRects(state);
+        for (const Rect& rect : rects) {
+            Damage(frame, stride, rect, bpp, state);
+        }
+        CHECK(transport.transferRegions(frame.data(), stride, rects.data(), rects.size()));
+        const size_t mismatches = test::PanelMismatches(simulator->snapshot(), frame.data(), stride, bpp);
+        CHECK_MSG(mismatches == 0, "%zu pixels differ: %zu bpp, batch %d, stride %zu, round %d", mismatches, bpp,
+                  batch, stride, round);
+    }
+    CHECK(simulator->snapshot().stats().clipped_pixels == 0);
+}
+
+// Batching skips CASET or PASET when that axis of the window is unchanged.
+void CheckWindowCache(bool batch) {
+    auto bus = std::make_unique<SimulatorBus>();
+    SimulatorBus* simulator = bus.get();
+    ILI9488Transport transport;
+    if (!transport.initialize(test::PanelSpiConfig(3, 0, false, batch), std::move(bus))) {
+        CHECK_MSG(false, "transport init failed");
+        return;
+    }
+    std::vector<uint8_t> frame(kWidth * 3 * kHeight);
+    test::FillPattern(frame, 3);
+    const size_t stride = kWidth * 3;
+
+    CHECK(transport.transferRegion(frame.data(), stride, 10, 10, 20, 20));
+    uint64_t before = simulator->snapshot().stats().commands;
+    CHECK(transport.transferRegion(frame.data(), stride, 10, 100, 20, 20));
+    const uint64_t same_columns = simulator->snapshot().stats().commands - before;
+    before = simulator->snapshot().stats().commands;
+    CHECK(transport.transferRegion(frame.data(), stride, 50, 100, 20, 20));
+    const uint64_t same_pages = simulator->snapshot().stats().commands - before;
+    before = simulator->snapshot().stats().commands;
+    CHECK(transport.transferRegion(frame.data(), stride, 50, 100, 20, 20));
+    const uint64_t same_window = simulator->snapshot().stats().commands - before;
+
+    CHECK_MSG(same_columns == (batch ? 2U : 3U), "same columns sent %llu commands",
+              static_cast<unsigned long long>(same_columns));
+    CHECK_MSG(same_pages == (batch ? 2U : 3U), "same pages sent %llu commands",
+              static_cast<unsigned long long>(same_pages));
+    CHECK_MSG(same_window == (batch ? 1U : 3U), "same window sent %llu commands",
+              static_cast<unsigned long long>(same_window));
+}
+
+void CheckCoalesce() {
+    // Touching tiles become one rect.
+    std::vector<Rect> rects = {{16, 0, 16, 16}, {0, 0, 16, 16}, {0, 16, 32, 16}};
+    CoalesceRects(rects, kRegionOverheadBytes / 3);
+    CHECK(rects.size() == 1 && rects[0].x == 0 && rects[0].y == 0 && rects[0].width == 32 && rects[0].height == 32);
+
+    // Far-apart rects stay separate and come back sorted by y, then x.
+    rects = {{300, 400, 4, 4}, {0, 0, 4, 4}, {200, 0, 4, 4}};
+    CoalesceRects(rects, kRegionOverheadBytes / 3);
+    CHECK(rects.size() == 3 && rects[0].x == 0 && rects[1].x == 200 && rects[2].y == 400);
+
+    // The output covers every input pixel, for large tile lists too.
+    uint32_t state = 12345;
+    for (int round = 0; round < 20; ++round) {
+        std::vector<Rect> input;
+        for (int i = 0; i < 150 + round * 50; ++i) {
+            input.push_back({(Next(state) % 20) * 16, (Next(state) % 30) * 16, 16, 16});
+        }
+        rects = input;
+        CoalesceRects(rects, kRegionOverheadBytes / 3);
+        std::vector<uint8_t> covered(kWidth * kHeight, 0);
+        for (const Rect& r : rects) {
+            for (uint32_t y = r.y; y < r.y + r.height; ++y) {
+                std::fill_n(covered.begin() + y * kWidth + r.x, r.width, 1);
+            }
+        }
+        size_t missing = 0;
+        for (const Rect& r : input) {
+            for (uint32_t y = r.y; y < r.y + r.height; ++y) {
+                missing += static_cast<size_t>(std::count(covered.begin() + y * kWidth + r.x,
+                                                          covered.begin() + y * kWidth + r.x + r.width, 0));
+            }
+        }
+        CHECK_MSG(missing == 0, "%zu damaged pixels not covered", missing);
+        CHECK(rects.size() <= input.size());
+    }
+}
+
+}
+
+int main() {
+    for (size_t bpp : {3U, 2U}) {
+        for (bool batch : {true, false}) {
+            for (bool padded : {false, true}) {
+                CheckRegions(bpp, batch, padded);
+            }
+        }
+    }
+    CheckWindowCache(true);
+    CheckWindowCache(false);
+    CheckCoalesce();
+    return test::Finish("test_transfer_regions");
+}
@@ -0,0 +1,220 @@
+#include "triple_buffer_protocol.h"
+
+#include "test_common.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ili9488;
+
+namespace {
+
+constexpr uint32_t kFrames = 200000;
+constexpr size_t kSlotWords = 64;
+
+using Clock = std::chrono::steady_clock;
+
+long long ElapsedMs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+bool Readable(int fd, int timeout_ms) {
+    pollfd pfd {fd, POLLIN, 0};
+    return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN) != 0;
+}
+
+std::unique_ptr<TripleBufferControlV2> MakeControl() {
+    auto control = std::make_unique<TripleBufferControlV2>();
+    shm::InitializeControl(control.get());
+    return control;
+}
+
+// A producer and a consumer hammer one control block. Each slot carries a
+// user count that must go 0 -> 1 when a side takes it, so the producer,
+// consumer and published slots can never alias, and the frame it holds must
+// be the whole frame of the sequence the consumer was told about.
+void CheckProducerConsumer() {
+    auto control = MakeControl();
+    std::vector<uint32_t> slots[3];
+    for (auto& slot : slots) {
+        slot.assign(kSlotWords, 0);
+    }
+    std::atomic<int> users[3] = {};
+    std::atomic<bool> producer_done {false};
+    std::atomic<uint64_t> aliased {0};
+    std::atomic<uint64_t> torn {0};
+    std::atomic<uint64_t> backwards {0};
+
+    std::thread producer([&] {
+        uint32_t slot = __atomic_load_n(&control->producer_slot, __ATOMIC_RELAXED);
+        for (uint32_t frame = 1; frame <= kFrames; ++frame) {
+            if (users[slot].fetch_add(1) != 0) {
+                ++aliased;
+            }
+            for (uint32_t& word : slots[slot]) {
+                word = frame;
+            }
+            users[slot].fetch_sub(1);
+            slot = shm::PublishFrame(control.get());
+        }
+        producer_done.store(true);
+    });
+
+    std::thread consumer([&] {
+        uint32_t held = __atomic_load_n(&control->consumer_slot, __ATOMIC_RELAXED);
+        users[held].fetch_add(1);
+        uint32_t last_sequence = 0;
+        for (;;) {
+            const bool done = producer_done.load();
+            shm::WaitForFrame(control.get(), 1000);
+            users[held].fetch_sub(1);
+            uint32_t slot = 0;
+            uint32_t sequence = 0;
+            if (!shm::AcquireFrame(control.get(), &slot, &sequence)) {
+                users[held].fetch_add(1);
+                if (done) {
+                    break;
+                }
+                continue;
+            }
+            held = slot;
+            if (users[held].fetch_add(1) != 0) {
+                ++aliased;
+            }
+            if (sequence <= last_sequence) {
+                ++backwards;
+            }
+            last_sequence = sequence;
+            for (uint32_t word : slots[held]) {
+                if (word != sequence) {
+                    ++torn;
+                    break;
+                }
+            }
+        }
+        users[held].fetch_sub(1);
+    });
+
+    producer.join();
+    consumer.join();
+
+    const uint64_t published = __atomic_load_n(&control->frames_published, __ATOMIC_RELAXED);
+    const uint64_t dropped = __atomic_load_n(&control->frames_dropped, __ATOMIC_RELAXED);
+    const uint64_t consumed = __atomic_load_n(&control->frames_consumed, __ATOMIC_RELAXED);
+    CHECK_MSG(aliased.load() == 0, "%llu slots taken by two sides at once",
+              static_cast<unsigned long long>(aliased.load()));
+    CHECK_MSG(torn.load() == 0, "%llu frames did not match their sequence",
+              static_cast<unsigned long long>(torn.load()));
+    CHECK_MSG(backwards.load() == 0, "%llu sequences went backwards",
+              static_cast<unsigned long long>(backwards.load()));
+    CHECK(published == kFrames);
+    CHECK(consumed > 0);
+    CHECK_MSG(dropped + consumed == published, "dropped %llu + consumed %llu != published %llu",
+              static_cast<unsigned long long>(dropped), static_cast<unsigned long long>(consumed),
+              static_cast<unsigned long long>(published));
+
+    const uint32_t state = __atomic_load_n(&control->state, __ATOMIC_RELAXED);
+    CHECK(!shm::StateDirty(state) && shm::StateSequence(state) == kFrames);
+    const uint32_t producer_slot = __atomic_load_n(&control->producer_slot, __ATOMIC_RELAXED);
+    const uint32_t consumer_slot = __atomic_load_n(&control->consumer_slot, __ATOMIC_RELAXED);
+    CHECK(producer_slot != consumer_slot && producer_slot != shm::StateSlot(state) &&
+          consumer_slot != shm::StateSlot(state));
+}
+
+void CheckWaitForFrame() {
+    auto control = MakeControl();
+
+    // Nothing published: the wait times out.
+    Clock::time_point start = Clock::now();
+    CHECK(!shm::WaitForFrame(control.get(), 20000));
+    const long long waited = ElapsedMs(start);
+    CHECK_MSG(waited >= 15 && waited < 1000, "20 ms wait took %lld ms", waited);
+    CHECK(__atomic_load_n(&control->consumer_waiting, __ATOMIC_RELAXED) == 0);
+
+    // A publish from another thread ends the wait early.
+    std::thread producer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        shm::PublishFrame(control.get());
+    });
+    start = Clock::now();
+    const bool woke = shm::WaitForFrame(control.get(), 5000000);
+    producer.join();
+    CHECK(woke);
+    CHECK_MSG(ElapsedMs(start) < 1000, "publish did not wake the waiter");
+
+    // A pending frame returns at once.
+    start = Clock::now();
+    CHECK(shm::WaitForFrame(control.get(), 5000000));
+    CHECK(ElapsedMs(start) < 100);
+    uint32_t sequence = 0;
+    CHECK(shm::AcquireFrame(control.get(), nullptr, &sequence) && sequence == 1);
+    CHECK(!shm::AcquireFrame(control.get(), nullptr));
+}
+
+void CheckNotifier() {
+    auto control = MakeControl();
+    shm::FrameNotifier notifier;
+    CHECK(notifier.start(control.get()));
+    CHECK(!Readable(notifier.fd(), 50));
+
+    shm::PublishFrame(control.get());
+    CHECK(Readable(notifier.fd(), 1000));
+    notifier.drain();
+    CHECK(!Readable(notifier.fd(), 0));
+    CHECK(shm::AcquireFrame(control.get(), nullptr));
+
+    shm::PublishFrame(control.get());
+    CHECK(Readable(notifier.fd(), 1000));
+    notifier.drain();
+
+    Clock::time_point start = Clock::now();
+    notifier.stop();
+    CHECK_MSG(ElapsedMs(start) < 500, "stop() took %lld ms", ElapsedMs(start));
+    CHECK(notifier.fd() < 0);
+    CHECK(__atomic_load_n(&control->consumer_waiting, __ATOMIC_RELAXED) == 0);
+
+    // A frame already pending at start() is reported straight away.
+    CHECK(notifier.start(control.get()));
+    CHECK(Readable(notifier.fd(), 1000));
+    notifier.stop();
+
+    // stop() right after start(), before or while the helper enters its
+    // FUTEX_WAIT, and with a producer racing it, must never hang.
+    std::atomic<bool> publishing {true};
+    std::thread producer([&] {
+        while (publishing.load()) {
+            shm::PublishFrame(control.get());
+            shm::AcquireFrame(control.get(), nullptr);
+        }
+    });
+    long long slowest = 0;
+    for (int i = 0; i < 300; ++i) {
+        CHECK(notifier.start(control.get()));
+        if (i % 3 == 1) {
+            std::this_thread::yield();
+        } else if (i % 3 == 2) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        start = Clock::now();
+        notifier.stop();
+        slowest = std::max(slowest, ElapsedMs(start));
+    }
+    publishing.store(false);
+    producer.join();
+    CHECK_MSG(slowest < 500, "slowest stop() took %lld ms", slowest);
+}
+
+}
+
+int main() {
+    CheckProducerConsumer();
+    CheckWaitForFrame();
+    CheckNotifier();
+    return test::Finish("test_triple_buffer");
+}